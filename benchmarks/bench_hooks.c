@@ -0,0 +1,26 @@
+/**
+ * @file bench_hooks.c
+ * @brief Internal stages of a sampling tick, see bench_hooks.h
+ * @author Qi Deng<dengqi935@gmail.com>
+ */
+
+/* The static functions of the library are only reachable from its own translation unit */
+#include "../src/jetpwmon.c"
+#include "bench_hooks.h"
+
+void bench_read_rails(pm_handle_t handle)
+{
+        for (int i = 0; i < handle->backend_count; i++)
+        {
+                handle->backends[i].ops->read(handle, &handle->backends[i]);
+        }
+}
+
+pm_error_t bench_update_statistics(pm_handle_t handle, uint64_t timestamp_ns)
+{
+        pthread_mutex_lock(&handle->data_mutex);
+        handle->last_sample_ns = timestamp_ns;
+        pm_error_t error = update_statistics(handle);
+        pthread_mutex_unlock(&handle->data_mutex);
+        return error;
+}
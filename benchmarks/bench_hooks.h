@@ -0,0 +1,40 @@
+/**
+ * @file bench_hooks.h
+ * @brief Access to the internal stages of a sampling tick for the benchmarks
+ * @author Qi Deng<dengqi935@gmail.com>
+ *
+ * bench_hooks.c compiles the library source together with these functions,
+ * so a benchmark linking it must not link jetpwmon_static as well. Call them
+ * only while the handle is not sampling, after pm_sample_now() has opened the
+ * sensor files.
+ */
+
+#ifndef JETPWMON_BENCH_HOOKS_H
+#define JETPWMON_BENCH_HOOKS_H
+
+#include <stdint.h>
+#include "jetpwmon/jetpwmon.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Read the raw values of every rail, the first stage of a tick
+ * @param handle Handle that is not sampling
+ */
+void bench_read_rails(pm_handle_t handle);
+
+/**
+ * @brief Fold the latest readings into the statistics as a tick at a given time
+ * @param handle Handle that is not sampling
+ * @param timestamp_ns Monotonic time of the tick, increasing between calls
+ * @return Error code
+ */
+pm_error_t bench_update_statistics(pm_handle_t handle, uint64_t timestamp_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JETPWMON_BENCH_HOOKS_H */
@@ -0,0 +1,54 @@
+/**
+ * @file bench_io_backends.cpp
+ * @brief Per-tick read latency of the stdio, pread and io_uring backends
+ *
+ * Builds a synthetic INA3221 hwmon tree in a temporary directory, points the
+ * library at it through pm_config_t.sysfs_root and times pm_sample_now().
+ */
+
+#include <benchmark/benchmark.h>
+#include <jetpwmon/jetpwmon.h>
+#include <string>
+#include "bench_tree.h"
+
+namespace {
+
+void BM_SampleTick(benchmark::State& state, pm_io_backend_t backend) {
+    const int rails = static_cast<int>(state.range(0));
+    std::string root = bench::MakeSyntheticTree(rails);
+    pm_config_t config = {};
+    config.sysfs_root = root.c_str();
+
+    pm_handle_t handle = nullptr;
+    if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed on the synthetic tree");
+        bench::RemoveTree(root);
+        return;
+    }
+
+    pm_io_backend_t active = backend;
+    pm_set_io_backend(handle, backend);
+    pm_sample_now(handle);
+    pm_get_io_backend(handle, &active);
+    if (active != backend) {
+        state.SkipWithError("Requested I/O backend is not available");
+    }
+
+    for (auto _ : state) {
+        pm_sample_now(handle);
+    }
+
+    state.counters["rails"] = rails;
+    state.counters["per_rail"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * rails,
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    pm_cleanup(handle);
+    bench::RemoveTree(root);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_SampleTick, stdio, PM_IO_BACKEND_STDIO)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_SampleTick, pread, PM_IO_BACKEND_PREAD)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_SampleTick, io_uring, PM_IO_BACKEND_IO_URING)->Arg(3)->Arg(12)->Arg(48);
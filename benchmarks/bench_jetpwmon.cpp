@@ -0,0 +1,348 @@
+/**
+ * @file bench_jetpwmon.cpp
+ * @brief Discovery, per-tick and snapshot costs of the library
+ *
+ * - Discovery: pm_init_config() on synthetic trees of growing size, with and
+ *   without the discovery cache, and on the simulated boards of sysfs_sim.h
+ * - Per tick: the raw reads of every rail, update_statistics() and the whole
+ *   pm_sample_now(), each reported per rail
+ * - Readers: pm_get_latest_data(), pm_get_statistics() and their caller-buffer
+ *   variants from 1 to 16 threads while the sampler runs
+ * - C++: the PowerData deep copy and PowerMonitor::getLatestData()
+ *
+ * Run with --benchmark_out=<file> --benchmark_out_format=json (or build the
+ * run_benchmarks target) to keep the results for comparison between releases.
+ */
+
+#include <benchmark/benchmark.h>
+#include <jetpwmon/jetpwmon.h>
+#include <jetpwmon/jetpwmon++.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench_hooks.h"
+#include "bench_tree.h"
+#include "sysfs_sim.h"
+
+namespace {
+
+// Rails of the handle shared by the reader benchmarks
+constexpr int kReaderRails = 16;
+
+// Sampling rate of that handle while the readers run
+constexpr int kReaderSamplingHz = 1000;
+
+// Period between the ticks fed to update_statistics()
+constexpr uint64_t kTickNs = 1000000;
+
+void SetPerRail(benchmark::State& state, int rails) {
+    state.counters["rails"] = rails;
+    state.counters["per_rail"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * rails,
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// Handle on a synthetic sysfs tree with `rails` rails, or on synthetic waveforms
+class BenchHandle {
+public:
+    BenchHandle(int rails, bool sysfs) : rails_(rails) {
+        pm_config_t config = {};
+        if (sysfs) {
+            root_ = bench::MakeSyntheticTree(rails);
+            config.sysfs_root = root_.c_str();
+        } else {
+            spec_ = bench::SyntheticSpec(rails);
+            config.synthetic = spec_.c_str();
+        }
+        if (pm_init_config(&handle_, &config) != PM_SUCCESS) {
+            handle_ = nullptr;
+        }
+    }
+
+    ~BenchHandle() {
+        if (handle_) {
+            pm_cleanup(handle_);
+        }
+        bench::RemoveTree(root_);
+    }
+
+    pm_handle_t get() const { return handle_; }
+    int rails() const { return rails_; }
+
+private:
+    int rails_;
+    std::string root_;
+    std::string spec_;
+    pm_handle_t handle_ = nullptr;
+};
+
+// --- Discovery ---
+
+void BM_Discovery(benchmark::State& state) {
+    const int rails = static_cast<int>(state.range(0));
+    std::string root = bench::MakeSyntheticTree(rails, static_cast<int>(state.range(1)));
+    pm_config_t config = {};
+    config.sysfs_root = root.c_str();
+
+    for (auto _ : state) {
+        pm_handle_t handle = nullptr;
+        if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+            state.SkipWithError("pm_init_config failed on the synthetic tree");
+            break;
+        }
+        state.PauseTiming();
+        pm_cleanup(handle);
+        state.ResumeTiming();
+    }
+
+    state.counters["rails"] = rails;
+    bench::RemoveTree(root);
+}
+
+void BM_DiscoveryCached(benchmark::State& state) {
+    const int rails = static_cast<int>(state.range(0));
+    std::string root = bench::MakeSyntheticTree(rails, static_cast<int>(state.range(1)));
+    std::string cache = root + "/discovery.cache";
+    pm_config_t config = {};
+    config.sysfs_root = root.c_str();
+    config.discovery_cache = cache.c_str();
+
+    // The first handle scans the tree and writes the cache
+    pm_handle_t handle = nullptr;
+    if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed on the synthetic tree");
+        bench::RemoveTree(root);
+        return;
+    }
+    pm_cleanup(handle);
+
+    for (auto _ : state) {
+        if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+            state.SkipWithError("pm_init_config failed with the discovery cache");
+            break;
+        }
+        state.PauseTiming();
+        pm_cleanup(handle);
+        state.ResumeTiming();
+    }
+
+    state.counters["rails"] = rails;
+    bench::RemoveTree(root);
+}
+
+void BM_DiscoveryBoard(benchmark::State& state, pm_sim_board_t board) {
+    pm_sim_t sim = pm_sim_create(board, nullptr);
+    if (!sim) {
+        state.SkipWithError("pm_sim_create failed");
+        return;
+    }
+    pm_config_t config = {};
+    config.sysfs_root = pm_sim_root(sim);
+
+    for (auto _ : state) {
+        pm_handle_t handle = nullptr;
+        if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+            state.SkipWithError("pm_init_config failed on the simulated board");
+            break;
+        }
+        state.PauseTiming();
+        pm_cleanup(handle);
+        state.ResumeTiming();
+    }
+
+    state.counters["rails"] = pm_sim_rail_count(sim);
+    pm_sim_destroy(sim);
+}
+
+// --- Per Tick ---
+
+void BM_ReadRails(benchmark::State& state, pm_io_backend_t backend) {
+    BenchHandle handle(static_cast<int>(state.range(0)), true);
+    if (!handle.get()) {
+        state.SkipWithError("pm_init_config failed on the synthetic tree");
+        return;
+    }
+
+    pm_io_backend_t active = backend;
+    pm_set_io_backend(handle.get(), backend);
+    pm_sample_now(handle.get());
+    pm_get_io_backend(handle.get(), &active);
+    if (active != backend) {
+        state.SkipWithError("Requested I/O backend is not available");
+        return;
+    }
+
+    for (auto _ : state) {
+        bench_read_rails(handle.get());
+    }
+    SetPerRail(state, handle.rails());
+}
+
+void BM_ReadRailsSynthetic(benchmark::State& state) {
+    BenchHandle handle(static_cast<int>(state.range(0)), false);
+    if (!handle.get() || pm_sample_now(handle.get()) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+
+    for (auto _ : state) {
+        bench_read_rails(handle.get());
+    }
+    SetPerRail(state, handle.rails());
+}
+
+void BM_UpdateStatistics(benchmark::State& state) {
+    BenchHandle handle(static_cast<int>(state.range(0)), false);
+    if (!handle.get() || pm_sample_now(handle.get()) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+
+    // Ticks a period apart, as the sampler would fold them in
+    uint64_t timestamp_ns = kTickNs;
+    for (auto _ : state) {
+        bench_update_statistics(handle.get(), timestamp_ns);
+        timestamp_ns += kTickNs;
+    }
+    SetPerRail(state, handle.rails());
+}
+
+void BM_SampleNow(benchmark::State& state, bool sysfs) {
+    BenchHandle handle(static_cast<int>(state.range(0)), sysfs);
+    if (!handle.get() || pm_sample_now(handle.get()) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed");
+        return;
+    }
+
+    for (auto _ : state) {
+        pm_sample_now(handle.get());
+    }
+    SetPerRail(state, handle.rails());
+}
+
+// --- Readers ---
+
+// Handle sampling in the background for the whole run, shared by the reader threads
+pm_handle_t ReaderHandle() {
+    static std::unique_ptr<BenchHandle> handle = [] {
+        std::unique_ptr<BenchHandle> created(new BenchHandle(kReaderRails, false));
+        if (created->get()) {
+            pm_set_sampling_frequency(created->get(), kReaderSamplingHz);
+            pm_start_sampling(created->get());
+        }
+        return created;
+    }();
+    return handle->get();
+}
+
+void BM_GetLatestData(benchmark::State& state) {
+    pm_handle_t handle = ReaderHandle();
+    if (!handle) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+    pm_power_data_t data;
+    for (auto _ : state) {
+        pm_get_latest_data(handle, &data);
+        benchmark::DoNotOptimize(data);
+    }
+}
+
+void BM_ReadLatestData(benchmark::State& state) {
+    pm_handle_t handle = ReaderHandle();
+    if (!handle) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+    pm_power_data_t data;
+    std::vector<pm_sensor_data_t> sensors(kReaderRails);
+    for (auto _ : state) {
+        pm_read_latest_data(handle, &data, sensors.data(), kReaderRails, nullptr);
+        benchmark::DoNotOptimize(data);
+    }
+}
+
+void BM_GetStatistics(benchmark::State& state) {
+    pm_handle_t handle = ReaderHandle();
+    if (!handle) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+    pm_power_stats_t stats;
+    for (auto _ : state) {
+        pm_get_statistics(handle, &stats);
+        benchmark::DoNotOptimize(stats);
+    }
+}
+
+void BM_ReadStatistics(benchmark::State& state) {
+    pm_handle_t handle = ReaderHandle();
+    if (!handle) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+    pm_power_stats_t stats;
+    std::vector<pm_sensor_stats_t> sensors(kReaderRails);
+    for (auto _ : state) {
+        pm_read_statistics(handle, &stats, sensors.data(), kReaderRails, nullptr);
+        benchmark::DoNotOptimize(stats);
+    }
+}
+
+// --- C++ ---
+
+void BM_PowerDataCopy(benchmark::State& state) {
+    BenchHandle handle(static_cast<int>(state.range(0)), false);
+    if (!handle.get() || pm_sample_now(handle.get()) != PM_SUCCESS) {
+        state.SkipWithError("pm_init_config failed on the synthetic spec");
+        return;
+    }
+    pm_power_data_t data;
+    pm_get_latest_data(handle.get(), &data);
+
+    for (auto _ : state) {
+        jetpwmon::PowerData copy(data);
+        benchmark::DoNotOptimize(copy.getSensors());
+    }
+    SetPerRail(state, handle.rails());
+}
+
+void BM_GetLatestDataCpp(benchmark::State& state) {
+    const int rails = static_cast<int>(state.range(0));
+    std::string spec = bench::SyntheticSpec(rails);
+    pm_config_t config = {};
+    config.synthetic = spec.c_str();
+    jetpwmon::PowerMonitor monitor(config);
+
+    for (auto _ : state) {
+        jetpwmon::PowerData data = monitor.getLatestData();
+        benchmark::DoNotOptimize(data.getSensors());
+    }
+    SetPerRail(state, rails);
+}
+
+} // namespace
+
+BENCHMARK(BM_Discovery)->ArgsProduct({{3, 12, 48, 192}, {0, 256, 2048}})->ArgNames({"rails", "other"})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DiscoveryCached)->ArgsProduct({{3, 12, 48, 192}, {0, 2048}})->ArgNames({"rails", "other"})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_DiscoveryBoard, orin, PM_SIM_BOARD_ORIN)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_DiscoveryBoard, xavier, PM_SIM_BOARD_XAVIER)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_DiscoveryBoard, nano, PM_SIM_BOARD_NANO)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_CAPTURE(BM_ReadRails, stdio, PM_IO_BACKEND_STDIO)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_ReadRails, pread, PM_IO_BACKEND_PREAD)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_ReadRails, io_uring, PM_IO_BACKEND_IO_URING)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK(BM_ReadRailsSynthetic)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK(BM_UpdateStatistics)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_SampleNow, pread, true)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK_CAPTURE(BM_SampleNow, synthetic, false)->Arg(3)->Arg(12)->Arg(48);
+
+BENCHMARK(BM_GetLatestData)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ReadLatestData)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_GetStatistics)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_ReadStatistics)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK(BM_PowerDataCopy)->Arg(3)->Arg(12)->Arg(48);
+BENCHMARK(BM_GetLatestDataCpp)->Arg(3)->Arg(12)->Arg(48);
@@ -0,0 +1,111 @@
+/**
+ * @file bench_tree.h
+ * @brief Synthetic sysfs trees and synthetic specs of any size for the benchmarks
+ *
+ * The simulated boards of sysfs_sim.h have their real rail counts; these
+ * helpers scale the INA3221 hwmon layout to any number of rails and pad the
+ * I2C bus with unrelated devices, as discovery scans every one of them.
+ */
+
+#ifndef JETPWMON_BENCH_TREE_H
+#define JETPWMON_BENCH_TREE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bench {
+
+// Rails per synthetic INA3221 device (channels 1..3)
+constexpr int kRailsPerDevice = 3;
+
+inline void WriteFile(const std::string& path, const std::string& value) {
+    FILE* fp = std::fopen(path.c_str(), "w");
+    if (fp) {
+        std::fputs(value.c_str(), fp);
+        std::fclose(fp);
+    }
+}
+
+// Create `rails` rails under <root>/devices/i2c-1/1-XXXX/hwmon/hwmonX,
+// followed by `other_devices` I2C devices that are not power monitors, and
+// link every device from <root>/bus/i2c/devices as sysfs does
+inline std::string MakeSyntheticTree(int rails, int other_devices = 0) {
+    char tmpl[] = "/tmp/jetpwmon-bench-XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        return std::string();
+    }
+    std::string root = tmpl;
+    std::string links = root + "/bus";
+    mkdir(links.c_str(), 0755);
+    links += "/i2c";
+    mkdir(links.c_str(), 0755);
+    links += "/devices";
+    mkdir(links.c_str(), 0755);
+    mkdir((root + "/class").c_str(), 0755);
+    mkdir((root + "/class/power_supply").c_str(), 0755);
+    mkdir((root + "/devices").c_str(), 0755);
+    mkdir((root + "/devices/i2c-1").c_str(), 0755);
+    mkdir((root + "/devices/i2c-2").c_str(), 0755);
+
+    auto add_device = [&](int bus, int address) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%d-%04x", bus, address);
+        std::string device = root + "/devices/i2c-" + std::to_string(bus) + "/" + name;
+        mkdir(device.c_str(), 0755);
+        std::string target = "../../../devices/i2c-" + std::to_string(bus) + "/" + name;
+        if (symlink(target.c_str(), (links + "/" + name).c_str()) != 0) {
+            std::perror("symlink");
+        }
+        return device;
+    };
+
+    for (int dev = 0; dev * kRailsPerDevice < rails; dev++) {
+        std::string device = add_device(1, 0x40 + dev);
+        std::string hwmon = device + "/hwmon/hwmon" + std::to_string(dev);
+        mkdir((device + "/hwmon").c_str(), 0755);
+        mkdir(hwmon.c_str(), 0755);
+        WriteFile(device + "/name", "ina3221\n");
+
+        for (int ch = 1; ch <= kRailsPerDevice && dev * kRailsPerDevice + ch <= rails; ch++) {
+            std::string prefix = hwmon + "/in" + std::to_string(ch);
+            WriteFile(prefix + "_label", "VDD_RAIL_" + std::to_string(dev * kRailsPerDevice + ch) + "\n");
+            WriteFile(prefix + "_input", "19000\n");
+            WriteFile(hwmon + "/curr" + std::to_string(ch) + "_input", "500\n");
+        }
+    }
+
+    // EEPROMs, sensors and the like on a second bus
+    for (int dev = 0; dev < other_devices; dev++) {
+        WriteFile(add_device(2, 0x10 + dev) + "/name", "eeprom\n");
+    }
+    return root;
+}
+
+inline void RemoveTree(const std::string& root) {
+    if (root.empty()) {
+        return;
+    }
+    std::string cmd = "rm -rf '" + root + "'";
+    if (std::system(cmd.c_str()) != 0) {
+        std::fprintf(stderr, "Failed to remove %s\n", root.c_str());
+    }
+}
+
+// pm_config_t.synthetic spec of `rails` sine rails
+inline std::string SyntheticSpec(int rails) {
+    std::string spec;
+    for (int i = 0; i < rails; i++) {
+        if (i > 0) {
+            spec += ';';
+        }
+        spec += "VDD_RAIL_" + std::to_string(i + 1) + "=sine:" + std::to_string(1 + i % 8) + ",0.5,10";
+    }
+    return spec;
+}
+
+} // namespace bench
+
+#endif // JETPWMON_BENCH_TREE_H
@@ -1,6 +1,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
+#include <algorithm>
 #include "jetpwmon/jetpwmon.h"
 
 namespace py = pybind11;
@@ -16,8 +17,111 @@ void add_stats_to_dict(py::dict& d, const pm_stats_t& s) {
     d["avg"] = s.avg;
     d["total"] = s.total;
     d["count"] = s.count;
+    d["variance"] = s.variance;
+    d["stddev"] = s.stddev;
 }
 
+/**
+ * @brief Helper function to convert power statistics to a Python dictionary
+ * @param stats Reference to the power statistics structure
+ * @return Python dictionary with the 'total' and 'sensors' statistics
+ */
+py::dict power_stats_to_dict(const pm_power_stats_t& stats) {
+    py::dict result;
+    py::dict total;
+    total["name"] = std::string(stats.total.name);
+    py::dict voltage_stats;
+    py::dict current_stats;
+    py::dict power_stats;
+
+    add_stats_to_dict(voltage_stats, stats.total.voltage);
+    add_stats_to_dict(current_stats, stats.total.current);
+    add_stats_to_dict(power_stats, stats.total.power);
+
+    total["voltage"] = voltage_stats;
+    total["current"] = current_stats;
+    total["power"] = power_stats;
+    total["energy"] = stats.total.energy;
+    total["duration"] = stats.total.duration;
+    total["avg_power"] = stats.total.avg_power;
+    result["total"] = total;
+
+    py::list sensors;
+    if (stats.sensor_count > 0 && stats.sensors != nullptr) {
+        for (int i = 0; i < stats.sensor_count; i++) {
+            py::dict sensor;
+            sensor["name"] = std::string(stats.sensors[i].name);
+            
+            py::dict sensor_voltage_stats;
+            py::dict sensor_current_stats;
+            py::dict sensor_power_stats;
+
+            add_stats_to_dict(sensor_voltage_stats, stats.sensors[i].voltage);
+            add_stats_to_dict(sensor_current_stats, stats.sensors[i].current);
+            add_stats_to_dict(sensor_power_stats, stats.sensors[i].power);
+
+            sensor["voltage"] = sensor_voltage_stats;
+            sensor["current"] = sensor_current_stats;
+            sensor["power"] = sensor_power_stats;
+            sensor["energy"] = stats.sensors[i].energy;
+            sensor["duration"] = stats.sensors[i].duration;
+            sensor["avg_power"] = stats.sensors[i].avg_power;
+
+            sensors.append(sensor);
+        }
+    }
+    result["sensors"] = sensors;
+    result["sensor_count"] = stats.sensor_count;
+
+    return result;
+}
+
+/**
+ * @brief Measurement session measuring from its opening, independently of reset_statistics()
+ */
+class Session {
+public:
+    Session(pm_handle_t handle, pm_session_t session) : handle_(handle), session_(session) {}
+
+    ~Session() {
+        close();
+    }
+
+    /**
+     * @brief Get the statistics since the session (re)started
+     * @param restart Whether to start over at the tick the statistics were taken at
+     * @return Python dictionary structured like PowerMonitor.get_statistics()
+     * @throws std::runtime_error if the session is closed or reading it fails
+     */
+    py::dict read(bool restart) {
+        int count = 0;
+        if (!session_ || pm_get_sensor_count(handle_, &count) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to read session");
+        }
+
+        std::vector<pm_sensor_stats_t> sensor_buffer(count);
+        pm_power_stats_t stats;
+        if (pm_session_read(handle_, session_, &stats, sensor_buffer.data(), count, restart) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to read session");
+        }
+        return power_stats_to_dict(stats);
+    }
+
+    /**
+     * @brief Close the session; further reads fail
+     */
+    void close() {
+        if (session_) {
+            pm_session_close(handle_, session_);
+            session_ = nullptr;
+        }
+    }
+
+private:
+    pm_handle_t handle_;   ///< Handle the session belongs to
+    pm_session_t session_; ///< Session, nullptr once closed
+};
+
 /**
  * @brief Wrapper class to handle C structures and provide Python interface
  */
@@ -35,6 +139,64 @@ public:
         handle_ = handle;
     }
 
+    /**
+     * @brief Constructor that takes ownership of an initialized handle
+     * @param handle Handle returned by pm_init() or pm_attach_shared()
+     */
+    explicit PowerMonitor(pm_handle_t handle) : handle_(handle) {}
+
+    /**
+     * @brief Attach to the data published by another process
+     * @param name Segment name given to publish_shared()
+     * @return Power monitor reading the publisher's data; sampler calls raise
+     * @throws std::runtime_error if attaching fails
+     */
+    static std::unique_ptr<PowerMonitor> attach_shared(const std::string& name) {
+        pm_handle_t handle;
+        if (pm_attach_shared(&handle, name.c_str()) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to attach to shared memory");
+        }
+        return std::unique_ptr<PowerMonitor>(new PowerMonitor(handle));
+    }
+
+    /**
+     * @brief Create a power monitor replaying a recorded trace as its sensors
+     * @param path Recording of record_start() or CSV trace
+     * @param speed Trace seconds per second, 0 to advance one tick per sample
+     * @param loop Restart the trace at its end
+     * @return Power monitor whose rails are those of the trace
+     * @throws std::runtime_error if the trace cannot be read
+     */
+    static std::unique_ptr<PowerMonitor> replay(const std::string& path, double speed, bool loop) {
+        pm_config_t config = {};
+        config.replay_path = path.c_str();
+        config.replay_speed = speed;
+        config.replay_loop = loop;
+
+        pm_handle_t handle;
+        if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to open replay trace");
+        }
+        return std::unique_ptr<PowerMonitor>(new PowerMonitor(handle));
+    }
+
+    /**
+     * @brief Create a power monitor generating synthetic waveforms as its sensors
+     * @param spec Rails as "name=wave:params[@volts]" separated by ';', or "default"
+     * @return Power monitor whose rails are generated without file I/O
+     * @throws std::runtime_error if the spec is malformed
+     */
+    static std::unique_ptr<PowerMonitor> synthetic(const std::string& spec) {
+        pm_config_t config = {};
+        config.synthetic = spec.c_str();
+
+        pm_handle_t handle;
+        if (pm_init_config(&handle, &config) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to create synthetic sensors");
+        }
+        return std::unique_ptr<PowerMonitor>(new PowerMonitor(handle));
+    }
+
     /**
      * @brief Destructor that cleans up the power monitor
      */
@@ -68,6 +230,97 @@ public:
         return frequency;
     }
 
+    /**
+     * @brief Set the sampling period, applied from the next tick when sampling
+     * @param period_ns Sampling period in nanoseconds
+     * @throws std::runtime_error if setting the period fails
+     */
+    void set_sampling_period_ns(uint64_t period_ns) {
+        if (pm_set_sampling_period_ns(handle_, period_ns) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to set sampling period");
+        }
+    }
+
+    /**
+     * @brief Get the current sampling period
+     * @return Current sampling period in nanoseconds
+     * @throws std::runtime_error if getting the period fails
+     */
+    uint64_t get_sampling_period_ns() {
+        uint64_t period_ns;
+        if (pm_get_sampling_period_ns(handle_, &period_ns) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get sampling period");
+        }
+        return period_ns;
+    }
+
+    /**
+     * @brief Get the scheduler accounting of the sampling thread
+     * @return Python dictionary with tick, overrun and lateness counters
+     * @throws std::runtime_error if getting the accounting fails
+     */
+    py::dict get_sampler_stats() {
+        pm_sampler_stats_t stats;
+        if (pm_get_sampler_stats(handle_, &stats) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get sampler stats");
+        }
+
+        py::dict result;
+        result["period_ns"] = stats.period_ns;
+        result["ticks"] = stats.ticks;
+        result["overruns"] = stats.overruns;
+        result["missed_ticks"] = stats.missed_ticks;
+        result["last_tick_ns"] = stats.last_tick_ns;
+        result["max_tick_ns"] = stats.max_tick_ns;
+        result["last_lateness_ns"] = stats.last_lateness_ns;
+        result["max_lateness_ns"] = stats.max_lateness_ns;
+        return result;
+    }
+
+    /**
+     * @brief Configure how the sampling thread runs, applied at start_sampling()
+     * @param policy Scheduling policy
+     * @param priority Real-time priority for SCHED_FIFO/SCHED_RR
+     * @param cpu CPU to pin the sampler to, -1 for no pinning
+     * @param lock_memory Whether to lock the memory of the whole process while sampling
+     * @param timer_slack_ns Sampler timer slack, 0 to keep the default
+     * @throws std::runtime_error if the settings are invalid or sampling is active
+     */
+    void set_sampler_config(pm_sched_policy_t policy, int priority, int cpu,
+                            bool lock_memory, uint64_t timer_slack_ns) {
+        pm_sampler_config_t config = {};
+        config.policy = policy;
+        config.priority = priority;
+        config.pin_cpu = cpu >= 0;
+        config.cpu = cpu >= 0 ? cpu : 0;
+        config.lock_memory = lock_memory;
+        config.timer_slack_ns = timer_slack_ns;
+        if (pm_set_sampler_config(handle_, &config) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to set sampler config");
+        }
+    }
+
+    /**
+     * @brief Report which sampler settings took effect at the last start_sampling()
+     * @return Python dictionary with requested/applied flags and errno values
+     * @throws std::runtime_error if getting the report fails
+     */
+    py::dict get_sampler_report() {
+        pm_sampler_report_t report;
+        if (pm_get_sampler_report(handle_, &report) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get sampler report");
+        }
+
+        py::dict result;
+        result["requested"] = report.requested;
+        result["applied"] = report.applied;
+        result["policy_errno"] = report.policy_errno;
+        result["affinity_errno"] = report.affinity_errno;
+        result["mlock_errno"] = report.mlock_errno;
+        result["timer_slack_errno"] = report.timer_slack_errno;
+        return result;
+    }
+
     /**
      * @brief Start power sampling
      * @throws std::runtime_error if starting sampling fails
@@ -107,8 +360,11 @@ public:
      * @throws std::runtime_error if getting data fails
      */
     py::object get_latest_data() {
+        int count = get_sensor_count();
+        std::vector<pm_sensor_data_t> sensor_buffer(count);
         pm_power_data_t data;
-        if (pm_get_latest_data(handle_, &data) != PM_SUCCESS) {
+        uint64_t generation;
+        if (pm_read_latest_data(handle_, &data, sensor_buffer.data(), count, &generation) != PM_SUCCESS) {
             throw std::runtime_error("Failed to get latest data");
         }
 
@@ -143,6 +399,7 @@ public:
         }
         result["sensors"] = sensors;
         result["sensor_count"] = data.sensor_count;
+        result["generation"] = generation;
 
         return result;
     }
@@ -153,54 +410,356 @@ public:
      * @throws std::runtime_error if getting statistics fails
      */
     py::object get_statistics() {
+        int count = get_sensor_count();
+        std::vector<pm_sensor_stats_t> sensor_buffer(count);
         pm_power_stats_t stats;
-        if (pm_get_statistics(handle_, &stats) != PM_SUCCESS) {
+        uint64_t generation;
+        if (pm_read_statistics(handle_, &stats, sensor_buffer.data(), count, &generation) != PM_SUCCESS) {
             throw std::runtime_error("Failed to get statistics");
         }
 
+        py::dict result = power_stats_to_dict(stats);
+        result["generation"] = generation;
+
+        return result;
+    }
+
+    /**
+     * @brief Configure the sample history
+     * @param capacity Number of samples to keep, 0 to disable the history
+     * @param policy What to do when the history is full
+     * @throws std::runtime_error if configuring the history fails
+     */
+    void configure_history(int capacity, pm_overflow_policy_t policy) {
+        if (pm_configure_history(handle_, capacity, policy) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to configure history");
+        }
+    }
+
+    /**
+     * @brief Drain samples from the history
+     * @param cursor Sequence number to read from
+     * @param max Maximum number of samples to return
+     * @return Python dictionary with the samples and the cursor to continue from
+     * @throws std::runtime_error if the history is not configured
+     */
+    py::dict read_samples(uint64_t cursor, int max) {
+        std::vector<pm_sample_t> buffer(max > 0 ? max : 0);
+        int count = 0;
+        if (pm_read_samples(handle_, buffer.data(), max, &cursor, &count) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to read samples");
+        }
+
+        py::list samples;
+        for (int i = 0; i < count; i++) {
+            py::dict sample;
+            sample["seq"] = buffer[i].seq;
+            sample["timestamp_ns"] = buffer[i].timestamp_ns;
+            sample["rail"] = buffer[i].rail;
+            sample["online"] = buffer[i].online;
+            sample["voltage"] = buffer[i].voltage;
+            sample["current"] = buffer[i].current;
+            sample["power"] = buffer[i].power;
+            samples.append(sample);
+        }
+
         py::dict result;
+        result["samples"] = samples;
+        result["cursor"] = cursor;
+        return result;
+    }
+
+    /**
+     * @brief Get the counters of the sample history
+     * @return Python dictionary with capacity, written, dropped and lost samples
+     * @throws std::runtime_error if getting the counters fails
+     */
+    py::dict get_history_stats() {
+        pm_history_stats_t stats;
+        if (pm_get_history_stats(handle_, &stats) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get history stats");
+        }
+
+        py::dict result;
+        result["capacity"] = stats.capacity;
+        result["policy"] = stats.policy;
+        result["written"] = stats.written;
+        result["dropped"] = stats.dropped;
+        result["lost"] = stats.lost;
+        return result;
+    }
+
+    /**
+     * @brief Start recording every tick to a binary file
+     * @param path File to create, in the format of jetpwmon/jetpwmon_record.h
+     * @throws std::runtime_error if the recording cannot be started
+     */
+    void record_start(const std::string& path) {
+        if (pm_record_start(handle_, path.c_str()) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to start recording");
+        }
+    }
+
+    /**
+     * @brief Stop recording and close the file
+     * @throws std::runtime_error if no recording is running or a write failed
+     */
+    void record_stop() {
+        if (pm_record_stop(handle_) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to stop recording");
+        }
+    }
+
+    /**
+     * @brief Get the counters of the recording
+     * @return Python dictionary with the recording state, ticks, blocks and dropped ticks
+     * @throws std::runtime_error if getting the counters fails
+     */
+    py::dict get_record_stats() {
+        pm_record_stats_t stats;
+        if (pm_get_record_stats(handle_, &stats) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get record stats");
+        }
+
+        py::dict result;
+        result["recording"] = stats.recording;
+        result["ticks"] = stats.ticks;
+        result["blocks"] = stats.blocks;
+        result["dropped"] = stats.dropped;
+        return result;
+    }
+
+    /**
+     * @brief Publish the data and the history to other processes
+     * @param name Shared-memory segment name, starting with '/'
+     * @throws std::runtime_error if publishing fails
+     */
+    void publish_shared(const std::string& name) {
+        if (pm_publish_shared(handle_, name.c_str()) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to publish shared memory");
+        }
+    }
+
+    /**
+     * @brief Configure the sliding windows
+     * @param window_ns Window lengths in nanoseconds, empty to disable the windows
+     * @throws std::runtime_error if configuring the windows fails
+     */
+    void configure_windows(const std::vector<uint64_t>& window_ns) {
+        if (pm_configure_windows(handle_, window_ns.data(), static_cast<int>(window_ns.size())) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to configure windows");
+        }
+    }
+
+    /**
+     * @brief Get the power statistics of a sliding window
+     * @param window Index of the window passed to configure_windows()
+     * @return Python dictionary with the window, the span it covers and the power statistics
+     * @throws std::runtime_error if the window does not exist
+     */
+    py::dict get_window_statistics(int window) {
+        int count = get_sensor_count();
+        std::vector<pm_stats_t> sensor_buffer(count);
+        pm_window_stats_t stats;
+        if (pm_get_window_statistics(handle_, window, &stats, sensor_buffer.data(), count) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get window statistics");
+        }
+
+        py::dict result;
+        result["window_ns"] = stats.window_ns;
+        result["span_ns"] = stats.span_ns;
+
         py::dict total;
-        total["name"] = std::string(stats.total.name);
-        py::dict voltage_stats;
-        py::dict current_stats;
-        py::dict power_stats;
-
-        add_stats_to_dict(voltage_stats, stats.total.voltage);
-        add_stats_to_dict(current_stats, stats.total.current);
-        add_stats_to_dict(power_stats, stats.total.power);
-
-        total["voltage"] = voltage_stats;
-        total["current"] = current_stats;
-        total["power"] = power_stats;
+        add_stats_to_dict(total, stats.total);
         result["total"] = total;
 
         py::list sensors;
-        if (stats.sensor_count > 0 && stats.sensors != nullptr) {
-            for (int i = 0; i < stats.sensor_count; i++) {
-                py::dict sensor;
-                sensor["name"] = std::string(stats.sensors[i].name);
-                
-                py::dict sensor_voltage_stats;
-                py::dict sensor_current_stats;
-                py::dict sensor_power_stats;
+        for (int i = 0; i < stats.sensor_count; i++) {
+            py::dict sensor;
+            add_stats_to_dict(sensor, stats.sensors[i]);
+            sensors.append(sensor);
+        }
+        result["sensors"] = sensors;
+        result["sensor_count"] = stats.sensor_count;
+        return result;
+    }
 
-                add_stats_to_dict(sensor_voltage_stats, stats.sensors[i].voltage);
-                add_stats_to_dict(sensor_current_stats, stats.sensors[i].current);
-                add_stats_to_dict(sensor_power_stats, stats.sensors[i].power);
+    /**
+     * @brief Configure the rollup tiers
+     * @param tiers List of (resolution_ns, capacity) pairs, empty to disable the tiers
+     * @throws std::runtime_error if configuring the tiers fails
+     */
+    void configure_rollups(const std::vector<std::pair<uint64_t, int>>& tiers) {
+        std::vector<pm_rollup_tier_t> config;
+        for (const auto& tier : tiers) {
+            config.push_back({tier.first, tier.second});
+        }
+        if (pm_configure_rollups(handle_, config.data(), static_cast<int>(config.size())) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to configure rollups");
+        }
+    }
 
-                sensor["voltage"] = sensor_voltage_stats;
-                sensor["current"] = sensor_current_stats;
-                sensor["power"] = sensor_power_stats;
+    /**
+     * @brief Read the buckets of a rollup tier that start within a time range
+     * @param tier Index of the tier
+     * @param sensor Index of the sensor, -1 for the total
+     * @param from_ns Start of the range (CLOCK_MONOTONIC)
+     * @param to_ns End of the range, exclusive
+     * @return List of bucket dictionaries, oldest first
+     * @throws std::runtime_error if the tier or the sensor does not exist
+     */
+    py::list read_rollup(int tier, int sensor, uint64_t from_ns, uint64_t to_ns) {
+        pm_rollup_tier_t config;
+        if (pm_get_rollup_tier(handle_, tier, &config) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to read rollup");
+        }
 
-                sensors.append(sensor);
+        std::vector<pm_rollup_point_t> buffer(config.capacity);
+        int count = 0;
+        if (pm_read_rollup(handle_, tier, sensor, from_ns, to_ns, buffer.data(), config.capacity, &count) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to read rollup");
+        }
+
+        py::list points;
+        for (int i = 0; i < count; i++) {
+            py::dict point;
+            point["start_ns"] = buffer[i].start_ns;
+            point["count"] = buffer[i].count;
+            point["min"] = buffer[i].min;
+            point["max"] = buffer[i].max;
+            point["avg"] = buffer[i].avg;
+            point["energy"] = buffer[i].energy;
+            points.append(point);
+        }
+        return points;
+    }
+
+    /**
+     * @brief Get the power histogram of a sensor
+     * @param sensor Index of the sensor, -1 for the total
+     * @return Python dictionary with the totals and the per-bin samples and seconds as numpy arrays
+     * @throws std::runtime_error if the sensor does not exist
+     */
+    py::dict get_power_histogram(int sensor) {
+        pm_histogram_t histogram;
+        if (pm_get_power_histogram(handle_, sensor, &histogram) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get power histogram");
+        }
+
+        py::dict result;
+        result["count"] = histogram.count;
+        result["duration"] = histogram.duration;
+        result["samples"] = py::array_t<uint64_t>(PM_HISTOGRAM_BINS, histogram.samples);
+        result["seconds"] = py::array_t<double>(PM_HISTOGRAM_BINS, histogram.seconds);
+        return result;
+    }
+
+    /**
+     * @brief Estimate power quantiles of a sensor
+     * @param sensor Index of the sensor, -1 for the total
+     * @param quantiles Quantiles between 0 and 1
+     * @param weight Whether samples or the time they cover are ranked
+     * @return List of powers in watts, one per quantile
+     * @throws std::runtime_error if the sensor or a quantile is invalid
+     */
+    py::list get_power_quantiles(int sensor, const std::vector<double>& quantiles, pm_weight_t weight) {
+        pm_histogram_t histogram;
+        if (pm_get_power_histogram(handle_, sensor, &histogram) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get power histogram");
+        }
+
+        py::list result;
+        for (double quantile : quantiles) {
+            double value;
+            if (pm_histogram_quantile(&histogram, quantile, weight, &value) != PM_SUCCESS) {
+                throw std::runtime_error("Failed to estimate power quantile");
             }
+            result.append(value);
         }
-        result["sensors"] = sensors;
-        result["sensor_count"] = stats.sensor_count;
+        return result;
+    }
+
+    /**
+     * @brief Register a named code region, or look up its id
+     * @param name Region name
+     * @return Region id
+     * @throws std::runtime_error if no more regions can be registered
+     */
+    int register_region(const std::string& name) {
+        int id;
+        if (pm_region_register(handle_, name.c_str(), &id) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to register region");
+        }
+        return id;
+    }
+
+    /**
+     * @brief Mark the start of a code region on the calling thread
+     * @param id Region id
+     * @throws std::runtime_error if the region does not exist or the marker queue is full
+     */
+    void region_begin(int id) {
+        if (pm_region_begin(handle_, id) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to begin region");
+        }
+    }
+
+    /**
+     * @brief Mark the end of a code region on the calling thread
+     * @param id Region id
+     * @throws std::runtime_error if the region does not exist or the marker queue is full
+     */
+    void region_end(int id) {
+        if (pm_region_end(handle_, id) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to end region");
+        }
+    }
+
+    /**
+     * @brief Get the energy attributed to every registered region
+     * @return Python dictionary mapping region names to their statistics
+     * @throws std::runtime_error if getting the statistics fails
+     */
+    py::dict get_region_stats() {
+        int count;
+        if (pm_get_region_count(handle_, &count) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to get region statistics");
+        }
+
+        py::dict result;
+        for (int id = 0; id < count; id++) {
+            pm_region_stats_t stats;
+            if (pm_get_region_stats(handle_, id, &stats) != PM_SUCCESS) {
+                throw std::runtime_error("Failed to get region statistics");
+            }
 
+            py::dict region;
+            region["id"] = id;
+            region["count"] = stats.count;
+            region["active"] = stats.active;
+            region["duration_ns"] = stats.duration_ns;
+            region["energy"] = stats.energy;
+            region["avg_power"] = stats.avg_power;
+            region["peak_power"] = stats.peak_power;
+            region["dropped"] = stats.dropped;
+            result[py::str(stats.name)] = region;
+        }
         return result;
     }
 
+    /**
+     * @brief Open a measurement session independent of reset_statistics()
+     * @return Session measuring from now on
+     * @throws std::runtime_error if opening the session fails
+     */
+    Session* open_session() {
+        pm_session_t session;
+        if (pm_session_open(handle_, &session) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to open session");
+        }
+        return new Session(handle_, session);
+    }
+
     /**
      * @brief Reset power statistics
      * @throws std::runtime_error if resetting statistics fails
@@ -258,19 +817,107 @@ private:
     pm_handle_t handle_; ///< Handle to the power monitor instance
 };
 
+/**
+ * @brief Context manager marking a code region for the duration of a with block
+ */
+class Region {
+public:
+    Region(PowerMonitor& monitor, int id) : monitor_(monitor), id_(id) {}
+
+    Region& enter() {
+        monitor_.region_begin(id_);
+        return *this;
+    }
+
+    void exit(py::args) {
+        monitor_.region_end(id_);
+    }
+
+private:
+    PowerMonitor& monitor_; ///< Monitor recording the region
+    int id_;                ///< Region id
+};
+
 PYBIND11_MODULE(_core, m) {
     m.doc() = "Python bindings for Jetson Power Monitor";
 
+    // 导出调度策略枚举（需在 PowerMonitor 的默认参数之前注册）
+    py::enum_<pm_sched_policy_t>(m, "SchedPolicy")
+        .value("SCHED_OTHER", PM_SCHED_OTHER)
+        .value("SCHED_FIFO", PM_SCHED_FIFO)
+        .value("SCHED_RR", PM_SCHED_RR)
+        .export_values();
+
+    // 导出历史缓冲区溢出策略枚举
+    py::enum_<pm_overflow_policy_t>(m, "OverflowPolicy")
+        .value("DROP_OLDEST", PM_OVERFLOW_DROP_OLDEST)
+        .value("DROP_NEWEST", PM_OVERFLOW_DROP_NEWEST)
+        .export_values();
+
+    // 导出分位数权重枚举
+    py::enum_<pm_weight_t>(m, "Weight")
+        .value("SAMPLES", PM_WEIGHT_SAMPLES)
+        .value("TIME", PM_WEIGHT_TIME)
+        .export_values();
+
+    py::class_<Session>(m, "Session")
+        .def("read", &Session::read, py::arg("restart") = false)
+        .def("close", &Session::close)
+        .def("__enter__", [](Session& self) -> Session& { return self; }, py::return_value_policy::reference)
+        .def("__exit__", [](Session& self, py::args) { self.close(); });
+
+    py::class_<Region>(m, "Region")
+        .def("__enter__", &Region::enter, py::return_value_policy::reference_internal)
+        .def("__exit__", &Region::exit);
+
     py::class_<PowerMonitor>(m, "PowerMonitor")
         .def(py::init<>())
+        .def_static("attach_shared", &PowerMonitor::attach_shared, py::arg("name"))
+        .def_static("replay", &PowerMonitor::replay,
+                    py::arg("path"), py::arg("speed") = 1.0, py::arg("loop") = false)
+        .def_static("synthetic", &PowerMonitor::synthetic, py::arg("spec") = "default")
         .def("set_sampling_frequency", &PowerMonitor::set_sampling_frequency)
         .def("get_sampling_frequency", &PowerMonitor::get_sampling_frequency)
+        .def("set_sampling_period_ns", &PowerMonitor::set_sampling_period_ns)
+        .def("get_sampling_period_ns", &PowerMonitor::get_sampling_period_ns)
+        .def("get_sampler_stats", &PowerMonitor::get_sampler_stats)
+        .def("set_sampler_config", &PowerMonitor::set_sampler_config,
+             py::arg("policy") = PM_SCHED_OTHER, py::arg("priority") = 0, py::arg("cpu") = -1,
+             py::arg("lock_memory") = false, py::arg("timer_slack_ns") = 0)
+        .def("get_sampler_report", &PowerMonitor::get_sampler_report)
         .def("start_sampling", &PowerMonitor::start_sampling)
         .def("stop_sampling", &PowerMonitor::stop_sampling)
         .def("is_sampling", &PowerMonitor::is_sampling)
         .def("get_latest_data", &PowerMonitor::get_latest_data)
         .def("get_statistics", &PowerMonitor::get_statistics)
         .def("reset_statistics", &PowerMonitor::reset_statistics)
+        .def("open_session", &PowerMonitor::open_session, py::keep_alive<0, 1>())
+        .def("configure_history", &PowerMonitor::configure_history,
+             py::arg("capacity"), py::arg("policy") = PM_OVERFLOW_DROP_OLDEST)
+        .def("read_samples", &PowerMonitor::read_samples,
+             py::arg("cursor") = 0, py::arg("max") = 1024)
+        .def("get_history_stats", &PowerMonitor::get_history_stats)
+        .def("record_start", &PowerMonitor::record_start, py::arg("path"))
+        .def("record_stop", &PowerMonitor::record_stop)
+        .def("get_record_stats", &PowerMonitor::get_record_stats)
+        .def("publish_shared", &PowerMonitor::publish_shared, py::arg("name"))
+        .def("configure_rollups", &PowerMonitor::configure_rollups, py::arg("tiers"))
+        .def("read_rollup", &PowerMonitor::read_rollup,
+             py::arg("tier"), py::arg("sensor") = -1, py::arg("from_ns") = 0,
+             py::arg("to_ns") = UINT64_MAX)
+        .def("get_power_histogram", &PowerMonitor::get_power_histogram, py::arg("sensor") = -1)
+        .def("get_power_quantiles", &PowerMonitor::get_power_quantiles,
+             py::arg("sensor") = -1, py::arg("quantiles") = std::vector<double>{0.5, 0.95, 0.99},
+             py::arg("weight") = PM_WEIGHT_SAMPLES)
+        .def("configure_windows", &PowerMonitor::configure_windows, py::arg("window_ns"))
+        .def("get_window_statistics", &PowerMonitor::get_window_statistics, py::arg("window"))
+        .def("register_region", &PowerMonitor::register_region, py::arg("name"))
+        .def("region_begin", &PowerMonitor::region_begin, py::arg("id"))
+        .def("region_end", &PowerMonitor::region_end, py::arg("id"))
+        .def("region", [](PowerMonitor& self, const std::string& name) {
+            return Region(self, self.register_region(name));
+        }, py::arg("name"), py::keep_alive<0, 1>())
+        .def("get_region_stats", &PowerMonitor::get_region_stats)
         .def("get_sensor_count", &PowerMonitor::get_sensor_count)
         .def("get_sensor_names", [](PowerMonitor& self) {
             PyErr_WarnEx(PyExc_DeprecationWarning,
@@ -292,6 +939,7 @@ PYBIND11_MODULE(_core, m) {
         .value("ERROR_FILE_ACCESS", PM_ERROR_FILE_ACCESS)
         .value("ERROR_MEMORY", PM_ERROR_MEMORY)
         .value("ERROR_THREAD", PM_ERROR_THREAD)
+        .value("ERROR_NOT_SUPPORTED", PM_ERROR_NOT_SUPPORTED)
         .export_values();
 
     // 导出传感器类型枚举
@@ -303,4 +951,20 @@ PYBIND11_MODULE(_core, m) {
 
     // 导出错误字符串函数
     m.def("error_string", &pm_error_string);
+
+    // 导出直方图分位数函数，可用于合并后的直方图（samples 或 seconds 数组相加）
+    m.def("histogram_quantile", [](py::array_t<double, py::array::c_style | py::array::forcecast> weights,
+                                   double quantile) {
+        if (weights.ndim() != 1 || weights.shape(0) != PM_HISTOGRAM_BINS) {
+            throw std::runtime_error("Histogram must have " + std::to_string(PM_HISTOGRAM_BINS) + " bins");
+        }
+
+        pm_histogram_t histogram = {};
+        std::copy(weights.data(), weights.data() + PM_HISTOGRAM_BINS, histogram.seconds);
+        double value;
+        if (pm_histogram_quantile(&histogram, quantile, PM_WEIGHT_TIME, &value) != PM_SUCCESS) {
+            throw std::runtime_error("Failed to estimate histogram quantile");
+        }
+        return value;
+    }, py::arg("weights"), py::arg("quantile"));
 } 
\ No newline at end of file
@@ -26,6 +26,8 @@ fn main() {
     println!("cargo:rustc-link-search=native={}", std::env::var("OUT_DIR").unwrap());
     println!("cargo:rustc-link-lib=static=jetpwmon");
     println!("cargo:rustc-link-lib=pthread");
+    println!("cargo:rustc-link-lib=m");
+    println!("cargo:rustc-link-lib=rt");
 
     println!("cargo:rerun-if-changed=src/lib.rs");
     println!("cargo:rerun-if-changed=vendor/src/jetpwmon.c");
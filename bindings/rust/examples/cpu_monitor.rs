@@ -65,7 +65,7 @@ where
     println!("  最小值: {:.2} W", stats.total.power.min);
     println!("  最大值: {:.2} W", stats.total.power.max);
     println!("  平均值: {:.2} W", stats.total.power.avg);
-    println!("  总能耗: {:.2} J", stats.total.power.total);
+    println!("  总能耗: {:.2} J", stats.total.energy);
     println!("  采样次数: {}", stats.total.power.count);
     
     // 打印各个传感器的功耗信息
@@ -78,7 +78,7 @@ where
         println!("  最小值: {:.2} W", sensor.power.min);
         println!("  最大值: {:.2} W", sensor.power.max);
         println!("  平均值: {:.2} W", sensor.power.avg);
-        println!("  总能耗: {:.2} J", sensor.power.total);
+        println!("  总能耗: {:.2} J", sensor.energy);
         println!("  采样次数: {}", sensor.power.count);
     }
     
@@ -92,7 +92,8 @@ fn main() {
     println!("  Minimum Value: {:.2} W", stats.total.power.min);
     println!("  Maximum Value: {:.2} W", stats.total.power.max);
     println!("  Average Value: {:.2} W", stats.total.power.avg);
-    println!("  Total Energy Consumption: {:.2} J", stats.total.power.total);
+    println!("  Time-Weighted Average: {:.2} W", stats.total.avg_power);
+    println!("  Total Energy Consumption: {:.2} J over {:.2} s", stats.total.energy, stats.total.duration);
     println!("  Sample Count: {}", stats.total.power.count);
     
     // Printing power consumption information for each sensor
@@ -104,7 +105,7 @@ fn main() {
         println!("  Minimum Value: {:.2} W", sensor.power.min);
         println!("  Maximum Value: {:.2} W", sensor.power.max);
         println!("  Average Value: {:.2} W", sensor.power.avg);
-        println!("  Total Energy Consumption: {:.2} J", sensor.power.total);
+        println!("  Total Energy Consumption: {:.2} J", sensor.energy);
         println!("  Sample Count: {}", sensor.power.count);
     }
 } 
\ No newline at end of file
@@ -52,10 +52,18 @@ pub struct Stats {
     pub max: f64,
     /// Average value
     pub avg: f64,
-    /// Sum of all samples
+    /// Sum of all samples (not an energy, see `SensorStats::energy`)
     pub total: f64,
     /// Number of samples
     pub count: u64,
+    /// Rounding error of `total`, which `total + compensation` corrects
+    pub compensation: f64,
+    /// Sum of squared deviations from the average
+    pub m2: f64,
+    /// Sample variance, `m2 / (count - 1)`
+    pub variance: f64,
+    /// Sample standard deviation
+    pub stddev: f64,
 }
 
 /// Power statistics for a sensor
@@ -70,6 +78,12 @@ pub struct SensorStats {
     pub current: Stats,
     /// Power statistics
     pub power: Stats,
+    /// Energy in joules, power integrated over sample timestamps
+    pub energy: f64,
+    /// Time covered by `energy` in seconds
+    pub duration: f64,
+    /// Time-weighted average power in watts
+    pub avg_power: f64,
 }
 
 /// Overall power data
@@ -118,8 +132,10 @@ pub enum Error {
     Memory = -8,
     /// Thread creation/management error
     Thread = -9,
+    /// Operation not supported by this handle
+    NotSupported = -10,
     /// Unknown error code
-    Unknown(i32) = -10,
+    Unknown(i32) = -11,
 }
 
 impl From<i32> for Error {
@@ -134,6 +150,7 @@ impl From<i32> for Error {
             -7 => Error::FileAccess,
             -8 => Error::Memory,
             -9 => Error::Thread,
+            -10 => Error::NotSupported,
             _ => Error::Unknown(code),
         }
     }
@@ -151,6 +168,7 @@ impl From<Error> for i32 {
             Error::FileAccess => -7,
             Error::Memory => -8,
             Error::Thread => -9,
+            Error::NotSupported => -10,
             Error::Unknown(code) => code,
         }
     }
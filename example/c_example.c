@@ -105,7 +105,8 @@ void monitor_power_consumption(void (*task_func)()) {
     printf("  Minimum Value: %.2f W\n", stats.total.power.min);
     printf("  Maximum Value: %.2f W\n", stats.total.power.max);
     printf("  Average Value: %.2f W\n", stats.total.power.avg);
-    printf("  Total Energy Consumption: %.2f J\n", stats.total.power.total);
+    printf("  Time-Weighted Average: %.2f W\n", stats.total.avg_power);
+    printf("  Total Energy Consumption: %.2f J over %.2f s\n", stats.total.energy, stats.total.duration);
     printf("  Sample Count: %lu\n", stats.total.power.count);
     
     // Print power consumption information for each sensor
@@ -115,7 +116,7 @@ void monitor_power_consumption(void (*task_func)()) {
         printf("  Minimum Value: %.2f W\n", stats.sensors[i].power.min);
         printf("  Maximum Value: %.2f W\n", stats.sensors[i].power.max);
         printf("  Average Value: %.2f W\n", stats.sensors[i].power.avg);
-        printf("  Total Energy Consumption: %.2f J\n", stats.sensors[i].power.total);
+        printf("  Total Energy Consumption: %.2f J\n", stats.sensors[i].energy);
         printf("  Sample Count: %lu\n", stats.sensors[i].power.count);
     }
     
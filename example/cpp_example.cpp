@@ -88,7 +88,7 @@ void monitorPowerConsumption(std::function<void()> task) {
         std::cout << "  Min: " << stats.getTotal().power.min << " W" << std::endl;
         std::cout << "  Max: " << stats.getTotal().power.max << " W" << std::endl;
         std::cout << "  Avg: " << stats.getTotal().power.avg << " W" << std::endl;
-        std::cout << "  Total Energy: " << stats.getTotal().power.total << " J" << std::endl;
+        std::cout << "  Total Energy: " << stats.getTotal().energy << " J" << std::endl;
         std::cout << "  Samples: " << stats.getTotal().power.count << std::endl;
         
         // Print individual sensor statistics
@@ -99,7 +99,7 @@ void monitorPowerConsumption(std::function<void()> task) {
             std::cout << "  Min: " << sensor.power.min << " W" << std::endl;
             std::cout << "  Max: " << sensor.power.max << " W" << std::endl;
             std::cout << "  Avg: " << sensor.power.avg << " W" << std::endl;
-            std::cout << "  Total Energy: " << sensor.power.total << " J" << std::endl;
+            std::cout << "  Total Energy: " << sensor.energy << " J" << std::endl;
             std::cout << "  Samples: " << sensor.power.count << std::endl;
         }
         
@@ -140,7 +140,7 @@ int main() {
     cout << "  Minimum Value: " << stats.total.power.min << " W\n";
     cout << "  Maximum Value: " << stats.total.power.max << " W\n";
     cout << "  Average Value: " << stats.total.power.avg << " W\n";
-    cout << "  Total Energy: " << stats.total.power.avg * total_time << " J\n";
+    cout << "  Total Energy: " << stats.total.energy << " J\n";
     cout << "  Sample Count: " << stats.total.power.count << "\n";
 
     cout << "\nPer-Sensor Power Consumption Information:\n";
@@ -149,7 +149,7 @@ int main() {
         cout << "  Minimum Value: " << stats.sensors[i].power.min << " W\n";
         cout << "  Maximum Value: " << stats.sensors[i].power.max << " W\n";
         cout << "  Average Value: " << stats.sensors[i].power.avg << " W\n";
-        cout << "  Total Energy: " << stats.sensors[i].power.avg * total_time << " J\n";
+        cout << "  Total Energy: " << stats.sensors[i].energy << " J\n";
         cout << "  Sample Count: " << stats.sensors[i].power.count << "\n";
     }
 
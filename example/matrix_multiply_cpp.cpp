@@ -127,17 +127,16 @@ int main()
                 const pm_sensor_stats_t &total_stats = stats.getTotal();
                 double task_duration_sec = task_duration.count(); // Duration in seconds
 
-                // Calculate energy based on the measured average power and task duration.
-                // Note: The 'total_stats.power.total' field contains energy calculated by the library,
-                // potentially based on sample count and frequency, which might be slightly different.
-                double calculated_total_energy = total_stats.power.avg * task_duration_sec;
+                // The library integrates power over the sample timestamps, so energy is exact
+                // for the sampled period; task_duration_sec is printed for comparison only.
 
                 std::cout << "Total Power Consumption:" << std::endl;
                 std::cout << "  Min Power   : " << total_stats.power.min << " W" << std::endl;
                 std::cout << "  Max Power   : " << total_stats.power.max << " W" << std::endl;
                 std::cout << "  Avg Power   : " << total_stats.power.avg << " W" << std::endl;
-                std::cout << "  Total Energy: " << calculated_total_energy << " J (Avg * Measured Duration)" << std::endl;
-                std::cout << "  (Lib Energy): " << total_stats.power.total << " J" << std::endl; // Display library's calculation too
+                std::cout << "  Time-Wt Avg : " << total_stats.avg_power << " W" << std::endl;
+                std::cout << "  Total Energy: " << total_stats.energy << " J over " << total_stats.duration
+                          << " s (task took " << task_duration_sec << " s)" << std::endl;
                 std::cout << "  Sample Count: " << total_stats.power.count << std::endl;
 
                 // Access per-sensor statistics using the pointer and count.
@@ -152,15 +151,12 @@ int main()
                         for (int i = 0; i < sensor_count; ++i)
                         {
                                 const pm_sensor_stats_t &sensor_stat = sensors_stats_ptr[i]; // Access element
-                                double calculated_sensor_energy = sensor_stat.power.avg * task_duration_sec;
-
                                 // Safely convert the C char array name to std::string
                                 std::cout << "\n  Sensor: " << c_char_to_string(sensor_stat.name, sizeof(sensor_stat.name)) << std::endl;
                                 std::cout << "    Min Power   : " << sensor_stat.power.min << " W" << std::endl;
                                 std::cout << "    Max Power   : " << sensor_stat.power.max << " W" << std::endl;
                                 std::cout << "    Avg Power   : " << sensor_stat.power.avg << " W" << std::endl;
-                                std::cout << "    Total Energy: " << calculated_sensor_energy << " J (Avg * Measured Duration)" << std::endl;
-                                std::cout << "    (Lib Energy): " << sensor_stat.power.total << " J" << std::endl;
+                                std::cout << "    Total Energy: " << sensor_stat.energy << " J" << std::endl;
                                 std::cout << "    Sample Count: " << sensor_stat.power.count << std::endl;
                         }
                 }
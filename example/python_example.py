@@ -51,7 +51,8 @@ def monitor_power_consumption(task_func):
     print(f"  Minimum Value: {total_stats['power']['min']:.2f} W")
     print(f"  Maximum Value: {total_stats['power']['max']:.2f} W")
     print(f"  Average Value: {total_stats['power']['avg']:.2f} W")
-    print(f"  Total Energy Consumption: {total_stats['power']['total']:.2f} J")
+    print(f"  Time-Weighted Average: {total_stats['avg_power']:.2f} W")
+    print(f"  Total Energy Consumption: {total_stats['energy']:.2f} J over {total_stats['duration']:.2f} s")
     print(f"  Sample Count: {total_stats['power']['count']}")
     
     # Print power consumption information for each sensor
@@ -61,7 +62,7 @@ def monitor_power_consumption(task_func):
         print(f"  Minimum Value: {sensor['power']['min']:.2f} W")
         print(f"  Maximum Value: {sensor['power']['max']:.2f} W")
         print(f"  Average Value: {sensor['power']['avg']:.2f} W")
-        print(f"  Total Energy Consumption: {sensor['power']['total']:.2f} J")
+        print(f"  Total Energy Consumption: {sensor['energy']:.2f} J")
         print(f"  Sample Count: {sensor['power']['count']}")
 
 def main():
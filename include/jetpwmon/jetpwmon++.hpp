@@ -87,6 +87,71 @@ namespace jetpwmon
                 int sensor_count_;
         };
 
+        /**
+         * @brief Copy of the power statistics of one sliding window
+         */
+        class WindowStats
+        {
+        public:
+                /**
+                 * @brief Constructor that copies a pm_window_stats_t
+                 * @param stats Reference to pm_window_stats_t
+                 */
+                WindowStats(const pm_window_stats_t &stats)
+                        : window_ns_(stats.window_ns), span_ns_(stats.span_ns), total_(stats.total),
+                          sensors_(stats.sensors, stats.sensors + stats.sensor_count) {}
+
+                // Getters
+                uint64_t getWindowNs() const { return window_ns_; }
+                uint64_t getSpanNs() const { return span_ns_; }
+                const pm_stats_t &getTotal() const { return total_; }
+                const pm_stats_t *getSensors() const { return sensors_.data(); }
+                int getSensorCount() const { return static_cast<int>(sensors_.size()); }
+
+        private:
+                uint64_t window_ns_;
+                uint64_t span_ns_;
+                pm_stats_t total_;
+                std::vector<pm_stats_t> sensors_;
+        };
+
+        /**
+         * @brief RAII wrapper for a measurement session, see PowerMonitor::openSession()
+         *
+         * The session must not outlive the PowerMonitor that opened it.
+         */
+        class Session
+        {
+        public:
+                /**
+                 * @brief Destructor that closes the session
+                 */
+                ~Session();
+
+                /**
+                 * @brief Get the statistics since the session (re)started
+                 * @param restart Whether to start over at the tick the statistics were taken at
+                 * @return Power statistics of the session
+                 * @throw std::runtime_error if reading the session fails
+                 */
+                PowerStats read(bool restart = false);
+
+                // Delete copy constructor and assignment operator
+                Session(const Session &) = delete;
+                Session &operator=(const Session &) = delete;
+
+                // Allow move
+                Session(Session &&) noexcept;
+                Session &operator=(Session &&) noexcept;
+
+        private:
+                friend class PowerMonitor;
+                Session(pm_handle_t handle, pm_session_t session);
+
+                pm_handle_t handle_;
+                pm_session_t session_;
+        };
+
         /**
          * @brief RAII wrapper for the power monitoring library
          */
@@ -99,11 +164,26 @@ namespace jetpwmon
                  */
                 PowerMonitor();
 
+                /**
+                 * @brief Constructor with options, e.g. a trace to replay
+                 * @param config Options passed to pm_init_config()
+                 * @throw std::runtime_error if initialization fails
+                 */
+                explicit PowerMonitor(const pm_config_t &config);
+
                 /**
                  * @brief Destructor that cleans up resources
                  */
                 ~PowerMonitor();
 
+                /**
+                 * @brief Attach to the data published by another process
+                 * @param name Segment name given to publishShared()
+                 * @return PowerMonitor reading the publisher's data; sampler calls throw
+                 * @throw std::runtime_error if attaching fails
+                 */
+                static PowerMonitor attachShared(const std::string &name);
+
                 /**
                  * @brief Set sampling frequency
                  * @param frequency_hz Sampling frequency in Hz
@@ -118,6 +198,48 @@ namespace jetpwmon
                  */
                 int getSamplingFrequency() const;
 
+                /**
+                 * @brief Set sampling period, applied from the next tick when sampling
+                 * @param period_ns Sampling period in nanoseconds
+                 * @throw std::runtime_error if setting the period fails
+                 */
+                void setSamplingPeriodNs(uint64_t period_ns);
+
+                /**
+                 * @brief Get current sampling period
+                 * @return Sampling period in nanoseconds
+                 * @throw std::runtime_error if getting the period fails
+                 */
+                uint64_t getSamplingPeriodNs() const;
+
+                /**
+                 * @brief Get the scheduler accounting of the sampling thread
+                 * @return Tick, overrun and lateness counters
+                 * @throw std::runtime_error if getting the accounting fails
+                 */
+                pm_sampler_stats_t getSamplerStats() const;
+
+                /**
+                 * @brief Configure how the sampling thread runs, applied at startSampling()
+                 * @param config Sampler settings
+                 * @throw std::runtime_error if the settings are invalid or sampling is active
+                 */
+                void setSamplerConfig(const pm_sampler_config_t &config);
+
+                /**
+                 * @brief Get the sampler settings
+                 * @return Sampler settings
+                 * @throw std::runtime_error if getting the settings fails
+                 */
+                pm_sampler_config_t getSamplerConfig() const;
+
+                /**
+                 * @brief Report which sampler settings took effect at the last startSampling()
+                 * @return Requested and applied settings with the errors of the failed ones
+                 * @throw std::runtime_error if getting the report fails
+                 */
+                pm_sampler_report_t getSamplerReport() const;
+
                 /**
                  * @brief Start sampling
                  * @throw std::runtime_error if starting sampling fails
@@ -157,6 +279,153 @@ namespace jetpwmon
                  */
                 void resetStatistics();
 
+                /**
+                 * @brief Open a measurement session independent of resetStatistics()
+                 * @return Session measuring from now on
+                 * @throw std::runtime_error if opening the session fails
+                 */
+                Session openSession();
+
+                /**
+                 * @brief Configure the sample history, 0 samples to disable it
+                 * @param capacity Number of samples to keep
+                 * @param policy What to do when the history is full
+                 * @throw std::runtime_error if configuring the history fails
+                 */
+                void configureHistory(int capacity, pm_overflow_policy_t policy = PM_OVERFLOW_DROP_OLDEST);
+
+                /**
+                 * @brief Drain up to max samples from the history
+                 * @param cursor Sequence number to read from, advanced past the returned samples
+                 * @param max Maximum number of samples to return
+                 * @return Samples in sequence order
+                 * @throw std::runtime_error if the history is not configured
+                 */
+                std::vector<pm_sample_t> readSamples(uint64_t &cursor, int max = 1024) const;
+
+                /**
+                 * @brief Get the counters of the sample history
+                 * @return Capacity, written, dropped and lost samples
+                 * @throw std::runtime_error if getting the counters fails
+                 */
+                pm_history_stats_t getHistoryStats() const;
+
+                /**
+                 * @brief Start recording every tick to a binary file
+                 * @param path File to create, in the format of jetpwmon/jetpwmon_record.h
+                 * @throw std::runtime_error if the file cannot be created or a recording is running
+                 */
+                void startRecording(const std::string &path);
+
+                /**
+                 * @brief Stop recording and close the file
+                 * @throw std::runtime_error if no recording is running or a write failed
+                 */
+                void stopRecording();
+
+                /**
+                 * @brief Get the counters of the recording
+                 * @return Ticks and blocks written and ticks dropped
+                 * @throw std::runtime_error if getting the counters fails
+                 */
+                pm_record_stats_t getRecordStats() const;
+
+                /**
+                 * @brief Publish the data and the history to other processes
+                 * @param name Shared-memory segment name, starting with '/'
+                 * @throw std::runtime_error if publishing fails
+                 */
+                void publishShared(const std::string &name);
+
+                /**
+                 * @brief Configure the sliding windows, an empty list to disable them
+                 * @param window_ns Window lengths in nanoseconds
+                 * @throw std::runtime_error if configuring the windows fails
+                 */
+                void configureWindows(const std::vector<uint64_t> &window_ns);
+
+                /**
+                 * @brief Get the power statistics of a sliding window
+                 * @param window Index of the window passed to configureWindows()
+                 * @return Statistics over the ticks in the window
+                 * @throw std::runtime_error if the window does not exist
+                 */
+                WindowStats getWindowStatistics(int window) const;
+
+                /**
+                 * @brief Configure the rollup tiers, an empty list to disable them
+                 * @param tiers Resolution and number of buckets of every tier
+                 * @throw std::runtime_error if configuring the tiers fails
+                 */
+                void configureRollups(const std::vector<pm_rollup_tier_t> &tiers);
+
+                /**
+                 * @brief Read the buckets of a rollup tier that start within a time range
+                 * @param tier Index of the tier passed to configureRollups()
+                 * @param sensor Index of the sensor, -1 for the total
+                 * @param from_ns Start of the range (CLOCK_MONOTONIC)
+                 * @param to_ns End of the range, exclusive
+                 * @return Buckets, oldest first
+                 * @throw std::runtime_error if the tier or the sensor does not exist
+                 */
+                std::vector<pm_rollup_point_t> readRollup(int tier, int sensor = -1, uint64_t from_ns = 0,
+                                                          uint64_t to_ns = UINT64_MAX) const;
+
+                /**
+                 * @brief Get the power histogram of a sensor
+                 * @param sensor Index of the sensor, -1 for the total
+                 * @return Copy of the histogram, mergeable with pm_histogram_merge()
+                 * @throw std::runtime_error if the sensor does not exist
+                 */
+                pm_histogram_t getPowerHistogram(int sensor) const;
+
+                /**
+                 * @brief Estimate a power quantile of a sensor
+                 * @param sensor Index of the sensor, -1 for the total
+                 * @param quantile Quantile between 0 and 1, e.g. 0.99 for P99
+                 * @param weight Whether samples or the time they cover are ranked
+                 * @return Power in watts, 0 if nothing was recorded
+                 * @throw std::runtime_error if the sensor or the quantile is invalid
+                 */
+                double getPowerQuantile(int sensor, double quantile, pm_weight_t weight = PM_WEIGHT_SAMPLES) const;
+
+                /**
+                 * @brief Register a named code region, or look up its id
+                 * @param name Region name
+                 * @return Region id for beginRegion() and endRegion()
+                 * @throw std::runtime_error if no more regions can be registered
+                 */
+                int registerRegion(const std::string &name);
+
+                /**
+                 * @brief Mark the start of a code region on the calling thread
+                 * @param id Region id from registerRegion()
+                 * @throw std::runtime_error if the region does not exist or the marker queue is full
+                 */
+                void beginRegion(int id);
+
+                /**
+                 * @brief Mark the end of a code region on the calling thread
+                 * @param id Region id from registerRegion()
+                 * @throw std::runtime_error if the region does not exist or the marker queue is full
+                 */
+                void endRegion(int id);
+
+                /**
+                 * @brief Get the number of registered regions
+                 * @return Number of regions; ids run from 0 to the count minus one
+                 * @throw std::runtime_error if getting the count fails
+                 */
+                int getRegionCount() const;
+
+                /**
+                 * @brief Get the energy attributed to a code region
+                 * @param id Region id
+                 * @return Count, duration, energy and power of the completed instances
+                 * @throw std::runtime_error if the region does not exist
+                 */
+                pm_region_stats_t getRegionStats(int id) const;
+
                 /**
                  * @brief Get number of sensors
                  * @return Number of sensors
@@ -184,6 +453,8 @@ namespace jetpwmon
                 PowerMonitor &operator=(PowerMonitor &&) noexcept;
 
         private:
+                explicit PowerMonitor(pm_handle_t handle);
+
                 struct HandleDeleter
                 {
                         void operator()(pm_handle_t *handle) const
@@ -195,4 +466,32 @@ namespace jetpwmon
                 std::unique_ptr<pm_handle_t, HandleDeleter> handle_;
         };
 
+        /**
+         * @brief Marks a code region for the lifetime of the object
+         */
+        class ScopedRegion
+        {
+        public:
+                /**
+                 * @brief Constructor that begins the region
+                 * @param monitor Power monitor the region is recorded by
+                 * @param id Region id from PowerMonitor::registerRegion()
+                 * @throw std::runtime_error if the region cannot be marked
+                 */
+                ScopedRegion(PowerMonitor &monitor, int id);
+
+                /**
+                 * @brief Destructor that ends the region
+                 */
+                ~ScopedRegion();
+
+                // Delete copy constructor and assignment operator
+                ScopedRegion(const ScopedRegion &) = delete;
+                ScopedRegion &operator=(const ScopedRegion &) = delete;
+
+        private:
+                PowerMonitor &monitor_;
+                int id_;
+        };
+
 } // namespace jetpwmon
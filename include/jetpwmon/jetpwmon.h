@@ -31,7 +31,8 @@ typedef enum {
     PM_ERROR_NO_SENSORS = -6,        /**< No power sensors found */
     PM_ERROR_FILE_ACCESS = -7,       /**< Error accessing sensor files */
     PM_ERROR_MEMORY = -8,            /**< Memory allocation error */
-    PM_ERROR_THREAD = -9             /**< Thread creation/management error */
+    PM_ERROR_THREAD = -9,            /**< Thread creation/management error */
+    PM_ERROR_NOT_SUPPORTED = -10     /**< Operation not supported by this handle */
 } pm_error_t;
 
 /**
@@ -43,6 +44,50 @@ typedef enum {
     PM_SENSOR_TYPE_SYSTEM = 2        /**< System power supply */
 } pm_sensor_type_t;
 
+/**
+ * @brief I/O strategies used by the sampler to read sensor attributes
+ */
+typedef enum {
+    PM_IO_BACKEND_PREAD = 0,         /**< Cached fds re-read with pread() (default) */
+    PM_IO_BACKEND_STDIO = 1,         /**< fopen()/fgets()/fclose() on every read */
+    PM_IO_BACKEND_IO_URING = 2       /**< One io_uring batch per tick, falls back to pread() */
+} pm_io_backend_t;
+
+/**
+ * @brief Scheduling policies for the sampling thread
+ */
+typedef enum {
+    PM_SCHED_OTHER = 0,              /**< Default time-sharing scheduler */
+    PM_SCHED_FIFO = 1,               /**< SCHED_FIFO real-time policy */
+    PM_SCHED_RR = 2                  /**< SCHED_RR real-time policy */
+} pm_sched_policy_t;
+
+/**
+ * @brief Sampler settings reported by pm_get_sampler_report()
+ */
+typedef enum {
+    PM_SAMPLER_SETTING_POLICY = 0x1,      /**< Scheduling policy and priority */
+    PM_SAMPLER_SETTING_AFFINITY = 0x2,    /**< CPU affinity */
+    PM_SAMPLER_SETTING_MLOCK = 0x4,       /**< Locked process memory */
+    PM_SAMPLER_SETTING_TIMER_SLACK = 0x8  /**< Timer slack */
+} pm_sampler_setting_t;
+
+/**
+ * @brief What the sample history does when it is full
+ */
+typedef enum {
+    PM_OVERFLOW_DROP_OLDEST = 0,     /**< Overwrite the oldest samples (readers count them as lost) */
+    PM_OVERFLOW_DROP_NEWEST = 1      /**< Discard new ticks until the reader catches up */
+} pm_overflow_policy_t;
+
+/**
+ * @brief Weighting of a power histogram quantile
+ */
+typedef enum {
+    PM_WEIGHT_SAMPLES = 0,           /**< Every sample counts once */
+    PM_WEIGHT_TIME = 1               /**< Samples count for the time they cover (power residency) */
+} pm_weight_t;
+
 /**
  * @brief Power data for a single sensor
  */
@@ -60,13 +105,21 @@ typedef struct {
 
 /**
  * @brief Statistical data
+ *
+ * The average and m2 follow Welford's algorithm and the total is a
+ * compensated sum, so both stay accurate over billions of samples.
+ * Statistics of disjoint intervals merge with pm_stats_merge().
  */
 typedef struct {
     double min;                      /**< Minimum value */
     double max;                      /**< Maximum value */
     double avg;                      /**< Average value */
-    double total;                    /**< Sum of all samples */
+    double total;                    /**< Sum of all samples (not an energy, see pm_sensor_stats_t) */
     uint64_t count;                  /**< Number of samples */
+    double compensation;             /**< Rounding error of total, which total + compensation corrects */
+    double m2;                       /**< Sum of squared deviations from the average */
+    double variance;                 /**< Sample variance, m2 / (count - 1) */
+    double stddev;                   /**< Sample standard deviation */
 } pm_stats_t;
 
 /**
@@ -77,6 +130,9 @@ typedef struct {
     pm_stats_t voltage;              /**< Voltage statistics */
     pm_stats_t current;              /**< Current statistics */
     pm_stats_t power;                /**< Power statistics */
+    double energy;                   /**< Energy in joules, power integrated over sample timestamps */
+    double duration;                 /**< Time covered by energy in seconds */
+    double avg_power;                /**< Time-weighted average power in watts (energy / duration) */
 } pm_sensor_stats_t;
 
 /**
@@ -97,22 +153,269 @@ typedef struct {
     int sensor_count;                /**< Number of sensors */
 } pm_power_stats_t;
 
+/**
+ * @brief Scheduler accounting of the sampling thread
+ *
+ * Ticks are scheduled on absolute CLOCK_MONOTONIC deadlines. A tick that
+ * finishes after its next deadline counts as an overrun, and the deadlines
+ * it passed are skipped rather than sampled back to back.
+ */
+typedef struct {
+    uint64_t period_ns;              /**< Period used for the last tick */
+    uint64_t ticks;                  /**< Number of ticks executed */
+    uint64_t overruns;               /**< Ticks that ran past the next deadline */
+    uint64_t missed_ticks;           /**< Deadlines skipped because of overruns */
+    uint64_t last_tick_ns;           /**< Duration of the last tick */
+    uint64_t max_tick_ns;            /**< Longest tick duration */
+    uint64_t last_lateness_ns;       /**< Wakeup delay past the last deadline */
+    uint64_t max_lateness_ns;        /**< Largest wakeup delay past a deadline */
+} pm_sampler_stats_t;
+
+/**
+ * @brief Execution settings of the sampling thread
+ *
+ * A zero-initialized structure keeps the defaults: the time-sharing
+ * scheduler, no CPU pinning, unlocked memory and the default timer slack.
+ */
+typedef struct {
+    pm_sched_policy_t policy;        /**< Scheduling policy */
+    int priority;                    /**< Real-time priority for PM_SCHED_FIFO/PM_SCHED_RR */
+    bool pin_cpu;                    /**< Whether to pin the sampler to cpu */
+    int cpu;                         /**< CPU to run the sampler on when pin_cpu is set */
+    bool lock_memory;                /**< Lock the memory of the whole process with mlockall() while
+                                          sampling; it stays locked if the process had locked memory
+                                          before pm_start_sampling() */
+    uint64_t timer_slack_ns;         /**< Sampler timer slack, 0 to keep the default */
+} pm_sampler_config_t;
+
+/**
+ * @brief Outcome of applying a pm_sampler_config_t at pm_start_sampling()
+ */
+typedef struct {
+    uint32_t requested;              /**< PM_SAMPLER_SETTING_* bits asked for by the config */
+    uint32_t applied;                /**< PM_SAMPLER_SETTING_* bits that took effect */
+    int policy_errno;                /**< errno of the failed policy change, 0 otherwise */
+    int affinity_errno;              /**< errno of the failed affinity change, 0 otherwise */
+    int mlock_errno;                 /**< errno of the failed mlockall(), 0 otherwise */
+    int timer_slack_errno;           /**< errno of the failed timer slack change, 0 otherwise */
+} pm_sampler_report_t;
+
+/**
+ * @brief One timestamped rail reading in the sample history
+ *
+ * Every tick appends one sample per rail followed by one for the total.
+ */
+typedef struct {
+    uint64_t seq;                    /**< Sequence number of the sample */
+    uint64_t timestamp_ns;           /**< CLOCK_MONOTONIC time of the tick */
+    int16_t rail;                    /**< Index into the sensors array, -1 for the total */
+    bool online;                     /**< Whether the rail could be read */
+    float voltage;                   /**< Voltage in volts */
+    float current;                   /**< Current in amperes */
+    float power;                     /**< Power in watts */
+} pm_sample_t;
+
+/**
+ * @brief Counters of the sample history
+ */
+typedef struct {
+    int capacity;                    /**< Samples the history holds, 0 if disabled */
+    pm_overflow_policy_t policy;     /**< Overflow policy */
+    uint64_t written;                /**< Samples written, i.e. the next sequence number */
+    uint64_t dropped;                /**< Samples discarded by PM_OVERFLOW_DROP_NEWEST */
+    uint64_t lost;                   /**< Samples overwritten before a reader got to them */
+} pm_history_stats_t;
+
+/**
+ * @brief Counters of the recording, see pm_record_start()
+ */
+typedef struct {
+    bool recording;                  /**< Whether a recording is running */
+    uint64_t ticks;                  /**< Ticks written to the file */
+    uint64_t blocks;                 /**< Blocks written to the file */
+    uint64_t dropped;                /**< Ticks lost because the writer fell behind */
+} pm_record_stats_t;
+
+/**
+ * @brief Maximum number of sliding windows, see pm_configure_windows()
+ */
+#define PM_MAX_WINDOWS 8
+
+/**
+ * @brief Power statistics over a sliding window
+ *
+ * Covers the ticks of the last window_ns; offline readings are left out.
+ * In each pm_stats_t, total is the sum of the power samples in the window.
+ */
+typedef struct {
+    uint64_t window_ns;              /**< Configured window length */
+    uint64_t span_ns;                /**< Time from the oldest to the newest tick in the window */
+    pm_stats_t total;                /**< Power statistics of the total */
+    pm_stats_t* sensors;             /**< Power statistics per sensor */
+    int sensor_count;                /**< Number of sensors */
+} pm_window_stats_t;
+
+/**
+ * @brief Maximum number of rollup tiers, see pm_configure_rollups()
+ */
+#define PM_MAX_ROLLUP_TIERS 8
+
+/**
+ * @brief Resolution and length of a rollup tier
+ */
+typedef struct {
+    uint64_t resolution_ns;          /**< Bucket length, e.g. 1 s, 10 s, 1 min */
+    int capacity;                    /**< Buckets kept; the oldest are overwritten */
+} pm_rollup_tier_t;
+
+/**
+ * @brief Aggregate of one rail over one rollup bucket
+ */
+typedef struct {
+    uint64_t start_ns;               /**< CLOCK_MONOTONIC start of the bucket, a multiple of the resolution */
+    uint64_t count;                  /**< Online samples in the bucket */
+    double min;                      /**< Minimum power in watts */
+    double max;                      /**< Maximum power in watts */
+    double avg;                      /**< Mean power of the samples in watts */
+    double energy;                   /**< Energy in joules integrated by the ticks of the bucket */
+} pm_rollup_point_t;
+
+/**
+ * @brief Number of bins of a power histogram
+ *
+ * Bin 0 holds powers below 2^-10 W (about 1 mW), including zero; the last
+ * bin holds powers of 1024 W and more. In between, every power of two is
+ * split into 64 equal bins, so quantiles are within 1% of the true value.
+ */
+#define PM_HISTOGRAM_BINS 1282
+
+/**
+ * @brief Fixed-size streaming power histogram of one rail
+ *
+ * Histograms of the same rail can be added bin by bin with
+ * pm_histogram_merge(), e.g. across statistics resets or sessions.
+ */
+typedef struct {
+    uint64_t count;                      /**< Samples recorded */
+    double duration;                     /**< Seconds recorded */
+    uint64_t samples[PM_HISTOGRAM_BINS]; /**< Samples per bin */
+    double seconds[PM_HISTOGRAM_BINS];   /**< Seconds spent per bin */
+} pm_histogram_t;
+
+/**
+ * @brief Maximum number of named regions, see pm_region_register()
+ */
+#define PM_MAX_REGIONS 256
+
+/**
+ * @brief Energy attributed to a code region
+ *
+ * Covers the completed instances of the region, i.e. matched
+ * pm_region_begin()/pm_region_end() pairs, against the total power.
+ */
+typedef struct {
+    char name[64];                   /**< Region name */
+    uint64_t count;                  /**< Completed instances */
+    uint64_t active;                 /**< Instances still open */
+    uint64_t duration_ns;            /**< Summed duration of the completed instances */
+    double energy;                   /**< Summed energy of the completed instances in joules */
+    double avg_power;                /**< Energy divided by duration in watts */
+    double peak_power;               /**< Highest total power within any completed instance */
+    uint64_t dropped;                /**< Markers lost to a full queue or without a matching begin */
+} pm_region_stats_t;
+
 /**
  * @brief Library handle
  */
 typedef struct pm_handle_s* pm_handle_t;
 
+/**
+ * @brief Measurement session, see pm_session_open()
+ */
+typedef struct pm_session_s* pm_session_t;
+
+/**
+ * @brief Options of pm_init_config()
+ *
+ * A zero-initialized structure reads the sensors found in sysfs.
+ */
+typedef struct {
+    const char* replay_path;         /**< Trace replayed as the sensors, NULL to read sysfs */
+    double replay_speed;             /**< Trace seconds per second, 0 to advance one recorded tick per sample */
+    bool replay_loop;                /**< Restart the trace at its end instead of reporting the rails offline */
+    const char* synthetic;           /**< Waveforms generated as the sensors, NULL to read sysfs */
+    const char* sysfs_root;          /**< Directory standing in for /sys, NULL for JETPWMON_SYSFS_ROOT or /sys */
+    const char* discovery_cache;     /**< File caching the sysfs rails for this boot, NULL for JETPWMON_DISCOVERY_CACHE or none */
+} pm_config_t;
+
 /**
  * @brief Initialize the power monitor
  *
  * This function discovers power sensors on the system and initializes
  * the power monitor library.
  *
+ * If the environment variable JETPWMON_REPLAY names a trace, it is replayed
+ * instead, at JETPWMON_REPLAY_SPEED (default 1, real time) and looped if
+ * JETPWMON_REPLAY_LOOP is set to 1; otherwise the waveforms given in
+ * JETPWMON_SYNTHETIC are generated; see pm_init_config(). Sensors are
+ * discovered under JETPWMON_SYSFS_ROOT instead of /sys if it is set, and
+ * cached for the boot in the file named by JETPWMON_DISCOVERY_CACHE.
+ *
  * @param[out] handle Pointer to store the library handle
  * @return Error code
  */
 pm_error_t pm_init(pm_handle_t* handle);
 
+/**
+ * @brief Initialize the power monitor with options
+ *
+ * With a replay_path, the rails of a recorded trace stand in for the
+ * sensors and every other function works as with real hardware, which makes
+ * tests and benchmarks reproducible on any machine. The trace is either a
+ * recording of pm_record_start() or a CSV file whose header names the time
+ * column and then a voltage and a current column per rail, e.g.
+ * "time_s,VDD_IN_V,VDD_IN_A,VDD_SOC_V,VDD_SOC_A", with times in seconds,
+ * volts and amperes; an empty field marks the rail offline in that row.
+ *
+ * The trace starts with the first sample taken. At a replay_speed above 0
+ * each sample reads the trace at the elapsed time multiplied by the speed;
+ * at 0 every sample takes the next recorded tick, so pm_sample_now() steps
+ * through the trace deterministically. Sample timestamps follow the trace,
+ * so energy integrates over trace time at any speed. Once the trace ends
+ * the rails read offline unless replay_loop is set.
+ *
+ * A sysfs_root makes this handle discover its sensors in another directory
+ * holding the same layout as /sys (bus/i2c/devices and class/power_supply),
+ * e.g. a simulated tree; other handles are unaffected.
+ *
+ * With a discovery_cache (or JETPWMON_DISCOVERY_CACHE), the rails found in
+ * sysfs are written to that file with the boot id of
+ * /proc/sys/kernel/random/boot_id. Later calls in the same boot, for the
+ * same sysfs root, take the rails from the file instead of scanning and
+ * printing them, as long as it belongs to the user, is not writable by others
+ * and all its attribute files still exist; otherwise sysfs is scanned and the
+ * file rewritten. Delete the file to force a scan.
+ *
+ * Without a replay_path, a synthetic spec generates the rails in memory with
+ * no file I/O, to measure the software overhead of sampling at high rates.
+ * The spec lists rails separated by ';', each "name=wave:params" with an
+ * optional "@volts" suffix (default 5 V); the power in watts follows one of
+ * - const:power
+ * - step:low,high,period_s (square wave, low for the first half period)
+ * - sine:mean,amplitude,frequency_hz
+ * - walk:start,step,max (random walk of up to +-step per sample within [0, max])
+ * - burst:idle,peak,rate_hz,length_s (bursts of peak power arriving at random)
+ * e.g. "VDD_IN=sine:8,3,2;VDD_GPU=burst:0.5,9,5,0.02@19". The spec "default"
+ * generates one rail of each kind but const. Random waveforms are seeded
+ * identically for every handle.
+ *
+ * @param[out] handle Pointer to store the library handle
+ * @param config Options, NULL for the defaults of pm_init()
+ * @return Error code, PM_ERROR_FILE_ACCESS if the trace cannot be read,
+ *         PM_ERROR_INIT_FAILED if it or the synthetic spec is malformed or empty
+ */
+pm_error_t pm_init_config(pm_handle_t* handle, const pm_config_t* config);
+
 /**
  * @brief Clean up resources
  *
@@ -127,6 +430,9 @@ pm_error_t pm_cleanup(pm_handle_t handle);
 /**
  * @brief Set the sampling frequency
  *
+ * Equivalent to pm_set_sampling_period_ns() with a period of
+ * 1e9 / frequency_hz nanoseconds.
+ *
  * @param handle Library handle
  * @param frequency_hz Sampling frequency in Hz (must be > 0)
  * @return Error code
@@ -136,12 +442,121 @@ pm_error_t pm_set_sampling_frequency(pm_handle_t handle, int frequency_hz);
 /**
  * @brief Get the current sampling frequency
  *
+ * The frequency is derived from the sampling period and rounded to the
+ * nearest Hz, with a floor of 1 Hz for periods longer than two seconds.
+ * Callers that need the exact rate should use pm_get_sampling_period_ns().
+ *
  * @param handle Library handle
  * @param[out] frequency_hz Pointer to store the frequency
  * @return Error code
  */
 pm_error_t pm_get_sampling_frequency(pm_handle_t handle, int* frequency_hz);
 
+/**
+ * @brief Set the sampling period
+ *
+ * May be called while sampling is active; the new period applies from the
+ * next tick.
+ *
+ * @param handle Library handle
+ * @param period_ns Sampling period in nanoseconds (must be > 0)
+ * @return Error code
+ */
+pm_error_t pm_set_sampling_period_ns(pm_handle_t handle, uint64_t period_ns);
+
+/**
+ * @brief Get the sampling period
+ *
+ * @param handle Library handle
+ * @param[out] period_ns Pointer to store the period in nanoseconds
+ * @return Error code
+ */
+pm_error_t pm_get_sampling_period_ns(pm_handle_t handle, uint64_t* period_ns);
+
+/**
+ * @brief Get the scheduler accounting of the sampling thread
+ *
+ * The counters are reset by pm_start_sampling() and remain readable after
+ * pm_stop_sampling().
+ *
+ * @param handle Library handle
+ * @param[out] stats Pointer to store the accounting
+ * @return Error code
+ */
+pm_error_t pm_get_sampler_stats(pm_handle_t handle, pm_sampler_stats_t* stats);
+
+/**
+ * @brief Configure how the sampling thread runs
+ *
+ * The settings are applied by the sampling thread when pm_start_sampling()
+ * starts it. They are best effort: a setting the process is not permitted to
+ * make (e.g. a real-time policy without CAP_SYS_NICE) does not prevent
+ * sampling, and pm_get_sampler_report() tells which ones took effect. Memory
+ * locked by the sampler is unlocked again by pm_stop_sampling().
+ *
+ * @param handle Library handle
+ * @param config Sampler settings
+ * @return Error code, PM_ERROR_ALREADY_RUNNING while sampling
+ */
+pm_error_t pm_set_sampler_config(pm_handle_t handle, const pm_sampler_config_t* config);
+
+/**
+ * @brief Get the sampler settings
+ *
+ * @param handle Library handle
+ * @param[out] config Pointer to store the settings
+ * @return Error code
+ */
+pm_error_t pm_get_sampler_config(pm_handle_t handle, pm_sampler_config_t* config);
+
+/**
+ * @brief Report which sampler settings took effect
+ *
+ * Describes the most recent pm_start_sampling(); all zero before sampling
+ * was ever started.
+ *
+ * @param handle Library handle
+ * @param[out] report Pointer to store the report
+ * @return Error code
+ */
+pm_error_t pm_get_sampler_report(pm_handle_t handle, pm_sampler_report_t* report);
+
+/**
+ * @brief Select the I/O backend used to read sensor attributes
+ *
+ * The backend is applied the next time the sensor files are opened, so it
+ * cannot be changed while sampling is active. PM_IO_BACKEND_IO_URING falls
+ * back to PM_IO_BACKEND_PREAD when io_uring is not available at runtime.
+ *
+ * @param handle Library handle
+ * @param backend Requested backend
+ * @return Error code
+ */
+pm_error_t pm_set_io_backend(pm_handle_t handle, pm_io_backend_t backend);
+
+/**
+ * @brief Get the I/O backend in effect
+ *
+ * Returns the backend actually used by the sampler, which differs from the
+ * requested one when io_uring was requested but is unavailable.
+ *
+ * @param handle Library handle
+ * @param[out] backend Pointer to store the backend
+ * @return Error code
+ */
+pm_error_t pm_get_io_backend(pm_handle_t handle, pm_io_backend_t* backend);
+
+/**
+ * @brief Take a single sample synchronously
+ *
+ * Reads all sensors once in the calling thread and updates the latest data
+ * and the statistics, exactly like one tick of the sampling thread.
+ *
+ * @param handle Library handle
+ * @return Error code
+ */
+pm_error_t pm_sample_now(pm_handle_t handle);
+
 /**
  * @brief Start sampling
  *
@@ -179,7 +594,12 @@ pm_error_t pm_is_sampling(pm_handle_t handle, bool* is_sampling);
  * in the output structure to point to the library's internal buffer.
  * The caller must NOT free or modify the sensors pointer, as it points to
  * internal memory managed by the library. The pointer is only valid until
- * the next call to this function or pm_cleanup().
+ * the next call to this function from the same thread.
+ *
+ * The buffer holds a consistent copy of one tick and is not written by the
+ * sampler. Each thread has its own buffer, shared by all handles, so
+ * concurrent callers neither wait for nor overwrite each other. Threads
+ * that keep several results should use pm_read_latest_data() instead.
  *
  * @param handle Library handle
  * @param[out] data Pointer to store the data. The sensors pointer in this
@@ -188,6 +608,24 @@ pm_error_t pm_is_sampling(pm_handle_t handle, bool* is_sampling);
  */
 pm_error_t pm_get_latest_data(pm_handle_t handle, pm_power_data_t* data);
 
+/**
+ * @brief Copy the latest power data into caller storage
+ *
+ * The sampler publishes every tick as a complete snapshot; this function
+ * copies the newest one without taking any lock, so it never blocks the
+ * sampler or other readers and always returns values from a single tick.
+ *
+ * @param handle Library handle
+ * @param[out] data Pointer to store the data; its sensors pointer is set to sensors
+ * @param[out] sensors Array receiving the per-sensor data
+ * @param capacity Number of elements in sensors
+ * @param[out] generation Optional pointer to store the snapshot generation
+ * @return Error code, PM_ERROR_MEMORY if capacity is smaller than
+ *         data->sensor_count (which is always set)
+ */
+pm_error_t pm_read_latest_data(pm_handle_t handle, pm_power_data_t* data, pm_sensor_data_t* sensors,
+                               int capacity, uint64_t* generation);
+
 /**
  * @brief Get the power statistics
  *
@@ -195,7 +633,10 @@ pm_error_t pm_get_latest_data(pm_handle_t handle, pm_power_data_t* data);
  * in the output structure to point to the library's internal buffer.
  * The caller must NOT free or modify the sensors pointer, as it points to
  * internal memory managed by the library. The pointer is only valid until
- * the next call to this function or pm_cleanup().
+ * the next call to this function from the same thread.
+ *
+ * As with pm_get_latest_data(), the buffer belongs to the calling thread;
+ * pm_read_statistics() copies into caller storage instead.
  *
  * @param handle Library handle
  * @param[out] stats Pointer to store the statistics. The sensors pointer in this
@@ -204,6 +645,82 @@ pm_error_t pm_get_latest_data(pm_handle_t handle, pm_power_data_t* data);
  */
 pm_error_t pm_get_statistics(pm_handle_t handle, pm_power_stats_t* stats);
 
+/**
+ * @brief Copy the power statistics into caller storage
+ *
+ * Lock-free counterpart of pm_get_statistics(), see pm_read_latest_data().
+ *
+ * @param handle Library handle
+ * @param[out] stats Pointer to store the statistics; its sensors pointer is set to sensors
+ * @param[out] sensors Array receiving the per-sensor statistics
+ * @param capacity Number of elements in sensors
+ * @param[out] generation Optional pointer to store the snapshot generation
+ * @return Error code, PM_ERROR_MEMORY if capacity is smaller than
+ *         stats->sensor_count (which is always set)
+ */
+pm_error_t pm_read_statistics(pm_handle_t handle, pm_power_stats_t* stats, pm_sensor_stats_t* sensors,
+                              int capacity, uint64_t* generation);
+
+/**
+ * @brief Copy the power histogram of a sensor
+ *
+ * Every online sample is added to its rail's histogram, and the time between
+ * two online samples is split evenly between their bins, like the energy
+ * integration. Histograms are cleared by pm_reset_statistics(). The copy
+ * takes no lock; while sampling it may miss the tick being recorded.
+ *
+ * @param handle Library handle
+ * @param sensor Index of the sensor, -1 for the total
+ * @param[out] histogram Pointer to store the histogram
+ * @return Error code
+ */
+pm_error_t pm_get_power_histogram(pm_handle_t handle, int sensor, pm_histogram_t* histogram);
+
+/**
+ * @brief Add one power histogram into another
+ *
+ * @param[inout] histogram Histogram receiving the sum
+ * @param other Histogram to add
+ * @return Error code
+ */
+pm_error_t pm_histogram_merge(pm_histogram_t* histogram, const pm_histogram_t* other);
+
+/**
+ * @brief Estimate a quantile of a power histogram
+ *
+ * @param histogram Histogram to query
+ * @param quantile Quantile between 0 and 1, e.g. 0.99 for P99
+ * @param weight Whether samples or the time they cover are ranked
+ * @param[out] value Pointer to store the power in watts, 0 for an empty histogram
+ * @return Error code
+ */
+pm_error_t pm_histogram_quantile(const pm_histogram_t* histogram, double quantile, pm_weight_t weight,
+                                 double* value);
+
+/**
+ * @brief Merge the statistics of two disjoint intervals
+ *
+ * The result is the same as if all samples of other had been added to
+ * stats, up to rounding; e.g. to combine runs for an A/B comparison.
+ *
+ * @param[inout] stats Statistics receiving the merge
+ * @param other Statistics to merge in
+ * @return Error code
+ */
+pm_error_t pm_stats_merge(pm_stats_t* stats, const pm_stats_t* other);
+
+/**
+ * @brief Get the generation of the latest published snapshot
+ *
+ * The generation increases with every tick and every statistics reset, so
+ * pollers can cheaply tell whether there is anything new to read.
+ *
+ * @param handle Library handle
+ * @param[out] generation Pointer to store the generation
+ * @return Error code
+ */
+pm_error_t pm_get_generation(pm_handle_t handle, uint64_t* generation);
+
 /**
  * @brief Reset the statistics
  *
@@ -214,6 +731,319 @@ pm_error_t pm_get_statistics(pm_handle_t handle, pm_power_stats_t* stats);
  */
 pm_error_t pm_reset_statistics(pm_handle_t handle);
 
+/**
+ * @brief Open an independent measurement session
+ *
+ * A session records the lifetime statistics of the handle when it opens,
+ * and its statistics are the difference to them, so any number of
+ * consumers can measure their own intervals without pm_reset_statistics().
+ * Only the min and max of a session are tracked per tick.
+ *
+ * @param handle Library handle
+ * @param[out] session Pointer to store the session
+ * @return Error code
+ */
+pm_error_t pm_session_open(pm_handle_t handle, pm_session_t* session);
+
+/**
+ * @brief Copy the statistics of a session, optionally restarting it
+ *
+ * With restart, the session starts over at the tick the statistics were
+ * taken at, so back-to-back interval reports neither lose nor repeat a
+ * sample. Takes the sampler lock for the duration of the copy.
+ *
+ * @param handle Library handle
+ * @param session Session from pm_session_open()
+ * @param[out] stats Pointer to store the statistics; its sensors pointer is set to sensors
+ * @param[out] sensors Array receiving the per-sensor statistics
+ * @param capacity Number of elements in sensors
+ * @param restart Whether to restart the session after the copy
+ * @return Error code, PM_ERROR_MEMORY if capacity is smaller than
+ *         stats->sensor_count (which is always set)
+ */
+pm_error_t pm_session_read(pm_handle_t handle, pm_session_t session, pm_power_stats_t* stats,
+                           pm_sensor_stats_t* sensors, int capacity, bool restart);
+
+/**
+ * @brief Close a session
+ *
+ * Sessions still open are closed by pm_cleanup().
+ *
+ * @param handle Library handle
+ * @param session Session from pm_session_open()
+ * @return Error code
+ */
+pm_error_t pm_session_close(pm_handle_t handle, pm_session_t session);
+
+/**
+ * @brief Configure the sample history
+ *
+ * Allocates a ring of capacity samples that the sampler fills with every
+ * tick, so consumers can drain power traces in batches with
+ * pm_read_samples() instead of polling faster than the sampler. The history
+ * is disabled by default; reconfiguring it discards the samples it holds.
+ * Not while sampling. Threads reading samples meanwhile finish on the old
+ * ring, which is kept until pm_cleanup().
+ *
+ * @param handle Library handle
+ * @param capacity Number of samples to keep, 0 to disable the history; must
+ *                 hold at least one tick (sensor count + 1 samples)
+ * @param policy What to do when the history is full
+ * @return Error code
+ */
+pm_error_t pm_configure_history(pm_handle_t handle, int capacity, pm_overflow_policy_t policy);
+
+/**
+ * @brief Drain samples from the history
+ *
+ * Copies up to max samples starting at *cursor, the sequence number of the
+ * next sample to read, and advances *cursor past them. A cursor of 0 starts
+ * at the oldest sample still held. Several readers may drain concurrently
+ * with their own cursors; with PM_OVERFLOW_DROP_NEWEST the sampler waits for
+ * the furthest cursor returned, so that policy expects a single reader.
+ * When samples were overwritten before being read the cursor skips ahead and
+ * the gap shows in the sequence numbers and in pm_history_stats_t.lost.
+ *
+ * @param handle Library handle
+ * @param[out] buffer Array receiving the samples
+ * @param max Number of elements in buffer
+ * @param[inout] cursor Sequence number to read from; updated to the next one
+ * @param[out] count Pointer to store the number of samples copied
+ * @return Error code, PM_ERROR_INIT_FAILED if the history is not configured
+ */
+pm_error_t pm_read_samples(pm_handle_t handle, pm_sample_t* buffer, int max, uint64_t* cursor, int* count);
+
+/**
+ * @brief Get the counters of the sample history
+ *
+ * @param handle Library handle
+ * @param[out] stats Pointer to store the counters
+ * @return Error code
+ */
+pm_error_t pm_get_history_stats(pm_handle_t handle, pm_history_stats_t* stats);
+
+/**
+ * @brief Configure the sliding windows
+ *
+ * Every tick updates each window in amortized constant time, independently
+ * of pm_reset_statistics(). The rings are sized for the sampling period when
+ * sampling starts and grow when ticks arrive faster, up to about a million
+ * ticks per window; beyond that span_ns shows the time a window actually
+ * covers. Reconfiguring discards the ticks the windows hold. Not while
+ * sampling. Threads reading windows meanwhile finish on the old windows,
+ * which are kept until pm_cleanup().
+ *
+ * @param handle Library handle
+ * @param window_ns Array of window lengths in nanoseconds
+ * @param count Number of windows, 0 to disable them; at most PM_MAX_WINDOWS
+ * @return Error code
+ */
+pm_error_t pm_configure_windows(pm_handle_t handle, const uint64_t* window_ns, int count);
+
+/**
+ * @brief Copy the statistics of a sliding window into caller storage
+ *
+ * The windows are published after every tick; this function copies a
+ * consistent set without blocking the sampler.
+ *
+ * @param handle Library handle
+ * @param window Index of the window in the array given to pm_configure_windows()
+ * @param[out] stats Pointer to store the statistics; its sensors pointer is set to sensors
+ * @param[out] sensors Array receiving the per-sensor statistics
+ * @param capacity Number of elements in sensors
+ * @return Error code, PM_ERROR_MEMORY if capacity is smaller than
+ *         stats->sensor_count (which is always set)
+ */
+pm_error_t pm_get_window_statistics(pm_handle_t handle, int window, pm_window_stats_t* stats,
+                                    pm_stats_t* sensors, int capacity);
+
+/**
+ * @brief Configure the rollup tiers
+ *
+ * Every tier aggregates the ticks into buckets of resolution_ns aligned to
+ * CLOCK_MONOTONIC and keeps the last capacity buckets in a fixed ring, so
+ * e.g. 1 s, 10 s, 1 min and 10 min tiers give hours of history at a
+ * constant memory footprint. Tiers are independent of pm_reset_statistics().
+ * Reconfiguring discards the buckets. Not while sampling. Threads reading
+ * tiers meanwhile finish on the old tiers, which are kept until pm_cleanup().
+ *
+ * @param handle Library handle
+ * @param tiers Array of tier settings
+ * @param count Number of tiers, 0 to disable them; at most PM_MAX_ROLLUP_TIERS
+ * @return Error code
+ */
+pm_error_t pm_configure_rollups(pm_handle_t handle, const pm_rollup_tier_t* tiers, int count);
+
+/**
+ * @brief Get the settings of a rollup tier
+ *
+ * @param handle Library handle
+ * @param tier Index of the tier in the array given to pm_configure_rollups()
+ * @param[out] config Pointer to store the settings
+ * @return Error code
+ */
+pm_error_t pm_get_rollup_tier(pm_handle_t handle, int tier, pm_rollup_tier_t* config);
+
+/**
+ * @brief Read the buckets of a rollup tier that start within a time range
+ *
+ * Copies the buckets whose start_ns lies in [from_ns, to_ns), oldest first.
+ * Buckets without any tick are absent, and the newest bucket may still be
+ * filling. The copy takes no lock and never blocks the sampler.
+ *
+ * @param handle Library handle
+ * @param tier Index of the tier
+ * @param sensor Index of the sensor, -1 for the total
+ * @param from_ns Start of the range (CLOCK_MONOTONIC)
+ * @param to_ns End of the range, exclusive; UINT64_MAX for everything
+ * @param[out] points Array receiving the buckets
+ * @param max Number of elements in points
+ * @param[out] count Pointer to store the number of buckets copied
+ * @return Error code
+ */
+pm_error_t pm_read_rollup(pm_handle_t handle, int tier, int sensor, uint64_t from_ns, uint64_t to_ns,
+                          pm_rollup_point_t* points, int max, int* count);
+
+/**
+ * @brief Register a named code region
+ *
+ * Returns the id of the region with this name, registering it on first
+ * use. Registration takes the sampler lock, so look ids up once and keep
+ * them for pm_region_begin() and pm_region_end().
+ *
+ * @param handle Library handle
+ * @param name Region name, truncated to 63 characters
+ * @param[out] id Pointer to store the region id
+ * @return Error code, PM_ERROR_MEMORY once PM_MAX_REGIONS regions exist
+ */
+pm_error_t pm_region_register(pm_handle_t handle, const char* name, int* id);
+
+/**
+ * @brief Mark the start of a code region on the calling thread
+ *
+ * Takes a CLOCK_MONOTONIC timestamp and queues it without locks or
+ * syscalls. The sampler joins the markers against its power samples, so
+ * regions are resolved once a tick past their end has been taken. Regions
+ * may nest and may run on several threads at once; every end is matched
+ * with the innermost open begin of the same region on the same thread.
+ *
+ * @param handle Library handle
+ * @param id Region id from pm_region_register()
+ * @return Error code, PM_ERROR_MEMORY if the marker queue is full
+ */
+pm_error_t pm_region_begin(pm_handle_t handle, int id);
+
+/**
+ * @brief Mark the end of a code region on the calling thread
+ *
+ * @param handle Library handle
+ * @param id Region id from pm_region_register()
+ * @return Error code, PM_ERROR_MEMORY if the marker queue is full
+ */
+pm_error_t pm_region_end(pm_handle_t handle, int id);
+
+/**
+ * @brief Get the number of registered regions
+ *
+ * Region ids run from 0 to the count minus one.
+ *
+ * @param handle Library handle
+ * @param[out] count Pointer to store the count
+ * @return Error code
+ */
+pm_error_t pm_get_region_count(pm_handle_t handle, int* count);
+
+/**
+ * @brief Get the energy attributed to a code region
+ *
+ * Region statistics are kept since registration, independently of
+ * pm_reset_statistics(). The copy takes no lock and never blocks the
+ * sampler.
+ *
+ * @param handle Library handle
+ * @param id Region id
+ * @param[out] stats Pointer to store the statistics
+ * @return Error code
+ */
+pm_error_t pm_get_region_stats(pm_handle_t handle, int id, pm_region_stats_t* stats);
+
+/**
+ * @brief Start recording every tick to a file
+ *
+ * The sampler queues each tick as raw integer readings, without blocking on
+ * I/O; a background thread packs them into fixed-size blocks with a time and
+ * power index and appends them to @p path in the format described in
+ * jetpwmon/jetpwmon_record.h. Ticks the writer cannot keep up with are
+ * dropped and counted. Recording may start and stop while sampling.
+ *
+ * @param handle Library handle
+ * @param path File to create, truncated if it exists
+ * @return Error code, PM_ERROR_ALREADY_RUNNING if a recording is running,
+ *         PM_ERROR_FILE_ACCESS if the file cannot be written,
+ *         PM_ERROR_NOT_SUPPORTED with more than PM_RECORD_MAX_RAILS rails
+ */
+pm_error_t pm_record_start(pm_handle_t handle, const char* path);
+
+/**
+ * @brief Stop recording
+ *
+ * Writes the queued ticks and the last, partial block, then closes the
+ * file. A running recording is also stopped by pm_cleanup().
+ *
+ * @param handle Library handle
+ * @return Error code, PM_ERROR_NOT_RUNNING if no recording is running,
+ *         PM_ERROR_FILE_ACCESS if a write failed; the file then ends at the
+ *         last complete block
+ */
+pm_error_t pm_record_stop(pm_handle_t handle);
+
+/**
+ * @brief Get the counters of the recording
+ *
+ * @param handle Library handle
+ * @param[out] stats Pointer to store the counters; they are kept after
+ *                   pm_record_stop() until the next pm_record_start()
+ * @return Error code
+ */
+pm_error_t pm_get_record_stats(pm_handle_t handle, pm_record_stats_t* stats);
+
+/**
+ * @brief Publish the snapshots and the sample history to other processes
+ *
+ * Moves the snapshot ring and the sample history into the POSIX
+ * shared-memory segment @p name (e.g. "/jetpwmon"). Other processes open it
+ * with pm_attach_shared(). A segment of that name is replaced only if the
+ * process that published it no longer exists. The segment is unlinked by
+ * pm_cleanup(). Configure the history before publishing;
+ * pm_configure_history() is refused afterwards. Attached readers cannot hold
+ * the sampler back, so a PM_OVERFLOW_DROP_NEWEST history is not published.
+ *
+ * @param handle Library handle
+ * @param name Segment name, starting with '/'
+ * @return Error code, PM_ERROR_ALREADY_RUNNING while sampling,
+ *         PM_ERROR_NOT_SUPPORTED for a PM_OVERFLOW_DROP_NEWEST history,
+ *         PM_ERROR_FILE_ACCESS if the segment cannot be created or another
+ *         live process publishes under that name
+ */
+pm_error_t pm_publish_shared(pm_handle_t handle, const char* name);
+
+/**
+ * @brief Attach to the segment published by another process
+ *
+ * The segment is mapped read-only. The returned handle reads the
+ * publisher's data without locks or copies
+ * through pm_get_latest_data(), pm_read_latest_data(), pm_get_statistics(),
+ * pm_read_statistics(), pm_get_generation() and pm_read_samples(). It never
+ * samples: functions that would drive or reconfigure the sampler return
+ * PM_ERROR_NOT_SUPPORTED. Release it with pm_cleanup().
+ *
+ * @param[out] handle Pointer to store the attached handle
+ * @param name Segment name given to pm_publish_shared()
+ * @return Error code, PM_ERROR_FILE_ACCESS if the segment does not exist,
+ *         PM_ERROR_INIT_FAILED if it is incomplete or from another version
+ */
+pm_error_t pm_attach_shared(pm_handle_t* handle, const char* name);
+
 /**
  * @brief Get the number of sensors
  *
@@ -0,0 +1,111 @@
+/**
+ * @file jetpwmon_record.h
+ * @brief File format of the recordings written by pm_record_start()
+ * @author Qi Deng<dengqi935@gmail.com>
+ *
+ * A recording is a pm_record_header_t, then header.rail_count
+ * pm_record_rail_t, padded to header.header_size bytes. Fixed-size blocks of
+ * header.block_size bytes follow back to back, so block i starts at
+ * header_size + i * block_size. All fields are in host byte order.
+ *
+ * A block holds footer.tick_count ticks from its start, each a
+ * pm_record_tick_t followed by one pm_record_value_t per rail, and ends with
+ * its index: a pm_record_footer_t followed by rail_count + 1
+ * pm_record_range_t, the total last, in the last header.footer_size bytes.
+ * Blocks are written whole and in time order, so a reader can mmap the file
+ * and binary-search the footers for a time range without scanning samples.
+ * A file cut short by a crash simply ends after its last complete block.
+ */
+
+#ifndef JETPWMON_RECORD_H
+#define JETPWMON_RECORD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Magic at the start of a recording */
+#define PM_RECORD_MAGIC "JPWMREC"
+
+/** @brief Version of the format */
+#define PM_RECORD_VERSION 1
+
+/** @brief Magic of a block footer */
+#define PM_RECORD_BLOCK_MAGIC 0x4b434f4c42574d50ULL
+
+/** @brief Maximum number of rails in a recording, one bit each in the offline mask */
+#define PM_RECORD_MAX_RAILS 32
+
+/**
+ * @brief File header
+ */
+typedef struct {
+    char magic[8];               /**< PM_RECORD_MAGIC, NUL terminated */
+    uint32_t version;            /**< PM_RECORD_VERSION */
+    uint32_t header_size;        /**< Bytes before the first block */
+    uint32_t block_size;         /**< Bytes per block, footer included */
+    uint32_t tick_size;          /**< Bytes per tick, values included */
+    uint32_t footer_size;        /**< Bytes of the footer at the end of every block, ranges included */
+    uint32_t rail_count;         /**< Number of rails, the total excluded */
+    int32_t total_rail;          /**< Rail measuring the board input, -1 if the total is the sum of the rails */
+    uint32_t reserved;           /**< Zero */
+    uint64_t period_ns;          /**< Sampling period when the recording started */
+    uint64_t start_monotonic_ns; /**< CLOCK_MONOTONIC time the recording started */
+    uint64_t start_realtime_ns;  /**< CLOCK_REALTIME time the recording started */
+} pm_record_header_t;
+
+/**
+ * @brief Description of a rail, following the header
+ */
+typedef struct {
+    char name[64];               /**< Rail name */
+    uint32_t type;               /**< pm_sensor_type_t */
+    uint32_t reserved;           /**< Zero */
+    double volt_scale;           /**< Volts per voltage count */
+    double curr_scale;           /**< Amperes per current count */
+} pm_record_rail_t;
+
+/**
+ * @brief One tick in a block, followed by the rail values
+ */
+typedef struct {
+    uint32_t offset_us;          /**< Microseconds since footer.first_ns */
+    uint32_t offline;            /**< Bit i set if rail i could not be read */
+} pm_record_tick_t;
+
+/**
+ * @brief Raw reading of a rail; multiply by the rail's scales for volts and amperes
+ */
+typedef struct {
+    int32_t voltage;             /**< Voltage in counts */
+    int32_t current;             /**< Current in counts */
+} pm_record_value_t;
+
+/**
+ * @brief Index of a block, at its end
+ */
+typedef struct {
+    uint64_t magic;              /**< PM_RECORD_BLOCK_MAGIC */
+    uint64_t block;              /**< Index of the block in the file */
+    uint64_t first_ns;           /**< CLOCK_MONOTONIC time of the first tick */
+    uint64_t last_ns;            /**< CLOCK_MONOTONIC time of the last tick */
+    uint64_t dropped;            /**< Ticks the writer could not keep up with, up to this block */
+    uint32_t tick_count;         /**< Ticks in the block */
+    uint32_t reserved;           /**< Zero */
+} pm_record_footer_t;
+
+/**
+ * @brief Power range of a rail over a block; min > max if it was never online
+ */
+typedef struct {
+    float min_power;             /**< Minimum power in watts */
+    float max_power;             /**< Maximum power in watts */
+} pm_record_range_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JETPWMON_RECORD_H */
@@ -0,0 +1,108 @@
+/**
+ * @file jetpwmond.h
+ * @brief Wire protocol of the jetpwmond sampling daemon
+ * @author Qi Deng<dengqi935@gmail.com>
+ *
+ * jetpwmond streams the samples of its sensors to local clients over a Unix
+ * stream socket. Every message is a pmd_frame_header_t followed by length
+ * payload bytes. All fields are in host byte order.
+ *
+ * On connect the daemon sends PMD_MSG_HELLO. Nothing is streamed until the
+ * client sends PMD_MSG_SUBSCRIBE; the daemon then sends PMD_MSG_SAMPLES
+ * batches of the subscribed rails. A client that does not keep up has ticks
+ * dropped and its decimation raised until it catches up, the sampler never
+ * waits for it.
+ */
+
+#ifndef JETPWMOND_H
+#define JETPWMOND_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Version carried by every frame header */
+#define PMD_PROTOCOL_VERSION 1
+
+/** @brief Bit of the total in a rail mask; bit i is rail i */
+#define PMD_RAIL_TOTAL 63
+
+/** @brief Default socket path of the daemon */
+#define PMD_DEFAULT_SOCKET "/tmp/jetpwmond.sock"
+
+/**
+ * @brief Message types
+ */
+typedef enum {
+    PMD_MSG_HELLO = 1,     /**< Daemon to client: pmd_hello_t, then the rail names */
+    PMD_MSG_SUBSCRIBE = 2, /**< Client to daemon: pmd_subscribe_t */
+    PMD_MSG_SAMPLES = 3    /**< Daemon to client: pmd_samples_t, then the ticks */
+} pmd_msg_type_t;
+
+/**
+ * @brief Header of every frame
+ */
+typedef struct {
+    uint32_t length;  /**< Payload bytes following the header */
+    uint16_t type;    /**< pmd_msg_type_t */
+    uint16_t version; /**< PMD_PROTOCOL_VERSION */
+} pmd_frame_header_t;
+
+/**
+ * @brief Payload of PMD_MSG_HELLO
+ *
+ * Followed by rail_count + 1 names of 64 bytes, the total last.
+ */
+typedef struct {
+    uint64_t period_ns;  /**< Sampling period of the daemon */
+    uint32_t rail_count; /**< Number of rails, the total excluded */
+    uint32_t reserved;   /**< Zero */
+} pmd_hello_t;
+
+/**
+ * @brief Payload of PMD_MSG_SUBSCRIBE, replacing the previous subscription
+ */
+typedef struct {
+    uint64_t rails;      /**< Rail mask, PMD_RAIL_TOTAL for the total, 0 to pause */
+    uint32_t decimation; /**< Send every n-th tick, at least 1 */
+    uint32_t reserved;   /**< Zero */
+} pmd_subscribe_t;
+
+/**
+ * @brief Payload of PMD_MSG_SAMPLES
+ *
+ * Followed by tick_count records, each a pmd_tick_t and one pmd_reading_t
+ * per bit set in rails, in bit order.
+ */
+typedef struct {
+    uint64_t rails;      /**< Rails in every tick */
+    uint64_t dropped;    /**< Ticks dropped for this client so far */
+    uint32_t decimation; /**< Decimation in effect, raised while the client lags */
+    uint32_t tick_count; /**< Ticks in the batch */
+} pmd_samples_t;
+
+/**
+ * @brief One tick of a PMD_MSG_SAMPLES batch
+ */
+typedef struct {
+    uint64_t tick;         /**< Tick number since the daemon started */
+    uint64_t timestamp_ns; /**< CLOCK_MONOTONIC time of the tick */
+    uint64_t offline;      /**< Rail mask of the readings that failed */
+} pmd_tick_t;
+
+/**
+ * @brief One rail reading of a tick
+ */
+typedef struct {
+    float voltage; /**< Voltage in volts */
+    float current; /**< Current in amperes */
+    float power;   /**< Power in watts */
+} pmd_reading_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JETPWMOND_H */
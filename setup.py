@@ -9,7 +9,7 @@ ext_modules = [
         cxx_std=14,  # 使用C++14
         include_dirs=['include'],
         define_macros=[('VERSION_INFO', '0.1.2')],
-        libraries=['pthread'],  # 如果需要
+        libraries=['pthread', 'm', 'rt'],  # 如果需要
     ),
 ]
 
@@ -108,6 +108,50 @@ PowerData& PowerData::operator=(PowerData&& other) noexcept {
     return *this;
 }
 
+// Session implementation
+Session::Session(pm_handle_t handle, pm_session_t session)
+    : handle_(handle), session_(session) {}
+
+Session::~Session() {
+    if (session_) {
+        pm_session_close(handle_, session_);
+    }
+}
+
+Session::Session(Session&& other) noexcept
+    : handle_(other.handle_)
+    , session_(other.session_) {
+    other.session_ = nullptr;
+}
+
+Session& Session::operator=(Session&& other) noexcept {
+    if (this != &other) {
+        if (session_) {
+            pm_session_close(handle_, session_);
+        }
+        handle_ = other.handle_;
+        session_ = other.session_;
+        other.session_ = nullptr;
+    }
+    return *this;
+}
+
+PowerStats Session::read(bool restart) {
+    int count = 0;
+    pm_error_t error = pm_get_sensor_count(handle_, &count);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+
+    std::vector<pm_sensor_stats_t> sensors(count);
+    pm_power_stats_t stats;
+    error = pm_session_read(handle_, session_, &stats, sensors.data(), count, restart);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return PowerStats(stats);
+}
+
 // PowerMonitor implementation
 PowerMonitor::PowerMonitor() : handle_(nullptr) {
     pm_handle_t handle;
@@ -118,8 +162,28 @@ PowerMonitor::PowerMonitor() : handle_(nullptr) {
     handle_.reset(new pm_handle_t(handle));
 }
 
+PowerMonitor::PowerMonitor(const pm_config_t& config) : handle_(nullptr) {
+    pm_handle_t handle;
+    pm_error_t error = pm_init_config(&handle, &config);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    handle_.reset(new pm_handle_t(handle));
+}
+
+PowerMonitor::PowerMonitor(pm_handle_t handle) : handle_(new pm_handle_t(handle)) {}
+
 PowerMonitor::~PowerMonitor() = default;
 
+PowerMonitor PowerMonitor::attachShared(const std::string& name) {
+    pm_handle_t handle;
+    pm_error_t error = pm_attach_shared(&handle, name.c_str());
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return PowerMonitor(handle);
+}
+
 PowerMonitor::PowerMonitor(PowerMonitor&& other) noexcept
     : handle_(std::move(other.handle_)) {}
 
@@ -146,6 +210,56 @@ int PowerMonitor::getSamplingFrequency() const {
     return frequency_hz;
 }
 
+void PowerMonitor::setSamplingPeriodNs(uint64_t period_ns) {
+    pm_error_t error = pm_set_sampling_period_ns(*handle_.get(), period_ns);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+uint64_t PowerMonitor::getSamplingPeriodNs() const {
+    uint64_t period_ns;
+    pm_error_t error = pm_get_sampling_period_ns(*handle_.get(), &period_ns);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return period_ns;
+}
+
+pm_sampler_stats_t PowerMonitor::getSamplerStats() const {
+    pm_sampler_stats_t stats;
+    pm_error_t error = pm_get_sampler_stats(*handle_.get(), &stats);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return stats;
+}
+
+void PowerMonitor::setSamplerConfig(const pm_sampler_config_t& config) {
+    pm_error_t error = pm_set_sampler_config(*handle_.get(), &config);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+pm_sampler_config_t PowerMonitor::getSamplerConfig() const {
+    pm_sampler_config_t config;
+    pm_error_t error = pm_get_sampler_config(*handle_.get(), &config);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return config;
+}
+
+pm_sampler_report_t PowerMonitor::getSamplerReport() const {
+    pm_sampler_report_t report;
+    pm_error_t error = pm_get_sampler_report(*handle_.get(), &report);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return report;
+}
+
 void PowerMonitor::startSampling() {
     pm_error_t error = pm_start_sampling(*handle_.get());
     if (error != PM_SUCCESS) {
@@ -170,8 +284,11 @@ bool PowerMonitor::isSampling() const {
 }
 
 PowerData PowerMonitor::getLatestData() const {
+    // Copy into local storage so concurrent callers never share a buffer
+    int count = getSensorCount();
+    std::vector<pm_sensor_data_t> sensors(count);
     pm_power_data_t data;
-    pm_error_t error = pm_get_latest_data(*handle_.get(), &data);
+    pm_error_t error = pm_read_latest_data(*handle_.get(), &data, sensors.data(), count, nullptr);
     if (error != PM_SUCCESS) {
         throw std::runtime_error(pm_error_string(error));
     }
@@ -179,14 +296,26 @@ PowerData PowerMonitor::getLatestData() const {
 }
 
 PowerStats PowerMonitor::getStatistics() const {
+    // Copy into local storage so concurrent callers never share a buffer
+    int count = getSensorCount();
+    std::vector<pm_sensor_stats_t> sensors(count);
     pm_power_stats_t stats;
-    pm_error_t error = pm_get_statistics(*handle_.get(), &stats);
+    pm_error_t error = pm_read_statistics(*handle_.get(), &stats, sensors.data(), count, nullptr);
     if (error != PM_SUCCESS) {
         throw std::runtime_error(pm_error_string(error));
     }
     return PowerStats(stats);
 }
 
+Session PowerMonitor::openSession() {
+    pm_session_t session;
+    pm_error_t error = pm_session_open(*handle_.get(), &session);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return Session(*handle_.get(), session);
+}
+
 void PowerMonitor::resetStatistics() {
     pm_error_t error = pm_reset_statistics(*handle_.get());
     if (error != PM_SUCCESS) {
@@ -194,6 +323,165 @@ void PowerMonitor::resetStatistics() {
     }
 }
 
+void PowerMonitor::configureHistory(int capacity, pm_overflow_policy_t policy) {
+    pm_error_t error = pm_configure_history(*handle_.get(), capacity, policy);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+std::vector<pm_sample_t> PowerMonitor::readSamples(uint64_t& cursor, int max) const {
+    std::vector<pm_sample_t> samples(max > 0 ? max : 0);
+    int count = 0;
+    pm_error_t error = pm_read_samples(*handle_.get(), samples.data(), max, &cursor, &count);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    samples.resize(count);
+    return samples;
+}
+
+pm_history_stats_t PowerMonitor::getHistoryStats() const {
+    pm_history_stats_t stats;
+    pm_error_t error = pm_get_history_stats(*handle_.get(), &stats);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return stats;
+}
+
+void PowerMonitor::startRecording(const std::string& path) {
+    pm_error_t error = pm_record_start(*handle_.get(), path.c_str());
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+void PowerMonitor::stopRecording() {
+    pm_error_t error = pm_record_stop(*handle_.get());
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+pm_record_stats_t PowerMonitor::getRecordStats() const {
+    pm_record_stats_t stats;
+    pm_error_t error = pm_get_record_stats(*handle_.get(), &stats);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return stats;
+}
+
+void PowerMonitor::publishShared(const std::string& name) {
+    pm_error_t error = pm_publish_shared(*handle_.get(), name.c_str());
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+void PowerMonitor::configureWindows(const std::vector<uint64_t>& window_ns) {
+    pm_error_t error = pm_configure_windows(*handle_.get(), window_ns.data(), static_cast<int>(window_ns.size()));
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+WindowStats PowerMonitor::getWindowStatistics(int window) const {
+    int count = getSensorCount();
+    std::vector<pm_stats_t> sensors(count);
+    pm_window_stats_t stats;
+    pm_error_t error = pm_get_window_statistics(*handle_.get(), window, &stats, sensors.data(), count);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return WindowStats(stats);
+}
+
+void PowerMonitor::configureRollups(const std::vector<pm_rollup_tier_t>& tiers) {
+    pm_error_t error = pm_configure_rollups(*handle_.get(), tiers.data(), static_cast<int>(tiers.size()));
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+std::vector<pm_rollup_point_t> PowerMonitor::readRollup(int tier, int sensor, uint64_t from_ns, uint64_t to_ns) const {
+    pm_rollup_tier_t config;
+    pm_error_t error = pm_get_rollup_tier(*handle_.get(), tier, &config);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+
+    std::vector<pm_rollup_point_t> points(config.capacity);
+    int count = 0;
+    error = pm_read_rollup(*handle_.get(), tier, sensor, from_ns, to_ns, points.data(), config.capacity, &count);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    points.resize(count);
+    return points;
+}
+
+pm_histogram_t PowerMonitor::getPowerHistogram(int sensor) const {
+    pm_histogram_t histogram;
+    pm_error_t error = pm_get_power_histogram(*handle_.get(), sensor, &histogram);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return histogram;
+}
+
+double PowerMonitor::getPowerQuantile(int sensor, double quantile, pm_weight_t weight) const {
+    pm_histogram_t histogram = getPowerHistogram(sensor);
+    double value = 0.0;
+    pm_error_t error = pm_histogram_quantile(&histogram, quantile, weight, &value);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return value;
+}
+
+int PowerMonitor::registerRegion(const std::string &name) {
+    int id;
+    pm_error_t error = pm_region_register(*handle_.get(), name.c_str(), &id);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return id;
+}
+
+void PowerMonitor::beginRegion(int id) {
+    pm_error_t error = pm_region_begin(*handle_.get(), id);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+void PowerMonitor::endRegion(int id) {
+    pm_error_t error = pm_region_end(*handle_.get(), id);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+}
+
+int PowerMonitor::getRegionCount() const {
+    int count;
+    pm_error_t error = pm_get_region_count(*handle_.get(), &count);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return count;
+}
+
+pm_region_stats_t PowerMonitor::getRegionStats(int id) const {
+    pm_region_stats_t stats;
+    pm_error_t error = pm_get_region_stats(*handle_.get(), id, &stats);
+    if (error != PM_SUCCESS) {
+        throw std::runtime_error(pm_error_string(error));
+    }
+    return stats;
+}
+
 int PowerMonitor::getSensorCount() const {
     int count;
     pm_error_t error = pm_get_sensor_count(*handle_.get(), &count);
@@ -229,4 +517,16 @@ std::vector<std::string> PowerMonitor::getSensorNames() const {
     return result;
 }
 
+ScopedRegion::ScopedRegion(PowerMonitor &monitor, int id) : monitor_(monitor), id_(id) {
+    monitor_.beginRegion(id_);
+}
+
+ScopedRegion::~ScopedRegion() {
+    // A lost end marker shows up in pm_region_stats_t.dropped; destructors must not throw
+    try {
+        monitor_.endRegion(id_);
+    } catch (const std::runtime_error &) {
+    }
+}
+
 } // namespace jetpwmon
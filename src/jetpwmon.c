@@ -8,77 +8,740 @@
 #define _POSIX_C_SOURCE 200809L
 /* Define _XOPEN_SOURCE for usleep */
 #define _XOPEN_SOURCE 500
+/* Define _GNU_SOURCE for syscall(), MAP_POPULATE and thread CPU affinity */
+#define _GNU_SOURCE
 
 #include "jetpwmon/jetpwmon.h"
+#include "jetpwmon/jetpwmon_record.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>  /* For access() and usleep() */
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <dirent.h>
 #include <errno.h>
+#include <signal.h>
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <fcntl.h>
+#include <math.h>
+
+/* io_uring is used through raw syscalls when the kernel headers provide it */
+#if !defined(JETPWMON_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
 
 /* Default configuration */
 #define DEFAULT_SAMPLING_FREQUENCY_HZ 1
+#define NSEC_PER_SEC 1000000000ULL
 
-/* Paths for power sensors */
-#define I2C_PATH "/sys/bus/i2c/devices"
-#define POWER_SUPPLY_PATH "/sys/class/power_supply"
+/* Paths for power sensors, relative to the sysfs root */
+#define SYSFS_ROOT "/sys"
+#define I2C_PATH "/bus/i2c/devices"
+#define POWER_SUPPLY_PATH "/class/power_supply"
 
 /* Testing mode environment variable */
 #define ENV_JTOP_TESTING "JTOP_TESTING"
+#define JTOP_TESTING_ROOT "/fake_sys"
+
+/* Environment variable overriding the sysfs root (e.g. a synthetic tree) */
+#define ENV_SYSFS_ROOT "JETPWMON_SYSFS_ROOT"
+
+/* Environment variable naming the discovery cache, see pm_init_config() */
+#define ENV_DISCOVERY_CACHE "JETPWMON_DISCOVERY_CACHE"
+
+/* Environment variables selecting a trace to replay, see pm_init() */
+#define ENV_REPLAY "JETPWMON_REPLAY"
+#define ENV_REPLAY_SPEED "JETPWMON_REPLAY_SPEED"
+#define ENV_REPLAY_LOOP "JETPWMON_REPLAY_LOOP"
+
+/* Environment variable selecting synthetic rails, see pm_init() */
+#define ENV_SYNTHETIC "JETPWMON_SYNTHETIC"
+
+/* Rails of the synthetic spec "default" */
+#define SYNTH_DEFAULT_SPEC "VDD_IN=sine:8,3,2;VDD_CPU_GPU_CV=step:1,6,0.5;VDD_SOC=walk:2,0.01,4;VDD_GPU=burst:0.5,9,5,0.02"
+#define SYNTH_DEFAULT_VOLTAGE 5.0
+
+/* Backoff bounds for reopening a sensor attribute that went away */
+#define REOPEN_BACKOFF_MIN_MS 10
+#define REOPEN_BACKOFF_MAX_MS 1000
+
+/* Snapshot slots; a reader only retries when the sampler laps all of them */
+#define SNAPSHOT_SLOTS 4
+#define CACHE_LINE_SIZE 64
+
+/* Bounds of the ticks a sliding window holds */
+#define WINDOW_MIN_TICKS 2
+#define WINDOW_MAX_TICKS (1u << 20)
+
+/* Layout of pm_histogram_t: underflow bin, HISTOGRAM_SUB_BINS bins per power of two, overflow bin */
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_BINS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MIN_EXPONENT (-10)
+#define HISTOGRAM_MAX_EXPONENT 10
+
+/* Code region markers; the queue size must be a power of two */
+#define REGION_QUEUE_SIZE 4096
+#define REGION_MAX_OPEN 1024
+#define REGION_END_FLAG 0x80000000u
+#define REGION_CLOCK_TICKS 64
+
+/* Recording: blocks of the file, ticks queued for the writer and its flush interval */
+#define RECORD_BLOCK_SIZE 65536
+#define RECORD_HEADER_ALIGN 4096
+#define RECORD_QUEUE_TICKS 8192
+#define RECORD_FLUSH_MS 100
+
+/* Sensor sources behind a handle */
+#define BACKEND_MAX 8
+
+/* Shared-memory segment header; bump the version with any layout change */
+#define SHARED_MAGIC 0x4e4f4d5750544a00ULL
+#define SHARED_VERSION 2
+
+/* Discovery cache file; bump the version with any layout change */
+#define DISCOVERY_CACHE_MAGIC "JPWMDSC"
+#define DISCOVERY_CACHE_VERSION 2
+#define DISCOVERY_CACHE_MAX_RAILS 1024
+#define BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+
+#if PM_HISTOGRAM_BINS != 2 + (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_MIN_EXPONENT) * HISTOGRAM_SUB_BINS
+#error "PM_HISTOGRAM_BINS does not match the histogram layout"
+#endif
+
+/* Rail role flags */
+#define RAIL_FLAG_TOTAL_INPUT 0x1     /* Rail measures the whole board input */
+
+/* Immutable per-rail descriptor built once at discovery */
+typedef struct
+{
+        char name[64];                /* Rail name */
+        pm_sensor_type_t type;        /* Sensor type */
+        char volt_path[512];          /* Resolved voltage attribute path */
+        char curr_path[512];          /* Resolved current attribute path */
+        int channel;                  /* Channel parsed from the label file, -1 if none */
+        double volt_scale;            /* Raw voltage reading to volts */
+        double curr_scale;            /* Raw current reading to amperes */
+        unsigned int flags;           /* RAIL_FLAG_* role flags */
+        double warning_threshold;     /* Warning threshold in watts */
+        double critical_threshold;    /* Critical threshold in watts */
+} pm_rail_t;
+
+/* Header of the discovery cache file, followed by rail_count pm_cache_rail_t */
+typedef struct
+{
+        char magic[8];                /* DISCOVERY_CACHE_MAGIC, NUL terminated */
+        uint32_t version;             /* DISCOVERY_CACHE_VERSION */
+        uint32_t rail_count;          /* Rails following the header */
+        char boot_id[40];             /* Boot the rails were discovered in */
+        char i2c_path[256];           /* I2C folder that was scanned */
+        char power_supply_path[256];  /* Power supply folder that was scanned */
+} pm_cache_header_t;
+
+/* Rail of the discovery cache, as found by its source */
+typedef struct
+{
+        char source[16];              /* Name of the backend that found the rail */
+        char name[64];                /* Rail name */
+        int32_t type;                 /* pm_sensor_type_t */
+        int32_t channel;              /* Channel parsed from the label file, -1 if none */
+        char volt_path[512];          /* Voltage attribute path */
+        char curr_path[512];          /* Current attribute path */
+} pm_cache_rail_t;
+
+/* Previous reading of a rail for energy integration */
+typedef struct
+{
+        double power;                 /* Power of the previous tick in watts */
+        uint64_t timestamp_ns;        /* CLOCK_MONOTONIC time of the previous tick */
+        bool valid;                   /* Whether the previous tick was online */
+} pm_energy_state_t;
+
+/* Cached attribute file descriptors for a rail */
+typedef struct
+{
+        int volt_fd;                  /* Voltage attribute fd, -1 if closed */
+        int curr_fd;                  /* Current attribute fd, -1 if closed */
+        int reopen_backoff_ms;        /* Current reopen backoff, 0 if healthy */
+        struct timespec next_reopen;  /* Earliest time of the next reopen */
+        double volt_raw;              /* Raw voltage read this tick */
+        double curr_raw;              /* Raw current read this tick */
+        bool read_ok;                 /* Whether both reads succeeded this tick */
+} pm_sensor_fds_t;
+
+/* Header of one published snapshot, followed by the per-rail arrays */
+typedef struct
+{
+        uint64_t seq;                  /* Odd while the slot is being written */
+        uint64_t generation;           /* Publication held by the slot */
+        uint64_t timestamp_ns;         /* CLOCK_MONOTONIC time of the tick */
+        pm_sensor_data_t total;        /* Total data of the tick */
+        pm_sensor_stats_t total_stats; /* Total statistics including the tick */
+} pm_snapshot_slot_t;
+
+/* Seqlock-protected ring of snapshots, addressed by offsets so the block is relocatable */
+typedef struct
+{
+        uint64_t generation;           /* Latest published generation, 0 before the first */
+        uint32_t slot_count;           /* Number of slots */
+        uint32_t sensor_count;         /* Rails in every slot */
+        uint64_t slots_offset;         /* Offset of the first slot from the block */
+        uint64_t slot_size;            /* Bytes per slot, rail arrays included */
+        uint64_t sensors_offset;       /* Offset of pm_sensor_data_t[] within a slot */
+        uint64_t stats_offset;         /* Offset of pm_sensor_stats_t[] within a slot */
+} pm_snapshot_block_t;
+
+/* History slot; stamp is the sample's seq + 1 once complete, 0 while written */
+typedef struct
+{
+        uint64_t stamp;                /* Validity stamp checked by readers */
+        pm_sample_t sample;            /* The sample */
+} pm_history_slot_t;
+
+/* Ring of timestamped samples filled by the writer and drained by readers, relocatable like the snapshots */
+typedef struct
+{
+        uint64_t capacity;             /* Number of slots */
+        uint64_t slots_offset;         /* Offset of the first slot from the block */
+        pm_overflow_policy_t policy;   /* Overflow policy */
+        uint64_t head;                 /* Next sequence number, published per tick */
+        uint64_t consumed;             /* Furthest cursor returned to a reader */
+        uint64_t dropped;              /* Samples discarded by DROP_NEWEST */
+        uint64_t lost;                 /* Samples readers skipped because they were overwritten */
+} pm_history_t;
+
+/* A replaced block kept until pm_cleanup(), as lock-free readers may still use it */
+typedef struct pm_retired_s
+{
+        struct pm_retired_s *next;     /* Next retired block */
+        void *block;                   /* The block */
+        void (*release)(void *block);  /* Frees the block */
+} pm_retired_t;
+
+/* Header at the start of a shared-memory segment; the blocks follow at cache-line offsets */
+typedef struct
+{
+        uint64_t magic;                /* SHARED_MAGIC, stored last once the segment is complete */
+        uint32_t version;              /* SHARED_VERSION of the publisher */
+        int32_t publisher;             /* pid of the publisher, stored first so a stale segment can be told apart */
+        uint32_t sensor_count;         /* Rails in the snapshot block */
+        uint32_t data_size;            /* sizeof(pm_sensor_data_t) of the publisher */
+        uint32_t stats_size;           /* sizeof(pm_sensor_stats_t) of the publisher */
+        uint64_t size;                 /* Bytes of the segment */
+        uint64_t snapshot_offset;      /* Offset of the snapshot block */
+        uint64_t history_offset;       /* Offset of the history block, 0 if disabled */
+} pm_shared_header_t;
+
+/* Buffers handed out by pm_get_latest_data() and pm_get_statistics(), one set per thread */
+typedef struct
+{
+        pm_sensor_data_t *sensors;     /* Returned by pm_get_latest_data() */
+        pm_sensor_stats_t *stats;      /* Returned by pm_get_statistics() */
+        int capacity;                  /* Rails both arrays hold */
+} pm_reader_buffers_t;
+
+/* Per-column state of a sliding window; deque positions grow monotonically */
+typedef struct
+{
+        uint64_t min_front;            /* First entry of the min deque */
+        uint64_t min_back;             /* One past the last entry of the min deque */
+        uint64_t max_front;            /* First entry of the max deque */
+        uint64_t max_back;             /* One past the last entry of the max deque */
+        double shift;                  /* Reference value the sums are taken around */
+        double sum;                    /* Sum of value - shift over the window */
+        double squares;                /* Sum of (value - shift)^2 over the window */
+        uint64_t count;                /* Number of online values in the window */
+} pm_window_column_t;
+
+/* Rollup bucket; seq is odd while the sampler updates it */
+typedef struct
+{
+        uint64_t seq;                  /* Seqlock sequence of the slot */
+        uint64_t bucket;               /* Bucket number held by the slot */
+        pm_rollup_point_t points[];    /* Per rail, then the total */
+} pm_rollup_slot_t;
+
+/* Ring of rollup buckets of one tier */
+typedef struct
+{
+        uint64_t resolution_ns;        /* Bucket length */
+        uint64_t capacity;             /* Number of slots */
+        uint64_t next;                 /* Buckets started, published once the slot is initialized */
+        size_t slot_size;              /* Bytes per slot, points included */
+        char *slots;                   /* Slot storage */
+} pm_rollup_ring_t;
+
+/* The configured rollup tiers, replaced as a whole */
+typedef struct
+{
+        int count;                     /* Number of tiers */
+        pm_rollup_ring_t *rings;       /* Tiers, [count] */
+} pm_rollup_set_t;
+
+/* Sliding window over the ticks of the last window_ns; columns are the rails, then the total */
+typedef struct
+{
+        uint64_t window_ns;            /* Window length */
+        uint64_t capacity;             /* Ticks the rings hold */
+        uint64_t head;                 /* Number of ticks pushed */
+        uint64_t tail;                 /* Oldest tick still in the window */
+        uint64_t *timestamps;          /* Tick timestamps, [capacity] */
+        double *values;                /* Power per tick and column, [capacity][columns] */
+        bool *online;                  /* Whether the value counts, [capacity][columns] */
+        uint64_t *min_queue;           /* Ticks of increasing power, [columns][capacity] */
+        uint64_t *max_queue;           /* Ticks of decreasing power, [columns][capacity] */
+        pm_window_column_t *columns;   /* Deque bounds and sums, [columns] */
+} pm_window_t;
+
+/* The configured windows and their published results, replaced as a whole */
+typedef struct
+{
+        int count;                     /* Number of windows */
+        pm_window_t *windows;          /* Windows, [count] */
+        pm_stats_t *results;           /* Power statistics, [count][columns] */
+        uint64_t *spans;               /* Time covered by each window, [count] */
+} pm_window_set_t;
+
+/* Region marker in the bounded MPSC queue; seq says whether a producer or the sampler owns the cell */
+typedef struct
+{
+        uint64_t seq;                  /* Position + 1 once written, position + queue size once drained */
+        uint64_t timestamp_ns;         /* CLOCK_MONOTONIC time of the marker */
+        uint32_t region;               /* Region id, REGION_END_FLAG set for an end */
+        uint32_t thread;               /* Marking thread */
+} pm_region_marker_t;
+
+/* Region instance waiting for its end */
+typedef struct
+{
+        uint32_t region;               /* Region id */
+        uint32_t thread;               /* Thread that began it */
+        uint64_t begin_ns;             /* Time of the begin */
+        double begin_energy;           /* Energy clock at the begin */
+        double peak_power;             /* Highest total power seen so far */
+} pm_region_open_t;
+
+/* Cumulative total energy at a tick; markers are interpolated between two of them */
+typedef struct
+{
+        uint64_t timestamp_ns;         /* Time of the tick */
+        double power;                  /* Total power, 0 if offline */
+        double energy;                 /* Joules integrated up to the tick */
+} pm_region_tick_t;
+
+/* Extremes of a session column; unlike the sums they cannot be recovered from a difference */
+typedef struct
+{
+        double min[3];                 /* Minimum voltage, current and power */
+        double max[3];                 /* Maximum voltage, current and power */
+        bool seen;                     /* Whether an online reading was seen */
+} pm_session_range_t;
+
+/* Measurement session; the columns are the rails, then the total */
+struct pm_session_s
+{
+        struct pm_session_s *next;     /* Next open session */
+        pm_sensor_stats_t *base;       /* Lifetime statistics when the session (re)started */
+        pm_session_range_t *ranges;    /* Extremes since the session (re)started */
+};
+
+/* Tick queued for the recording writer, followed by the rail values */
+typedef struct
+{
+        uint64_t timestamp_ns;         /* CLOCK_MONOTONIC time of the tick */
+        uint32_t offline;              /* Bit i set if rail i failed */
+        uint32_t reserved;             /* Keeps the values 8-byte aligned */
+        pm_record_value_t values[];    /* Raw reading per rail */
+} pm_record_entry_t;
+
+/* Recorded trace standing in for the sensors; times are relative to the first tick */
+typedef struct
+{
+        double speed;                  /* Trace seconds per second, 0 to step one tick per sample */
+        bool loop;                     /* Restart the trace at its end */
+        int rail_count;                /* Rails per tick */
+        uint64_t first_ns;             /* Trace time of the first tick */
+        uint64_t period_ns;            /* Tick interval, used between laps and after the end */
+
+        /* Recording of pm_record_start(), mapped */
+        char *map;                     /* File mapping, NULL for a CSV trace */
+        size_t map_size;               /* Bytes mapped */
+        const pm_record_header_t *header; /* Header at the start of the mapping */
+        uint64_t block_count;          /* Complete blocks in the file */
+        uint64_t block;                /* Block of the next tick */
+        uint32_t index;                /* Tick of the next tick within the block */
+
+        /* CSV trace, parsed */
+        uint64_t *csv_times;           /* Tick times, [csv_ticks] */
+        uint32_t *csv_offline;         /* Offline masks, [csv_ticks] */
+        double *csv_values;            /* Voltage and current, [csv_ticks][rail_count][2] */
+        uint64_t csv_ticks;            /* Ticks parsed */
+        uint64_t csv_next;             /* Next tick to replay */
+        char (*names)[64];             /* Rail names from the header, freed at discovery */
+
+        /* Replay position */
+        bool started;                  /* Whether the first sample was taken */
+        uint64_t start_ns;             /* CLOCK_MONOTONIC time of the first sample */
+        uint64_t lap_ns;               /* Trace time added by the completed laps */
+        bool have_next;                /* Whether next_* holds an unread tick */
+        uint64_t next_ns;              /* Trace time of the next tick */
+        uint32_t next_offline;         /* Offline mask of the next tick */
+        double *next_values;           /* Raw readings of the next tick, [rail_count][2] */
+        bool have_current;             /* Whether a tick was replayed yet */
+        uint64_t current_ns;           /* Trace time of the replayed tick */
+        uint32_t current_offline;      /* Offline mask of the replayed tick */
+        double *current_values;        /* Raw readings of the replayed tick, [rail_count][2] */
+        bool ended;                    /* Whether the trace is over */
+        uint64_t sample_ns;            /* Timestamp of the last sample, on the trace clock */
+} pm_replay_t;
+
+/* Waveforms of the synthetic source */
+typedef enum
+{
+        SYNTH_CONST,                   /* power */
+        SYNTH_STEP,                    /* low, high, period_s */
+        SYNTH_SINE,                    /* mean, amplitude, frequency_hz */
+        SYNTH_WALK,                    /* start, step, max */
+        SYNTH_BURST                    /* idle, peak, rate_hz, length_s */
+} pm_synth_wave_t;
+
+/* Generated rail */
+typedef struct
+{
+        char name[64];                 /* Rail name */
+        pm_synth_wave_t wave;          /* Waveform of the power */
+        double params[4];              /* Waveform parameters */
+        double voltage;                /* Constant voltage in volts */
+        double power;                  /* Power of the last sample in watts */
+        uint64_t burst_end_ns;         /* End of the running burst, 0 if idle */
+} pm_synth_rail_t;
+
+/* Synthetic source generating the rails in memory */
+typedef struct
+{
+        int rail_count;                /* Number of rails */
+        pm_synth_rail_t *rails;        /* Generated rails */
+        uint64_t rng;                  /* xorshift64 state */
+        bool started;                  /* Whether the first sample was taken */
+        uint64_t start_ns;             /* CLOCK_MONOTONIC time of the first sample */
+        uint64_t sample_ns;            /* CLOCK_MONOTONIC time of the last sample */
+} pm_synth_t;
+
+/* Recording: an SPSC ring filled by the sampler and drained into blocks by the writer thread */
+typedef struct
+{
+        int fd;                        /* Recording file */
+        pthread_t thread;              /* Writer thread */
+        sem_t wake;                    /* Posted to make the writer drain and exit */
+        bool stop_flag;                /* Set by pm_record_stop() */
+        int error;                     /* errno of the first failed write, 0 if none */
+        pm_record_stats_t *stats;      /* Counters in the handle */
+        int rail_count;                /* Rails per tick */
+        int total_rail;                /* Rail measuring the board input, -1 for the sum */
+        double *volt_scale;            /* Volts per count per rail */
+        double *curr_scale;            /* Amperes per count per rail */
+        size_t entry_size;             /* Bytes per queued tick */
+        uint64_t capacity;             /* Ticks the ring holds */
+        char *ring;                    /* Queued ticks, [capacity][entry_size] */
+        uint64_t head;                 /* Ticks queued, published by the sampler */
+        uint64_t tail;                 /* Ticks drained, published by the writer */
+        uint32_t header_size;          /* File offset of the first block */
+        uint32_t tick_size;            /* Bytes per tick in a block */
+        uint32_t footer_size;          /* Bytes of the footer, ranges included */
+        uint32_t ticks_per_block;      /* Ticks that fit in front of the footer */
+        char *block;                   /* Block being filled, [RECORD_BLOCK_SIZE] */
+        pm_record_footer_t footer;     /* Index of the block being filled */
+        pm_record_range_t *ranges;     /* Power ranges of the block, per rail then the total */
+} pm_recorder_t;
+
+#ifdef HAVE_IO_URING
+/* io_uring read buffer; sysfs numbers are far shorter than this */
+#define URING_BUFFER_SIZE 32
+
+/* Rings and buffers of the io_uring backend */
+typedef struct
+{
+        int ring_fd;                  /* io_uring instance */
+        void *sq_ring;                /* Mapped submission ring */
+        size_t sq_ring_size;          /* Size of the submission ring mapping */
+        void *cq_ring;                /* Mapped completion ring (may alias sq_ring) */
+        size_t cq_ring_size;          /* Size of the completion ring mapping */
+        struct io_uring_sqe *sqes;    /* Mapped submission queue entries */
+        size_t sqes_size;             /* Size of the sqe mapping */
+        unsigned *sq_tail;            /* Submission ring tail */
+        unsigned *sq_mask;            /* Submission ring mask */
+        unsigned *sq_array;           /* Submission ring index array */
+        unsigned *cq_head;            /* Completion ring head */
+        unsigned *cq_tail;            /* Completion ring tail */
+        unsigned *cq_mask;            /* Completion ring mask */
+        struct io_uring_cqe *cqes;    /* Completion queue entries */
+        char (*buffers)[URING_BUFFER_SIZE]; /* Voltage/current buffers, two per rail */
+        int *errors;                  /* Per-buffer read error of the last tick */
+} pm_uring_t;
+#endif
+
+/* Sensor source; it owns a contiguous range of rails and reads them as one batch */
+typedef struct pm_backend_s pm_backend_t;
+
+typedef struct
+{
+        const char *name;                                                  /* Source name for debug output */
+        pm_error_t (*discover)(pm_handle_t handle, pm_backend_t *backend); /* Add the rails with add_rail() */
+        pm_error_t (*open)(pm_handle_t handle, pm_backend_t *backend);     /* Prepare the reads, NULL if none */
+        void (*read)(pm_handle_t handle, pm_backend_t *backend);          /* Set the raw values of every rail */
+        void (*close)(pm_handle_t handle, pm_backend_t *backend);         /* Undo open, NULL if none */
+        uint64_t (*clock)(const pm_backend_t *backend);                   /* Time of the last read, NULL for now */
+        void (*destroy)(pm_backend_t *backend);                           /* Release the state, NULL if none */
+} pm_backend_ops_t;
+
+struct pm_backend_s
+{
+        const pm_backend_ops_t *ops;   /* Operations of the source */
+        int first_rail;                /* Index of the first rail */
+        int rail_count;                /* Number of rails */
+        void *state;                   /* Source state */
+};
+
+/* State of a sysfs source while its files are open */
+typedef struct
+{
+        pm_io_backend_t io_backend;    /* I/O backend used for the files */
+#ifdef HAVE_IO_URING
+        pm_uring_t *uring;             /* io_uring state, NULL if unused */
+#endif
+} pm_sysfs_state_t;
 
 /* Internal structure for the library handle */
 struct pm_handle_s
 {
         bool initialized;          /* Whether the library is initialized */
         bool sampling;             /* Whether sampling is active */
-        int sampling_frequency_hz; /* Sampling frequency in Hz */
+        bool attached;             /* Whether the handle reads another process's segment */
+        uint64_t sampling_period_ns; /* Sampling period, read by the sampler once per tick */
 
         /* Sampling thread */
         pthread_t sampling_thread;  /* Thread ID */
         pthread_mutex_t data_mutex; /* Mutex for data access */
         bool thread_stop_flag;      /* Flag to stop the thread */
+        sem_t thread_ready;         /* Posted once the thread applied its config */
+        pm_sampler_config_t sampler_config; /* Settings applied by the thread */
+        pm_sampler_report_t sampler_report; /* Settings that took effect */
+        bool unlock_memory;         /* Whether pm_stop_sampling() undoes the mlockall() */
+        pm_sampler_stats_t sampler_stats; /* Scheduler accounting, updated atomically */
 
         /* Sensor information */
-        char **sensor_paths;            /* Array of sensor paths */
-        char **sensor_names;            /* Array of sensor names */
-        pm_sensor_type_t *sensor_types; /* Array of sensor types */
+        pm_rail_t *rails;               /* Array of rail descriptors */
         int sensor_count;               /* Number of sensors */
+        int total_rail;                 /* Index of the total input rail, -1 if none */
+
+        /* Sources of the rails, in rail order */
+        pm_backend_t backends[BACKEND_MAX]; /* Sources found at discovery */
+        int backend_count;                  /* Number of sources */
+        const pm_backend_t *clock_backend;  /* Source timing the samples, NULL for CLOCK_MONOTONIC */
 
-        /* Current data */
+        /* Attribute files kept open while sampling */
+        pm_io_backend_t io_backend;        /* Requested I/O backend */
+        pm_io_backend_t active_io_backend; /* Backend used by the open files */
+        pm_sensor_fds_t *sensor_fds;       /* Array of cached sensor fds */
+
+        /* Current data, written under data_mutex only */
         pm_power_data_t latest_data; /* Latest power data */
 
-        /* Statistics */
+        /* Statistics, written under data_mutex only */
         pm_power_stats_t statistics; /* Power statistics */
+        pm_energy_state_t *energy_state; /* Integration state per rail, the total last */
+        pm_histogram_t *histograms;      /* Power histogram per rail, the total last; bins stored atomically */
+        double *tick_energy;             /* Joules integrated by the last tick per rail, the total last */
+
+        /* Statistics sessions are measured against, never reset; written under data_mutex only */
+        pm_sensor_stats_t *lifetime;        /* Per rail, the total last */
+        pm_energy_state_t *lifetime_state;  /* Integration state of the lifetime energy */
+        struct pm_session_s *sessions;      /* Open sessions */
+
+        /* Snapshots published to readers after every update */
+        pm_snapshot_block_t *snapshot;      /* Seqlock snapshot ring */
+
+        /* Sample history */
+        pm_history_t *history;              /* Ring of per-rail samples, NULL if disabled */
+        uint64_t history_lost;              /* Samples this attached handle's readers skipped; the segment is read-only */
+
+        /* Blocks replaced by a reconfiguration, freed by pm_cleanup() */
+        pm_retired_t *retired;              /* Most recently retired first, changed under data_mutex */
+
+        /* Shared-memory segment holding the snapshot and history blocks once published or attached */
+        void *shared;                       /* Mapping, NULL if private */
+        size_t shared_size;                 /* Bytes mapped */
+        char shared_name[256];              /* Segment name, unlinked at cleanup by the publisher */
+
+        /* Sliding windows, updated under data_mutex and published with a seqlock */
+        pm_window_set_t *windows;           /* Configured windows, NULL if none */
+        uint64_t window_seq;                /* Odd while the results are being written */
+
+        /* Rollup tiers, written under data_mutex and read through per-slot seqlocks */
+        pm_rollup_set_t *rollups;           /* Configured tiers, NULL if none */
+
+        /* Code regions: markers queued lock-free, joined by the sampler under data_mutex */
+        pm_region_marker_t *region_queue;   /* Marker ring, [REGION_QUEUE_SIZE] */
+        uint64_t region_enqueue;            /* Next position claimed by a producer */
+        uint64_t region_dequeue;            /* Next position drained by the sampler */
+        pm_region_open_t *region_open;      /* Open instances in begin order, [REGION_MAX_OPEN] */
+        int region_open_count;              /* Number of open instances */
+        pm_region_tick_t region_ticks[REGION_CLOCK_TICKS]; /* Recent ticks the markers are joined against */
+        uint64_t region_tick_count;         /* Ticks recorded */
+        int region_count;                   /* Registered regions, published after the name */
+        uint64_t region_seq;                /* Odd while the results are being written */
+        pm_region_stats_t *regions;         /* Results, [PM_MAX_REGIONS] */
+        uint64_t *region_dropped;           /* Lost markers per region, updated atomically */
+
+        /* Recording, attached under data_mutex; the counters are updated atomically */
+        pm_recorder_t *recorder;            /* Running recording, NULL if none */
+        pm_record_stats_t record_stats;     /* Counters of the running or last recording */
 
         /* Time tracking */
         struct timespec last_sample_time; /* Time of the last sample */
+        uint64_t last_sample_ns;          /* CLOCK_MONOTONIC time of the last sample */
 
         /* Paths */
         char i2c_path[256];          /* Path to I2C devices */
         char power_supply_path[256]; /* Path to power supplies */
+
+        /* Rails of a valid discovery cache, only while discovering */
+        pm_cache_rail_t *cached_rails;
+        int cached_rail_count;
 };
 
 /* Forward declarations for internal functions */
 static void *sampling_thread_func(void *arg);
-static pm_error_t discover_sensors(pm_handle_t handle);
+static uint64_t monotonic_now_ns(void);
+static void sleep_until_ns(uint64_t deadline_ns);
+static void apply_sampler_config(pm_handle_t handle);
+static bool memory_locked(void);
+static pm_error_t discover_sensors(pm_handle_t handle, const char *cache_path);
+static pm_error_t add_backend(pm_handle_t handle, const pm_backend_ops_t *ops, void *state);
+static void backends_free(pm_handle_t handle);
+static bool read_boot_id(char *boot_id, size_t size);
+static pm_cache_rail_t *cache_load(pm_handle_t handle, const char *path, int *count);
+static void cache_store(pm_handle_t handle, const char *path);
+static pm_error_t cache_discover(pm_handle_t handle, pm_backend_t *backend);
+static pm_error_t ina3221_discover(pm_handle_t handle, pm_backend_t *backend);
+static pm_error_t power_supply_discover(pm_handle_t handle, pm_backend_t *backend);
+static pm_error_t testing_discover(pm_handle_t handle, pm_backend_t *backend);
+static pm_error_t sysfs_open(pm_handle_t handle, pm_backend_t *backend);
+static void sysfs_read(pm_handle_t handle, pm_backend_t *backend);
+static void sysfs_close(pm_handle_t handle, pm_backend_t *backend);
+static pm_error_t replay_open(const pm_config_t *config, pm_replay_t **replay_out);
+static pm_error_t replay_discover(pm_handle_t handle, pm_backend_t *backend);
+static void replay_read(pm_handle_t handle, pm_backend_t *backend);
+static uint64_t replay_clock(const pm_backend_t *backend);
+static void replay_destroy(pm_backend_t *backend);
+static void replay_free(pm_replay_t *replay);
+static pm_error_t synth_parse(const char *spec, pm_synth_t **synth_out);
+static pm_error_t synth_discover(pm_handle_t handle, pm_backend_t *backend);
+static double synth_random(pm_synth_t *synth);
+static void synth_read(pm_handle_t handle, pm_backend_t *backend);
+static uint64_t synth_clock(const pm_backend_t *backend);
+static void synth_destroy(pm_backend_t *backend);
 static pm_error_t read_sensor_data(pm_handle_t handle);
 static pm_error_t update_statistics(pm_handle_t handle);
-static bool check_file_exists(const char *path);
+static double accumulate_energy(pm_sensor_stats_t *stats, pm_energy_state_t *state,
+                                const pm_sensor_data_t *data, uint64_t timestamp_ns);
+static void reset_energy_state(pm_handle_t handle);
+static void record_histogram(pm_histogram_t *histogram, const pm_energy_state_t *state,
+                             const pm_sensor_data_t *data, uint64_t timestamp_ns);
+static void clear_histogram(pm_histogram_t *histogram);
 static pm_error_t find_all_i2c_power_monitor(pm_handle_t handle);
 static pm_error_t find_all_system_monitor(pm_handle_t handle);
 static void calculate_total_power(pm_handle_t handle);
+static pm_snapshot_block_t *snapshot_create(int sensor_count);
+static size_t snapshot_size(const pm_snapshot_block_t *block);
+static pm_history_t *history_create(int capacity, pm_overflow_policy_t policy);
+static size_t history_size(const pm_history_t *history);
+static pm_history_slot_t *history_slot(const pm_history_t *history, uint64_t seq);
+static void record_history(pm_handle_t handle);
+static void write_history_sample(pm_history_t *history, uint64_t seq, uint64_t timestamp_ns,
+                                 int rail, const pm_sensor_data_t *data);
+static pm_error_t window_init(pm_window_t *window, uint64_t window_ns, int columns, uint64_t period_ns);
+static void window_free(pm_window_t *window);
+static bool retire(pm_handle_t handle, void *block, void (*release)(void *block));
+static void retired_free(pm_handle_t handle);
+static void window_set_free(void *set);
+static pm_error_t fit_windows_to_period(pm_handle_t handle);
+static void update_windows(pm_handle_t handle);
+static pm_rollup_slot_t *rollup_slot(const pm_rollup_ring_t *ring, uint64_t bucket);
+static void rollup_set_free(void *set);
+static void update_rollups(pm_handle_t handle);
+static pm_error_t region_mark(pm_handle_t handle, int id, uint32_t flag);
+static void record_tick(pm_handle_t handle);
+static int write_all(int fd, const void *data, size_t size, off_t offset);
+static void *record_thread_func(void *arg);
+static void recorder_free(pm_recorder_t *recorder);
+static void update_regions(pm_handle_t handle);
+static void finish_stats(pm_stats_t *stats);
+static void session_delta(pm_sensor_stats_t *stats, const pm_sensor_stats_t *now, const pm_sensor_stats_t *base,
+                          const pm_session_range_t *range);
+static pm_snapshot_slot_t *snapshot_slot(const pm_snapshot_block_t *block, uint64_t generation);
+static void publish_snapshot(pm_handle_t handle);
+static uint64_t read_snapshot(const pm_snapshot_block_t *block, pm_sensor_data_t *total,
+                              pm_sensor_data_t *sensors, pm_sensor_stats_t *total_stats,
+                              pm_sensor_stats_t *sensor_stats);
+static bool shared_stale(const char *name);
+static pm_reader_buffers_t *reader_buffers(int sensor_count);
 static char *strdup_safe(const char *str);
+static pm_error_t add_rail(pm_handle_t handle, const char *name, pm_sensor_type_t type,
+                           int channel, const char *volt_path, const char *curr_path);
+static pm_error_t open_sensor_files(pm_handle_t handle);
+static void close_sensor_files(pm_handle_t handle);
+static bool reopen_sensor_files(const pm_rail_t *rail, pm_sensor_fds_t *fds);
+static int read_sysfs_value(int fd, double *value);
+static int parse_sysfs_value(char *buffer, ssize_t length, double *value);
+static void handle_read_error(const pm_rail_t *rail, pm_sensor_fds_t *fds, int err, bool voltage);
+static void read_rails_stdio(pm_handle_t handle, const pm_backend_t *backend);
+static void read_rails_pread(pm_handle_t handle, const pm_backend_t *backend);
+#ifdef HAVE_IO_URING
+static pm_uring_t *uring_create(unsigned entries, int rail_count);
+static void uring_destroy(pm_uring_t *uring);
+static bool read_rails_uring(pm_handle_t handle, const pm_backend_t *backend, pm_uring_t *uring);
+#endif
 
 /* Forward declarations for static functions */
-static bool is_directory(const char *path);
-static pm_error_t find_driver_power_folders(pm_handle_t handle, const char *path);
-static pm_error_t list_all_i2c_ports(pm_handle_t handle, const char *path);
+static int open_directory(int parent_fd, const char *name);
+static bool may_be_directory(const struct dirent *entry);
+static ssize_t read_attribute(int dir_fd, const char *name, char *buffer, size_t size);
+static pm_error_t find_driver_power_folders(pm_handle_t handle, int parent_fd, const char *name,
+                                            const char *path);
+static pm_error_t list_all_i2c_ports(pm_handle_t handle, int parent_fd, const char *name, const char *path);
+
+/* INA3221 monitors on the I2C bus, under hwmon (JetPack 5 and later) or as IIO devices (JetPack 4 and earlier) */
+static const pm_backend_ops_t ina3221_backend = {
+    "ina3221", ina3221_discover, sysfs_open, sysfs_read, sysfs_close, NULL, NULL};
+
+/* Power supplies reporting voltage_now and current_now */
+static const pm_backend_ops_t power_supply_backend = {
+    "power_supply", power_supply_discover, sysfs_open, sysfs_read, sysfs_close, NULL, NULL};
+
+/* Placeholder rails for JTOP_TESTING when nothing was found */
+static const pm_backend_ops_t testing_backend = {
+    "testing", testing_discover, sysfs_open, sysfs_read, sysfs_close, NULL, NULL};
+
+/* Trace of pm_record_start() or a CSV file */
+static const pm_backend_ops_t replay_backend = {
+    "replay", replay_discover, NULL, replay_read, NULL, replay_clock, replay_destroy};
+
+/* Waveforms generated without file I/O */
+static const pm_backend_ops_t synth_backend = {
+    "synthetic", synth_discover, NULL, synth_read, NULL, synth_clock, synth_destroy};
 
 /* Error messages */
 static const char *error_messages[] = {
@@ -91,10 +754,17 @@ static const char *error_messages[] = {
     "No sensors found",
     "File access error",
     "Memory allocation error",
-    "Thread creation error"};
+    "Thread creation error",
+    "Operation not supported"};
 
 /* Initialize the library */
 pm_error_t pm_init(pm_handle_t *handle)
+{
+        return pm_init_config(handle, NULL);
+}
+
+/* Initialize the library with options */
+pm_error_t pm_init_config(pm_handle_t *handle, const pm_config_t *config)
 {
         if (!handle)
         {
@@ -110,32 +780,106 @@ pm_error_t pm_init(pm_handle_t *handle)
 
         /* Initialize the handle */
         memset(*handle, 0, sizeof(struct pm_handle_s));
-        (*handle)->sampling_frequency_hz = DEFAULT_SAMPLING_FREQUENCY_HZ;
+        (*handle)->sampling_period_ns = NSEC_PER_SEC / DEFAULT_SAMPLING_FREQUENCY_HZ;
+        (*handle)->io_backend = PM_IO_BACKEND_PREAD;
+        (*handle)->active_io_backend = PM_IO_BACKEND_PREAD;
 
-        /* Set the paths based on environment variables */
-        if (getenv(ENV_JTOP_TESTING))
-        {
-                snprintf((*handle)->i2c_path, sizeof((*handle)->i2c_path), "/fake_sys/bus/i2c/devices");
-                snprintf((*handle)->power_supply_path, sizeof((*handle)->power_supply_path), "/fake_sys/class/power_supply");
-        }
-        else
+        /* Initialize the mutex */
+        if (pthread_mutex_init(&(*handle)->data_mutex, NULL) != 0)
         {
-                snprintf((*handle)->i2c_path, sizeof((*handle)->i2c_path), "%s", I2C_PATH);
-                snprintf((*handle)->power_supply_path, sizeof((*handle)->power_supply_path), "%s", POWER_SUPPLY_PATH);
+                free(*handle);
+                *handle = NULL;
+                return PM_ERROR_INIT_FAILED;
         }
 
-        /* Initialize the mutex */
-        if (pthread_mutex_init(&(*handle)->data_mutex, NULL) != 0)
+        /* Initialize the start handshake with the sampling thread */
+        if (sem_init(&(*handle)->thread_ready, 0, 0) != 0)
         {
+                pthread_mutex_destroy(&(*handle)->data_mutex);
                 free(*handle);
                 *handle = NULL;
                 return PM_ERROR_INIT_FAILED;
         }
 
-        /* Discover sensors */
-        pm_error_t error = discover_sensors(*handle);
+        /* Without options, a trace or waveforms named in the environment replace the sensors */
+        pm_config_t env_config;
+        if (!config)
+        {
+                const char *speed = getenv(ENV_REPLAY_SPEED);
+                const char *loop = getenv(ENV_REPLAY_LOOP);
+
+                memset(&env_config, 0, sizeof(env_config));
+                env_config.replay_path = getenv(ENV_REPLAY);
+                if (env_config.replay_path && env_config.replay_path[0] == '\0')
+                {
+                        env_config.replay_path = NULL;
+                }
+                env_config.replay_speed = speed ? strtod(speed, NULL) : 1.0;
+                env_config.replay_loop = loop && strcmp(loop, "1") == 0;
+                env_config.synthetic = getenv(ENV_SYNTHETIC);
+                if (env_config.synthetic && env_config.synthetic[0] == '\0')
+                {
+                        env_config.synthetic = NULL;
+                }
+                config = &env_config;
+        }
+
+        /* Set the paths from the options or the environment */
+        const char *root = config->sysfs_root;
+        if (!root || root[0] == '\0')
+        {
+                root = getenv(ENV_SYSFS_ROOT);
+        }
+        if (!root || root[0] == '\0')
+        {
+                root = getenv(ENV_JTOP_TESTING) ? JTOP_TESTING_ROOT : SYSFS_ROOT;
+        }
+        snprintf((*handle)->i2c_path, sizeof((*handle)->i2c_path), "%s%s", root, I2C_PATH);
+        snprintf((*handle)->power_supply_path, sizeof((*handle)->power_supply_path), "%s%s", root, POWER_SUPPLY_PATH);
+
+        /* Rails discovered earlier in this boot can be reused */
+        const char *cache_path = config->discovery_cache;
+        if (!cache_path || cache_path[0] == '\0')
+        {
+                cache_path = getenv(ENV_DISCOVERY_CACHE);
+        }
+        if (cache_path && cache_path[0] == '\0')
+        {
+                cache_path = NULL;
+        }
+
+        /* Discover sensors, or take the rails of the trace or the waveforms */
+        pm_error_t error;
+        (*handle)->rails = NULL;
+        (*handle)->sensor_count = 0;
+        (*handle)->total_rail = -1;
+        if (config->replay_path)
+        {
+                pm_replay_t *replay = NULL;
+                error = replay_open(config, &replay);
+                if (error == PM_SUCCESS)
+                {
+                        error = add_backend(*handle, &replay_backend, replay);
+                }
+        }
+        else if (config->synthetic)
+        {
+                pm_synth_t *synth = NULL;
+                error = synth_parse(config->synthetic, &synth);
+                if (error == PM_SUCCESS)
+                {
+                        error = add_backend(*handle, &synth_backend, synth);
+                }
+        }
+        else
+        {
+                error = discover_sensors(*handle, cache_path);
+        }
         if (error != PM_SUCCESS)
         {
+                backends_free(*handle);
+                free((*handle)->rails);
+                sem_destroy(&(*handle)->thread_ready);
                 pthread_mutex_destroy(&(*handle)->data_mutex);
                 free(*handle);
                 *handle = NULL;
@@ -145,26 +889,40 @@ pm_error_t pm_init(pm_handle_t *handle)
         /* Initialize data structures */
         (*handle)->latest_data.sensors = (pm_sensor_data_t *)malloc((*handle)->sensor_count * sizeof(pm_sensor_data_t));
         (*handle)->statistics.sensors = (pm_sensor_stats_t *)malloc((*handle)->sensor_count * sizeof(pm_sensor_stats_t));
-
-        if (!(*handle)->latest_data.sensors || !(*handle)->statistics.sensors)
+        (*handle)->snapshot = snapshot_create((*handle)->sensor_count);
+        (*handle)->energy_state = (pm_energy_state_t *)calloc((*handle)->sensor_count + 1, sizeof(pm_energy_state_t));
+        (*handle)->histograms = (pm_histogram_t *)calloc((*handle)->sensor_count + 1, sizeof(pm_histogram_t));
+        (*handle)->tick_energy = (double *)calloc((*handle)->sensor_count + 1, sizeof(double));
+        (*handle)->lifetime = (pm_sensor_stats_t *)calloc((*handle)->sensor_count + 1, sizeof(pm_sensor_stats_t));
+        (*handle)->lifetime_state = (pm_energy_state_t *)calloc((*handle)->sensor_count + 1, sizeof(pm_energy_state_t));
+        (*handle)->region_queue = (pm_region_marker_t *)malloc(REGION_QUEUE_SIZE * sizeof(pm_region_marker_t));
+        (*handle)->region_open = (pm_region_open_t *)malloc(REGION_MAX_OPEN * sizeof(pm_region_open_t));
+        (*handle)->regions = (pm_region_stats_t *)calloc(PM_MAX_REGIONS, sizeof(pm_region_stats_t));
+        (*handle)->region_dropped = (uint64_t *)calloc(PM_MAX_REGIONS, sizeof(uint64_t));
+
+        if (!(*handle)->latest_data.sensors || !(*handle)->statistics.sensors ||
+            !(*handle)->snapshot || !(*handle)->energy_state || !(*handle)->histograms ||
+            !(*handle)->tick_energy || !(*handle)->region_queue || !(*handle)->region_open ||
+            !(*handle)->regions || !(*handle)->region_dropped || !(*handle)->lifetime ||
+            !(*handle)->lifetime_state)
         {
-                if ((*handle)->latest_data.sensors)
-                        free((*handle)->latest_data.sensors);
-                if ((*handle)->statistics.sensors)
-                        free((*handle)->statistics.sensors);
-
-                for (int i = 0; i < (*handle)->sensor_count; i++)
-                {
-                        if ((*handle)->sensor_names[i])
-                                free((*handle)->sensor_names[i]);
-                        if ((*handle)->sensor_paths[i])
-                                free((*handle)->sensor_paths[i]);
-                }
-
-                free((*handle)->sensor_names);
-                free((*handle)->sensor_paths);
-                free((*handle)->sensor_types);
-
+                free((*handle)->latest_data.sensors);
+                free((*handle)->statistics.sensors);
+                free((*handle)->energy_state);
+                free((*handle)->histograms);
+                free((*handle)->tick_energy);
+                free((*handle)->region_queue);
+                free((*handle)->region_open);
+                free((*handle)->regions);
+                free((*handle)->region_dropped);
+                free((*handle)->lifetime);
+                free((*handle)->lifetime_state);
+                free((*handle)->snapshot);
+
+                free((*handle)->rails);
+                backends_free(*handle);
+
+                sem_destroy(&(*handle)->thread_ready);
                 pthread_mutex_destroy(&(*handle)->data_mutex);
                 free(*handle);
                 *handle = NULL;
@@ -177,12 +935,35 @@ pm_error_t pm_init(pm_handle_t *handle)
 
         for (int i = 0; i < (*handle)->sensor_count; i++)
         {
-                strncpy((*handle)->latest_data.sensors[i].name, (*handle)->sensor_names[i], sizeof((*handle)->latest_data.sensors[i].name) - 1);
-                (*handle)->latest_data.sensors[i].type = (*handle)->sensor_types[i];
+                const pm_rail_t *rail = &(*handle)->rails[i];
+
+                strncpy((*handle)->latest_data.sensors[i].name, rail->name, sizeof((*handle)->latest_data.sensors[i].name) - 1);
+                (*handle)->latest_data.sensors[i].type = rail->type;
+                (*handle)->latest_data.sensors[i].warning_threshold = rail->warning_threshold;
+                (*handle)->latest_data.sensors[i].critical_threshold = rail->critical_threshold;
+
+                strncpy((*handle)->statistics.sensors[i].name, rail->name, sizeof((*handle)->statistics.sensors[i].name) - 1);
+                snprintf((*handle)->lifetime[i].name, sizeof((*handle)->lifetime[i].name), "%s", rail->name);
+        }
+        snprintf((*handle)->lifetime[(*handle)->sensor_count].name,
+                 sizeof((*handle)->lifetime[(*handle)->sensor_count].name), "%s", "Total");
+
+        /* The total row is VDD_IN when present, otherwise the sum of all rails */
+        snprintf((*handle)->latest_data.total.name, sizeof((*handle)->latest_data.total.name), "%s",
+                 (*handle)->total_rail >= 0 ? "Total (VDD_IN)" : "Total (Sum)");
+        (*handle)->latest_data.total.warning_threshold = 25.0;
+        (*handle)->latest_data.total.critical_threshold = 35.0;
 
-                strncpy((*handle)->statistics.sensors[i].name, (*handle)->sensor_names[i], sizeof((*handle)->statistics.sensors[i].name) - 1);
+        /* Every queue cell starts out free for the producer claiming its position */
+        for (uint64_t i = 0; i < REGION_QUEUE_SIZE; i++)
+        {
+                (*handle)->region_queue[i].seq = i;
         }
 
+        /* Readers see the sensor names before the first sample */
+        (*handle)->last_sample_ns = monotonic_now_ns();
+        publish_snapshot(*handle);
+
         (*handle)->initialized = true;
         return PM_SUCCESS;
 }
@@ -201,6 +982,15 @@ pm_error_t pm_cleanup(pm_handle_t handle)
                 pm_stop_sampling(handle);
         }
 
+        /* Finish the recording */
+        if (handle->recorder)
+        {
+                pm_record_stop(handle);
+        }
+
+        /* Close files left open by pm_sample_now() */
+        close_sensor_files(handle);
+
         /* Free resources */
         if (handle->latest_data.sensors)
         {
@@ -212,32 +1002,50 @@ pm_error_t pm_cleanup(pm_handle_t handle)
                 free(handle->statistics.sensors);
         }
 
-        if (handle->sensor_names)
+        free(handle->energy_state);
+        free(handle->histograms);
+        free(handle->tick_energy);
+        free(handle->region_queue);
+        free(handle->region_open);
+        free(handle->regions);
+        free(handle->region_dropped);
+        free(handle->lifetime);
+        free(handle->lifetime_state);
+        while (handle->sessions)
         {
-                for (int i = 0; i < handle->sensor_count; i++)
-                {
-                        if (handle->sensor_names[i])
-                                free(handle->sensor_names[i]);
-                }
-                free(handle->sensor_names);
+                struct pm_session_s *session = handle->sessions;
+                handle->sessions = session->next;
+                free(session->base);
+                free(session->ranges);
+                free(session);
+        }
+
+        if (handle->rails)
+        {
+                free(handle->rails);
         }
+        backends_free(handle);
 
-        if (handle->sensor_paths)
+        if (handle->shared)
         {
-                for (int i = 0; i < handle->sensor_count; i++)
+                /* The snapshot and history blocks live in the segment */
+                munmap(handle->shared, handle->shared_size);
+                if (!handle->attached)
                 {
-                        if (handle->sensor_paths[i])
-                                free(handle->sensor_paths[i]);
+                        shm_unlink(handle->shared_name);
                 }
-                free(handle->sensor_paths);
         }
-
-        if (handle->sensor_types)
+        else
         {
-                free(handle->sensor_types);
+                free(handle->snapshot);
+                free(handle->history);
         }
+        window_set_free(handle->windows);
+        rollup_set_free(handle->rollups);
+        retired_free(handle);
 
-        /* Destroy the mutex */
+        /* Destroy the mutexes and the start handshake */
+        sem_destroy(&handle->thread_ready);
         pthread_mutex_destroy(&handle->data_mutex);
 
         /* Free the handle */
@@ -254,17 +1062,17 @@ pm_error_t pm_set_sampling_frequency(pm_handle_t handle, int frequency_hz)
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
         if (frequency_hz <= 0)
         {
                 return PM_ERROR_INVALID_FREQUENCY;
         }
 
-        /* Lock the mutex to update the frequency */
-        pthread_mutex_lock(&handle->data_mutex);
-        handle->sampling_frequency_hz = frequency_hz;
-        pthread_mutex_unlock(&handle->data_mutex);
-
-        return PM_SUCCESS;
+        return pm_set_sampling_period_ns(handle, NSEC_PER_SEC / (uint64_t)frequency_hz);
 }
 
 /* Get the current sampling frequency */
@@ -275,1109 +1083,5295 @@ pm_error_t pm_get_sampling_frequency(pm_handle_t handle, int *frequency_hz)
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
         if (!frequency_hz)
         {
                 return PM_ERROR_INIT_FAILED;
         }
 
-        *frequency_hz = handle->sampling_frequency_hz;
+        /* Round to the nearest Hz; periods set in nanoseconds need not be exact, and sampling is never 0 Hz */
+        uint64_t period_ns = __atomic_load_n(&handle->sampling_period_ns, __ATOMIC_RELAXED);
+        uint64_t frequency = (NSEC_PER_SEC + period_ns / 2) / period_ns;
+        *frequency_hz = frequency > 0 ? (int)frequency : 1;
         return PM_SUCCESS;
 }
 
-/* Start sampling */
-pm_error_t pm_start_sampling(pm_handle_t handle)
+/* Set the sampling period */
+pm_error_t pm_set_sampling_period_ns(pm_handle_t handle, uint64_t period_ns)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (handle->sampling)
+        if (handle->attached)
         {
-                return PM_ERROR_ALREADY_RUNNING;
+                return PM_ERROR_NOT_SUPPORTED;
         }
 
-        /* Reset the stop flag */
-        handle->thread_stop_flag = false;
-
-        /* Create the sampling thread */
-        if (pthread_create(&handle->sampling_thread, NULL, sampling_thread_func, handle) != 0)
+        if (period_ns == 0)
         {
-                return PM_ERROR_THREAD;
+                return PM_ERROR_INVALID_FREQUENCY;
         }
 
-        handle->sampling = true;
+        /* A running sampler picks the new period up when it schedules its next tick */
+        __atomic_store_n(&handle->sampling_period_ns, period_ns, __ATOMIC_RELAXED);
         return PM_SUCCESS;
 }
 
-/* Stop sampling */
-pm_error_t pm_stop_sampling(pm_handle_t handle)
+/* Get the sampling period */
+pm_error_t pm_get_sampling_period_ns(pm_handle_t handle, uint64_t *period_ns)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!handle->sampling)
+        if (handle->attached)
         {
-                return PM_ERROR_NOT_RUNNING;
+                return PM_ERROR_NOT_SUPPORTED;
         }
 
-        /* Set the stop flag and wait for the thread to exit */
-        handle->thread_stop_flag = true;
-        pthread_join(handle->sampling_thread, NULL);
+        if (!period_ns)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
 
-        handle->sampling = false;
+        *period_ns = __atomic_load_n(&handle->sampling_period_ns, __ATOMIC_RELAXED);
         return PM_SUCCESS;
 }
 
-/* Check if sampling is active */
-pm_error_t pm_is_sampling(pm_handle_t handle, bool *is_sampling)
+/* Get the scheduler accounting of the sampling thread */
+pm_error_t pm_get_sampler_stats(pm_handle_t handle, pm_sampler_stats_t *stats)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!is_sampling)
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!stats)
         {
                 return PM_ERROR_INIT_FAILED;
         }
 
-        *is_sampling = handle->sampling;
+        const pm_sampler_stats_t *src = &handle->sampler_stats;
+        stats->period_ns = __atomic_load_n(&src->period_ns, __ATOMIC_RELAXED);
+        stats->ticks = __atomic_load_n(&src->ticks, __ATOMIC_RELAXED);
+        stats->overruns = __atomic_load_n(&src->overruns, __ATOMIC_RELAXED);
+        stats->missed_ticks = __atomic_load_n(&src->missed_ticks, __ATOMIC_RELAXED);
+        stats->last_tick_ns = __atomic_load_n(&src->last_tick_ns, __ATOMIC_RELAXED);
+        stats->max_tick_ns = __atomic_load_n(&src->max_tick_ns, __ATOMIC_RELAXED);
+        stats->last_lateness_ns = __atomic_load_n(&src->last_lateness_ns, __ATOMIC_RELAXED);
+        stats->max_lateness_ns = __atomic_load_n(&src->max_lateness_ns, __ATOMIC_RELAXED);
         return PM_SUCCESS;
 }
 
-/* Get the latest power data */
-pm_error_t pm_get_latest_data(pm_handle_t handle, pm_power_data_t *data)
+/* Configure the sampling thread */
+pm_error_t pm_set_sampler_config(pm_handle_t handle, const pm_sampler_config_t *config)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!data)
+        if (handle->attached)
         {
-                return PM_ERROR_INIT_FAILED;
+                return PM_ERROR_NOT_SUPPORTED;
         }
 
-        /* Lock the mutex to read the data */
-        pthread_mutex_lock(&handle->data_mutex);
+        if (!config)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
 
-        /* Check internal buffer validity */
-        if (handle->sensor_count > 0 && handle->latest_data.sensors == NULL)
+        if (config->policy == PM_SCHED_FIFO || config->policy == PM_SCHED_RR)
         {
-                fprintf(stderr, "[jetpwmon] Internal Error: Sensor count %d but internal buffer handle->latest_data.sensors is NULL.\n", handle->sensor_count);
-                pthread_mutex_unlock(&handle->data_mutex);
-                return PM_ERROR_MEMORY;
+                int policy = config->policy == PM_SCHED_FIFO ? SCHED_FIFO : SCHED_RR;
+                if (config->priority < sched_get_priority_min(policy) ||
+                    config->priority > sched_get_priority_max(policy))
+                {
+                        return PM_ERROR_INIT_FAILED;
+                }
+        }
+        else if (config->policy != PM_SCHED_OTHER)
+        {
+                return PM_ERROR_INIT_FAILED;
         }
 
-        /* Copy the total data */
-        data->total = handle->latest_data.total;
-        data->sensor_count = handle->sensor_count;
+        if (config->pin_cpu && (config->cpu < 0 || config->cpu >= CPU_SETSIZE))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
 
-        /* Point to internal buffer */
-        data->sensors = handle->latest_data.sensors;
+        /* The settings are applied when the thread starts */
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
 
-        pthread_mutex_unlock(&handle->data_mutex);
+        handle->sampler_config = *config;
         return PM_SUCCESS;
 }
 
-/* Get the power statistics */
-pm_error_t pm_get_statistics(pm_handle_t handle, pm_power_stats_t *stats)
+/* Get the sampling thread settings */
+pm_error_t pm_get_sampler_config(pm_handle_t handle, pm_sampler_config_t *config)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!stats)
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!config)
         {
                 return PM_ERROR_INIT_FAILED;
         }
 
-        /* Lock the mutex to read the statistics */
-        pthread_mutex_lock(&handle->data_mutex);
+        *config = handle->sampler_config;
+        return PM_SUCCESS;
+}
 
-        /* Check internal buffer validity */
-        if (handle->sensor_count > 0 && handle->statistics.sensors == NULL)
+/* Report which sampling thread settings took effect */
+pm_error_t pm_get_sampler_report(pm_handle_t handle, pm_sampler_report_t *report)
+{
+        if (!handle || !handle->initialized)
         {
-                fprintf(stderr, "[jetpwmon] Internal Error: Sensor count %d but internal buffer handle->statistics.sensors is NULL.\n", handle->sensor_count);
-                pthread_mutex_unlock(&handle->data_mutex);
-                return PM_ERROR_MEMORY;
+                return PM_ERROR_NOT_INITIALIZED;
         }
 
-        /* Copy the total statistics */
-        stats->total = handle->statistics.total;
-        stats->sensor_count = handle->sensor_count;
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
 
-        /* Point to internal buffer */
-        stats->sensors = handle->statistics.sensors;
+        if (!report)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
 
-        pthread_mutex_unlock(&handle->data_mutex);
+        /* Written by the sampling thread before pm_start_sampling() returns */
+        *report = handle->sampler_report;
         return PM_SUCCESS;
 }
 
-/* Reset the statistics */
-pm_error_t pm_reset_statistics(pm_handle_t handle)
+/* Select the I/O backend */
+pm_error_t pm_set_io_backend(pm_handle_t handle, pm_io_backend_t backend)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        /* Lock the mutex to reset the statistics */
-        pthread_mutex_lock(&handle->data_mutex);
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
 
-        /* Reset the total statistics */
-        memset(&handle->statistics.total, 0, sizeof(pm_sensor_stats_t));
-        strncpy(handle->statistics.total.name, "Total", sizeof(handle->statistics.total.name) - 1);
+        if (backend != PM_IO_BACKEND_PREAD && backend != PM_IO_BACKEND_STDIO &&
+            backend != PM_IO_BACKEND_IO_URING)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
 
-        /* Reset the sensor statistics */
-        for (int i = 0; i < handle->sensor_count; i++)
+        if (handle->sampling)
         {
-                memset(&handle->statistics.sensors[i], 0, sizeof(pm_sensor_stats_t));
-                strncpy(handle->statistics.sensors[i].name, handle->sensor_names[i], sizeof(handle->statistics.sensors[i].name) - 1);
+                return PM_ERROR_ALREADY_RUNNING;
         }
 
-        pthread_mutex_unlock(&handle->data_mutex);
+        /* Files opened by pm_sample_now() are reopened with the new backend */
+        close_sensor_files(handle);
+        handle->io_backend = backend;
+        handle->active_io_backend = backend;
         return PM_SUCCESS;
 }
 
-/* Get the number of sensors */
-pm_error_t pm_get_sensor_count(pm_handle_t handle, int *count)
+/* Get the I/O backend in effect */
+pm_error_t pm_get_io_backend(pm_handle_t handle, pm_io_backend_t *backend)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!count)
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!backend)
         {
                 return PM_ERROR_INIT_FAILED;
         }
 
-        *count = handle->sensor_count;
+        *backend = handle->active_io_backend;
         return PM_SUCCESS;
 }
 
-/* Get the sensor names */
-#ifdef __GNUC__
-__attribute__((deprecated("This function is unsafe and will be removed in a future version. "
-                         "Please use pm_get_latest_data() or pm_get_statistics() instead to access sensor names.")))
-#endif
-pm_error_t pm_get_sensor_names(pm_handle_t handle, char **names, int *count)
+/* Take a single sample synchronously */
+pm_error_t pm_sample_now(pm_handle_t handle)
 {
         if (!handle || !handle->initialized)
         {
                 return PM_ERROR_NOT_INITIALIZED;
         }
 
-        if (!names || !count)
+        if (handle->attached)
         {
-                return PM_ERROR_INIT_FAILED;
+                return PM_ERROR_NOT_SUPPORTED;
         }
 
-        if (*count < handle->sensor_count)
+        /* The sampling thread owns the sensor files while it runs */
+        if (handle->sampling)
         {
-                *count = handle->sensor_count;
-                return PM_ERROR_MEMORY;
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        pm_error_t error = open_sensor_files(handle);
+        if (error != PM_SUCCESS)
+        {
+                return error;
+        }
+
+        return read_sensor_data(handle);
+}
+
+/* Start sampling */
+pm_error_t pm_start_sampling(pm_handle_t handle)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        /* Open the sensor attribute files once for the whole sampling run */
+        pm_error_t error = open_sensor_files(handle);
+        if (error != PM_SUCCESS)
+        {
+                return error;
+        }
+
+        /* Reset the stop flag and the scheduler accounting of the previous run */
+        handle->thread_stop_flag = false;
+        memset(&handle->sampler_stats, 0, sizeof(handle->sampler_stats));
+
+        /* Do not integrate energy across the time sampling was stopped */
+        pthread_mutex_lock(&handle->data_mutex);
+        reset_energy_state(handle);
+        error = fit_windows_to_period(handle);
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        if (error != PM_SUCCESS)
+        {
+                close_sensor_files(handle);
+                return error;
+        }
+
+        /* Create the sampling thread */
+        if (pthread_create(&handle->sampling_thread, NULL, sampling_thread_func, handle) != 0)
+        {
+                close_sensor_files(handle);
+                return PM_ERROR_THREAD;
+        }
+
+        /* Wait until the thread applied its settings so the report is complete */
+        while (sem_wait(&handle->thread_ready) != 0 && errno == EINTR)
+        {
+        }
+
+        handle->sampling = true;
+        return PM_SUCCESS;
+}
+
+/* Stop sampling */
+pm_error_t pm_stop_sampling(pm_handle_t handle)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!handle->sampling)
+        {
+                return PM_ERROR_NOT_RUNNING;
+        }
+
+        /* Set the stop flag and wait for the thread to exit */
+        __atomic_store_n(&handle->thread_stop_flag, true, __ATOMIC_RELEASE);
+        pthread_join(handle->sampling_thread, NULL);
+
+        /* Release the cached sensor file descriptors */
+        close_sensor_files(handle);
+
+        /* Memory locked for the sampler is only locked while sampling, unless the application locked it first */
+        if (handle->unlock_memory)
+        {
+                munlockall();
+                handle->unlock_memory = false;
+        }
+
+        handle->sampling = false;
+        return PM_SUCCESS;
+}
+
+/* Check if sampling is active */
+pm_error_t pm_is_sampling(pm_handle_t handle, bool *is_sampling)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!is_sampling)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        *is_sampling = handle->sampling;
+        return PM_SUCCESS;
+}
+
+/* Thread-specific key of the reader buffers, shared by all handles */
+static pthread_key_t reader_key;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+static bool reader_key_valid;
+
+/* Free the buffers of an exiting thread */
+static void reader_buffers_free(void *arg)
+{
+        pm_reader_buffers_t *buffers = (pm_reader_buffers_t *)arg;
+        free(buffers->sensors);
+        free(buffers->stats);
+        free(buffers);
+}
+
+static void reader_key_create(void)
+{
+        reader_key_valid = pthread_key_create(&reader_key, reader_buffers_free) == 0;
+}
+
+/* Buffers of the calling thread, grown to hold sensor_count rails; NULL if out of memory */
+static pm_reader_buffers_t *reader_buffers(int sensor_count)
+{
+        pthread_once(&reader_key_once, reader_key_create);
+        if (!reader_key_valid)
+        {
+                return NULL;
+        }
+
+        pm_reader_buffers_t *buffers = (pm_reader_buffers_t *)pthread_getspecific(reader_key);
+        if (!buffers)
+        {
+                buffers = (pm_reader_buffers_t *)calloc(1, sizeof(pm_reader_buffers_t));
+                if (!buffers || pthread_setspecific(reader_key, buffers) != 0)
+                {
+                        free(buffers);
+                        return NULL;
+                }
+        }
+
+        if (buffers->capacity < sensor_count)
+        {
+                pm_sensor_data_t *sensors = (pm_sensor_data_t *)malloc(sensor_count * sizeof(pm_sensor_data_t));
+                pm_sensor_stats_t *stats = (pm_sensor_stats_t *)malloc(sensor_count * sizeof(pm_sensor_stats_t));
+                if (!sensors || !stats)
+                {
+                        free(sensors);
+                        free(stats);
+                        return NULL;
+                }
+                free(buffers->sensors);
+                free(buffers->stats);
+                buffers->sensors = sensors;
+                buffers->stats = stats;
+                buffers->capacity = sensor_count;
+        }
+        return buffers;
+}
+
+/* Get the latest power data */
+pm_error_t pm_get_latest_data(pm_handle_t handle, pm_power_data_t *data)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!data)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* Copy a consistent snapshot into the buffer this thread hands out */
+        pm_reader_buffers_t *buffers = reader_buffers(handle->sensor_count);
+        if (!buffers)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        read_snapshot(__atomic_load_n(&handle->snapshot, __ATOMIC_ACQUIRE), &data->total, buffers->sensors, NULL, NULL);
+        data->sensor_count = handle->sensor_count;
+        data->sensors = buffers->sensors;
+        return PM_SUCCESS;
+}
+
+/* Copy the latest power data into caller storage */
+pm_error_t pm_read_latest_data(pm_handle_t handle, pm_power_data_t *data, pm_sensor_data_t *sensors,
+                               int capacity, uint64_t *generation)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!data)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        data->sensor_count = handle->sensor_count;
+        if (capacity < handle->sensor_count)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        if (!sensors && handle->sensor_count > 0)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        uint64_t gen = read_snapshot(__atomic_load_n(&handle->snapshot, __ATOMIC_ACQUIRE), &data->total, sensors, NULL, NULL);
+        data->sensors = sensors;
+        if (generation)
+        {
+                *generation = gen;
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Get the power statistics */
+pm_error_t pm_get_statistics(pm_handle_t handle, pm_power_stats_t *stats)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* Copy a consistent snapshot into the buffer this thread hands out */
+        pm_reader_buffers_t *buffers = reader_buffers(handle->sensor_count);
+        if (!buffers)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        read_snapshot(__atomic_load_n(&handle->snapshot, __ATOMIC_ACQUIRE), NULL, NULL, &stats->total, buffers->stats);
+        stats->sensor_count = handle->sensor_count;
+        stats->sensors = buffers->stats;
+        return PM_SUCCESS;
+}
+
+/* Copy the power statistics into caller storage */
+pm_error_t pm_read_statistics(pm_handle_t handle, pm_power_stats_t *stats, pm_sensor_stats_t *sensors,
+                              int capacity, uint64_t *generation)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        stats->sensor_count = handle->sensor_count;
+        if (capacity < handle->sensor_count)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        if (!sensors && handle->sensor_count > 0)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        uint64_t gen = read_snapshot(__atomic_load_n(&handle->snapshot, __ATOMIC_ACQUIRE), NULL, NULL, &stats->total, sensors);
+        stats->sensors = sensors;
+        if (generation)
+        {
+                *generation = gen;
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Copy the power histogram of a sensor */
+pm_error_t pm_get_power_histogram(pm_handle_t handle, int sensor, pm_histogram_t *histogram)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!histogram || sensor < -1 || sensor >= handle->sensor_count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* The totals are summed from the copied bins so they always match them */
+        const pm_histogram_t *source = &handle->histograms[sensor < 0 ? handle->sensor_count : sensor];
+        histogram->count = 0;
+        histogram->duration = 0.0;
+        for (int i = 0; i < PM_HISTOGRAM_BINS; i++)
+        {
+                histogram->samples[i] = __atomic_load_n(&source->samples[i], __ATOMIC_RELAXED);
+                __atomic_load(&source->seconds[i], &histogram->seconds[i], __ATOMIC_RELAXED);
+                histogram->count += histogram->samples[i];
+                histogram->duration += histogram->seconds[i];
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Add one power histogram into another */
+pm_error_t pm_histogram_merge(pm_histogram_t *histogram, const pm_histogram_t *other)
+{
+        if (!histogram || !other)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        for (int i = 0; i < PM_HISTOGRAM_BINS; i++)
+        {
+                histogram->samples[i] += other->samples[i];
+                histogram->seconds[i] += other->seconds[i];
+        }
+        histogram->count += other->count;
+        histogram->duration += other->duration;
+        return PM_SUCCESS;
+}
+
+/* Power represented by a histogram bin */
+static double histogram_bin_value(int bin)
+{
+        if (bin == 0)
+        {
+                return 0.0;
+        }
+
+        /* The bins of the binade 2^exponent are equal steps of 2^exponent / HISTOGRAM_SUB_BINS */
+        int index = bin - 1;
+        int exponent = HISTOGRAM_MIN_EXPONENT + index / HISTOGRAM_SUB_BINS;
+        uint64_t bits = (uint64_t)(exponent + 1023) << 52;
+        double scale;
+        memcpy(&scale, &bits, sizeof(scale));
+
+        if (bin == PM_HISTOGRAM_BINS - 1)
+        {
+                return scale;
+        }
+
+        return scale * (1.0 + (index % HISTOGRAM_SUB_BINS + 0.5) / HISTOGRAM_SUB_BINS);
+}
+
+/* Estimate a quantile of a power histogram */
+pm_error_t pm_histogram_quantile(const pm_histogram_t *histogram, double quantile, pm_weight_t weight,
+                                 double *value)
+{
+        if (!histogram || !value || !(quantile >= 0.0 && quantile <= 1.0) ||
+            (weight != PM_WEIGHT_SAMPLES && weight != PM_WEIGHT_TIME))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        double total = 0.0;
+        for (int i = 0; i < PM_HISTOGRAM_BINS; i++)
+        {
+                total += weight == PM_WEIGHT_TIME ? histogram->seconds[i] : (double)histogram->samples[i];
+        }
+
+        /* First bin whose cumulative weight reaches the rank, or the last non-empty one after rounding */
+        double rank = quantile * total;
+        double cumulative = 0.0;
+        int found = -1;
+        for (int i = 0; i < PM_HISTOGRAM_BINS; i++)
+        {
+                double w = weight == PM_WEIGHT_TIME ? histogram->seconds[i] : (double)histogram->samples[i];
+                if (w <= 0.0)
+                {
+                        continue;
+                }
+
+                found = i;
+                cumulative += w;
+                if (cumulative >= rank)
+                {
+                        break;
+                }
+        }
+
+        *value = found < 0 ? 0.0 : histogram_bin_value(found);
+        return PM_SUCCESS;
+}
+
+/* Get the generation of the latest published snapshot */
+pm_error_t pm_get_generation(pm_handle_t handle, uint64_t *generation)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!generation)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        const pm_snapshot_block_t *snapshot = __atomic_load_n(&handle->snapshot, __ATOMIC_ACQUIRE);
+        *generation = __atomic_load_n(&snapshot->generation, __ATOMIC_ACQUIRE);
+        return PM_SUCCESS;
+}
+
+/* Reset the statistics */
+pm_error_t pm_reset_statistics(pm_handle_t handle)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        /* Lock the mutex to reset the statistics */
+        pthread_mutex_lock(&handle->data_mutex);
+
+        /* Reset the total statistics */
+        memset(&handle->statistics.total, 0, sizeof(pm_sensor_stats_t));
+        strncpy(handle->statistics.total.name, "Total", sizeof(handle->statistics.total.name) - 1);
+
+        /* Reset the sensor statistics */
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                memset(&handle->statistics.sensors[i], 0, sizeof(pm_sensor_stats_t));
+                strncpy(handle->statistics.sensors[i].name, handle->rails[i].name, sizeof(handle->statistics.sensors[i].name) - 1);
+        }
+
+        /* Integrate from now on, so the interval up to the next tick still counts */
+        uint64_t now = monotonic_now_ns();
+        for (int i = 0; i <= handle->sensor_count; i++)
+        {
+                clear_histogram(&handle->histograms[i]);
+                if (handle->energy_state[i].timestamp_ns < now)
+                        handle->energy_state[i].timestamp_ns = now;
+        }
+
+        /* Readers must not see pre-reset statistics after this returns */
+        publish_snapshot(handle);
+
+        pthread_mutex_unlock(&handle->data_mutex);
+        return PM_SUCCESS;
+}
+
+/* Open an independent measurement session */
+pm_error_t pm_session_open(pm_handle_t handle, pm_session_t *session)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!session)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        int columns = handle->sensor_count + 1;
+        struct pm_session_s *opened = (struct pm_session_s *)calloc(1, sizeof(struct pm_session_s));
+        if (!opened)
+        {
+                return PM_ERROR_MEMORY;
+        }
+        opened->base = (pm_sensor_stats_t *)malloc(columns * sizeof(pm_sensor_stats_t));
+        opened->ranges = (pm_session_range_t *)calloc(columns, sizeof(pm_session_range_t));
+        if (!opened->base || !opened->ranges)
+        {
+                free(opened->base);
+                free(opened->ranges);
+                free(opened);
+                return PM_ERROR_MEMORY;
+        }
+
+        /* The baseline and the registration take effect at the same tick */
+        pthread_mutex_lock(&handle->data_mutex);
+        memcpy(opened->base, handle->lifetime, columns * sizeof(pm_sensor_stats_t));
+        opened->next = handle->sessions;
+        handle->sessions = opened;
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        *session = opened;
+        return PM_SUCCESS;
+}
+
+/* Copy the statistics of a session, optionally restarting it */
+pm_error_t pm_session_read(pm_handle_t handle, pm_session_t session, pm_power_stats_t *stats,
+                           pm_sensor_stats_t *sensors, int capacity, bool restart)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!session || !stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        stats->sensor_count = handle->sensor_count;
+        if (capacity < handle->sensor_count)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        if (!sensors && handle->sensor_count > 0)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        int columns = handle->sensor_count + 1;
+
+        /* Holding the lock makes the copy and the restart happen between two ticks */
+        pthread_mutex_lock(&handle->data_mutex);
+        for (int c = 0; c < columns; c++)
+        {
+                pm_sensor_stats_t *out = c < handle->sensor_count ? &sensors[c] : &stats->total;
+                session_delta(out, &handle->lifetime[c], &session->base[c], &session->ranges[c]);
+        }
+        if (restart)
+        {
+                memcpy(session->base, handle->lifetime, columns * sizeof(pm_sensor_stats_t));
+                memset(session->ranges, 0, columns * sizeof(pm_session_range_t));
+        }
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        stats->sensors = sensors;
+        return PM_SUCCESS;
+}
+
+/* Close a session */
+pm_error_t pm_session_close(pm_handle_t handle, pm_session_t session)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!session)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        pthread_mutex_lock(&handle->data_mutex);
+        struct pm_session_s **link = &handle->sessions;
+        while (*link && *link != session)
+        {
+                link = &(*link)->next;
+        }
+        bool found = *link != NULL;
+        if (found)
+        {
+                *link = session->next;
+        }
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        if (!found)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        free(session->base);
+        free(session->ranges);
+        free(session);
+        return PM_SUCCESS;
+}
+
+/* Configure the sample history */
+pm_error_t pm_configure_history(pm_handle_t handle, int capacity, pm_overflow_policy_t policy)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        /* The history lives in the shared segment once published */
+        if (handle->shared)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        /* A tick is written as a whole, so the ring must hold at least one */
+        if (capacity < 0 || (capacity > 0 && capacity < handle->sensor_count + 1) ||
+            (policy != PM_OVERFLOW_DROP_OLDEST && policy != PM_OVERFLOW_DROP_NEWEST))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        pm_history_t *history = NULL;
+        if (capacity > 0)
+        {
+                history = history_create(capacity, policy);
+                if (!history)
+                {
+                        return PM_ERROR_MEMORY;
+                }
+        }
+
+        /* pm_sample_now() writes the history under the same lock; readers may still hold the old ring */
+        pthread_mutex_lock(&handle->data_mutex);
+        if (!retire(handle, handle->history, free))
+        {
+                pthread_mutex_unlock(&handle->data_mutex);
+                free(history);
+                return PM_ERROR_MEMORY;
+        }
+        __atomic_store_n(&handle->history, history, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        return PM_SUCCESS;
+}
+
+/* Keep a replaced block until pm_cleanup(); the caller holds data_mutex */
+static bool retire(pm_handle_t handle, void *block, void (*release)(void *block))
+{
+        if (!block)
+        {
+                return true;
+        }
+
+        pm_retired_t *retired = (pm_retired_t *)malloc(sizeof(pm_retired_t));
+        if (!retired)
+        {
+                return false;
+        }
+
+        retired->block = block;
+        retired->release = release;
+        retired->next = handle->retired;
+        handle->retired = retired;
+        return true;
+}
+
+/* Free the retired blocks once no reader can use them */
+static void retired_free(pm_handle_t handle)
+{
+        while (handle->retired)
+        {
+                pm_retired_t *retired = handle->retired;
+                handle->retired = retired->next;
+                retired->release(retired->block);
+                free(retired);
+        }
+}
+
+/* Drain samples from the history */
+pm_error_t pm_read_samples(pm_handle_t handle, pm_sample_t *buffer, int max, uint64_t *cursor, int *count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!buffer || max < 0 || !cursor || !count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        pm_history_t *history = __atomic_load_n(&handle->history, __ATOMIC_ACQUIRE);
+        if (!history)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        uint64_t capacity = history->capacity;
+        uint64_t head = __atomic_load_n(&history->head, __ATOMIC_ACQUIRE);
+        uint64_t pos = *cursor;
+        int copied = 0;
+
+        /* A cursor from before a reconfiguration restarts at the beginning */
+        if (pos > head)
+        {
+                pos = 0;
+        }
+
+        while (copied < max && pos < head)
+        {
+                uint64_t oldest = head > capacity ? head - capacity : 0;
+                if (pos < oldest)
+                {
+                        /* The writer lapped this reader; a fresh cursor loses nothing */
+                        if (pos != 0)
+                        {
+                                __atomic_fetch_add(handle->attached ? &handle->history_lost : &history->lost,
+                                                   oldest - pos, __ATOMIC_RELAXED);
+                        }
+                        pos = oldest;
+                        continue;
+                }
+
+                const pm_history_slot_t *slot = history_slot(history, pos);
+                uint64_t stamp = __atomic_load_n(&slot->stamp, __ATOMIC_ACQUIRE);
+                if (stamp == pos + 1)
+                {
+                        buffer[copied] = slot->sample;
+
+                        /* Keep the copy only if the slot was not rewritten meanwhile */
+                        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                        if (__atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) == stamp)
+                        {
+                                copied++;
+                                pos++;
+                                continue;
+                        }
+                }
+
+                /* The slot is being reused: re-read the head and skip what was overwritten */
+                uint64_t new_head = __atomic_load_n(&history->head, __ATOMIC_ACQUIRE);
+                if (new_head == head)
+                {
+                        break;
+                }
+                head = new_head;
+        }
+
+        /* DROP_NEWEST keeps the samples past the furthest cursor handed out */
+        if (history->policy == PM_OVERFLOW_DROP_NEWEST)
+        {
+                uint64_t consumed = __atomic_load_n(&history->consumed, __ATOMIC_RELAXED);
+                while (consumed < pos &&
+                       !__atomic_compare_exchange_n(&history->consumed, &consumed, pos, false,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                {
+                }
+        }
+
+        *cursor = pos;
+        *count = copied;
+        return PM_SUCCESS;
+}
+
+/* Get the counters of the sample history */
+pm_error_t pm_get_history_stats(pm_handle_t handle, pm_history_stats_t *stats)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        memset(stats, 0, sizeof(*stats));
+
+        const pm_history_t *history = __atomic_load_n(&handle->history, __ATOMIC_ACQUIRE);
+        if (history)
+        {
+                stats->capacity = (int)history->capacity;
+                stats->policy = history->policy;
+                stats->written = __atomic_load_n(&history->head, __ATOMIC_ACQUIRE);
+                stats->dropped = __atomic_load_n(&history->dropped, __ATOMIC_RELAXED);
+                stats->lost = __atomic_load_n(&history->lost, __ATOMIC_RELAXED) +
+                              __atomic_load_n(&handle->history_lost, __ATOMIC_RELAXED);
+        }
+        return PM_SUCCESS;
+}
+
+/* Configure the sliding windows */
+pm_error_t pm_configure_windows(pm_handle_t handle, const uint64_t *window_ns, int count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (count < 0 || count > PM_MAX_WINDOWS || (count > 0 && !window_ns))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+                if (window_ns[i] == 0)
+                {
+                        return PM_ERROR_INIT_FAILED;
+                }
+        }
+
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        int columns = handle->sensor_count + 1;
+        pm_window_set_t *set = NULL;
+
+        if (count > 0)
+        {
+                set = (pm_window_set_t *)calloc(1, sizeof(pm_window_set_t));
+                if (!set)
+                {
+                        return PM_ERROR_MEMORY;
+                }
+
+                set->count = count;
+                set->windows = (pm_window_t *)calloc((size_t)count, sizeof(pm_window_t));
+                set->results = (pm_stats_t *)calloc((size_t)count * columns, sizeof(pm_stats_t));
+                set->spans = (uint64_t *)calloc((size_t)count, sizeof(uint64_t));
+                if (!set->windows || !set->results || !set->spans)
+                {
+                        window_set_free(set);
+                        return PM_ERROR_MEMORY;
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                        if (window_init(&set->windows[i], window_ns[i], columns, handle->sampling_period_ns) != PM_SUCCESS)
+                        {
+                                window_set_free(set);
+                                return PM_ERROR_MEMORY;
+                        }
+                }
+        }
+
+        /* pm_sample_now() updates the windows under the same lock; readers may still hold the old set */
+        pthread_mutex_lock(&handle->data_mutex);
+        if (!retire(handle, handle->windows, window_set_free))
+        {
+                pthread_mutex_unlock(&handle->data_mutex);
+                window_set_free(set);
+                return PM_ERROR_MEMORY;
+        }
+        __atomic_store_n(&handle->windows, set, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        return PM_SUCCESS;
+}
+
+/* Copy the statistics of a sliding window */
+pm_error_t pm_get_window_statistics(pm_handle_t handle, int window, pm_window_stats_t *stats,
+                                    pm_stats_t *sensors, int capacity)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        stats->sensor_count = handle->sensor_count;
+        if (capacity < handle->sensor_count)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        /* The count, the results and the spans come from the same set */
+        const pm_window_set_t *set = __atomic_load_n(&handle->windows, __ATOMIC_ACQUIRE);
+        if (!sensors || !set || window < 0 || window >= set->count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        int columns = handle->sensor_count + 1;
+        const pm_stats_t *results = &set->results[window * columns];
+
+        for (;;)
+        {
+                uint64_t seq = __atomic_load_n(&handle->window_seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                {
+                        continue;
+                }
+
+                memcpy(sensors, results, handle->sensor_count * sizeof(pm_stats_t));
+                stats->total = results[handle->sensor_count];
+                stats->span_ns = set->spans[window];
+
+                /* The copy is only valid if no tick was published meanwhile */
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&handle->window_seq, __ATOMIC_RELAXED) == seq)
+                {
+                        break;
+                }
+        }
+
+        stats->window_ns = set->windows[window].window_ns;
+        stats->sensors = sensors;
+        return PM_SUCCESS;
+}
+
+/* Configure the rollup tiers */
+pm_error_t pm_configure_rollups(pm_handle_t handle, const pm_rollup_tier_t *tiers, int count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (count < 0 || count > PM_MAX_ROLLUP_TIERS || (count > 0 && !tiers))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+                if (tiers[i].resolution_ns == 0 || tiers[i].capacity <= 0)
+                {
+                        return PM_ERROR_INIT_FAILED;
+                }
+        }
+
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        size_t slot_size = sizeof(pm_rollup_slot_t) + (handle->sensor_count + 1) * sizeof(pm_rollup_point_t);
+        pm_rollup_set_t *set = NULL;
+
+        if (count > 0)
+        {
+                set = (pm_rollup_set_t *)calloc(1, sizeof(pm_rollup_set_t));
+                if (!set)
+                {
+                        return PM_ERROR_MEMORY;
+                }
+
+                set->count = count;
+                set->rings = (pm_rollup_ring_t *)calloc((size_t)count, sizeof(pm_rollup_ring_t));
+                if (!set->rings)
+                {
+                        rollup_set_free(set);
+                        return PM_ERROR_MEMORY;
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                        pm_rollup_ring_t *ring = &set->rings[i];
+                        ring->resolution_ns = tiers[i].resolution_ns;
+                        ring->capacity = (uint64_t)tiers[i].capacity;
+                        ring->slot_size = slot_size;
+                        ring->slots = (char *)calloc((size_t)tiers[i].capacity, slot_size);
+                        if (!ring->slots)
+                        {
+                                rollup_set_free(set);
+                                return PM_ERROR_MEMORY;
+                        }
+                }
+        }
+
+        /* pm_sample_now() feeds the tiers under the same lock; readers may still hold the old set */
+        pthread_mutex_lock(&handle->data_mutex);
+        if (!retire(handle, handle->rollups, rollup_set_free))
+        {
+                pthread_mutex_unlock(&handle->data_mutex);
+                rollup_set_free(set);
+                return PM_ERROR_MEMORY;
+        }
+        __atomic_store_n(&handle->rollups, set, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        return PM_SUCCESS;
+}
+
+/* Get the configuration of a rollup tier */
+pm_error_t pm_get_rollup_tier(pm_handle_t handle, int tier, pm_rollup_tier_t *config)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        const pm_rollup_set_t *set = __atomic_load_n(&handle->rollups, __ATOMIC_ACQUIRE);
+        if (!config || !set || tier < 0 || tier >= set->count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        config->resolution_ns = set->rings[tier].resolution_ns;
+        config->capacity = (int)set->rings[tier].capacity;
+        return PM_SUCCESS;
+}
+
+/* Read the buckets of a rollup tier that start within a time range */
+pm_error_t pm_read_rollup(pm_handle_t handle, int tier, int sensor, uint64_t from_ns, uint64_t to_ns,
+                          pm_rollup_point_t *points, int max, int *count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        /* The tier count and the rings come from the same set */
+        const pm_rollup_set_t *set = __atomic_load_n(&handle->rollups, __ATOMIC_ACQUIRE);
+        if (!points || max < 0 || !count || !set || tier < 0 || tier >= set->count ||
+            sensor < -1 || sensor >= handle->sensor_count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        const pm_rollup_ring_t *ring = &set->rings[tier];
+        int column = sensor < 0 ? handle->sensor_count : sensor;
+        uint64_t next = __atomic_load_n(&ring->next, __ATOMIC_ACQUIRE);
+        uint64_t bucket = next > ring->capacity ? next - ring->capacity : 0;
+        int copied = 0;
+
+        while (copied < max && bucket < next)
+        {
+                const pm_rollup_slot_t *slot = rollup_slot(ring, bucket);
+                uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                {
+                        /* The sampler is adding a tick to this bucket */
+                        continue;
+                }
+
+                pm_rollup_point_t point = slot->points[column];
+                uint64_t held = slot->bucket;
+
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+                {
+                        continue;
+                }
+
+                /* The sampler lapped this reader: skip to the oldest bucket still held */
+                if (held != bucket)
+                {
+                        next = __atomic_load_n(&ring->next, __ATOMIC_ACQUIRE);
+                        uint64_t oldest = next > ring->capacity ? next - ring->capacity : 0;
+                        bucket = oldest > bucket ? oldest : bucket + 1;
+                        continue;
+                }
+
+                if (point.start_ns >= to_ns)
+                {
+                        break;
+                }
+                if (point.start_ns >= from_ns)
+                {
+                        points[copied++] = point;
+                }
+                bucket++;
+        }
+
+        *count = copied;
+        return PM_SUCCESS;
+}
+
+/* Register a named code region */
+pm_error_t pm_region_register(pm_handle_t handle, const char *name, int *id)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!name || !id)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        pthread_mutex_lock(&handle->data_mutex);
+
+        size_t length = sizeof(handle->regions[0].name) - 1;
+        for (int i = 0; i < handle->region_count; i++)
+        {
+                if (strncmp(handle->regions[i].name, name, length) == 0)
+                {
+                        *id = i;
+                        pthread_mutex_unlock(&handle->data_mutex);
+                        return PM_SUCCESS;
+                }
+        }
+
+        if (handle->region_count == PM_MAX_REGIONS)
+        {
+                pthread_mutex_unlock(&handle->data_mutex);
+                return PM_ERROR_MEMORY;
+        }
+
+        /* Markers and readers only accept the id once the name is in place */
+        int next = handle->region_count;
+        snprintf(handle->regions[next].name, sizeof(handle->regions[next].name), "%s", name);
+        __atomic_store_n(&handle->region_count, next + 1, __ATOMIC_RELEASE);
+        *id = next;
+
+        pthread_mutex_unlock(&handle->data_mutex);
+        return PM_SUCCESS;
+}
+
+/* Mark the start of a code region */
+pm_error_t pm_region_begin(pm_handle_t handle, int id)
+{
+        return region_mark(handle, id, 0);
+}
+
+/* Mark the end of a code region */
+pm_error_t pm_region_end(pm_handle_t handle, int id)
+{
+        return region_mark(handle, id, REGION_END_FLAG);
+}
+
+/* Get the number of registered regions */
+pm_error_t pm_get_region_count(pm_handle_t handle, int *count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        *count = __atomic_load_n(&handle->region_count, __ATOMIC_ACQUIRE);
+        return PM_SUCCESS;
+}
+
+/* Get the energy attributed to a code region */
+pm_error_t pm_get_region_stats(pm_handle_t handle, int id, pm_region_stats_t *stats)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats || id < 0 || id >= __atomic_load_n(&handle->region_count, __ATOMIC_ACQUIRE))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        for (;;)
+        {
+                uint64_t seq = __atomic_load_n(&handle->region_seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                {
+                        continue;
+                }
+
+                *stats = handle->regions[id];
+
+                /* The copy is only valid if no markers were joined meanwhile */
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&handle->region_seq, __ATOMIC_RELAXED) == seq)
+                {
+                        break;
+                }
+        }
+
+        stats->dropped = __atomic_load_n(&handle->region_dropped[id], __ATOMIC_RELAXED);
+        return PM_SUCCESS;
+}
+
+/* Start recording every tick to a file */
+pm_error_t pm_record_start(pm_handle_t handle, const char *path)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached || handle->sensor_count > PM_RECORD_MAX_RAILS)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!path)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        if (handle->recorder)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        pm_recorder_t *recorder = (pm_recorder_t *)calloc(1, sizeof(pm_recorder_t));
+        if (!recorder)
+        {
+                return PM_ERROR_MEMORY;
+        }
+
+        int rails = handle->sensor_count;
+        recorder->fd = -1;
+        recorder->stats = &handle->record_stats;
+        recorder->rail_count = rails;
+        recorder->total_rail = handle->total_rail;
+        recorder->entry_size = sizeof(pm_record_entry_t) + (size_t)rails * sizeof(pm_record_value_t);
+        recorder->capacity = RECORD_QUEUE_TICKS;
+        recorder->tick_size = (uint32_t)(sizeof(pm_record_tick_t) + (size_t)rails * sizeof(pm_record_value_t));
+        recorder->footer_size = (uint32_t)(sizeof(pm_record_footer_t) + (size_t)(rails + 1) * sizeof(pm_record_range_t));
+        recorder->ticks_per_block = (RECORD_BLOCK_SIZE - recorder->footer_size) / recorder->tick_size;
+        recorder->header_size = (uint32_t)((sizeof(pm_record_header_t) + (size_t)rails * sizeof(pm_record_rail_t) +
+                                            RECORD_HEADER_ALIGN - 1) & ~(size_t)(RECORD_HEADER_ALIGN - 1));
+        recorder->volt_scale = (double *)malloc((size_t)rails * sizeof(double));
+        recorder->curr_scale = (double *)malloc((size_t)rails * sizeof(double));
+        recorder->ring = (char *)malloc(recorder->capacity * recorder->entry_size);
+        recorder->block = (char *)malloc(RECORD_BLOCK_SIZE);
+        recorder->ranges = (pm_record_range_t *)malloc((size_t)(rails + 1) * sizeof(pm_record_range_t));
+        char *header = (char *)calloc(1, recorder->header_size);
+
+        if (!recorder->volt_scale || !recorder->curr_scale || !recorder->ring ||
+            !recorder->block || !recorder->ranges || !header)
+        {
+                free(header);
+                recorder_free(recorder);
+                return PM_ERROR_MEMORY;
+        }
+
+        /* The header describes the rails so the file can be read without the library */
+        pm_record_header_t *file_header = (pm_record_header_t *)header;
+        pm_record_rail_t *file_rails = (pm_record_rail_t *)(header + sizeof(pm_record_header_t));
+        struct timespec realtime;
+        clock_gettime(CLOCK_REALTIME, &realtime);
+
+        memcpy(file_header->magic, PM_RECORD_MAGIC, sizeof(PM_RECORD_MAGIC));
+        file_header->version = PM_RECORD_VERSION;
+        file_header->header_size = recorder->header_size;
+        file_header->block_size = RECORD_BLOCK_SIZE;
+        file_header->tick_size = recorder->tick_size;
+        file_header->footer_size = recorder->footer_size;
+        file_header->rail_count = (uint32_t)rails;
+        file_header->total_rail = handle->total_rail;
+        file_header->period_ns = __atomic_load_n(&handle->sampling_period_ns, __ATOMIC_RELAXED);
+        file_header->start_monotonic_ns = monotonic_now_ns();
+        file_header->start_realtime_ns = (uint64_t)realtime.tv_sec * NSEC_PER_SEC + (uint64_t)realtime.tv_nsec;
+
+        for (int i = 0; i < rails; i++)
+        {
+                const pm_rail_t *rail = &handle->rails[i];
+
+                snprintf(file_rails[i].name, sizeof(file_rails[i].name), "%s", rail->name);
+                file_rails[i].type = (uint32_t)rail->type;
+                file_rails[i].volt_scale = rail->volt_scale;
+                file_rails[i].curr_scale = rail->curr_scale;
+                recorder->volt_scale[i] = rail->volt_scale;
+                recorder->curr_scale[i] = rail->curr_scale;
+        }
+
+        recorder->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        int error = recorder->fd >= 0 ? write_all(recorder->fd, header, recorder->header_size, 0) : errno;
+        free(header);
+
+        if (error != 0)
+        {
+                recorder_free(recorder);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        if (sem_init(&recorder->wake, 0, 0) != 0)
+        {
+                recorder_free(recorder);
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        memset(&handle->record_stats, 0, sizeof(handle->record_stats));
+        if (pthread_create(&recorder->thread, NULL, record_thread_func, recorder) != 0)
+        {
+                sem_destroy(&recorder->wake);
+                recorder_free(recorder);
+                return PM_ERROR_THREAD;
+        }
+
+        /* The sampler queues ticks from its next tick on */
+        pthread_mutex_lock(&handle->data_mutex);
+        handle->recorder = recorder;
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        __atomic_store_n(&handle->record_stats.recording, true, __ATOMIC_RELEASE);
+        return PM_SUCCESS;
+}
+
+/* Stop recording */
+pm_error_t pm_record_stop(pm_handle_t handle)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!handle->recorder)
+        {
+                return PM_ERROR_NOT_RUNNING;
+        }
+
+        /* Detach the recorder so no tick is queued after the writer's last drain */
+        pthread_mutex_lock(&handle->data_mutex);
+        pm_recorder_t *recorder = handle->recorder;
+        handle->recorder = NULL;
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        __atomic_store_n(&recorder->stop_flag, true, __ATOMIC_RELEASE);
+        sem_post(&recorder->wake);
+        pthread_join(recorder->thread, NULL);
+
+        int error = recorder->error;
+        if (close(recorder->fd) != 0 && error == 0)
+        {
+                error = errno;
+        }
+        recorder->fd = -1;
+
+        sem_destroy(&recorder->wake);
+        recorder_free(recorder);
+
+        __atomic_store_n(&handle->record_stats.recording, false, __ATOMIC_RELEASE);
+        return error == 0 ? PM_SUCCESS : PM_ERROR_FILE_ACCESS;
+}
+
+/* Get the counters of the recording */
+pm_error_t pm_get_record_stats(pm_handle_t handle, pm_record_stats_t *stats)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!stats)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        stats->recording = __atomic_load_n(&handle->record_stats.recording, __ATOMIC_ACQUIRE);
+        stats->ticks = __atomic_load_n(&handle->record_stats.ticks, __ATOMIC_RELAXED);
+        stats->blocks = __atomic_load_n(&handle->record_stats.blocks, __ATOMIC_RELAXED);
+        stats->dropped = __atomic_load_n(&handle->record_stats.dropped, __ATOMIC_RELAXED);
+        return PM_SUCCESS;
+}
+
+/* Publish the snapshots and the history through a shared-memory segment */
+pm_error_t pm_publish_shared(pm_handle_t handle, const char *name)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (handle->attached || handle->shared)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (!name || name[0] == '\0' || strlen(name) >= sizeof(handle->shared_name))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* Attached readers map the segment read-only and cannot hold the sampler back */
+        if (handle->history && handle->history->policy == PM_OVERFLOW_DROP_NEWEST)
+        {
+                return PM_ERROR_NOT_SUPPORTED;
+        }
+
+        if (handle->sampling)
+        {
+                return PM_ERROR_ALREADY_RUNNING;
+        }
+
+        /* Header, snapshot block and history block, each on its own cache lines */
+        uint64_t header_size = (sizeof(pm_shared_header_t) + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+        uint64_t history_offset = (header_size + snapshot_size(handle->snapshot) + CACHE_LINE_SIZE - 1) &
+                                  ~(uint64_t)(CACHE_LINE_SIZE - 1);
+        uint64_t size = history_offset + (handle->history ? history_size(handle->history) : 0);
+
+        /* A segment left behind by a publisher that died is replaced, a live one never */
+        int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+        if (fd < 0 && errno == EEXIST && shared_stale(name))
+        {
+                shm_unlink(name);
+                fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+        }
+        if (fd < 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        /* Claim the segment with the pid before growing it, so a publisher dying from here on leaves it provably stale */
+        pm_shared_header_t claim;
+        memset(&claim, 0, sizeof(claim));
+        claim.version = SHARED_VERSION;
+        claim.publisher = (int32_t)getpid();
+        if (pwrite(fd, &claim, sizeof(claim), 0) != (ssize_t)sizeof(claim) || ftruncate(fd, (off_t)size) != 0)
+        {
+                close(fd);
+                shm_unlink(name);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        void *shared = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (shared == MAP_FAILED)
+        {
+                shm_unlink(name);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        pm_shared_header_t *header = (pm_shared_header_t *)shared;
+        pm_snapshot_block_t *snapshot = (pm_snapshot_block_t *)((char *)shared + header_size);
+        pm_history_t *history = handle->history ? (pm_history_t *)((char *)shared + history_offset) : NULL;
+
+        /* pm_sample_now() publishes under the same lock; readers may still hold the private blocks */
+        pthread_mutex_lock(&handle->data_mutex);
+        if (!retire(handle, handle->snapshot, free))
+        {
+                pthread_mutex_unlock(&handle->data_mutex);
+                munmap(shared, (size_t)size);
+                shm_unlink(name);
+                return PM_ERROR_MEMORY;
+        }
+        if (!retire(handle, handle->history, free))
+        {
+                /* The snapshot stays private: take it back off the retired list */
+                pm_retired_t *retired = handle->retired;
+                handle->retired = retired->next;
+                free(retired);
+                pthread_mutex_unlock(&handle->data_mutex);
+                munmap(shared, (size_t)size);
+                shm_unlink(name);
+                return PM_ERROR_MEMORY;
+        }
+        memcpy(snapshot, handle->snapshot, snapshot_size(handle->snapshot));
+        if (history)
+        {
+                memcpy(history, handle->history, history_size(handle->history));
+        }
+        __atomic_store_n(&handle->snapshot, snapshot, __ATOMIC_RELEASE);
+        __atomic_store_n(&handle->history, history, __ATOMIC_RELEASE);
+
+        header->sensor_count = (uint32_t)handle->sensor_count;
+        header->data_size = sizeof(pm_sensor_data_t);
+        header->stats_size = sizeof(pm_sensor_stats_t);
+        header->size = size;
+        header->snapshot_offset = header_size;
+        header->history_offset = history ? history_offset : 0;
+        pthread_mutex_unlock(&handle->data_mutex);
+
+        /* Readers check the magic before anything else */
+        __atomic_store_n(&header->magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+
+        handle->shared = shared;
+        handle->shared_size = (size_t)size;
+        snprintf(handle->shared_name, sizeof(handle->shared_name), "%s", name);
+        return PM_SUCCESS;
+}
+
+/* Check whether the existing segment @p name belongs to a publisher that is gone */
+static bool shared_stale(const char *name)
+{
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+        {
+                /* Removed meanwhile: nothing to protect */
+                return errno == ENOENT;
+        }
+
+        bool stale = false;
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+                close(fd);
+                return false;
+        }
+
+        if (st.st_size < (off_t)sizeof(pm_shared_header_t))
+        {
+                /* The pid comes with the first bytes, so the publisher died right after creating it */
+                stale = true;
+        }
+        else
+        {
+                const pm_shared_header_t *header =
+                        (const pm_shared_header_t *)mmap(NULL, sizeof(pm_shared_header_t), PROT_READ, MAP_SHARED, fd, 0);
+                if (header != MAP_FAILED)
+                {
+                        /* An unfinished segment without a pid was never claimed; another version's cannot be judged */
+                        pid_t pid = (pid_t)__atomic_load_n(&header->publisher, __ATOMIC_ACQUIRE);
+                        if (pid == 0)
+                        {
+                                stale = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC;
+                        }
+                        else
+                        {
+                                stale = pid > 0 && header->version == SHARED_VERSION && kill(pid, 0) != 0 &&
+                                        errno == ESRCH;
+                        }
+                        munmap((void *)header, sizeof(pm_shared_header_t));
+                }
+        }
+
+        close(fd);
+        return stale;
+}
+
+/* Check that a mapped segment is complete and laid out like this build expects */
+static bool shared_valid(const void *shared, uint64_t size)
+{
+        const pm_shared_header_t *header = (const pm_shared_header_t *)shared;
+        if (size < sizeof(pm_shared_header_t) ||
+            __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC ||
+            header->version != SHARED_VERSION || header->size > size || header->sensor_count == 0 ||
+            header->data_size != sizeof(pm_sensor_data_t) || header->stats_size != sizeof(pm_sensor_stats_t))
+        {
+                return false;
+        }
+
+        const pm_snapshot_block_t *snapshot = (const pm_snapshot_block_t *)((const char *)shared + header->snapshot_offset);
+        if (header->snapshot_offset + sizeof(pm_snapshot_block_t) > header->size ||
+            header->snapshot_offset + snapshot_size(snapshot) > header->size ||
+            snapshot->sensor_count != header->sensor_count || snapshot->slot_count == 0)
+        {
+                return false;
+        }
+
+        if (header->history_offset)
+        {
+                const pm_history_t *history = (const pm_history_t *)((const char *)shared + header->history_offset);
+                if (header->history_offset + sizeof(pm_history_t) > header->size ||
+                    header->history_offset + history_size(history) > header->size || history->capacity == 0)
+                {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/* Attach to a segment published by another process */
+pm_error_t pm_attach_shared(pm_handle_t *handle, const char *name)
+{
+        if (!handle || !name)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(pm_shared_header_t))
+        {
+                close(fd);
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* Read-only: the cursors and the lost count of this reader stay in its handle */
+        void *shared = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (shared == MAP_FAILED)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        if (!shared_valid(shared, (uint64_t)st.st_size))
+        {
+                munmap(shared, (size_t)st.st_size);
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        const pm_shared_header_t *header = (const pm_shared_header_t *)shared;
+        pm_handle_t attached = (pm_handle_t)calloc(1, sizeof(struct pm_handle_s));
+        if (!attached)
+        {
+                munmap(shared, (size_t)st.st_size);
+                return PM_ERROR_MEMORY;
+        }
+
+        attached->attached = true;
+        attached->shared = shared;
+        attached->shared_size = (size_t)st.st_size;
+        snprintf(attached->shared_name, sizeof(attached->shared_name), "%s", name);
+        attached->sensor_count = (int)header->sensor_count;
+        attached->total_rail = -1;
+        attached->snapshot = (pm_snapshot_block_t *)((char *)shared + header->snapshot_offset);
+        attached->history = header->history_offset ? (pm_history_t *)((char *)shared + header->history_offset) : NULL;
+
+        /* Only the names are known; they back pm_get_sensor_names() */
+        attached->rails = (pm_rail_t *)calloc(attached->sensor_count, sizeof(pm_rail_t));
+        pm_sensor_data_t *sensors = (pm_sensor_data_t *)malloc(attached->sensor_count * sizeof(pm_sensor_data_t));
+        if (!attached->rails || !sensors)
+        {
+                free(attached->rails);
+                free(sensors);
+                free(attached);
+                munmap(shared, (size_t)st.st_size);
+                return PM_ERROR_MEMORY;
+        }
+
+        if (pthread_mutex_init(&attached->data_mutex, NULL) != 0 ||
+            sem_init(&attached->thread_ready, 0, 0) != 0)
+        {
+                free(attached->rails);
+                free(sensors);
+                free(attached);
+                munmap(shared, (size_t)st.st_size);
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        read_snapshot(attached->snapshot, NULL, sensors, NULL, NULL);
+        for (int i = 0; i < attached->sensor_count; i++)
+        {
+                snprintf(attached->rails[i].name, sizeof(attached->rails[i].name), "%s", sensors[i].name);
+                attached->rails[i].type = sensors[i].type;
+        }
+        free(sensors);
+
+        attached->initialized = true;
+        *handle = attached;
+        return PM_SUCCESS;
+}
+
+/* Get the number of sensors */
+pm_error_t pm_get_sensor_count(pm_handle_t handle, int *count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        *count = handle->sensor_count;
+        return PM_SUCCESS;
+}
+
+/* Get the sensor names */
+#ifdef __GNUC__
+__attribute__((deprecated("This function is unsafe and will be removed in a future version. "
+                         "Please use pm_get_latest_data() or pm_get_statistics() instead to access sensor names.")))
+#endif
+pm_error_t pm_get_sensor_names(pm_handle_t handle, char **names, int *count)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (!names || !count)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        if (*count < handle->sensor_count)
+        {
+                *count = handle->sensor_count;
+                return PM_ERROR_MEMORY;
+        }
+
+        *count = handle->sensor_count;
+
+        /* Copy the sensor names with explicit size limit */
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                if (!names[i]) {
+                        fprintf(stderr, "[jetpwmon] Warning: names[%d] is NULL\n", i);
+                        continue;
+                }
+                /* Assume maximum safe buffer size of 64 (same as in pm_sensor_data_t) */
+                strncpy(names[i], handle->rails[i].name, 63);
+                names[i][63] = '\0';  /* Ensure null termination */
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Get the error message for an error code */
+const char *pm_error_string(pm_error_t error)
+{
+        int index = -error;
+        if (index < 0 || index >= (int)(sizeof(error_messages) / sizeof(error_messages[0])))
+        {
+                return "Unknown error";
+        }
+
+        return error_messages[index];
+}
+
+/* Current CLOCK_MONOTONIC time in nanoseconds */
+static uint64_t monotonic_now_ns(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * NSEC_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+/* Sleep until an absolute CLOCK_MONOTONIC deadline */
+static void sleep_until_ns(uint64_t deadline_ns)
+{
+        struct timespec deadline;
+        deadline.tv_sec = (time_t)(deadline_ns / NSEC_PER_SEC);
+        deadline.tv_nsec = (long)(deadline_ns % NSEC_PER_SEC);
+
+        /* An absolute deadline is unaffected by restarting after a signal */
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        {
+        }
+}
+
+/* Apply the sampler config to the calling thread and record what took effect */
+static void apply_sampler_config(pm_handle_t handle)
+{
+        const pm_sampler_config_t *config = &handle->sampler_config;
+        pm_sampler_report_t *report = &handle->sampler_report;
+
+        memset(report, 0, sizeof(*report));
+
+        /* Timer slack is per thread and delays the absolute-deadline wakeups */
+        if (config->timer_slack_ns > 0)
+        {
+                report->requested |= PM_SAMPLER_SETTING_TIMER_SLACK;
+                if (prctl(PR_SET_TIMERSLACK, (unsigned long)config->timer_slack_ns, 0, 0, 0) == 0)
+                {
+                        report->applied |= PM_SAMPLER_SETTING_TIMER_SLACK;
+                }
+                else
+                {
+                        report->timer_slack_errno = errno;
+                }
+        }
+
+        if (config->pin_cpu)
+        {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(config->cpu, &cpus);
+
+                report->requested |= PM_SAMPLER_SETTING_AFFINITY;
+                int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+                if (err == 0)
+                {
+                        report->applied |= PM_SAMPLER_SETTING_AFFINITY;
+                }
+                else
+                {
+                        report->affinity_errno = err;
+                }
+        }
+
+        /* Lock the pages touched by the sampler, including its own stack; the lock is process-wide */
+        if (config->lock_memory)
+        {
+                report->requested |= PM_SAMPLER_SETTING_MLOCK;
+                bool already_locked = memory_locked();
+                if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+                {
+                        report->applied |= PM_SAMPLER_SETTING_MLOCK;
+                        handle->unlock_memory = !already_locked;
+                }
+                else
+                {
+                        report->mlock_errno = errno;
+                }
+        }
+
+        if (config->policy != PM_SCHED_OTHER)
+        {
+                struct sched_param param;
+                memset(&param, 0, sizeof(param));
+                param.sched_priority = config->priority;
+
+                report->requested |= PM_SAMPLER_SETTING_POLICY;
+                int err = pthread_setschedparam(pthread_self(),
+                                                config->policy == PM_SCHED_FIFO ? SCHED_FIFO : SCHED_RR,
+                                                &param);
+                if (err == 0)
+                {
+                        report->applied |= PM_SAMPLER_SETTING_POLICY;
+                }
+                else
+                {
+                        report->policy_errno = err;
+                }
+        }
+
+#ifdef SHOW_ALL_DEBUG
+        printf("Sampler settings requested 0x%x, applied 0x%x\n", report->requested, report->applied);
+#endif
+}
+
+/* Whether the process holds locked memory, from VmLck in /proc/self/status; unknown counts as locked */
+static bool memory_locked(void)
+{
+        FILE *fp = fopen("/proc/self/status", "r");
+        if (!fp)
+        {
+                return true;
+        }
+
+        char line[256];
+        bool locked = true;
+        while (fgets(line, sizeof(line), fp))
+        {
+                unsigned long kb;
+                if (sscanf(line, "VmLck: %lu kB", &kb) == 1)
+                {
+                        locked = kb > 0;
+                        break;
+                }
+        }
+
+        fclose(fp);
+        return locked;
+}
+
+/* Sampling thread function */
+static void *sampling_thread_func(void *arg)
+{
+        pm_handle_t handle = (pm_handle_t)arg;
+        pm_sampler_stats_t *stats = &handle->sampler_stats;
+
+        /* Apply the thread settings before the first tick, then release pm_start_sampling() */
+        apply_sampler_config(handle);
+        sem_post(&handle->thread_ready);
+
+        /* Ticks are scheduled on absolute deadlines so read time never adds drift */
+        uint64_t deadline = monotonic_now_ns();
+
+        while (!__atomic_load_n(&handle->thread_stop_flag, __ATOMIC_ACQUIRE))
+        {
+                uint64_t tick_start = monotonic_now_ns();
+
+                /* Read the sensor data and update the statistics */
+                read_sensor_data(handle);
+
+                uint64_t tick_end = monotonic_now_ns();
+                uint64_t tick_ns = tick_end - tick_start;
+
+                /* The period is re-read every tick so changes apply to the next deadline */
+                uint64_t period_ns = __atomic_load_n(&handle->sampling_period_ns, __ATOMIC_RELAXED);
+                deadline += period_ns;
+
+                /* On overrun, skip the deadlines already passed instead of bursting to catch up */
+                if (tick_end > deadline)
+                {
+                        uint64_t missed = (tick_end - deadline) / period_ns + 1;
+                        deadline += missed * period_ns;
+                        __atomic_fetch_add(&stats->overruns, 1, __ATOMIC_RELAXED);
+                        __atomic_fetch_add(&stats->missed_ticks, missed, __ATOMIC_RELAXED);
+                }
+
+                __atomic_store_n(&stats->period_ns, period_ns, __ATOMIC_RELAXED);
+                __atomic_store_n(&stats->last_tick_ns, tick_ns, __ATOMIC_RELAXED);
+                if (tick_ns > stats->max_tick_ns)
+                {
+                        __atomic_store_n(&stats->max_tick_ns, tick_ns, __ATOMIC_RELAXED);
+                }
+                __atomic_fetch_add(&stats->ticks, 1, __ATOMIC_RELAXED);
+
+                sleep_until_ns(deadline);
+
+                /* Wakeup latency past the deadline, e.g. from scheduling delays */
+                uint64_t wake = monotonic_now_ns();
+                uint64_t lateness_ns = wake > deadline ? wake - deadline : 0;
+                __atomic_store_n(&stats->last_lateness_ns, lateness_ns, __ATOMIC_RELAXED);
+                if (lateness_ns > stats->max_lateness_ns)
+                {
+                        __atomic_store_n(&stats->max_lateness_ns, lateness_ns, __ATOMIC_RELAXED);
+                }
+        }
+
+        return NULL;
+}
+
+/* Discover sensors on the system */
+static pm_error_t discover_sensors(pm_handle_t handle, const char *cache_path)
+{
+        /* Sysfs sources, in rail order */
+        static const pm_backend_ops_t *const sources[] = {&ina3221_backend, &power_supply_backend};
+        pm_error_t error = PM_SUCCESS;
+
+        /* A valid cache stands in for the scans of every source */
+        if (cache_path)
+        {
+                handle->cached_rails = cache_load(handle, cache_path, &handle->cached_rail_count);
+        }
+        bool cached = handle->cached_rails != NULL;
+
+        for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]) && error == PM_SUCCESS; i++)
+        {
+                error = add_backend(handle, sources[i], NULL);
+        }
+
+        free(handle->cached_rails);
+        handle->cached_rails = NULL;
+        handle->cached_rail_count = 0;
+        if (error != PM_SUCCESS)
+        {
+                return error;
+        }
+
+        /* Keep what the scans found for the next pm_init() of this boot */
+        if (cache_path && !cached && handle->sensor_count > 0)
+        {
+                cache_store(handle, cache_path);
+        }
+
+        /* Check if any sensors were found */
+        if (handle->sensor_count == 0)
+        {
+                /* For testing purposes, add dummy sensors if none were found */
+                if (getenv(ENV_JTOP_TESTING))
+                {
+                        return add_backend(handle, &testing_backend, NULL);
+                }
+                return PM_ERROR_NO_SENSORS;
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Let a source add its rails after the ones found so far; it takes ownership of state */
+static pm_error_t add_backend(pm_handle_t handle, const pm_backend_ops_t *ops, void *state)
+{
+        if (handle->backend_count == BACKEND_MAX)
+        {
+                pm_backend_t spare = {ops, 0, 0, state};
+                if (ops->destroy)
+                        ops->destroy(&spare);
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        pm_backend_t *backend = &handle->backends[handle->backend_count];
+        backend->ops = ops;
+        backend->first_rail = handle->sensor_count;
+        backend->rail_count = 0;
+        backend->state = state;
+
+        pm_error_t error = handle->cached_rails ? cache_discover(handle, backend) : ops->discover(handle, backend);
+        backend->rail_count = handle->sensor_count - backend->first_rail;
+
+        #ifdef SHOW_ALL_DEBUG
+        printf("Backend %s: %d rails\n", ops->name, backend->rail_count);
+        #endif
+
+        /* Sources without rails are not kept, rails of a failed source are */
+        if (backend->rail_count == 0)
+        {
+                if (ops->destroy)
+                        ops->destroy(backend);
+                memset(backend, 0, sizeof(*backend));
+                return error;
+        }
+
+        handle->backend_count++;
+        if (ops->clock && !handle->clock_backend)
+        {
+                handle->clock_backend = backend;
+        }
+        return error;
+}
+
+/* Release the state of every source */
+static void backends_free(pm_handle_t handle)
+{
+        for (int i = 0; i < handle->backend_count; i++)
+        {
+                pm_backend_t *backend = &handle->backends[i];
+                if (backend->ops->destroy)
+                        backend->ops->destroy(backend);
+        }
+        handle->backend_count = 0;
+        handle->clock_backend = NULL;
+}
+
+/* Read the id of the current boot */
+static bool read_boot_id(char *boot_id, size_t size)
+{
+        int fd = open(BOOT_ID_PATH, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+                return false;
+        }
+
+        ssize_t length = read(fd, boot_id, size - 1);
+        close(fd);
+        if (length <= 0)
+        {
+                return false;
+        }
+
+        boot_id[length] = '\0';
+        boot_id[strcspn(boot_id, "\n")] = '\0';
+        return boot_id[0] != '\0';
+}
+
+/* Load the rails of a cache written in this boot for the same folders; NULL if it is missing or stale */
+static pm_cache_rail_t *cache_load(pm_handle_t handle, const char *path, int *count)
+{
+        pm_cache_header_t header;
+        char boot_id[sizeof(header.boot_id)];
+        struct stat st;
+
+        if (!read_boot_id(boot_id, sizeof(boot_id)))
+        {
+                return NULL;
+        }
+
+        int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd < 0)
+        {
+                return NULL;
+        }
+
+        /* Only trust a regular file of this user that nobody else can write */
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() ||
+            (st.st_mode & (S_IWGRP | S_IWOTH)) ||
+            pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        {
+                close(fd);
+                return NULL;
+        }
+
+        header.magic[sizeof(header.magic) - 1] = '\0';
+        header.boot_id[sizeof(header.boot_id) - 1] = '\0';
+        header.i2c_path[sizeof(header.i2c_path) - 1] = '\0';
+        header.power_supply_path[sizeof(header.power_supply_path) - 1] = '\0';
+        if (strcmp(header.magic, DISCOVERY_CACHE_MAGIC) != 0 || header.version != DISCOVERY_CACHE_VERSION ||
+            header.rail_count == 0 || header.rail_count > DISCOVERY_CACHE_MAX_RAILS ||
+            (uint64_t)st.st_size != sizeof(header) + (uint64_t)header.rail_count * sizeof(pm_cache_rail_t) ||
+            strcmp(header.boot_id, boot_id) != 0 || strcmp(header.i2c_path, handle->i2c_path) != 0 ||
+            strcmp(header.power_supply_path, handle->power_supply_path) != 0)
+        {
+                close(fd);
+                return NULL;
+        }
+
+        size_t size = header.rail_count * sizeof(pm_cache_rail_t);
+        pm_cache_rail_t *rails = (pm_cache_rail_t *)malloc(size);
+        if (!rails || pread(fd, rails, size, sizeof(header)) != (ssize_t)size)
+        {
+                free(rails);
+                close(fd);
+                return NULL;
+        }
+        close(fd);
+
+        /* The topology is fixed for a boot, but a driver may have been unloaded since */
+        for (uint32_t i = 0; i < header.rail_count; i++)
+        {
+                pm_cache_rail_t *rail = &rails[i];
+                rail->source[sizeof(rail->source) - 1] = '\0';
+                rail->name[sizeof(rail->name) - 1] = '\0';
+                rail->volt_path[sizeof(rail->volt_path) - 1] = '\0';
+                rail->curr_path[sizeof(rail->curr_path) - 1] = '\0';
+
+                if (stat(rail->volt_path, &st) != 0 || !S_ISREG(st.st_mode) ||
+                    stat(rail->curr_path, &st) != 0 || !S_ISREG(st.st_mode))
+                {
+                        #ifdef SHOW_ALL_DEBUG
+                        printf("Discovery cache %s is stale: %s is gone\n", path, rail->name);
+                        #endif
+                        free(rails);
+                        return NULL;
+                }
+        }
+
+        *count = (int)header.rail_count;
+        return rails;
+}
+
+/* Write the discovered rails to the cache, replacing it atomically; failures only cost the next rescan */
+static void cache_store(pm_handle_t handle, const char *path)
+{
+        pm_cache_header_t header;
+        char temp_path[PATH_MAX];
+
+        memset(&header, 0, sizeof(header));
+        if (!read_boot_id(header.boot_id, sizeof(header.boot_id)) ||
+            handle->sensor_count > DISCOVERY_CACHE_MAX_RAILS ||
+            snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path) >= (int)sizeof(temp_path))
+        {
+                return;
+        }
+        snprintf(header.magic, sizeof(header.magic), "%s", DISCOVERY_CACHE_MAGIC);
+        header.version = DISCOVERY_CACHE_VERSION;
+        header.rail_count = (uint32_t)handle->sensor_count;
+        snprintf(header.i2c_path, sizeof(header.i2c_path), "%s", handle->i2c_path);
+        snprintf(header.power_supply_path, sizeof(header.power_supply_path), "%s", handle->power_supply_path);
+
+        pm_cache_rail_t *rails = (pm_cache_rail_t *)calloc(handle->sensor_count, sizeof(pm_cache_rail_t));
+        if (!rails)
+        {
+                return;
+        }
+        for (int b = 0; b < handle->backend_count; b++)
+        {
+                const pm_backend_t *backend = &handle->backends[b];
+                for (int i = backend->first_rail; i < backend->first_rail + backend->rail_count; i++)
+                {
+                        const pm_rail_t *rail = &handle->rails[i];
+                        snprintf(rails[i].source, sizeof(rails[i].source), "%s", backend->ops->name);
+                        snprintf(rails[i].name, sizeof(rails[i].name), "%s", rail->name);
+                        rails[i].type = (int32_t)rail->type;
+                        rails[i].channel = rail->channel;
+                        snprintf(rails[i].volt_path, sizeof(rails[i].volt_path), "%s", rail->volt_path);
+                        snprintf(rails[i].curr_path, sizeof(rails[i].curr_path), "%s", rail->curr_path);
+                }
+        }
+
+        int fd = mkstemp(temp_path);
+        if (fd < 0)
+        {
+                free(rails);
+                return;
+        }
+
+        size_t size = (size_t)handle->sensor_count * sizeof(pm_cache_rail_t);
+        bool ok = write_all(fd, &header, sizeof(header), 0) == 0 &&
+                  write_all(fd, rails, size, (off_t)sizeof(header)) == 0 &&
+                  fchmod(fd, 0644) == 0;
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(temp_path, path) != 0)
+        {
+                unlink(temp_path);
+        }
+        free(rails);
+}
+
+/* Rails of the discovery cache found by this source, added in their original order */
+static pm_error_t cache_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        for (int i = 0; i < handle->cached_rail_count; i++)
+        {
+                const pm_cache_rail_t *rail = &handle->cached_rails[i];
+                if (strcmp(rail->source, backend->ops->name) != 0)
+                {
+                        continue;
+                }
+
+                if (add_rail(handle, rail->name, (pm_sensor_type_t)rail->type, rail->channel,
+                             rail->volt_path, rail->curr_path) != PM_SUCCESS)
+                {
+                        return PM_ERROR_MEMORY;
+                }
+        }
+        return PM_SUCCESS;
+}
+
+/* INA3221 rails of both layouts, in one walk of the I2C devices */
+static pm_error_t ina3221_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        (void)backend;
+        if (find_all_i2c_power_monitor(handle) == PM_ERROR_FILE_ACCESS)
+        {
+                fprintf(stderr, "Error: I2C folder %s doesn't exist\n", handle->i2c_path);
+        }
+        return PM_SUCCESS; /* We return success but log error to maintain compatibility */
+}
+
+/* Power supply rails */
+static pm_error_t power_supply_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        (void)backend;
+        return find_all_system_monitor(handle);
+}
+
+/* Dummy rails whose files never exist */
+static pm_error_t testing_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        (void)backend;
+        if (add_rail(handle, "CPU", PM_SENSOR_TYPE_SYSTEM, -1,
+                     "/fake/cpu/voltage_now", "/fake/cpu/current_now") != PM_SUCCESS ||
+            add_rail(handle, "GPU", PM_SENSOR_TYPE_SYSTEM, -1,
+                     "/fake/gpu/voltage_now", "/fake/gpu/current_now") != PM_SUCCESS)
+        {
+                return PM_ERROR_MEMORY;
+        }
+        return PM_SUCCESS;
+}
+
+/* Take the next tick of the trace, on the trace clock of the current lap */
+static bool replay_fetch(pm_replay_t *replay)
+{
+        uint64_t timestamp_ns;
+
+        if (replay->map)
+        {
+                const pm_record_header_t *header = replay->header;
+
+                for (;;)
+                {
+                        if (replay->block >= replay->block_count)
+                        {
+                                return false;
+                        }
+
+                        const char *block = replay->map + header->header_size + replay->block * header->block_size;
+                        const pm_record_footer_t *footer =
+                                (const pm_record_footer_t *)(block + header->block_size - header->footer_size);
+                        if (replay->index >= footer->tick_count)
+                        {
+                                replay->block++;
+                                replay->index = 0;
+                                continue;
+                        }
+
+                        const pm_record_tick_t *tick =
+                                (const pm_record_tick_t *)(block + (size_t)replay->index * header->tick_size);
+                        const pm_record_value_t *values = (const pm_record_value_t *)(tick + 1);
+
+                        timestamp_ns = footer->first_ns + (uint64_t)tick->offset_us * 1000;
+                        replay->next_offline = tick->offline;
+                        for (int i = 0; i < replay->rail_count; i++)
+                        {
+                                replay->next_values[2 * i] = values[i].voltage;
+                                replay->next_values[2 * i + 1] = values[i].current;
+                        }
+                        replay->index++;
+                        break;
+                }
+        }
+        else
+        {
+                if (replay->csv_next >= replay->csv_ticks)
+                {
+                        return false;
+                }
+
+                uint64_t tick = replay->csv_next++;
+                timestamp_ns = replay->csv_times[tick];
+                replay->next_offline = replay->csv_offline[tick];
+                memcpy(replay->next_values, replay->csv_values + tick * 2 * replay->rail_count,
+                       2 * replay->rail_count * sizeof(double));
+        }
+
+        replay->next_ns = replay->lap_ns + (timestamp_ns - replay->first_ns);
+        return true;
+}
+
+/* Load the next tick into next_*, starting another lap at the end of a looped trace */
+static void replay_advance(pm_replay_t *replay)
+{
+        uint64_t last_ns = replay->have_next ? replay->next_ns : replay->lap_ns;
+
+        replay->have_next = replay_fetch(replay);
+        if (!replay->have_next && replay->loop)
+        {
+                replay->lap_ns = last_ns + replay->period_ns;
+                replay->block = 0;
+                replay->index = 0;
+                replay->csv_next = 0;
+                replay->have_next = replay_fetch(replay);
+        }
+}
+
+/* Set the raw readings of every rail from the trace at the time of this sample */
+static void replay_read(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_replay_t *replay = (pm_replay_t *)backend->state;
+        uint64_t now = monotonic_now_ns();
+
+        if (!replay->started)
+        {
+                replay->started = true;
+                replay->start_ns = now;
+                replay_advance(replay);
+        }
+
+        if (replay->speed > 0.0)
+        {
+                /* Replay the newest tick recorded before the scaled elapsed time */
+                uint64_t trace_ns = (uint64_t)((double)(now - replay->start_ns) * replay->speed);
+                while (replay->have_next && replay->next_ns <= trace_ns)
+                {
+                        replay->have_current = true;
+                        replay->current_ns = replay->next_ns;
+                        replay->current_offline = replay->next_offline;
+                        memcpy(replay->current_values, replay->next_values, 2 * replay->rail_count * sizeof(double));
+                        replay_advance(replay);
+                }
+
+                /* The last tick holds for one period */
+                replay->ended = !replay->have_next && trace_ns >= replay->current_ns + replay->period_ns;
+                replay->sample_ns = replay->start_ns + trace_ns;
+        }
+        else if (replay->have_next)
+        {
+                /* Step mode: every sample is the next tick */
+                replay->have_current = true;
+                replay->current_ns = replay->next_ns;
+                replay->current_offline = replay->next_offline;
+                memcpy(replay->current_values, replay->next_values, 2 * replay->rail_count * sizeof(double));
+                replay->sample_ns = replay->start_ns + replay->current_ns;
+                replay_advance(replay);
+        }
+        else
+        {
+                replay->ended = true;
+                replay->sample_ns += replay->period_ns;
+        }
+
+        for (int i = 0; i < backend->rail_count; i++)
+        {
+                pm_sensor_fds_t *fds = &handle->sensor_fds[backend->first_rail + i];
+
+                fds->read_ok = replay->have_current && !replay->ended && !(replay->current_offline & (1u << i));
+                fds->volt_raw = replay->current_values[2 * i];
+                fds->curr_raw = replay->current_values[2 * i + 1];
+        }
+}
+
+/* Map a recording of pm_record_start() and check its layout */
+static pm_error_t replay_map_recording(pm_replay_t *replay, int fd)
+{
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        if ((size_t)st.st_size < sizeof(pm_record_header_t))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        replay->map = (char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (replay->map == MAP_FAILED)
+        {
+                replay->map = NULL;
+                return PM_ERROR_FILE_ACCESS;
+        }
+        replay->map_size = (size_t)st.st_size;
+
+        const pm_record_header_t *header = (const pm_record_header_t *)replay->map;
+        uint32_t rails = header->rail_count;
+        replay->header = header;
+
+        if (header->version != PM_RECORD_VERSION || rails == 0 || rails > PM_RECORD_MAX_RAILS ||
+            header->tick_size != sizeof(pm_record_tick_t) + rails * sizeof(pm_record_value_t) ||
+            header->footer_size != sizeof(pm_record_footer_t) + (rails + 1) * sizeof(pm_record_range_t) ||
+            header->header_size < sizeof(pm_record_header_t) + rails * sizeof(pm_record_rail_t) ||
+            header->header_size > replay->map_size || header->block_size < header->footer_size + header->tick_size)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        /* The file ends at the last complete block, e.g. after a crash */
+        uint64_t blocks = (replay->map_size - header->header_size) / header->block_size;
+        for (replay->block_count = 0; replay->block_count < blocks; replay->block_count++)
+        {
+                const char *block = replay->map + header->header_size + replay->block_count * header->block_size;
+                const pm_record_footer_t *footer =
+                        (const pm_record_footer_t *)(block + header->block_size - header->footer_size);
+                if (footer->magic != PM_RECORD_BLOCK_MAGIC ||
+                    footer->tick_count > (header->block_size - header->footer_size) / header->tick_size)
+                {
+                        break;
+                }
+                if (replay->block_count == 0)
+                {
+                        replay->first_ns = footer->first_ns;
+                }
+        }
+
+        if (replay->block_count == 0)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        replay->rail_count = (int)rails;
+        replay->period_ns = header->period_ns > 0 ? header->period_ns : NSEC_PER_SEC;
+        return PM_SUCCESS;
+}
+
+/* Split a CSV line in place into at most max fields */
+static int split_csv(char *line, char **fields, int max)
+{
+        int count = 0;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        while (count < max)
+        {
+                fields[count++] = line;
+                char *comma = strchr(line, ',');
+                if (!comma)
+                {
+                        break;
+                }
+                *comma = '\0';
+                line = comma + 1;
+        }
+        return count;
+}
+
+/* Parse a CSV trace: a header naming the rails, then one row per tick */
+static pm_error_t replay_parse_csv(pm_replay_t *replay, FILE *fp, char names[][64])
+{
+        char *line = NULL;
+        size_t line_size = 0;
+        char *fields[1 + 2 * PM_RECORD_MAX_RAILS + 1];
+        const int max_fields = 1 + 2 * PM_RECORD_MAX_RAILS + 1;
+        uint64_t capacity = 0;
+        pm_error_t error = PM_SUCCESS;
+
+        while (getline(&line, &line_size, fp) >= 0)
+        {
+                if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+                {
+                        continue;
+                }
+
+                int count = split_csv(line, fields, max_fields);
+
+                /* The header: time, then a voltage and a current column per rail */
+                if (replay->rail_count == 0)
+                {
+                        if (count < 3 || count % 2 == 0 || count == max_fields)
+                        {
+                                error = PM_ERROR_INIT_FAILED;
+                                break;
+                        }
+
+                        replay->rail_count = (count - 1) / 2;
+                        for (int i = 0; i < replay->rail_count; i++)
+                        {
+                                /* VDD_IN_V names the rail VDD_IN */
+                                const char *column = fields[1 + 2 * i];
+                                size_t length = strlen(column);
+                                if (length > 2 && strcmp(column + length - 2, "_V") == 0)
+                                {
+                                        length -= 2;
+                                }
+                                snprintf(names[i], 64, "%.*s", (int)length, column);
+                        }
+                        continue;
+                }
+
+                if (count != 1 + 2 * replay->rail_count)
+                {
+                        error = PM_ERROR_INIT_FAILED;
+                        break;
+                }
+
+                if (replay->csv_ticks == capacity)
+                {
+                        uint64_t grown = capacity ? 2 * capacity : 1024;
+                        uint64_t *times = (uint64_t *)realloc(replay->csv_times, grown * sizeof(uint64_t));
+                        if (times)
+                        {
+                                replay->csv_times = times;
+                        }
+                        uint32_t *offline = (uint32_t *)realloc(replay->csv_offline, grown * sizeof(uint32_t));
+                        if (offline)
+                        {
+                                replay->csv_offline = offline;
+                        }
+                        double *values = (double *)realloc(replay->csv_values,
+                                                           grown * 2 * replay->rail_count * sizeof(double));
+                        if (values)
+                        {
+                                replay->csv_values = values;
+                        }
+                        if (!times || !offline || !values)
+                        {
+                                error = PM_ERROR_MEMORY;
+                                break;
+                        }
+                        capacity = grown;
+                }
+
+                char *end;
+                double seconds = strtod(fields[0], &end);
+                if (end == fields[0] || seconds < 0.0)
+                {
+                        error = PM_ERROR_INIT_FAILED;
+                        break;
+                }
+
+                uint64_t tick = replay->csv_ticks;
+                uint64_t timestamp_ns = (uint64_t)llround(seconds * 1e9);
+                if (tick > 0 && timestamp_ns < replay->csv_times[tick - 1])
+                {
+                        error = PM_ERROR_INIT_FAILED;
+                        break;
+                }
+
+                replay->csv_times[tick] = timestamp_ns;
+                replay->csv_offline[tick] = 0;
+                for (int i = 0; i < 2 * replay->rail_count; i++)
+                {
+                        /* An empty field marks the rail offline; values are kept in mV and mA like sysfs */
+                        double value = strtod(fields[1 + i], &end);
+                        if (end == fields[1 + i])
+                        {
+                                replay->csv_offline[tick] |= 1u << (i / 2);
+                                value = 0.0;
+                        }
+                        replay->csv_values[tick * 2 * replay->rail_count + i] = value * 1000.0;
+                }
+                replay->csv_ticks++;
+        }
+        free(line);
+
+        if (error == PM_SUCCESS && replay->csv_ticks == 0)
+        {
+                error = PM_ERROR_INIT_FAILED;
+        }
+        if (error == PM_SUCCESS)
+        {
+                replay->first_ns = replay->csv_times[0];
+                replay->period_ns = replay->csv_ticks > 1 && replay->csv_times[1] > replay->csv_times[0] ?
+                                            replay->csv_times[1] - replay->csv_times[0] : NSEC_PER_SEC;
+        }
+        return error;
+}
+
+/* Timestamp of the last sample, on the trace clock */
+static uint64_t replay_clock(const pm_backend_t *backend)
+{
+        return ((const pm_replay_t *)backend->state)->sample_ns;
+}
+
+/* Open the trace of a replay */
+static pm_error_t replay_open(const pm_config_t *config, pm_replay_t **replay_out)
+{
+        char (*names)[64] = NULL;
+        pm_error_t error = PM_SUCCESS;
+
+        pm_replay_t *replay = (pm_replay_t *)calloc(1, sizeof(pm_replay_t));
+        if (!replay)
+        {
+                return PM_ERROR_MEMORY;
+        }
+        replay->speed = config->replay_speed > 0.0 ? config->replay_speed : 0.0;
+        replay->loop = config->replay_loop;
+
+        FILE *fp = fopen(config->replay_path, "r");
+        if (!fp)
+        {
+                free(replay);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        /* Recordings start with their magic, anything else is read as CSV */
+        char magic[sizeof(PM_RECORD_MAGIC)] = {0};
+        if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, PM_RECORD_MAGIC, sizeof(magic)) == 0)
+        {
+                error = replay_map_recording(replay, fileno(fp));
+        }
+        else
+        {
+                names = (char (*)[64])calloc(PM_RECORD_MAX_RAILS, 64);
+                if (!names)
+                {
+                        error = PM_ERROR_MEMORY;
+                }
+                else
+                {
+                        rewind(fp);
+                        error = replay_parse_csv(replay, fp, names);
+                }
+        }
+        fclose(fp);
+        replay->names = names;
+
+        if (error == PM_SUCCESS)
+        {
+                replay->next_values = (double *)calloc(2 * replay->rail_count, sizeof(double));
+                replay->current_values = (double *)calloc(2 * replay->rail_count, sizeof(double));
+                if (!replay->next_values || !replay->current_values)
+                {
+                        error = PM_ERROR_MEMORY;
+                }
+        }
+
+        if (error != PM_SUCCESS)
+        {
+                replay_free(replay);
+                return error;
+        }
+
+        *replay_out = replay;
+        return PM_SUCCESS;
+}
+
+/* The rails of the trace stand in for the discovered sensors */
+static pm_error_t replay_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_replay_t *replay = (pm_replay_t *)backend->state;
+        pm_error_t error = PM_SUCCESS;
+
+        for (int i = 0; error == PM_SUCCESS && i < replay->rail_count; i++)
+        {
+                if (replay->map)
+                {
+                        const pm_record_rail_t *rail =
+                                (const pm_record_rail_t *)(replay->map + sizeof(pm_record_header_t)) + i;
+                        char name[sizeof(rail->name) + 1];
+                        snprintf(name, sizeof(name), "%.*s", (int)sizeof(rail->name), rail->name);
+                        error = add_rail(handle, name, (pm_sensor_type_t)rail->type, -1, "", "");
+                        if (error == PM_SUCCESS)
+                        {
+                                handle->rails[backend->first_rail + i].volt_scale = rail->volt_scale;
+                                handle->rails[backend->first_rail + i].curr_scale = rail->curr_scale;
+                        }
+                }
+                else
+                {
+                        error = add_rail(handle, replay->names[i], PM_SENSOR_TYPE_UNKNOWN, -1, "", "");
+                }
+        }
+
+        /* The names are only needed until the rails exist */
+        free(replay->names);
+        replay->names = NULL;
+        return error;
+}
+
+/* Release the replay of a source */
+static void replay_destroy(pm_backend_t *backend)
+{
+        replay_free((pm_replay_t *)backend->state);
+        backend->state = NULL;
+}
+
+/* Release a replay */
+static void replay_free(pm_replay_t *replay)
+{
+        if (!replay)
+        {
+                return;
+        }
+
+        if (replay->map)
+        {
+                munmap(replay->map, replay->map_size);
+        }
+        free(replay->csv_times);
+        free(replay->csv_offline);
+        free(replay->csv_values);
+        free(replay->next_values);
+        free(replay->current_values);
+        free(replay->names);
+        free(replay);
+}
+
+/* Parse a synthetic spec, see pm_init_config() */
+static pm_error_t synth_parse(const char *spec, pm_synth_t **synth_out)
+{
+        static const struct
+        {
+                const char *name;
+                pm_synth_wave_t wave;
+                int params;
+        } waves[] = {{"const", SYNTH_CONST, 1}, {"step", SYNTH_STEP, 3}, {"sine", SYNTH_SINE, 3},
+                     {"walk", SYNTH_WALK, 3}, {"burst", SYNTH_BURST, 4}};
+        pm_error_t error = PM_SUCCESS;
+        char *saveptr = NULL;
+
+        char *copy = strdup_safe(strcmp(spec, "default") == 0 ? SYNTH_DEFAULT_SPEC : spec);
+        pm_synth_t *synth = (pm_synth_t *)calloc(1, sizeof(pm_synth_t));
+        if (!copy || !synth)
+        {
+                free(copy);
+                free(synth);
+                return PM_ERROR_MEMORY;
+        }
+        synth->rng = 0x9e3779b97f4a7c15ULL;
+
+        for (char *item = strtok_r(copy, ";", &saveptr); item && error == PM_SUCCESS;
+             item = strtok_r(NULL, ";", &saveptr))
+        {
+                while (*item == ' ')
+                        item++;
+                if (*item == '\0')
+                        continue;
+
+                /* name=wave:params[@volts] */
+                char *wave = strchr(item, '=');
+                char *params = wave ? strchr(wave, ':') : NULL;
+                if (!wave || !params || wave == item)
+                {
+                        error = PM_ERROR_INIT_FAILED;
+                        break;
+                }
+                *wave++ = '\0';
+                *params++ = '\0';
+
+                pm_synth_rail_t *rails = (pm_synth_rail_t *)realloc(synth->rails,
+                                                                    (synth->rail_count + 1) * sizeof(pm_synth_rail_t));
+                if (!rails)
+                {
+                        error = PM_ERROR_MEMORY;
+                        break;
+                }
+                synth->rails = rails;
+                pm_synth_rail_t *rail = &rails[synth->rail_count];
+                memset(rail, 0, sizeof(*rail));
+                snprintf(rail->name, sizeof(rail->name), "%s", item);
+                rail->voltage = SYNTH_DEFAULT_VOLTAGE;
+
+                int expected = -1;
+                for (size_t i = 0; i < sizeof(waves) / sizeof(waves[0]); i++)
+                {
+                        if (strcmp(wave, waves[i].name) == 0)
+                        {
+                                rail->wave = waves[i].wave;
+                                expected = waves[i].params;
+                        }
+                }
+
+                /* Comma-separated numbers, then the optional voltage */
+                char *end = params;
+                int count = 0;
+                while (expected > 0 && count < expected)
+                {
+                        char *next;
+                        rail->params[count++] = strtod(end, &next);
+                        if (next == end || (count < expected && *next != ','))
+                        {
+                                expected = -1;
+                                break;
+                        }
+                        end = next + (count < expected);
+                }
+                if (expected > 0 && *end == '@')
+                {
+                        char *next;
+                        rail->voltage = strtod(end + 1, &next);
+                        if (next == end + 1 || rail->voltage <= 0.0)
+                                expected = -1;
+                        end = next;
+                }
+                while (*end == ' ')
+                        end++;
+                if (expected < 0 || *end != '\0')
+                {
+                        error = PM_ERROR_INIT_FAILED;
+                        break;
+                }
+
+                rail->power = rail->params[0];
+                synth->rail_count++;
+        }
+        free(copy);
+
+        if (error == PM_SUCCESS && synth->rail_count == 0)
+        {
+                error = PM_ERROR_INIT_FAILED;
+        }
+        if (error != PM_SUCCESS)
+        {
+                free(synth->rails);
+                free(synth);
+                return error;
+        }
+
+        *synth_out = synth;
+        return PM_SUCCESS;
+}
+
+/* Add the rails of the spec, each one generating its readings in mV and mA */
+static pm_error_t synth_discover(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_synth_t *synth = (pm_synth_t *)backend->state;
+
+        for (int i = 0; i < synth->rail_count; i++)
+        {
+                /* Readings are in mV and mA like every other source, so recordings keep their resolution */
+                pm_error_t error = add_rail(handle, synth->rails[i].name, PM_SENSOR_TYPE_UNKNOWN, -1, "", "");
+                if (error != PM_SUCCESS)
+                {
+                        return error;
+                }
+        }
+        return PM_SUCCESS;
+}
+
+/* Uniform random number in [0, 1) from xorshift64 */
+static double synth_random(pm_synth_t *synth)
+{
+        synth->rng ^= synth->rng << 13;
+        synth->rng ^= synth->rng >> 7;
+        synth->rng ^= synth->rng << 17;
+        return (double)(synth->rng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Generate every rail at the current time */
+static void synth_read(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_synth_t *synth = (pm_synth_t *)backend->state;
+        uint64_t now = monotonic_now_ns();
+
+        if (!synth->started)
+        {
+                synth->started = true;
+                synth->start_ns = now;
+                synth->sample_ns = now;
+        }
+        double t = (double)(now - synth->start_ns) / (double)NSEC_PER_SEC;
+        double dt = (double)(now - synth->sample_ns) / (double)NSEC_PER_SEC;
+        synth->sample_ns = now;
+
+        for (int i = 0; i < synth->rail_count; i++)
+        {
+                pm_synth_rail_t *rail = &synth->rails[i];
+                pm_sensor_fds_t *fds = &handle->sensor_fds[backend->first_rail + i];
+                const double *p = rail->params;
+                double power;
+
+                switch (rail->wave)
+                {
+                case SYNTH_STEP:
+                        power = p[2] > 0.0 && fmod(t, p[2]) >= p[2] / 2.0 ? p[1] : p[0];
+                        break;
+                case SYNTH_SINE:
+                        power = p[0] + p[1] * sin(2.0 * M_PI * p[2] * t);
+                        break;
+                case SYNTH_WALK:
+                        rail->power += (2.0 * synth_random(synth) - 1.0) * p[1];
+                        if (rail->power < 0.0)
+                                rail->power = 0.0;
+                        else if (rail->power > p[2])
+                                rail->power = p[2];
+                        power = rail->power;
+                        break;
+                case SYNTH_BURST:
+                        /* Bursts arrive as a Poisson process of rate p[2] */
+                        if (now >= rail->burst_end_ns && synth_random(synth) < 1.0 - exp(-p[2] * dt))
+                        {
+                                rail->burst_end_ns = now + (uint64_t)(p[3] * (double)NSEC_PER_SEC);
+                        }
+                        power = now < rail->burst_end_ns ? p[1] : p[0];
+                        break;
+                default:
+                        power = p[0];
+                        break;
+                }
+                if (power < 0.0)
+                {
+                        power = 0.0;
+                }
+
+                fds->volt_raw = rail->voltage * 1000.0;
+                fds->curr_raw = power / rail->voltage * 1000.0;
+                fds->read_ok = true;
+        }
+}
+
+/* Time the waveforms were generated for */
+static uint64_t synth_clock(const pm_backend_t *backend)
+{
+        return ((const pm_synth_t *)backend->state)->sample_ns;
+}
+
+/* Release the synthetic source */
+static void synth_destroy(pm_backend_t *backend)
+{
+        pm_synth_t *synth = (pm_synth_t *)backend->state;
+
+        if (synth)
+        {
+                free(synth->rails);
+                free(synth);
+        }
+        backend->state = NULL;
+}
+
+/* Find all I2C power monitors */
+static pm_error_t find_all_i2c_power_monitor(pm_handle_t handle)
+{
+        DIR *dir;
+        struct dirent *entry;
+        char path[1024];  /* Increased from 512 */
+        char name_path[512];
+        char buffer[256];
+
+        /* Check if the I2C path exists; entries are then resolved relative to it */
+        int dir_fd = open_directory(AT_FDCWD, handle->i2c_path);
+        if (dir_fd < 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        dir = fdopendir(dir_fd);
+        if (!dir)
+        {
+                close(dir_fd);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        /* Scan all I2C devices for power sensors */
+        while ((entry = readdir(dir)) != NULL)
+        {
+                if (entry->d_name[0] == '.' || !may_be_directory(entry))
+                {
+                        continue; /* Skip hidden entries and plain files */
+                }
+
+                /* Devices are symlinks in sysfs: reading <device>/name fails for anything but a directory */
+                if (snprintf(name_path, sizeof(name_path), "%s/name", entry->d_name) >= (int)sizeof(name_path) ||
+                    read_attribute(dir_fd, name_path, buffer, sizeof(buffer)) <= 0)
+                {
+                        continue;
+                }
+
+                /* Look for ina3221 or similar power monitoring chips */
+                if (!strstr(buffer, "ina3221"))
+                {
+                        continue;
+                }
+
+                /* Build the full path to the device for the rail paths */
+                if (snprintf(path, sizeof(path), "%s/%s", handle->i2c_path, entry->d_name) >= (int)sizeof(path)) {
+                        continue; /* Skip if path would be truncated */
+                }
+
+                /* Find driver power folders */
+                find_driver_power_folders(handle, dir_fd, entry->d_name, path);
+        }
+
+        closedir(dir);
+        return PM_SUCCESS;
+}
+
+/* Find the driver power folders of an I2C device, "hwmon" or "iio:device" */
+static pm_error_t find_driver_power_folders(pm_handle_t handle, int parent_fd, const char *name,
+                                            const char *path)
+{
+        DIR *dir;
+        struct dirent *entry;
+        char driver_path[1024];  /* Increased from 512 */
+        char hwmon_path[1024];  /* Increased from 512 */
+
+        int dir_fd = open_directory(parent_fd, name);
+        if (dir_fd < 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        dir = fdopendir(dir_fd);
+        if (!dir)
+        {
+                close(dir_fd);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        while ((entry = readdir(dir)) != NULL)
+        {
+                if (entry->d_name[0] == '.' || !may_be_directory(entry) ||
+                    (!strstr(entry->d_name, "hwmon") && !strstr(entry->d_name, "iio:device")))
+                {
+                        continue;
+                }
+
+                if (snprintf(driver_path, sizeof(driver_path), "%s/%s", path, entry->d_name) >= (int)sizeof(driver_path)) {
+                        continue; /* Skip if path would be too long */
+                }
+
+                /* Check for hwmon directories (JP5 compatible) */
+                if (strstr(entry->d_name, "hwmon"))
+                {
+                        int hwmon_fd = open_directory(dir_fd, entry->d_name);
+                        if (hwmon_fd < 0)
+                        {
+                                continue;
+                        }
+
+                        DIR *hwmon_dir = fdopendir(hwmon_fd);
+                        if (!hwmon_dir)
+                        {
+                                close(hwmon_fd);
+                                continue;
+                        }
+
+                        /* The channels live in the first hwmonN entry */
+                        struct dirent *hwmon_entry;
+                        while ((hwmon_entry = readdir(hwmon_dir)) != NULL)
+                        {
+                                if (hwmon_entry->d_name[0] == '.')
+                                {
+                                        continue;
+                                }
+
+                                if (snprintf(hwmon_path, sizeof(hwmon_path), "%s/%s",
+                                             driver_path, hwmon_entry->d_name) >= (int)sizeof(hwmon_path)) {
+                                        continue; /* Skip if path would be truncated */
+                                }
+                                list_all_i2c_ports(handle, hwmon_fd, hwmon_entry->d_name, hwmon_path);
+                                break;
+                        }
+                        closedir(hwmon_dir);
+                }
+                /* Check for iio:device directories (JP4 or below) */
+                else if (strstr(entry->d_name, "iio:device"))
+                {
+                        list_all_i2c_ports(handle, dir_fd, entry->d_name, driver_path);
+                }
+        }
+
+        closedir(dir);
+        return PM_SUCCESS;
+}
+
+/* Find all system power monitors */
+static pm_error_t find_all_system_monitor(pm_handle_t handle)
+{
+        DIR *dir;
+        struct dirent *entry;
+        char local_path[1024];  /* Increased from 512 */
+        char voltage_path[1024];  /* New buffer for voltage path */
+        char current_path[1024];  /* New buffer for current path */
+        char type_supply[256];
+        char model_name[256];
+
+        /* Check if the power supply path exists */
+        int dir_fd = open_directory(AT_FDCWD, handle->power_supply_path);
+        dir = dir_fd >= 0 ? fdopendir(dir_fd) : NULL;
+        if (!dir)
+        {
+                if (dir_fd >= 0)
+                        close(dir_fd);
+                fprintf(stderr, "Error: Power supply folder %s doesn't exist\n",
+                        handle->power_supply_path);
+                return PM_SUCCESS; /* Return success but log error */
+        }
+
+        /* Find all system power monitors */
+        while ((entry = readdir(dir)) != NULL)
+        {
+                if (entry->d_name[0] == '.' || !may_be_directory(entry))
+                {
+                        continue;
+                }
+
+                /* Only process directories */
+                int supply_fd = open_directory(dir_fd, entry->d_name);
+                if (supply_fd < 0)
+                {
+                        continue;
+                }
+
+                /* Get a clean name for the sensor */
+                char *name = entry->d_name;
+                if (strstr(name, "ucsi-source-psy-"))
+                {
+                        name = name + strlen("ucsi-source-psy-");
+                }
+
+                /* Read the type and the model name */
+                if (read_attribute(supply_fd, "type", type_supply, sizeof(type_supply)) <= 0)
+                {
+                        snprintf(type_supply, sizeof(type_supply), "SYSTEM");
+                }
+                if (read_attribute(supply_fd, "model_name", model_name, sizeof(model_name)) <= 0)
+                {
+                        snprintf(model_name, sizeof(model_name), "<EMPTY>");
+                }
+
+                /* Check for required files for a power sensor */
+                bool has_voltage = faccessat(supply_fd, "voltage_now", F_OK, 0) == 0;
+                bool has_current = faccessat(supply_fd, "current_now", F_OK, 0) == 0;
+                close(supply_fd);
+
+                /* Only add sensor if it has both voltage and current capabilities */
+                if (has_voltage && has_current)
+                {
+                        /* Build full paths to the attributes */
+                        if (snprintf(local_path, sizeof(local_path), "%s/%s",
+                                     handle->power_supply_path, entry->d_name) >= (int)sizeof(local_path)) {
+                                continue; /* Skip if path would be truncated */
+                        }
+                        if (snprintf(voltage_path, sizeof(voltage_path), "%s/voltage_now",
+                                     local_path) >= (int)sizeof(voltage_path) ||
+                            snprintf(current_path, sizeof(current_path), "%s/current_now",
+                                     local_path) >= (int)sizeof(current_path)) {
+                                continue; /* Skip if path would be truncated */
+                        }
+
+                        /* Store sensor information */
+                        if (add_rail(handle, name, PM_SENSOR_TYPE_SYSTEM, -1,
+                                     voltage_path, current_path) != PM_SUCCESS)
+                        {
+                                fprintf(stderr, "Memory allocation error for sensor %s\n", name);
+                                closedir(dir);
+                                return PM_ERROR_MEMORY;
+                        }
+
+                        printf("Found power sensor: %s (type=%s, model=%s)\n",
+                               name, type_supply, model_name);
+                }
+                else
+                {
+                        printf("Skipped %s: missing voltage or current capability\n", name);
+                }
+        }
+
+        closedir(dir);
+        return PM_SUCCESS;
+}
+
+/* Open a directory relative to parent_fd (or AT_FDCWD), failing for anything else */
+static int open_directory(int parent_fd, const char *name)
+{
+        return openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+/* Whether a directory entry can be a directory, without a stat() when d_type is known */
+static bool may_be_directory(const struct dirent *entry)
+{
+        return entry->d_type == DT_DIR || entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN;
+}
+
+/* Read the first line of an attribute relative to dir_fd; returns its length or -1 */
+static ssize_t read_attribute(int dir_fd, const char *name, char *buffer, size_t size)
+{
+        int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+                return -1;
+        }
+
+        ssize_t length = read(fd, buffer, size - 1);
+        close(fd);
+        if (length < 0)
+        {
+                return -1;
+        }
+
+        buffer[length] = '\0';
+        buffer[strcspn(buffer, "\n")] = '\0';
+        return (ssize_t)strlen(buffer);
+}
+
+/* List all I2C ports for power monitoring */
+static pm_error_t list_all_i2c_ports(pm_handle_t handle, int parent_fd, const char *name, const char *path)
+{
+        DIR *dir;
+        struct dirent *entry;
+        char buffer[256];
+
+        int dir_fd = open_directory(parent_fd, name);
+        if (dir_fd < 0)
+        {
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        dir = fdopendir(dir_fd);
+        if (!dir)
+        {
+                close(dir_fd);
+                return PM_ERROR_FILE_ACCESS;
+        }
+
+        /* Both formats are tried on hwmon folders, the iio one elsewhere */
+        bool hwmon = strstr(path, "hwmon") != NULL;
+
+        /* Scan for label files that indicate power sensors */
+        while ((entry = readdir(dir)) != NULL)
+        {
+                if (entry->d_name[0] == '.')
+                {
+                        continue;
+                }
+
+                /* Check for label files indicating power rails */
+                if (!strstr(entry->d_name, "_label") && !strstr(entry->d_name, "rail_name_"))
+                {
+                        continue;
+                }
+
+                /* Read the sensor name from the label file */
+                if (read_attribute(dir_fd, entry->d_name, buffer, sizeof(buffer)) <= 0)
+                {
+                        continue;
+                }
+
+                /* Skip "NC" power (Orin family) */
+                if (strstr(buffer, "NC"))
+                {
+                        continue;
+                }
+
+                /* Get port number from the file name */
+                int port_number = -1;
+                if (sscanf(entry->d_name, strstr(entry->d_name, "_label") ? "in%d_label" : "rail_name_%d",
+                           &port_number) != 1)
+                {
+                        #ifdef SHOW_ALL_DEBUG
+                        printf("Failed to parse port number from %s\n", entry->d_name);
+                        #endif
+                        continue;
+                }
+
+                /* Skip "sum of shunt voltages" (port 7) */
+                if (port_number == 7)
+                {
+                        continue;
+                }
+
+                /* Check for voltage and current files */
+                char volt_name[64], curr_name[64];
+                bool has_volt = false, has_curr = false;
+
+                /* Try both hwmon and iio formats */
+                if (hwmon)
+                {
+                        /* Try hwmon format first */
+                        snprintf(volt_name, sizeof(volt_name), "in%d_input", port_number);
+                        snprintf(curr_name, sizeof(curr_name), "curr%d_input", port_number);
+                        has_volt = faccessat(dir_fd, volt_name, F_OK, 0) == 0;
+                        has_curr = faccessat(dir_fd, curr_name, F_OK, 0) == 0;
+
+                        /* If files don't exist, try alternative hwmon format */
+                        if (!has_volt || !has_curr)
+                        {
+                                snprintf(volt_name, sizeof(volt_name), "voltage%d_input", port_number);
+                                snprintf(curr_name, sizeof(curr_name), "current%d_input", port_number);
+                                has_volt = faccessat(dir_fd, volt_name, F_OK, 0) == 0;
+                                has_curr = faccessat(dir_fd, curr_name, F_OK, 0) == 0;
+                        }
+                }
+                else
+                {
+                        /* Try iio format */
+                        snprintf(volt_name, sizeof(volt_name), "in_voltage%d_input", port_number);
+                        snprintf(curr_name, sizeof(curr_name), "in_current%d_input", port_number);
+                        has_volt = faccessat(dir_fd, volt_name, F_OK, 0) == 0;
+                        has_curr = faccessat(dir_fd, curr_name, F_OK, 0) == 0;
+                }
+
+                #ifdef SHOW_ALL_DEBUG
+                printf("Checking sensor %s (port %d) in %s:\n", buffer, port_number, path);
+                printf("  Voltage file: %s (exists: %d)\n", volt_name, has_volt);
+                printf("  Current file: %s (exists: %d)\n", curr_name, has_curr);
+                #endif
+
+                /* Only add sensors with both voltage and current */
+                if (has_volt && has_curr)
+                {
+                        char volt_path[512], curr_path[512];
+                        snprintf(volt_path, sizeof(volt_path), "%s/%s", path, volt_name);
+                        snprintf(curr_path, sizeof(curr_path), "%s/%s", path, curr_name);
+
+                        /* Store sensor information */
+                        if (add_rail(handle, buffer, PM_SENSOR_TYPE_I2C, port_number,
+                                     volt_path, curr_path) != PM_SUCCESS)
+                        {
+                                closedir(dir);
+                                return PM_ERROR_MEMORY;
+                        }
+
+                        printf("Found I2C power sensor: %s (port %d)\n", buffer, port_number);
+                }
+                #ifdef SHOW_ALL_DEBUG
+                else
+                {
+                        printf("Skipped sensor %s: missing voltage or current capability\n", buffer);
+                }
+                #endif
+        }
+
+        closedir(dir);
+        return PM_SUCCESS;
+}
+
+/* Append a rail descriptor, resolving its role and thresholds once */
+static pm_error_t add_rail(pm_handle_t handle, const char *name, pm_sensor_type_t type,
+                           int channel, const char *volt_path, const char *curr_path)
+{
+        pm_rail_t *rails = realloc(handle->rails, (handle->sensor_count + 1) * sizeof(pm_rail_t));
+        if (!rails)
+        {
+                return PM_ERROR_MEMORY;
+        }
+        handle->rails = rails;
+
+        pm_rail_t *rail = &rails[handle->sensor_count];
+        memset(rail, 0, sizeof(*rail));
+        snprintf(rail->name, sizeof(rail->name), "%s", name);
+        snprintf(rail->volt_path, sizeof(rail->volt_path), "%s", volt_path);
+        snprintf(rail->curr_path, sizeof(rail->curr_path), "%s", curr_path);
+        rail->type = type;
+        rail->channel = channel;
+
+        /* INA3221 and power_supply readings are both reported in mV and mA */
+        rail->volt_scale = 1.0 / 1000.0;
+        rail->curr_scale = 1.0 / 1000.0;
+
+        /* Set thresholds based on the rail name */
+        if (strstr(rail->name, "VDD_IN"))
+        {
+                rail->flags |= RAIL_FLAG_TOTAL_INPUT;
+                rail->warning_threshold = 15.0;
+                rail->critical_threshold = 20.0;
+        }
+        else if (strstr(rail->name, "VDD_CPU_GPU_CV"))
+        {
+                rail->warning_threshold = 10.0;
+                rail->critical_threshold = 15.0;
+        }
+        else if (strstr(rail->name, "VDD_SOC"))
+        {
+                rail->warning_threshold = 5.0;
+                rail->critical_threshold = 8.0;
+        }
+        else
+        {
+                rail->warning_threshold = 3.0;
+                rail->critical_threshold = 5.0;
+        }
+
+        /* The first total input rail found is used for the total power */
+        if ((rail->flags & RAIL_FLAG_TOTAL_INPUT) && handle->total_rail < 0)
+        {
+                handle->total_rail = handle->sensor_count;
+        }
+
+        handle->sensor_count++;
+        return PM_SUCCESS;
+}
+
+/* Open the attribute files of all sensors for the sampling thread */
+static pm_error_t open_sensor_files(pm_handle_t handle)
+{
+        /* Files stay open between pm_sample_now() calls */
+        if (handle->sensor_fds || handle->sensor_count == 0)
+        {
+                return PM_SUCCESS;
+        }
+
+        handle->sensor_fds = (pm_sensor_fds_t *)calloc(handle->sensor_count, sizeof(pm_sensor_fds_t));
+        if (!handle->sensor_fds)
+        {
+                return PM_ERROR_MEMORY;
         }
 
-        *count = handle->sensor_count;
-
-        /* Copy the sensor names with explicit size limit */
         for (int i = 0; i < handle->sensor_count; i++)
         {
-                if (!names[i]) {
-                        fprintf(stderr, "[jetpwmon] Warning: names[%d] is NULL\n", i);
+                handle->sensor_fds[i].volt_fd = -1;
+                handle->sensor_fds[i].curr_fd = -1;
+        }
+
+        /* Sources downgrade this if their I/O backend is unavailable */
+        handle->active_io_backend = handle->io_backend;
+
+        for (int i = 0; i < handle->backend_count; i++)
+        {
+                pm_backend_t *backend = &handle->backends[i];
+                pm_error_t error = backend->ops->open ? backend->ops->open(handle, backend) : PM_SUCCESS;
+                if (error != PM_SUCCESS)
+                {
+                        close_sensor_files(handle);
+                        return error;
+                }
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Close all cached attribute files */
+static void close_sensor_files(pm_handle_t handle)
+{
+        if (!handle->sensor_fds)
+        {
+                return;
+        }
+
+        for (int i = 0; i < handle->backend_count; i++)
+        {
+                pm_backend_t *backend = &handle->backends[i];
+                if (backend->ops->close)
+                        backend->ops->close(handle, backend);
+        }
+
+        free(handle->sensor_fds);
+        handle->sensor_fds = NULL;
+}
+
+/* Open the files of a sysfs source with the requested I/O backend */
+static pm_error_t sysfs_open(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_sysfs_state_t *state = (pm_sysfs_state_t *)calloc(1, sizeof(pm_sysfs_state_t));
+        if (!state)
+        {
+                return PM_ERROR_MEMORY;
+        }
+        state->io_backend = handle->io_backend;
+        backend->state = state;
+
+        /* The stdio backend opens the files on every read */
+        if (state->io_backend != PM_IO_BACKEND_STDIO)
+        {
+                for (int i = backend->first_rail; i < backend->first_rail + backend->rail_count; i++)
+                {
+                        /* Sensors that cannot be opened yet are retried by the sampler */
+                        reopen_sensor_files(&handle->rails[i], &handle->sensor_fds[i]);
+                }
+        }
+
+        if (state->io_backend == PM_IO_BACKEND_IO_URING)
+        {
+#ifdef HAVE_IO_URING
+                state->uring = uring_create(2 * backend->rail_count, backend->rail_count);
+                if (!state->uring)
+#endif
+                {
+                        /* Fall back to the plain path when io_uring is unavailable */
+                        #ifdef SHOW_ALL_DEBUG
+                        printf("io_uring unavailable for %s, falling back to pread()\n", backend->ops->name);
+                        #endif
+                        state->io_backend = PM_IO_BACKEND_PREAD;
+                        handle->active_io_backend = PM_IO_BACKEND_PREAD;
+                }
+        }
+
+        return PM_SUCCESS;
+}
+
+/* Read the rails of a sysfs source as one batch */
+static void sysfs_read(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_sysfs_state_t *state = (pm_sysfs_state_t *)backend->state;
+
+        switch (state->io_backend)
+        {
+        case PM_IO_BACKEND_STDIO:
+                read_rails_stdio(handle, backend);
+                break;
+#ifdef HAVE_IO_URING
+        case PM_IO_BACKEND_IO_URING:
+                if (read_rails_uring(handle, backend, state->uring))
+                        break;
+                /* The ring failed: use the plain path from now on */
+                state->io_backend = PM_IO_BACKEND_PREAD;
+                handle->active_io_backend = PM_IO_BACKEND_PREAD;
+                read_rails_pread(handle, backend);
+                break;
+#endif
+        default:
+                read_rails_pread(handle, backend);
+                break;
+        }
+}
+
+/* Close the files of a sysfs source */
+static void sysfs_close(pm_handle_t handle, pm_backend_t *backend)
+{
+        pm_sysfs_state_t *state = (pm_sysfs_state_t *)backend->state;
+
+#ifdef HAVE_IO_URING
+        if (state && state->uring)
+        {
+                uring_destroy(state->uring);
+        }
+#endif
+        free(state);
+        backend->state = NULL;
+
+        for (int i = backend->first_rail; i < backend->first_rail + backend->rail_count; i++)
+        {
+                if (handle->sensor_fds[i].volt_fd >= 0)
+                        close(handle->sensor_fds[i].volt_fd);
+                if (handle->sensor_fds[i].curr_fd >= 0)
+                        close(handle->sensor_fds[i].curr_fd);
+        }
+}
+
+/* (Re)open the attribute files of a sensor, honouring the reopen backoff */
+static bool reopen_sensor_files(const pm_rail_t *rail, pm_sensor_fds_t *fds)
+{
+        struct timespec now;
+
+        if (fds->reopen_backoff_ms > 0)
+        {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if (now.tv_sec < fds->next_reopen.tv_sec ||
+                    (now.tv_sec == fds->next_reopen.tv_sec && now.tv_nsec < fds->next_reopen.tv_nsec))
+                {
+                        return false;
+                }
+        }
+
+        if (fds->volt_fd < 0)
+                fds->volt_fd = open(rail->volt_path, O_RDONLY | O_CLOEXEC);
+        if (fds->curr_fd < 0)
+                fds->curr_fd = open(rail->curr_path, O_RDONLY | O_CLOEXEC);
+
+        if (fds->volt_fd >= 0 && fds->curr_fd >= 0)
+        {
+                fds->reopen_backoff_ms = 0;
+                return true;
+        }
+
+        /* Double the backoff on every failed attempt */
+        if (fds->reopen_backoff_ms == 0)
+                fds->reopen_backoff_ms = REOPEN_BACKOFF_MIN_MS;
+        else if (fds->reopen_backoff_ms < REOPEN_BACKOFF_MAX_MS)
+                fds->reopen_backoff_ms *= 2;
+        if (fds->reopen_backoff_ms > REOPEN_BACKOFF_MAX_MS)
+                fds->reopen_backoff_ms = REOPEN_BACKOFF_MAX_MS;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        fds->next_reopen.tv_sec = now.tv_sec + fds->reopen_backoff_ms / 1000;
+        fds->next_reopen.tv_nsec = now.tv_nsec + (long)(fds->reopen_backoff_ms % 1000) * 1000000L;
+        if (fds->next_reopen.tv_nsec >= 1000000000L)
+        {
+                fds->next_reopen.tv_sec++;
+                fds->next_reopen.tv_nsec -= 1000000000L;
+        }
+
+        #ifdef SHOW_ALL_DEBUG
+        printf("  Cannot open %s, retrying in %d ms\n",
+               fds->volt_fd < 0 ? rail->volt_path : rail->curr_path, fds->reopen_backoff_ms);
+        #endif
+        return false;
+}
+
+/* Parse a numeric sysfs attribute; returns 0 or -errno */
+static int parse_sysfs_value(char *buffer, ssize_t length, double *value)
+{
+        if (length <= 0)
+        {
+                return -ENODATA;
+        }
+
+        buffer[length] = '\0';
+        *value = strtod(buffer, NULL);
+        return 0;
+}
+
+/* Read a numeric sysfs attribute from an open fd; returns 0 or -errno */
+static int read_sysfs_value(int fd, double *value)
+{
+        char buffer[64];
+        ssize_t n;
+
+        /* sysfs regenerates the attribute on every read from offset 0 */
+        do
+        {
+                n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+        {
+                return -errno;
+        }
+
+        return parse_sysfs_value(buffer, n, value);
+}
+
+/* Mark a failed read, dropping the fds when the device went away */
+static void handle_read_error(const pm_rail_t *rail, pm_sensor_fds_t *fds, int err, bool voltage)
+{
+        fds->read_ok = false;
+
+        #ifdef SHOW_ALL_DEBUG
+        printf("  Failed to read %s: %s\n", voltage ? rail->volt_path : rail->curr_path, strerror(-err));
+        #else
+        (void)rail;
+        (void)voltage;
+        #endif
+
+        /* The device went away: drop the fds and reopen later */
+        if ((err == -ENODEV || err == -ESTALE) && fds->volt_fd >= 0)
+        {
+                close(fds->volt_fd);
+                close(fds->curr_fd);
+                fds->volt_fd = -1;
+                fds->curr_fd = -1;
+                fds->reopen_backoff_ms = 0;
+        }
+}
+
+/* Read the rails of a source with fopen()/fgets() on every tick */
+static void read_rails_stdio(pm_handle_t handle, const pm_backend_t *backend)
+{
+        char line[256];
+        FILE *fp;
+
+        for (int i = backend->first_rail; i < backend->first_rail + backend->rail_count; i++)
+        {
+                const pm_rail_t *rail = &handle->rails[i];
+                pm_sensor_fds_t *fds = &handle->sensor_fds[i];
+
+                fds->read_ok = false;
+
+                fp = fopen(rail->volt_path, "r");
+                if (!fp)
                         continue;
+                if (fgets(line, sizeof(line), fp))
+                {
+                        fds->volt_raw = strtod(line, NULL);
+                        fds->read_ok = true;
                 }
-                /* Assume maximum safe buffer size of 64 (same as in pm_sensor_data_t) */
-                strncpy(names[i], handle->sensor_names[i], 63);
-                names[i][63] = '\0';  /* Ensure null termination */
+                fclose(fp);
+
+                if (!fds->read_ok)
+                        continue;
+
+                fds->read_ok = false;
+                fp = fopen(rail->curr_path, "r");
+                if (!fp)
+                        continue;
+                if (fgets(line, sizeof(line), fp))
+                {
+                        fds->curr_raw = strtod(line, NULL);
+                        fds->read_ok = true;
+                }
+                fclose(fp);
+        }
+}
+
+/* Read the rails of a source from the cached fds with pread() */
+static void read_rails_pread(pm_handle_t handle, const pm_backend_t *backend)
+{
+        for (int i = backend->first_rail; i < backend->first_rail + backend->rail_count; i++)
+        {
+                const pm_rail_t *rail = &handle->rails[i];
+                pm_sensor_fds_t *fds = &handle->sensor_fds[i];
+                int err;
+
+                fds->read_ok = false;
+
+                /* Reopen attributes that disappeared once the backoff expired */
+                if ((fds->volt_fd < 0 || fds->curr_fd < 0) && !reopen_sensor_files(rail, fds))
+                        continue;
+
+                err = read_sysfs_value(fds->volt_fd, &fds->volt_raw);
+                if (err)
+                {
+                        handle_read_error(rail, fds, err, true);
+                        continue;
+                }
+
+                err = read_sysfs_value(fds->curr_fd, &fds->curr_raw);
+                if (err)
+                {
+                        handle_read_error(rail, fds, err, false);
+                        continue;
+                }
+
+                fds->read_ok = true;
+        }
+}
+
+#ifdef HAVE_IO_URING
+/* Create an io_uring instance with read buffers for every rail */
+static pm_uring_t *uring_create(unsigned entries, int rail_count)
+{
+        struct io_uring_params params;
+        pm_uring_t *uring = (pm_uring_t *)calloc(1, sizeof(pm_uring_t));
+        if (!uring)
+        {
+                return NULL;
+        }
+
+        memset(&params, 0, sizeof(params));
+        uring->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (uring->ring_fd < 0)
+        {
+                free(uring);
+                return NULL;
+        }
+
+        /* IORING_OP_READ needs Linux 5.6, check it before relying on it */
+        size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, probe_size);
+        bool supported = probe &&
+                         syscall(__NR_io_uring_register, uring->ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                         probe->last_op >= IORING_OP_READ &&
+                         (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+        free(probe);
+
+        /* Map the submission and completion rings */
+        uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+                if (uring->cq_ring_size > uring->sq_ring_size)
+                        uring->sq_ring_size = uring->cq_ring_size;
+                uring->cq_ring_size = uring->sq_ring_size;
+        }
+        uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        uring->sq_ring = MAP_FAILED;
+        uring->cq_ring = MAP_FAILED;
+        uring->sqes = MAP_FAILED;
+        if (supported)
+        {
+                uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQ_RING);
+                if (params.features & IORING_FEAT_SINGLE_MMAP)
+                        uring->cq_ring = uring->sq_ring;
+                else
+                        uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_CQ_RING);
+                uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQES);
+        }
+        uring->buffers = calloc(2 * (size_t)rail_count, URING_BUFFER_SIZE);
+        uring->errors = (int *)calloc(2 * (size_t)rail_count, sizeof(int));
+
+        if (!supported || uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED ||
+            uring->sqes == MAP_FAILED || !uring->buffers || !uring->errors)
+        {
+                uring_destroy(uring);
+                return NULL;
+        }
+
+        char *sq = (char *)uring->sq_ring;
+        char *cq = (char *)uring->cq_ring;
+        uring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+        uring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+        uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+        uring->cq_head = (unsigned *)(cq + params.cq_off.head);
+        uring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+        uring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+        uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+        return uring;
+}
+
+/* Unmap and close an io_uring instance */
+static void uring_destroy(pm_uring_t *uring)
+{
+        if (uring->sqes != MAP_FAILED && uring->sqes)
+                munmap(uring->sqes, uring->sqes_size);
+        if (uring->cq_ring != MAP_FAILED && uring->cq_ring && uring->cq_ring != uring->sq_ring)
+                munmap(uring->cq_ring, uring->cq_ring_size);
+        if (uring->sq_ring != MAP_FAILED && uring->sq_ring)
+                munmap(uring->sq_ring, uring->sq_ring_size);
+        close(uring->ring_fd);
+        free(uring->buffers);
+        free(uring->errors);
+        free(uring);
+}
+
+/* Submit every voltage/current read of a source as one batch */
+static bool read_rails_uring(pm_handle_t handle, const pm_backend_t *backend, pm_uring_t *uring)
+{
+        pm_sensor_fds_t *sensor_fds = &handle->sensor_fds[backend->first_rail];
+        const pm_rail_t *rails = &handle->rails[backend->first_rail];
+        unsigned tail = *uring->sq_tail;
+        unsigned mask = *uring->sq_mask;
+        unsigned submitted = 0;
+
+        for (int i = 0; i < backend->rail_count; i++)
+        {
+                const pm_rail_t *rail = &rails[i];
+                pm_sensor_fds_t *fds = &sensor_fds[i];
+
+                fds->read_ok = false;
+
+                /* Reopen attributes that disappeared once the backoff expired */
+                if ((fds->volt_fd < 0 || fds->curr_fd < 0) && !reopen_sensor_files(rail, fds))
+                        continue;
+
+                for (int k = 0; k < 2; k++)
+                {
+                        unsigned index = tail & mask;
+                        struct io_uring_sqe *sqe = &uring->sqes[index];
+
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        sqe->fd = k == 0 ? fds->volt_fd : fds->curr_fd;
+                        sqe->addr = (uint64_t)(uintptr_t)uring->buffers[2 * i + k];
+                        sqe->len = URING_BUFFER_SIZE - 1;
+                        sqe->off = 0;
+                        sqe->user_data = (uint64_t)(2 * i + k);
+                        uring->sq_array[index] = index;
+                        tail++;
+                }
+                submitted += 2;
+
+                /* Both reads must succeed for the rail to be online */
+                fds->read_ok = true;
+                uring->errors[2 * i] = 0;
+                uring->errors[2 * i + 1] = 0;
+        }
+
+        if (submitted == 0)
+        {
+                return true;
+        }
+
+        /* Publish the new tail before entering the kernel */
+        __atomic_store_n(uring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        unsigned to_submit = submitted;
+        unsigned completed = 0;
+        while (completed < submitted)
+        {
+                int ret = (int)syscall(__NR_io_uring_enter, uring->ring_fd, to_submit,
+                                       submitted - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+                if (ret < 0)
+                {
+                        if (errno == EINTR)
+                                continue;
+                        return false;
+                }
+                to_submit -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+
+                /* Reap whatever completed so far */
+                unsigned head = *uring->cq_head;
+                unsigned cq_tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+                while (head != cq_tail)
+                {
+                        struct io_uring_cqe *cqe = &uring->cqes[head & *uring->cq_mask];
+                        int slot = (int)cqe->user_data;
+                        pm_sensor_fds_t *fds = &sensor_fds[slot / 2];
+
+                        uring->errors[slot] = cqe->res < 0 ? cqe->res :
+                                              parse_sysfs_value(uring->buffers[slot], cqe->res,
+                                                                slot % 2 == 0 ? &fds->volt_raw : &fds->curr_raw);
+                        head++;
+                        completed++;
+                }
+                __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        /* Handle failures only once nothing is in flight on the fds */
+        for (int i = 0; i < backend->rail_count; i++)
+        {
+                pm_sensor_fds_t *fds = &sensor_fds[i];
+
+                if (!fds->read_ok)
+                        continue;
+                if (uring->errors[2 * i])
+                        handle_read_error(&rails[i], fds, uring->errors[2 * i], true);
+                else if (uring->errors[2 * i + 1])
+                        handle_read_error(&rails[i], fds, uring->errors[2 * i + 1], false);
+        }
+
+        return true;
+}
+#endif
+
+/* Read sensor data */
+static pm_error_t read_sensor_data(pm_handle_t handle)
+{
+        if (!handle || !handle->latest_data.sensors || !handle->sensor_fds) {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        /* Read the raw values of every rail without holding the mutex, one batch per source */
+        for (int i = 0; i < handle->backend_count; i++)
+        {
+                handle->backends[i].ops->read(handle, &handle->backends[i]);
+        }
+
+        /* Lock the mutex to update the data */
+        pthread_mutex_lock(&handle->data_mutex);
+
+        /* Update the time */
+        clock_gettime(CLOCK_REALTIME, &handle->last_sample_time);
+        handle->last_sample_ns = handle->clock_backend ?
+                                         handle->clock_backend->ops->clock(handle->clock_backend) :
+                                         monotonic_now_ns();
+
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                const pm_rail_t *rail = &handle->rails[i];
+                const pm_sensor_fds_t *fds = &handle->sensor_fds[i];
+                bool read_success = fds->read_ok;
+                double voltage = 0.0, current = 0.0;
+
+                /* Convert raw readings to V and A */
+                if (read_success)
+                {
+                        voltage = fds->volt_raw * rail->volt_scale;
+                        current = fds->curr_raw * rail->curr_scale;
+                }
+
+                #ifdef SHOW_ALL_DEBUG
+                if (read_success)
+                {
+                        printf("  Converted values: %.3f V, %.3f A\n", voltage, current);
+                        printf("  Calculated power: %.3f W\n", voltage * current);
+                }
+                #endif
+
+                /* Update sensor data */
+                pm_sensor_data_t *sensor = &handle->latest_data.sensors[i];
+                sensor->voltage = voltage;
+                sensor->current = current;
+                sensor->power = voltage * current;
+
+                /* Only touch the status string when the online state changes */
+                if (sensor->online != read_success || sensor->status[0] == '\0')
+                {
+                        snprintf(sensor->status, sizeof(sensor->status), "%s",
+                                 read_success ? "Normal" : "Error");
+                }
+                sensor->online = read_success;
         }
 
+        /* Calculate total power */
+        calculate_total_power(handle);
+
+        /* Update statistics */
+        update_statistics(handle);
+
+        /* Hand the complete tick to readers */
+        publish_snapshot(handle);
+        record_history(handle);
+        record_tick(handle);
+        update_windows(handle);
+        update_rollups(handle);
+        update_regions(handle);
+
+        pthread_mutex_unlock(&handle->data_mutex);
         return PM_SUCCESS;
 }
 
-/* Get the error message for an error code */
-const char *pm_error_string(pm_error_t error)
+/* Allocate a snapshot ring for sensor_count rails */
+static pm_snapshot_block_t *snapshot_create(int sensor_count)
 {
-        int index = -error;
-        if (index < 0 || index >= (int)(sizeof(error_messages) / sizeof(error_messages[0])))
+        uint64_t header_size = (sizeof(pm_snapshot_block_t) + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+        uint64_t sensors_offset = sizeof(pm_snapshot_slot_t);
+        uint64_t stats_offset = sensors_offset + (uint64_t)sensor_count * sizeof(pm_sensor_data_t);
+        uint64_t slot_size = stats_offset + (uint64_t)sensor_count * sizeof(pm_sensor_stats_t);
+
+        /* Slots start on their own cache lines */
+        slot_size = (slot_size + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
+
+        pm_snapshot_block_t *block = (pm_snapshot_block_t *)calloc(1, header_size + SNAPSHOT_SLOTS * slot_size);
+        if (!block)
         {
-                return "Unknown error";
+                return NULL;
         }
 
-        return error_messages[index];
+        block->slot_count = SNAPSHOT_SLOTS;
+        block->sensor_count = (uint32_t)sensor_count;
+        block->slots_offset = header_size;
+        block->slot_size = slot_size;
+        block->sensors_offset = sensors_offset;
+        block->stats_offset = stats_offset;
+        return block;
 }
 
-/* Sampling thread function */
-static void *sampling_thread_func(void *arg)
+/* Slot holding the given generation */
+static pm_snapshot_slot_t *snapshot_slot(const pm_snapshot_block_t *block, uint64_t generation)
 {
-        pm_handle_t handle = (pm_handle_t)arg;
+        return (pm_snapshot_slot_t *)((char *)block + block->slots_offset +
+                                      (generation % block->slot_count) * block->slot_size);
+}
 
-        /* Calculate the sleep time in microseconds */
-        int sleep_us = 1000000 / handle->sampling_frequency_hz;
-        struct timespec sleep_time;
+/* Bytes of a snapshot block, slots included */
+static size_t snapshot_size(const pm_snapshot_block_t *block)
+{
+        return (size_t)(block->slots_offset + block->slot_count * block->slot_size);
+}
+
+/* Publish the current data and statistics; the caller holds data_mutex */
+static void publish_snapshot(pm_handle_t handle)
+{
+        pm_snapshot_block_t *block = handle->snapshot;
+        uint64_t generation = block->generation + 1;
+        pm_snapshot_slot_t *slot = snapshot_slot(block, generation);
+        char *base = (char *)slot;
+
+        /* Readers of the previous generation use another slot, so nobody waits here */
+        uint64_t seq = slot->seq;
+        __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        slot->generation = generation;
+        slot->timestamp_ns = handle->last_sample_ns;
+        slot->total = handle->latest_data.total;
+        slot->total_stats = handle->statistics.total;
+        memcpy(base + block->sensors_offset, handle->latest_data.sensors,
+               block->sensor_count * sizeof(pm_sensor_data_t));
+        memcpy(base + block->stats_offset, handle->statistics.sensors,
+               block->sensor_count * sizeof(pm_sensor_stats_t));
+
+        __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&block->generation, generation, __ATOMIC_RELEASE);
+}
 
-        while (!handle->thread_stop_flag)
+/* Copy the latest consistent snapshot; NULL outputs are skipped. Returns its generation */
+static uint64_t read_snapshot(const pm_snapshot_block_t *block, pm_sensor_data_t *total,
+                              pm_sensor_data_t *sensors, pm_sensor_stats_t *total_stats,
+                              pm_sensor_stats_t *sensor_stats)
+{
+        for (;;)
         {
-                /* Read the sensor data */
-                read_sensor_data(handle);
+                uint64_t generation = __atomic_load_n(&block->generation, __ATOMIC_ACQUIRE);
+                const pm_snapshot_slot_t *slot = snapshot_slot(block, generation);
+                const char *base = (const char *)slot;
+
+                uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+                if (seq & 1)
+                {
+                        /* The sampler lapped the ring and is rewriting this slot */
+                        continue;
+                }
+
+                if (total)
+                        *total = slot->total;
+                if (total_stats)
+                        *total_stats = slot->total_stats;
+                if (sensors)
+                        memcpy(sensors, base + block->sensors_offset, block->sensor_count * sizeof(pm_sensor_data_t));
+                if (sensor_stats)
+                        memcpy(sensor_stats, base + block->stats_offset, block->sensor_count * sizeof(pm_sensor_stats_t));
+
+                /* The copy is only valid if the slot was not rewritten meanwhile */
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq && slot->generation == generation)
+                {
+                        return generation;
+                }
+        }
+}
 
-                /* Update the statistics */
-                update_statistics(handle);
+/* Allocate an empty sample history of capacity slots */
+static pm_history_t *history_create(int capacity, pm_overflow_policy_t policy)
+{
+        uint64_t header_size = (sizeof(pm_history_t) + CACHE_LINE_SIZE - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1);
 
-                /* Sleep for the specified amount of time */
-                sleep_time.tv_sec = sleep_us / 1000000;
-                sleep_time.tv_nsec = (sleep_us % 1000000) * 1000;
-                nanosleep(&sleep_time, NULL);
+        pm_history_t *history = (pm_history_t *)calloc(1, header_size + (uint64_t)capacity * sizeof(pm_history_slot_t));
+        if (!history)
+        {
+                return NULL;
         }
 
-        return NULL;
+        history->capacity = (uint64_t)capacity;
+        history->slots_offset = header_size;
+        history->policy = policy;
+        return history;
+}
+
+/* Bytes of a history block, slots included */
+static size_t history_size(const pm_history_t *history)
+{
+        return (size_t)(history->slots_offset + history->capacity * sizeof(pm_history_slot_t));
+}
+
+/* Slot holding the given sequence number */
+static pm_history_slot_t *history_slot(const pm_history_t *history, uint64_t seq)
+{
+        return (pm_history_slot_t *)((char *)history + history->slots_offset) + seq % history->capacity;
+}
+
+/* Store one sample in its history slot */
+static void write_history_sample(pm_history_t *history, uint64_t seq, uint64_t timestamp_ns,
+                                 int rail, const pm_sensor_data_t *data)
+{
+        pm_history_slot_t *slot = history_slot(history, seq);
+
+        /* Invalidate the slot first so readers of the previous lap notice the rewrite */
+        __atomic_store_n(&slot->stamp, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        slot->sample.seq = seq;
+        slot->sample.timestamp_ns = timestamp_ns;
+        slot->sample.rail = (int16_t)rail;
+        slot->sample.online = data->online;
+        slot->sample.voltage = (float)data->voltage;
+        slot->sample.current = (float)data->current;
+        slot->sample.power = (float)data->power;
+
+        __atomic_store_n(&slot->stamp, seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Append the current tick to the sample history; the caller holds data_mutex */
+static void record_history(pm_handle_t handle)
+{
+        pm_history_t *history = handle->history;
+        if (!history)
+        {
+                return;
+        }
+
+        uint64_t head = history->head;
+        uint64_t needed = (uint64_t)handle->sensor_count + 1;
+
+        if (history->policy == PM_OVERFLOW_DROP_NEWEST)
+        {
+                uint64_t consumed = __atomic_load_n(&history->consumed, __ATOMIC_ACQUIRE);
+                if (head + needed - consumed > history->capacity)
+                {
+                        __atomic_fetch_add(&history->dropped, needed, __ATOMIC_RELAXED);
+                        return;
+                }
+        }
+
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                write_history_sample(history, head + (uint64_t)i, handle->last_sample_ns, i,
+                                     &handle->latest_data.sensors[i]);
+        }
+        write_history_sample(history, head + needed - 1, handle->last_sample_ns, -1,
+                             &handle->latest_data.total);
+
+        /* Readers only look at samples below the published head */
+        __atomic_store_n(&history->head, head + needed, __ATOMIC_RELEASE);
+}
+
+/* Raw sysfs reading as a recorded count */
+static int32_t record_count(double raw)
+{
+        if (raw >= (double)INT32_MAX)
+        {
+                return INT32_MAX;
+        }
+        if (raw <= (double)INT32_MIN)
+        {
+                return INT32_MIN;
+        }
+        return (int32_t)lround(raw);
+}
+
+/* Queue the current tick for the recording writer; the caller holds data_mutex */
+static void record_tick(pm_handle_t handle)
+{
+        pm_recorder_t *recorder = handle->recorder;
+        if (!recorder)
+        {
+                return;
+        }
+
+        /* Never wait for the writer: a full ring drops the tick */
+        uint64_t head = recorder->head;
+        if (head - __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE) >= recorder->capacity)
+        {
+                __atomic_fetch_add(&handle->record_stats.dropped, 1, __ATOMIC_RELAXED);
+                return;
+        }
+
+        pm_record_entry_t *entry = (pm_record_entry_t *)(recorder->ring + (head % recorder->capacity) * recorder->entry_size);
+        entry->timestamp_ns = handle->last_sample_ns;
+        entry->offline = 0;
+
+        for (int i = 0; i < recorder->rail_count; i++)
+        {
+                const pm_sensor_fds_t *fds = &handle->sensor_fds[i];
+
+                if (!handle->latest_data.sensors[i].online)
+                {
+                        entry->offline |= 1u << i;
+                        entry->values[i].voltage = 0;
+                        entry->values[i].current = 0;
+                        continue;
+                }
+                entry->values[i].voltage = record_count(fds->volt_raw);
+                entry->values[i].current = record_count(fds->curr_raw);
+        }
+
+        __atomic_store_n(&recorder->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Write size bytes at offset, returning 0 or the errno of the failure */
+static int write_all(int fd, const void *data, size_t size, off_t offset)
+{
+        const char *bytes = (const char *)data;
+
+        while (size > 0)
+        {
+                ssize_t written = pwrite(fd, bytes, size, offset);
+                if (written < 0)
+                {
+                        if (errno == EINTR)
+                        {
+                                continue;
+                        }
+                        return errno;
+                }
+                if (written == 0)
+                {
+                        return ENOSPC;
+                }
+                bytes += written;
+                size -= (size_t)written;
+                offset += written;
+        }
+        return 0;
+}
+
+/* Append the block being filled to the file with its footer, then start a new one */
+static void record_write_block(pm_recorder_t *recorder)
+{
+        pm_record_footer_t *footer = &recorder->footer;
+        size_t used = (size_t)footer->tick_count * recorder->tick_size;
+        char *end = recorder->block + RECORD_BLOCK_SIZE - recorder->footer_size;
+
+        footer->magic = PM_RECORD_BLOCK_MAGIC;
+        footer->dropped = __atomic_load_n(&recorder->stats->dropped, __ATOMIC_RELAXED);
+        memset(recorder->block + used, 0, (size_t)(end - recorder->block) - used);
+        memcpy(end, footer, sizeof(pm_record_footer_t));
+        memcpy(end + sizeof(pm_record_footer_t), recorder->ranges,
+               (size_t)(recorder->rail_count + 1) * sizeof(pm_record_range_t));
+
+        /* After a failed write the file ends at the last complete block */
+        if (recorder->error == 0)
+        {
+                recorder->error = write_all(recorder->fd, recorder->block, RECORD_BLOCK_SIZE,
+                                            (off_t)(recorder->header_size + footer->block * RECORD_BLOCK_SIZE));
+                if (recorder->error == 0)
+                {
+                        __atomic_fetch_add(&recorder->stats->blocks, 1, __ATOMIC_RELAXED);
+                        __atomic_fetch_add(&recorder->stats->ticks, footer->tick_count, __ATOMIC_RELAXED);
+                }
+        }
+
+        footer->block++;
+        footer->tick_count = 0;
+}
+
+/* Widen a block power range by one reading */
+static void record_range(pm_record_range_t *range, double power)
+{
+        if (power < range->min_power)
+        {
+                range->min_power = (float)power;
+        }
+        if (power > range->max_power)
+        {
+                range->max_power = (float)power;
+        }
 }
 
-/* Discover sensors on the system */
-static pm_error_t discover_sensors(pm_handle_t handle)
+/* Pack one queued tick into the block being filled */
+static void record_append(pm_recorder_t *recorder, const pm_record_entry_t *entry)
 {
-        pm_error_t error;
+        pm_record_footer_t *footer = &recorder->footer;
 
-        /* Initialize sensor lists */
-        handle->sensor_count = 0;
-        handle->sensor_names = NULL;
-        handle->sensor_paths = NULL;
-        handle->sensor_types = NULL;
-
-        /* Find I2C power monitors */
-        error = find_all_i2c_power_monitor(handle);
-        if (error != PM_SUCCESS)
+        /* A block ends when it is full or its offsets would overflow */
+        if (footer->tick_count > 0 &&
+            (footer->tick_count == recorder->ticks_per_block ||
+             entry->timestamp_ns - footer->first_ns > (uint64_t)UINT32_MAX * 1000))
         {
-                return error;
+                record_write_block(recorder);
         }
 
-        /* Find system power monitors */
-        error = find_all_system_monitor(handle);
-        if (error != PM_SUCCESS)
+        if (footer->tick_count == 0)
         {
-                return error;
+                footer->first_ns = entry->timestamp_ns;
+                for (int i = 0; i <= recorder->rail_count; i++)
+                {
+                        recorder->ranges[i].min_power = INFINITY;
+                        recorder->ranges[i].max_power = -INFINITY;
+                }
         }
 
-        /* Check if any sensors were found */
-        if (handle->sensor_count == 0)
+        pm_record_tick_t tick;
+        tick.offset_us = (uint32_t)((entry->timestamp_ns - footer->first_ns) / 1000);
+        tick.offline = entry->offline;
+
+        char *slot = recorder->block + (size_t)footer->tick_count * recorder->tick_size;
+        memcpy(slot, &tick, sizeof(tick));
+        memcpy(slot + sizeof(tick), entry->values, (size_t)recorder->rail_count * sizeof(pm_record_value_t));
+
+        /* The total follows calculate_total_power(): the input rail, or the sum if every rail is online */
+        double total = 0.0;
+        bool total_online = recorder->total_rail < 0 || !(entry->offline & (1u << recorder->total_rail));
+        for (int i = 0; i < recorder->rail_count; i++)
         {
-                /* For testing purposes, add dummy sensors if none were found */
-                if (getenv(ENV_JTOP_TESTING))
+                if (entry->offline & (1u << i))
                 {
-                        /* Allocate memory for dummy sensors */
-                        handle->sensor_count = 2;
-                        handle->sensor_names = (char **)malloc(handle->sensor_count * sizeof(char *));
-                        handle->sensor_paths = (char **)malloc(handle->sensor_count * sizeof(char *));
-                        handle->sensor_types = (pm_sensor_type_t *)malloc(handle->sensor_count * sizeof(pm_sensor_type_t));
-
-                        if (!handle->sensor_names || !handle->sensor_paths || !handle->sensor_types)
+                        if (recorder->total_rail < 0)
                         {
-                                if (handle->sensor_names)
-                                        free(handle->sensor_names);
-                                if (handle->sensor_paths)
-                                        free(handle->sensor_paths);
-                                if (handle->sensor_types)
-                                        free(handle->sensor_types);
-                                handle->sensor_count = 0;
-                                return PM_ERROR_MEMORY;
+                                total_online = false;
                         }
-
-                        /* Set dummy sensor information */
-                        handle->sensor_names[0] = strdup_safe("CPU");
-                        handle->sensor_paths[0] = strdup_safe("/fake/cpu");
-                        handle->sensor_types[0] = PM_SENSOR_TYPE_SYSTEM;
-
-                        handle->sensor_names[1] = strdup_safe("GPU");
-                        handle->sensor_paths[1] = strdup_safe("/fake/gpu");
-                        handle->sensor_types[1] = PM_SENSOR_TYPE_SYSTEM;
+                        continue;
                 }
-                else
+
+                double power = entry->values[i].voltage * recorder->volt_scale[i] *
+                               entry->values[i].current * recorder->curr_scale[i];
+                record_range(&recorder->ranges[i], power);
+                if (recorder->total_rail < 0 || recorder->total_rail == i)
                 {
-                        return PM_ERROR_NO_SENSORS;
+                        total += power;
                 }
         }
+        if (total_online)
+        {
+                record_range(&recorder->ranges[recorder->rail_count], total);
+        }
 
-        return PM_SUCCESS;
+        footer->last_ns = entry->timestamp_ns;
+        footer->tick_count++;
 }
 
-/* Find all I2C power monitors */
-static pm_error_t find_all_i2c_power_monitor(pm_handle_t handle)
+/* Drain the queued ticks into blocks until pm_record_stop() */
+static void *record_thread_func(void *arg)
 {
-        DIR *dir;
-        struct dirent *entry;
-        char path[1024];  /* Increased from 512 */
-        char name_path[1024];  /* Increased from 512 */
-        char buffer[256];
-        FILE *fp;
+        pm_recorder_t *recorder = (pm_recorder_t *)arg;
 
-        /* Check if the I2C path exists */
-        dir = opendir(handle->i2c_path);
-        if (!dir)
+        for (;;)
         {
-                fprintf(stderr, "Error: I2C folder %s doesn't exist\n", handle->i2c_path);
-                return PM_SUCCESS; /* We return success but log error to maintain compatibility */
-        }
+                /* Read the flag first so the last drain sees every tick queued before the stop */
+                bool stop = __atomic_load_n(&recorder->stop_flag, __ATOMIC_ACQUIRE);
+                uint64_t head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
 
-        /* Scan all I2C devices for power sensors */
-        while ((entry = readdir(dir)) != NULL)
-        {
-                if (entry->d_name[0] == '.')
+                for (uint64_t tail = recorder->tail; tail != head; tail++)
                 {
-                        continue; /* Skip hidden files/directories */
+                        record_append(recorder, (const pm_record_entry_t *)(recorder->ring +
+                                      (tail % recorder->capacity) * recorder->entry_size));
                 }
+                __atomic_store_n(&recorder->tail, head, __ATOMIC_RELEASE);
 
-                /* Build full path to the device */
-                if (snprintf(path, sizeof(path), "%s/%s", handle->i2c_path, entry->d_name) >= (int)sizeof(path)) {
-                        continue; /* Skip if path would be truncated */
+                if (stop)
+                {
+                        break;
                 }
 
-                /* Check if it's a directory */
-                if (is_directory(path))
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += RECORD_FLUSH_MS * 1000000L;
+                if (deadline.tv_nsec >= (long)NSEC_PER_SEC)
                 {
-                        /* Check for a "name" file to identify the sensor type */
-                        if (snprintf(name_path, sizeof(name_path), "%s/name", path) >= (int)sizeof(name_path)) {
-                                continue; /* Skip if path would be truncated */
-                        }
-
-                        if (check_file_exists(name_path))
-                        {
-                                fp = fopen(name_path, "r");
-                                if (fp)
-                                {
-                                        if (fgets(buffer, sizeof(buffer), fp))
-                                        {
-                                                /* Remove trailing newline */
-                                                buffer[strcspn(buffer, "\n")] = 0;
-
-                                                /* Look for ina3221 or similar power monitoring chips */
-                                                if (strstr(buffer, "ina3221"))
-                                                {
-                                                        /* Find driver power folders */
-                                                        find_driver_power_folders(handle, path);
-                                                }
-                                        }
-                                        fclose(fp);
-                                }
-                        }
+                        deadline.tv_sec++;
+                        deadline.tv_nsec -= (long)NSEC_PER_SEC;
                 }
+                sem_timedwait(&recorder->wake, &deadline);
+        }
+
+        /* The last block is written partially filled */
+        if (recorder->footer.tick_count > 0)
+        {
+                record_write_block(recorder);
+        }
+        return NULL;
+}
+
+/* Release a recorder whose thread is not running */
+static void recorder_free(pm_recorder_t *recorder)
+{
+        if (recorder->fd >= 0)
+        {
+                close(recorder->fd);
+        }
+        free(recorder->volt_scale);
+        free(recorder->curr_scale);
+        free(recorder->ring);
+        free(recorder->block);
+        free(recorder->ranges);
+        free(recorder);
+}
+
+/* Ring size for window_ns at period_ns, with room for a late tick */
+static uint64_t window_ticks(uint64_t window_ns, uint64_t period_ns)
+{
+        uint64_t ticks = window_ns / period_ns + WINDOW_MIN_TICKS;
+        return ticks < WINDOW_MAX_TICKS ? ticks : WINDOW_MAX_TICKS;
+}
+
+/* Allocate an empty window */
+static pm_error_t window_init(pm_window_t *window, uint64_t window_ns, int columns, uint64_t period_ns)
+{
+        uint64_t capacity = window_ticks(window_ns, period_ns);
+
+        memset(window, 0, sizeof(*window));
+        window->window_ns = window_ns;
+        window->capacity = capacity;
+        window->timestamps = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+        window->values = (double *)malloc(capacity * columns * sizeof(double));
+        window->online = (bool *)malloc(capacity * columns * sizeof(bool));
+        window->min_queue = (uint64_t *)malloc(capacity * columns * sizeof(uint64_t));
+        window->max_queue = (uint64_t *)malloc(capacity * columns * sizeof(uint64_t));
+        window->columns = (pm_window_column_t *)calloc((size_t)columns, sizeof(pm_window_column_t));
+
+        if (!window->timestamps || !window->values || !window->online ||
+            !window->min_queue || !window->max_queue || !window->columns)
+        {
+                window_free(window);
+                return PM_ERROR_MEMORY;
         }
 
-        closedir(dir);
         return PM_SUCCESS;
 }
 
-/* Find driver power folders for I2C devices */
-static pm_error_t find_driver_power_folders(pm_handle_t handle, const char *path)
+/* Release the rings of a window */
+static void window_free(pm_window_t *window)
 {
-        DIR *dir;
-        struct dirent *entry;
-        char driver_path[1024];  /* Increased from 512 */
-        char hwmon_path[1024];  /* Increased from 512 */
+        free(window->timestamps);
+        free(window->values);
+        free(window->online);
+        free(window->min_queue);
+        free(window->max_queue);
+        free(window->columns);
+        memset(window, 0, sizeof(*window));
+}
 
-        dir = opendir(path);
-        if (!dir)
+/* Release a window set and everything it owns */
+static void window_set_free(void *arg)
+{
+        pm_window_set_t *set = (pm_window_set_t *)arg;
+        if (!set)
         {
-                return PM_ERROR_FILE_ACCESS;
+                return;
         }
 
-        while ((entry = readdir(dir)) != NULL)
+        if (set->windows)
         {
-                if (entry->d_name[0] == '.')
+                for (int i = 0; i < set->count; i++)
                 {
-                        continue;
+                        window_free(&set->windows[i]);
                 }
+        }
+        free(set->windows);
+        free(set->results);
+        free(set->spans);
+        free(set);
+}
 
-                /* Check if the combined path would fit in the buffer */
-                size_t path_len = strlen(path);
-                size_t name_len = strlen(entry->d_name);
-                if (path_len + 1 + name_len >= sizeof(driver_path)) {
-                        continue; /* Skip if path would be too long */
-                }
+/* Move a window to rings of the given capacity, keeping the ticks it holds */
+static bool window_grow(pm_window_t *window, int columns, uint64_t capacity)
+{
+        uint64_t *timestamps = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+        double *values = (double *)malloc(capacity * columns * sizeof(double));
+        bool *online = (bool *)malloc(capacity * columns * sizeof(bool));
+        uint64_t *min_queue = (uint64_t *)malloc(capacity * columns * sizeof(uint64_t));
+        uint64_t *max_queue = (uint64_t *)malloc(capacity * columns * sizeof(uint64_t));
+
+        if (!timestamps || !values || !online || !min_queue || !max_queue)
+        {
+                free(timestamps);
+                free(values);
+                free(online);
+                free(min_queue);
+                free(max_queue);
+                return false;
+        }
+
+        /* Positions are monotonic, so every entry keeps its position modulo the new size */
+        uint64_t old = window->capacity;
+        for (uint64_t t = window->tail; t < window->head; t++)
+        {
+                timestamps[t % capacity] = window->timestamps[t % old];
+                memcpy(&values[(t % capacity) * columns], &window->values[(t % old) * columns], columns * sizeof(double));
+                memcpy(&online[(t % capacity) * columns], &window->online[(t % old) * columns], columns * sizeof(bool));
+        }
+
+        for (int c = 0; c < columns; c++)
+        {
+                const pm_window_column_t *column = &window->columns[c];
+                for (uint64_t p = column->min_front; p < column->min_back; p++)
+                        min_queue[c * capacity + p % capacity] = window->min_queue[c * old + p % old];
+                for (uint64_t p = column->max_front; p < column->max_back; p++)
+                        max_queue[c * capacity + p % capacity] = window->max_queue[c * old + p % old];
+        }
+
+        free(window->timestamps);
+        free(window->values);
+        free(window->online);
+        free(window->min_queue);
+        free(window->max_queue);
+        window->timestamps = timestamps;
+        window->values = values;
+        window->online = online;
+        window->min_queue = min_queue;
+        window->max_queue = max_queue;
+        window->capacity = capacity;
+        return true;
+}
+
+/* Size the windows for the current period so the sampler does not grow them; the caller holds data_mutex */
+static pm_error_t fit_windows_to_period(pm_handle_t handle)
+{
+        int columns = handle->sensor_count + 1;
+        pm_window_set_t *set = handle->windows;
 
-                snprintf(driver_path, sizeof(driver_path), "%s/%s", path, entry->d_name);
+        for (int i = 0; set && i < set->count; i++)
+        {
+                pm_window_t *window = &set->windows[i];
+                uint64_t capacity = window_ticks(window->window_ns, handle->sampling_period_ns);
 
-                if (is_directory(driver_path))
+                if (capacity > window->capacity && !window_grow(window, columns, capacity))
                 {
-                        /* Check for hwmon directories (JP5 compatible) */
-                        if (strstr(entry->d_name, "hwmon"))
-                        {
-                                DIR *hwmon_dir = opendir(driver_path);
-                                if (hwmon_dir)
-                                {
-                                        struct dirent *hwmon_entry = readdir(hwmon_dir);
-                                        while (hwmon_entry)
-                                        {
-                                                if (hwmon_entry->d_name[0] != '.')
-                                                {
-                                                        if (snprintf(hwmon_path, sizeof(hwmon_path), "%s/%s",
-                                                                 driver_path, hwmon_entry->d_name) >= (int)sizeof(hwmon_path)) {
-                                                                hwmon_entry = readdir(hwmon_dir);
-                                                                continue; /* Skip if path would be truncated */
-                                                        }
-                                                        list_all_i2c_ports(handle, hwmon_path);
-                                                        break;
-                                                }
-                                                hwmon_entry = readdir(hwmon_dir);
-                                        }
-                                        closedir(hwmon_dir);
-                                }
-                        }
-                        /* Check for iio:device directories (JP4 or below) */
-                        else if (strstr(entry->d_name, "iio:device"))
-                        {
-                                list_all_i2c_ports(handle, driver_path);
-                        }
+                        return PM_ERROR_MEMORY;
                 }
         }
 
-        closedir(dir);
         return PM_SUCCESS;
 }
 
-/* Find all system power monitors */
-static pm_error_t find_all_system_monitor(pm_handle_t handle)
+/* Value of a column at a tick still held by the window */
+static double window_value(const pm_window_t *window, int columns, uint64_t tick, int column)
 {
-        DIR *dir;
-        struct dirent *entry;
-        char local_path[1024];  /* Increased from 512 */
-        char path_type[1024];  /* Increased from 512 */
-        char path_name[1024];  /* Increased from 512 */
-        char voltage_path[1024];  /* New buffer for voltage path */
-        char current_path[1024];  /* New buffer for current path */
-        char buffer[256];
-        FILE *fp;
+        return window->values[(tick % window->capacity) * columns + column];
+}
 
-        /* Check if the power supply path exists */
-        dir = opendir(handle->power_supply_path);
-        if (!dir)
-        {
-                fprintf(stderr, "Error: Power supply folder %s doesn't exist\n",
-                        handle->power_supply_path);
-                return PM_SUCCESS; /* Return success but log error */
-        }
+/* Drop the oldest tick from a window */
+static void window_pop(pm_window_t *window, int columns)
+{
+        uint64_t tick = window->tail++;
+        uint64_t slot = tick % window->capacity;
 
-        /* Find all system power monitors */
-        while ((entry = readdir(dir)) != NULL)
+        for (int c = 0; c < columns; c++)
         {
-                if (entry->d_name[0] == '.')
+                pm_window_column_t *column = &window->columns[c];
+                if (!window->online[slot * columns + c])
                 {
                         continue;
                 }
 
-                /* Build full path to the power supply */
-                snprintf(local_path, sizeof(local_path), "%s/%s",
-                         handle->power_supply_path, entry->d_name);
+                double offset = window->values[slot * columns + c] - column->shift;
+                column->sum -= offset;
+                column->squares -= offset * offset;
+                column->count--;
+
+                /* The oldest tick can only be at the front of either deque */
+                const uint64_t *min_queue = &window->min_queue[c * window->capacity];
+                const uint64_t *max_queue = &window->max_queue[c * window->capacity];
+                if (column->min_front < column->min_back && min_queue[column->min_front % window->capacity] == tick)
+                        column->min_front++;
+                if (column->max_front < column->max_back && max_queue[column->max_front % window->capacity] == tick)
+                        column->max_front++;
+        }
+}
 
-                /* Only process directories */
-                if (!is_directory(local_path))
-                {
-                        continue;
-                }
+/* Append the current tick to a window and evict what fell out of it */
+static void window_push(pm_handle_t handle, pm_window_t *window, uint64_t now)
+{
+        int columns = handle->sensor_count + 1;
 
-                /* Get a clean name for the sensor */
-                char *name = entry->d_name;
-                if (strstr(name, "ucsi-source-psy-"))
-                {
-                        name = name + strlen("ucsi-source-psy-");
-                }
+        /* Ticks leave once they are window_ns old */
+        while (window->tail < window->head &&
+               now - window->timestamps[window->tail % window->capacity] >= window->window_ns)
+        {
+                window_pop(window, columns);
+        }
 
-                /* Read the type */
-                if (snprintf(path_type, sizeof(path_type), "%s/type", local_path) >= (int)sizeof(path_type)) {
-                        continue; /* Skip if path would be truncated */
-                }
-                char *type_supply = "SYSTEM";
+        /* Ticks arriving faster than the period double the rings; past the limit the oldest leaves early */
+        if (window->head - window->tail == window->capacity &&
+            (window->capacity >= WINDOW_MAX_TICKS || !window_grow(window, columns, 2 * window->capacity)))
+        {
+                window_pop(window, columns);
+        }
 
-                if (check_file_exists(path_type))
-                {
-                        fp = fopen(path_type, "r");
-                        if (fp)
-                        {
-                                if (fgets(buffer, sizeof(buffer), fp))
-                                {
-                                        buffer[strcspn(buffer, "\n")] = 0;
-                                        type_supply = strdup_safe(buffer);
-                                }
-                                fclose(fp);
-                        }
-                }
+        uint64_t capacity = window->capacity;
 
-                /* Read the model name */
-                if (snprintf(path_name, sizeof(path_name), "%s/model_name", local_path) >= (int)sizeof(path_name)) {
-                        continue; /* Skip if path would be truncated */
-                }
-                char *model_name = "<EMPTY>";
+        uint64_t tick = window->head;
+        uint64_t slot = tick % capacity;
+        window->timestamps[slot] = now;
 
-                if (check_file_exists(path_name))
+        for (int c = 0; c < columns; c++)
+        {
+                const pm_sensor_data_t *data = c < handle->sensor_count ?
+                        &handle->latest_data.sensors[c] : &handle->latest_data.total;
+                pm_window_column_t *column = &window->columns[c];
+                double power = data->power;
+
+                window->values[slot * columns + c] = power;
+                window->online[slot * columns + c] = data->online;
+                if (!data->online)
                 {
-                        fp = fopen(path_name, "r");
-                        if (fp)
-                        {
-                                if (fgets(buffer, sizeof(buffer), fp))
-                                {
-                                        buffer[strcspn(buffer, "\n")] = 0;
-                                        model_name = strdup_safe(buffer);
-                                }
-                                fclose(fp);
-                        }
+                        continue;
                 }
 
-                /* Check for required files for a power sensor */
-                snprintf(voltage_path, sizeof(voltage_path), "%s/voltage_now", local_path);
-                snprintf(current_path, sizeof(current_path), "%s/current_now", local_path);
-                bool has_voltage = check_file_exists(voltage_path);
-                bool has_current = check_file_exists(current_path);
-
-                /* Only add sensor if it has both voltage and current capabilities */
-                if (has_voltage && has_current)
+                /* Sums are taken around a value near the data so the variance does not cancel out */
+                if (column->count == 0)
                 {
-                        /* Allocate memory for sensor information */
-                        int idx = handle->sensor_count;
+                        column->shift = power;
+                        column->sum = 0.0;
+                        column->squares = 0.0;
+                }
 
-                        /* Resize the sensor arrays */
-                        handle->sensor_count++;
-                        handle->sensor_names = realloc(handle->sensor_names,
-                                                       handle->sensor_count * sizeof(char *));
-                        handle->sensor_paths = realloc(handle->sensor_paths,
-                                                       handle->sensor_count * sizeof(char *));
-                        handle->sensor_types = realloc(handle->sensor_types,
-                                                       handle->sensor_count * sizeof(pm_sensor_type_t));
+                double offset = power - column->shift;
+                column->sum += offset;
+                column->squares += offset * offset;
+                column->count++;
+
+                /* Entries the new value dominates can never be the extreme again */
+                uint64_t *min_queue = &window->min_queue[c * capacity];
+                while (column->min_back > column->min_front &&
+                       window_value(window, columns, min_queue[(column->min_back - 1) % capacity], c) >= power)
+                        column->min_back--;
+                min_queue[column->min_back++ % capacity] = tick;
+
+                uint64_t *max_queue = &window->max_queue[c * capacity];
+                while (column->max_back > column->max_front &&
+                       window_value(window, columns, max_queue[(column->max_back - 1) % capacity], c) <= power)
+                        column->max_back--;
+                max_queue[column->max_back++ % capacity] = tick;
+        }
+        window->head = tick + 1;
 
-                        if (!handle->sensor_names || !handle->sensor_paths || !handle->sensor_types)
+        /* Running sums drift with every subtraction; rebuild them around the current mean once per lap */
+        if (window->head % capacity == 0)
+        {
+                for (int c = 0; c < columns; c++)
+                {
+                        pm_window_column_t *column = &window->columns[c];
+                        if (column->count == 0)
                         {
-                                fprintf(stderr, "Memory allocation error for sensor %s\n", name);
-                                return PM_ERROR_MEMORY;
+                                continue;
                         }
 
-                        /* Store sensor information */
-                        handle->sensor_names[idx] = strdup_safe(name);
-                        handle->sensor_paths[idx] = strdup_safe(local_path);
-                        handle->sensor_types[idx] = PM_SENSOR_TYPE_SYSTEM;
+                        column->shift += column->sum / (double)column->count;
+                        column->sum = 0.0;
+                        column->squares = 0.0;
+                        for (uint64_t t = window->tail; t < window->head; t++)
+                        {
+                                if (!window->online[(t % capacity) * columns + c])
+                                        continue;
 
-                        printf("Found power sensor: %s (type=%s, model=%s)\n",
-                               name, type_supply, model_name);
-                }
-                else
-                {
-                        printf("Skipped %s: missing voltage or current capability\n", name);
+                                double offset = window_value(window, columns, t, c) - column->shift;
+                                column->sum += offset;
+                                column->squares += offset * offset;
+                        }
                 }
-
-                /* Free resources if dynamically allocated */
-                if (strcmp(type_supply, "SYSTEM") != 0)
-                        free(type_supply);
-                if (strcmp(model_name, "<EMPTY>") != 0)
-                        free(model_name);
         }
-
-        closedir(dir);
-        return PM_SUCCESS;
 }
 
-/* Helper function to check if a path is a directory */
-static bool is_directory(const char *path)
+/* Push the current tick into every window and publish the results; the caller holds data_mutex */
+static void update_windows(pm_handle_t handle)
 {
-        struct stat statbuf;
-        if (stat(path, &statbuf) != 0)
+        pm_window_set_t *set = handle->windows;
+        if (!set)
         {
-                return false;
+                return;
         }
-        return S_ISDIR(statbuf.st_mode);
-}
 
-/* List all I2C ports for power monitoring */
-static pm_error_t list_all_i2c_ports(pm_handle_t handle, const char *path)
-{
-        DIR *dir;
-        struct dirent *entry;
-        char port_path[512];
-        char buffer[256];
-        FILE *fp;
+        int columns = handle->sensor_count + 1;
+        uint64_t now = handle->last_sample_ns;
 
-        dir = opendir(path);
-        if (!dir)
+        for (int w = 0; w < set->count; w++)
         {
-                return PM_ERROR_FILE_ACCESS;
+                window_push(handle, &set->windows[w], now);
         }
 
-        /* Scan for label files that indicate power sensors */
-        while ((entry = readdir(dir)) != NULL)
+        uint64_t seq = handle->window_seq;
+        __atomic_store_n(&handle->window_seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        for (int w = 0; w < set->count; w++)
         {
-                if (entry->d_name[0] == '.')
-                {
-                        continue;
-                }
+                const pm_window_t *window = &set->windows[w];
+                pm_stats_t *results = &set->results[w * columns];
 
-                /* Check for label files indicating power rails */
-                if (strstr(entry->d_name, "_label") || strstr(entry->d_name, "rail_name_"))
+                set->spans[w] = now - window->timestamps[window->tail % window->capacity];
+                for (int c = 0; c < columns; c++)
                 {
-                        snprintf(port_path, sizeof(port_path), "%s/%s", path, entry->d_name);
+                        const pm_window_column_t *column = &window->columns[c];
+                        pm_stats_t *result = &results[c];
 
-                        /* Read the sensor name from the label file */
-                        fp = fopen(port_path, "r");
-                        if (fp)
+                        if (column->count == 0)
                         {
-                                if (fgets(buffer, sizeof(buffer), fp))
-                                {
-                                        buffer[strcspn(buffer, "\n")] = 0;
-
-                                        /* Skip "NC" power (Orin family) */
-                                        if (strstr(buffer, "NC"))
-                                        {
-                                                fclose(fp);
-                                                continue;
-                                        }
-
-                                        /* Get port number from the file name */
-                                        int port_number = -1;
-                                        if (strstr(entry->d_name, "_label"))
-                                        {
-                                                if (sscanf(entry->d_name, "in%d_label", &port_number) != 1)
-                                                {
-                                                    #ifdef SHOW_ALL_DEBUG
-                                                    printf("Failed to parse port number from %s\n", entry->d_name);
-                                                    #endif
-                                                    fclose(fp);
-                                                    continue;
-                                                }
-                                        }
-                                        else
-                                        {
-                                                if (sscanf(entry->d_name, "rail_name_%d", &port_number) != 1)
-                                                {
-                                                    #ifdef SHOW_ALL_DEBUG
-                                                    printf("Failed to parse port number from %s\n", entry->d_name);
-                                                    #endif
-                                                    fclose(fp);
-                                                    continue;
-                                                }
-                                        }
-
-                                        /* Skip "sum of shunt voltages" (port 7) */
-                                        if (port_number == 7)
-                                        {
-                                                fclose(fp);
-                                                continue;
-                                        }
-
-                                        /* Check for voltage and current files */
-                                        char volt_path[512], curr_path[512];
-                                        bool has_volt = false, has_curr = false;
-
-                                        /* Try both hwmon and iio formats */
-                                        if (strstr(path, "hwmon"))
-                                        {
-                                                /* Try hwmon format first */
-                                                snprintf(volt_path, sizeof(volt_path), "%s/in%d_input", 
-                                                        path, port_number);
-                                                snprintf(curr_path, sizeof(curr_path), "%s/curr%d_input", 
-                                                        path, port_number);
-
-                                                #ifdef SHOW_ALL_DEBUG
-                                                printf("  Trying hwmon format:\n");
-                                                printf("    Voltage path: %s\n", volt_path);
-                                                printf("    Current path: %s\n", curr_path);
-                                                #endif
-
-                                                has_volt = check_file_exists(volt_path);
-                                                has_curr = check_file_exists(curr_path);
-
-                                                /* If files don't exist, try alternative hwmon format */
-                                                if (!has_volt || !has_curr)
-                                                {
-                                                        snprintf(volt_path, sizeof(volt_path), "%s/voltage%d_input", 
-                                                                path, port_number);
-                                                        snprintf(curr_path, sizeof(curr_path), "%s/current%d_input", 
-                                                                path, port_number);
-
-                                                        #ifdef SHOW_ALL_DEBUG
-                                                        printf("  Trying alternative hwmon format:\n");
-                                                        printf("    Voltage path: %s\n", volt_path);
-                                                        printf("    Current path: %s\n", curr_path);
-                                                        #endif
-
-                                                        has_volt = check_file_exists(volt_path);
-                                                        has_curr = check_file_exists(curr_path);
-                                                }
-                                        }
-                                        else
-                                        {
-                                                /* Try iio format */
-                                                snprintf(volt_path, sizeof(volt_path), "%s/in_voltage%d_input", 
-                                                        path, port_number);
-                                                snprintf(curr_path, sizeof(curr_path), "%s/in_current%d_input", 
-                                                        path, port_number);
-
-                                                #ifdef SHOW_ALL_DEBUG
-                                                printf("  Trying iio format:\n");
-                                                printf("    Voltage path: %s\n", volt_path);
-                                                printf("    Current path: %s\n", curr_path);
-                                                #endif
-
-                                                has_volt = check_file_exists(volt_path);
-                                                has_curr = check_file_exists(curr_path);
-                                        }
-
-                                        #ifdef SHOW_ALL_DEBUG
-                                        printf("Checking sensor %s (port %d):\n", buffer, port_number);
-                                        printf("  Voltage path: %s (exists: %d)\n", volt_path, has_volt);
-                                        printf("  Current path: %s (exists: %d)\n", curr_path, has_curr);
-                                        #endif
-
-                                        /* Only add sensors with both voltage and current */
-                                        if (has_volt && has_curr)
-                                        {
-                                                /* Allocate memory for sensor info */
-                                                int idx = handle->sensor_count;
-
-                                                /* Resize the sensor arrays */
-                                                handle->sensor_count++;
-                                                handle->sensor_names = realloc(handle->sensor_names,
-                                                                               handle->sensor_count * sizeof(char *));
-                                                handle->sensor_paths = realloc(handle->sensor_paths,
-                                                                               handle->sensor_count * sizeof(char *));
-                                                handle->sensor_types = realloc(handle->sensor_types,
-                                                                               handle->sensor_count * sizeof(pm_sensor_type_t));
-
-                                                if (!handle->sensor_names || !handle->sensor_paths || !handle->sensor_types)
-                                                {
-                                                        fclose(fp);
-                                                        return PM_ERROR_MEMORY;
-                                                }
-
-                                                /* Store sensor information */
-                                                handle->sensor_names[idx] = strdup_safe(buffer);
-                                                handle->sensor_paths[idx] = strdup_safe(path);
-                                                handle->sensor_types[idx] = PM_SENSOR_TYPE_I2C;
-
-                                                printf("Found I2C power sensor: %s (port %d)\n", buffer, port_number);
-                                        }
-                                        #ifdef SHOW_ALL_DEBUG
-                                        else
-                                        {
-                                                printf("Skipped sensor %s: missing voltage or current capability\n", buffer);
-                                        }
-                                        #endif
-                                }
-                                fclose(fp);
+                                memset(result, 0, sizeof(*result));
+                                continue;
                         }
+
+                        result->min = window_value(window, columns,
+                                                   window->min_queue[c * window->capacity + column->min_front % window->capacity], c);
+                        result->max = window_value(window, columns,
+                                                   window->max_queue[c * window->capacity + column->max_front % window->capacity], c);
+                        double count = (double)column->count;
+                        double m2 = column->squares - column->sum * column->sum / count;
+
+                        result->count = column->count;
+                        result->avg = column->shift + column->sum / count;
+                        result->total = column->shift * count + column->sum;
+                        result->compensation = 0.0;
+                        result->m2 = m2 > 0.0 ? m2 : 0.0;
+                        finish_stats(result);
                 }
         }
 
-        closedir(dir);
-        return PM_SUCCESS;
+        __atomic_store_n(&handle->window_seq, seq + 2, __ATOMIC_RELEASE);
 }
 
-/* Read sensor data */
-static pm_error_t read_sensor_data(pm_handle_t handle)
+/* Slot holding a rollup bucket */
+static pm_rollup_slot_t *rollup_slot(const pm_rollup_ring_t *ring, uint64_t bucket)
 {
-        if (!handle || !handle->latest_data.sensors) {
-                return PM_ERROR_NOT_INITIALIZED;
+        return (pm_rollup_slot_t *)(ring->slots + (bucket % ring->capacity) * ring->slot_size);
+}
+
+/* Release a rollup set and everything it owns */
+static void rollup_set_free(void *arg)
+{
+        pm_rollup_set_t *set = (pm_rollup_set_t *)arg;
+        if (!set)
+        {
+                return;
         }
 
-        /* Lock the mutex to update the data */
-        pthread_mutex_lock(&handle->data_mutex);
+        if (set->rings)
+        {
+                for (int i = 0; i < set->count; i++)
+                {
+                        free(set->rings[i].slots);
+                }
+        }
+        free(set->rings);
+        free(set);
+}
 
-        /* Update the time */
-        clock_gettime(CLOCK_REALTIME, &handle->last_sample_time);
+/* Add the current tick to the open bucket of every tier; the caller holds data_mutex */
+static void update_rollups(pm_handle_t handle)
+{
+        pm_rollup_set_t *set = handle->rollups;
+        int columns = handle->sensor_count + 1;
+        uint64_t now = handle->last_sample_ns;
 
-        /* Read data from each sensor */
-        for (int i = 0; i < handle->sensor_count; i++)
+        for (int t = 0; set && t < set->count; t++)
         {
-                char volt_path[512], curr_path[512];
-                FILE *fp;
-                double voltage = 0.0, current = 0.0;
-                bool read_success = true;
-                int port_number = -1;
+                pm_rollup_ring_t *ring = &set->rings[t];
+                uint64_t start = now - now % ring->resolution_ns;
+                uint64_t bucket = ring->next;
+                bool open_new = bucket == 0 || rollup_slot(ring, bucket - 1)->points[0].start_ns != start;
+                pm_rollup_slot_t *slot = rollup_slot(ring, open_new ? bucket : bucket - 1);
 
-                /* Get port number from sensor name */
-                if (handle->sensor_types[i] == PM_SENSOR_TYPE_I2C)
+                uint64_t seq = slot->seq;
+                __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+
+                if (open_new)
                 {
-                        char *name = handle->sensor_names[i];
-                        if (!name) {
-                                read_success = false;
-                                continue;
+                        slot->bucket = bucket;
+                        memset(slot->points, 0, columns * sizeof(pm_rollup_point_t));
+                        for (int c = 0; c < columns; c++)
+                        {
+                                slot->points[c].start_ns = start;
                         }
-                        if (strstr(name, "VDD_IN")) port_number = 1;
-                        else if (strstr(name, "VDD_CPU_GPU_CV")) port_number = 2;
-                        else if (strstr(name, "VDD_SOC")) port_number = 3;
                 }
 
-                /* Temporarily unlock mutex while reading files */
-                pthread_mutex_unlock(&handle->data_mutex);
-
-                /* Construct paths based on sensor type */
-                if (handle->sensor_types[i] == PM_SENSOR_TYPE_I2C)
+                for (int c = 0; c < columns; c++)
                 {
-                        /* Try both hwmon and iio formats */
-                        if (strstr(handle->sensor_paths[i], "hwmon"))
-                        {
-                                /* Try hwmon format first */
-                                snprintf(volt_path, sizeof(volt_path), "%s/in%d_input", 
-                                        handle->sensor_paths[i], port_number);
-                                snprintf(curr_path, sizeof(curr_path), "%s/curr%d_input", 
-                                        handle->sensor_paths[i], port_number);
-
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Trying hwmon format:\n");
-                                printf("    Voltage path: %s\n", volt_path);
-                                printf("    Current path: %s\n", curr_path);
-                                #endif
-
-                                /* If files don't exist, try alternative hwmon format */
-                                if (!check_file_exists(volt_path) || !check_file_exists(curr_path))
-                                {
-                                        snprintf(volt_path, sizeof(volt_path), "%s/voltage%d_input", 
-                                                handle->sensor_paths[i], port_number);
-                                        snprintf(curr_path, sizeof(curr_path), "%s/current%d_input", 
-                                                handle->sensor_paths[i], port_number);
-
-                                        #ifdef SHOW_ALL_DEBUG
-                                        printf("  Trying alternative hwmon format:\n");
-                                        printf("    Voltage path: %s\n", volt_path);
-                                        printf("    Current path: %s\n", curr_path);
-                                        #endif
-                                }
-                        }
-                        else
+                        const pm_sensor_data_t *data = c < handle->sensor_count ?
+                                &handle->latest_data.sensors[c] : &handle->latest_data.total;
+                        pm_rollup_point_t *point = &slot->points[c];
+
+                        point->energy += handle->tick_energy[c];
+                        if (!data->online)
                         {
-                                /* Try iio format */
-                                snprintf(volt_path, sizeof(volt_path), "%s/in_voltage%d_input", 
-                                        handle->sensor_paths[i], port_number);
-                                snprintf(curr_path, sizeof(curr_path), "%s/in_current%d_input", 
-                                        handle->sensor_paths[i], port_number);
-
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Trying iio format:\n");
-                                printf("    Voltage path: %s\n", volt_path);
-                                printf("    Current path: %s\n", curr_path);
-                                #endif
+                                continue;
                         }
+
+                        if (point->count == 0 || data->power < point->min)
+                                point->min = data->power;
+                        if (point->count == 0 || data->power > point->max)
+                                point->max = data->power;
+                        point->count++;
+                        point->avg += (data->power - point->avg) / (double)point->count;
                 }
-                else /* PM_SENSOR_TYPE_SYSTEM */
+
+                __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+                if (open_new)
                 {
-                        snprintf(volt_path, sizeof(volt_path), "%s/voltage_now", 
-                                handle->sensor_paths[i]);
-                        snprintf(curr_path, sizeof(curr_path), "%s/current_now", 
-                                handle->sensor_paths[i]);
+                        __atomic_store_n(&ring->next, bucket + 1, __ATOMIC_RELEASE);
                 }
+        }
+}
+
+/* Thread numbers for matching region ends with their begins; 0 means not assigned yet */
+static uint32_t region_thread_count;
+static __thread uint32_t region_thread;
+
+/* Queue a region marker with the current time; lock-free and safe from any thread */
+static pm_error_t region_mark(pm_handle_t handle, int id, uint32_t flag)
+{
+        if (!handle || !handle->initialized)
+        {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        if (id < 0 || id >= __atomic_load_n(&handle->region_count, __ATOMIC_ACQUIRE))
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        uint64_t timestamp_ns = monotonic_now_ns();
+        if (region_thread == 0)
+        {
+                region_thread = __atomic_add_fetch(&region_thread_count, 1, __ATOMIC_RELAXED);
+        }
 
-                /* Read voltage */
-                fp = fopen(volt_path, "r");
-                if (fp)
+        /* Claim the next position unless the sampler has not drained it yet */
+        uint64_t pos = __atomic_load_n(&handle->region_enqueue, __ATOMIC_RELAXED);
+        pm_region_marker_t *cell;
+        for (;;)
+        {
+                cell = &handle->region_queue[pos & (REGION_QUEUE_SIZE - 1)];
+                int64_t diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+                if (diff == 0)
                 {
-                        char line[256];
-                        if (fgets(line, sizeof(line), fp))
-                        {
-                                voltage = strtod(line, NULL);
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Raw voltage: %lf\n", voltage);
-                                #endif
-                        }
-                        else
+                        if (__atomic_compare_exchange_n(&handle->region_enqueue, &pos, pos + 1, true,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
                         {
-                                read_success = false;
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Failed to read voltage from %s\n", volt_path);
-                                #endif
+                                break;
                         }
-                        fclose(fp);
-                }
-                else
-                {
-                        read_success = false;
-                        #ifdef SHOW_ALL_DEBUG
-                        printf("  Cannot open voltage file: %s\n", volt_path);
-                        #endif
                 }
-
-                /* Read current */
-                fp = fopen(curr_path, "r");
-                if (fp)
+                else if (diff < 0)
                 {
-                        char line[256];
-                        if (fgets(line, sizeof(line), fp))
-                        {
-                                current = strtod(line, NULL);
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Raw current: %lf\n", current);
-                                #endif
-                        }
-                        else
-                        {
-                                read_success = false;
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Failed to read current from %s\n", curr_path);
-                                #endif
-                        }
-                        fclose(fp);
+                        __atomic_add_fetch(&handle->region_dropped[id], 1, __ATOMIC_RELAXED);
+                        return PM_ERROR_MEMORY;
                 }
                 else
                 {
-                        read_success = false;
-                        #ifdef SHOW_ALL_DEBUG
-                        printf("  Cannot open current file: %s\n", curr_path);
-                        #endif
+                        pos = __atomic_load_n(&handle->region_enqueue, __ATOMIC_RELAXED);
                 }
+        }
 
-                /* Lock mutex again to update shared data */
-                pthread_mutex_lock(&handle->data_mutex);
+        cell->timestamp_ns = timestamp_ns;
+        cell->region = (uint32_t)id | flag;
+        cell->thread = region_thread;
+        __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+        return PM_SUCCESS;
+}
 
-                /* Convert units and validate readings */
-                if (read_success)
-                {
-                        /* For INA3221, keep raw values in mV and mA */
-                        if (handle->sensor_types[i] == PM_SENSOR_TYPE_I2C)
-                        {
-                                /* Keep raw values */
-                                #ifdef SHOW_ALL_DEBUG
-                                printf("  Raw values: %.3f mV, %.3f mA\n", voltage, current);
-                                printf("  Calculated power: %.3f mW\n", voltage * current / 1000.0);
-                                #endif
-
-                                /* Validate readings based on sensor type */
-                                bool valid_reading = true;
-                                // if (strstr(handle->sensor_names[i], "VDD_IN"))
-                                // {
-                                //         /* VDD_IN 是系统总功耗 */
-                                //         if (voltage < 18000.0 || voltage > 20000.0) valid_reading = false;
-                                //         if (current < 0.0 || current > 10000.0) valid_reading = false;
-                                // }
-                                // else if (strstr(handle->sensor_names[i], "VDD_CPU_GPU_CV"))
-                                // {
-                                //         /* VDD_CPU_GPU_CV 是 CPU + GPU + CV 组合电源轨 */
-                                //         if (voltage < 18000.0 || voltage > 20000.0) valid_reading = false;
-                                //         if (current < 0.0 || current > 10000.0) valid_reading = false;
-                                // }
-                                // else if (strstr(handle->sensor_names[i], "VDD_SOC"))
-                                // {
-                                //         /* VDD_SOC 是 SoC 电源轨 */
-                                //         if (voltage < 18000.0 || voltage > 20000.0) valid_reading = false;
-                                //         if (current < 0.0 || current > 10000.0) valid_reading = false;
-                                // }
-
-                                if (!valid_reading)
-                                {
-                                        #ifdef SHOW_ALL_DEBUG
-                                        printf("  Invalid reading for %s: %.3f mV, %.3f mA\n", 
-                                               handle->sensor_names[i], voltage, current);
-                                        #endif
-                                        read_success = false;
-                                }
+/* Energy clock and total power at a marker time, interpolated like the trapezoidal integration */
+static double region_energy_at(pm_handle_t handle, uint64_t timestamp_ns, double *power)
+{
+        const pm_region_tick_t *ticks = handle->region_ticks;
+        uint64_t newest = handle->region_tick_count - 1;
+        uint64_t oldest = handle->region_tick_count > REGION_CLOCK_TICKS ?
+                handle->region_tick_count - REGION_CLOCK_TICKS : 0;
+        const pm_region_tick_t *after = &ticks[newest % REGION_CLOCK_TICKS];
 
-                                /* Store values in V and A for consistency */
-                                voltage /= 1000.0;  /* mV to V */
-                                current /= 1000.0;  /* mA to A */
-                        }
-                        else /* PM_SENSOR_TYPE_SYSTEM */
-                        {
-                                /* Convert from mV to V and mA to A */
-                                voltage /= 1000.0;  /* mV to V */
-                                current /= 1000.0;  /* mA to A */
+        if (timestamp_ns >= after->timestamp_ns)
+        {
+                *power = after->power;
+                return after->energy;
+        }
 
-                                /* Validate readings */
-                                bool valid_reading = true;
-                                // if (voltage < 0.0 || voltage > 30.0) valid_reading = false;
-                                // if (current < 0.0 || current > 10.0) valid_reading = false;
+        /* Markers older than every tick kept are clamped to the oldest one */
+        if (timestamp_ns <= ticks[oldest % REGION_CLOCK_TICKS].timestamp_ns)
+        {
+                *power = ticks[oldest % REGION_CLOCK_TICKS].power;
+                return ticks[oldest % REGION_CLOCK_TICKS].energy;
+        }
 
-                                if (!valid_reading)
-                                {
-                                        #ifdef SHOW_ALL_DEBUG
-                                        printf("  Invalid reading for %s: %.3f V, %.3f A\n", 
-                                               handle->sensor_names[i], voltage, current);
-                                        #endif
-                                        read_success = false;
-                                }
-                        }
+        /* First tick at or after the marker; most markers land in the newest interval */
+        uint64_t low = oldest + 1, high = newest;
+        while (low < high)
+        {
+                uint64_t middle = low + (high - low) / 2;
+                if (ticks[middle % REGION_CLOCK_TICKS].timestamp_ns < timestamp_ns)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
 
-                        #ifdef SHOW_ALL_DEBUG
-                        if (read_success)
-                        {
-                                printf("  Converted values: %.3f V, %.3f A\n", voltage, current);
-                                printf("  Calculated power: %.3f W\n", voltage * current);
-                        }
-                        #endif
-                }
+        const pm_region_tick_t *before = &ticks[(low - 1) % REGION_CLOCK_TICKS];
+        after = &ticks[low % REGION_CLOCK_TICKS];
 
-                /* Update sensor data */
-                handle->latest_data.sensors[i].voltage = voltage;
-                handle->latest_data.sensors[i].current = current;
-                handle->latest_data.sensors[i].power = voltage * current;
-                handle->latest_data.sensors[i].online = read_success;
-                strncpy(handle->latest_data.sensors[i].status, 
-                        read_success ? "Normal" : "Error", 
-                        sizeof(handle->latest_data.sensors[i].status) - 1);
-                handle->latest_data.sensors[i].status[sizeof(handle->latest_data.sensors[i].status) - 1] = '\0';
+        double fraction = (double)(timestamp_ns - before->timestamp_ns) /
+                          (double)(after->timestamp_ns - before->timestamp_ns);
+        double sum = before->power + after->power;
 
-                /* Set thresholds based on sensor type */
-                if (strstr(handle->sensor_names[i], "VDD_IN"))
-                {
-                        handle->latest_data.sensors[i].warning_threshold = 15.0;
-                        handle->latest_data.sensors[i].critical_threshold = 20.0;
-                }
-                else if (strstr(handle->sensor_names[i], "VDD_CPU_GPU_CV"))
+        *power = before->power + (after->power - before->power) * fraction;
+        if (sum > 0.0)
+        {
+                fraction *= (before->power + *power) / sum;
+        }
+        return before->energy + (after->energy - before->energy) * fraction;
+}
+
+/* Match a marker with the open instances and fold completed ones into the results */
+static void join_region_marker(pm_handle_t handle, const pm_region_marker_t *marker)
+{
+        uint32_t id = marker->region & ~REGION_END_FLAG;
+        pm_region_stats_t *stats = &handle->regions[id];
+        double power;
+        double energy = region_energy_at(handle, marker->timestamp_ns, &power);
+
+        if (!(marker->region & REGION_END_FLAG))
+        {
+                if (handle->region_open_count == REGION_MAX_OPEN)
                 {
-                        handle->latest_data.sensors[i].warning_threshold = 10.0;
-                        handle->latest_data.sensors[i].critical_threshold = 15.0;
+                        __atomic_add_fetch(&handle->region_dropped[id], 1, __ATOMIC_RELAXED);
+                        return;
                 }
-                else if (strstr(handle->sensor_names[i], "VDD_SOC"))
+
+                pm_region_open_t *open = &handle->region_open[handle->region_open_count++];
+                open->region = id;
+                open->thread = marker->thread;
+                open->begin_ns = marker->timestamp_ns;
+                open->begin_energy = energy;
+                open->peak_power = power;
+                stats->active++;
+                return;
+        }
+
+        /* The innermost open instance of this region on the same thread */
+        int i = handle->region_open_count - 1;
+        while (i >= 0 && (handle->region_open[i].region != id || handle->region_open[i].thread != marker->thread))
+        {
+                i--;
+        }
+        if (i < 0)
+        {
+                __atomic_add_fetch(&handle->region_dropped[id], 1, __ATOMIC_RELAXED);
+                return;
+        }
+
+        pm_region_open_t open = handle->region_open[i];
+        memmove(&handle->region_open[i], &handle->region_open[i + 1],
+                (size_t)(handle->region_open_count - i - 1) * sizeof(pm_region_open_t));
+        handle->region_open_count--;
+
+        double peak = open.peak_power > power ? open.peak_power : power;
+        stats->active--;
+        stats->count++;
+        if (marker->timestamp_ns > open.begin_ns)
+        {
+                stats->duration_ns += marker->timestamp_ns - open.begin_ns;
+        }
+        stats->energy += energy - open.begin_energy;
+        stats->avg_power = stats->duration_ns > 0 ?
+                stats->energy * (double)NSEC_PER_SEC / (double)stats->duration_ns : 0.0;
+        if (stats->count == 1 || peak > stats->peak_power)
+        {
+                stats->peak_power = peak;
+        }
+}
+
+/* Advance the energy clock and join the markers up to the current tick; the caller holds data_mutex */
+static void update_regions(pm_handle_t handle)
+{
+        const pm_sensor_data_t *total = &handle->latest_data.total;
+        uint64_t now = handle->last_sample_ns;
+        double energy = handle->region_tick_count > 0 ?
+                handle->region_ticks[(handle->region_tick_count - 1) % REGION_CLOCK_TICKS].energy : 0.0;
+
+        pm_region_tick_t *tick = &handle->region_ticks[handle->region_tick_count++ % REGION_CLOCK_TICKS];
+        tick->timestamp_ns = now;
+        tick->power = total->online ? total->power : 0.0;
+        tick->energy = energy + handle->tick_energy[handle->sensor_count];
+
+        uint64_t pos = handle->region_dequeue;
+        const pm_region_marker_t *cell = &handle->region_queue[pos & (REGION_QUEUE_SIZE - 1)];
+        bool pending = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) == pos + 1 &&
+                       cell->timestamp_ns <= now;
+        if (!pending && handle->region_open_count == 0)
+        {
+                return;
+        }
+
+        uint64_t seq = handle->region_seq;
+        __atomic_store_n(&handle->region_seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        /* Markers after this tick wait for the next one, and so do the ones queued behind them */
+        for (;;)
+        {
+                pm_region_marker_t *marker = &handle->region_queue[pos & (REGION_QUEUE_SIZE - 1)];
+                if (__atomic_load_n(&marker->seq, __ATOMIC_ACQUIRE) != pos + 1 ||
+                    marker->timestamp_ns > now)
                 {
-                        handle->latest_data.sensors[i].warning_threshold = 5.0;
-                        handle->latest_data.sensors[i].critical_threshold = 8.0;
+                        break;
                 }
-                else
+
+                join_region_marker(handle, marker);
+                __atomic_store_n(&marker->seq, pos + REGION_QUEUE_SIZE, __ATOMIC_RELEASE);
+                pos++;
+        }
+        handle->region_dequeue = pos;
+
+        /* The tick falls within every instance still open */
+        if (total->online)
+        {
+                for (int i = 0; i < handle->region_open_count; i++)
                 {
-                        handle->latest_data.sensors[i].warning_threshold = 3.0;
-                        handle->latest_data.sensors[i].critical_threshold = 5.0;
+                        pm_region_open_t *open = &handle->region_open[i];
+                        if (total->power > open->peak_power)
+                        {
+                                open->peak_power = total->power;
+                        }
                 }
         }
 
-        /* Calculate total power */
-        calculate_total_power(handle);
-
-        /* Update statistics */
-        update_statistics(handle);
-
-        pthread_mutex_unlock(&handle->data_mutex);
-        return PM_SUCCESS;
+        __atomic_store_n(&handle->region_seq, seq + 2, __ATOMIC_RELEASE);
 }
 
 /* Calculate the total power from all sensors */
 static void calculate_total_power(pm_handle_t handle)
 {
-        if (!handle || !handle->latest_data.sensors || !handle->sensor_names) {
+        if (!handle || !handle->latest_data.sensors) {
                 return;
         }
 
-        /* Find VDD_IN sensor */
-        for (int i = 0; i < handle->sensor_count; i++)
+        /* Use the VDD_IN rail resolved at discovery as total power */
+        if (handle->total_rail >= 0)
         {
-                if (!handle->sensor_names[i]) continue;
-
-                if (strstr(handle->sensor_names[i], "VDD_IN"))
-                {
-                        /* Use VDD_IN as total power */
-                        strncpy(handle->latest_data.total.name, "Total (VDD_IN)", 
-                                sizeof(handle->latest_data.total.name) - 1);
-                        handle->latest_data.total.name[sizeof(handle->latest_data.total.name) - 1] = '\0';
-                        
-                        handle->latest_data.total.power = handle->latest_data.sensors[i].power;
-                        handle->latest_data.total.current = handle->latest_data.sensors[i].current;
-                        handle->latest_data.total.voltage = handle->latest_data.sensors[i].voltage;
-                        handle->latest_data.total.online = handle->latest_data.sensors[i].online;
-                        
-                        strncpy(handle->latest_data.total.status, handle->latest_data.sensors[i].status,
-                                sizeof(handle->latest_data.total.status) - 1);
-                        handle->latest_data.total.status[sizeof(handle->latest_data.total.status) - 1] = '\0';
-                        
-                        handle->latest_data.total.warning_threshold = 25.0;
-                        handle->latest_data.total.critical_threshold = 35.0;
-                        return;
-                }
+                const pm_sensor_data_t *input = &handle->latest_data.sensors[handle->total_rail];
+
+                handle->latest_data.total.power = input->power;
+                handle->latest_data.total.current = input->current;
+                handle->latest_data.total.voltage = input->voltage;
+                handle->latest_data.total.online = input->online;
+                memcpy(handle->latest_data.total.status, input->status, sizeof(handle->latest_data.total.status));
+                return;
         }
 
         /* If VDD_IN not found, use sum of all sensors (fallback) */
@@ -1399,174 +6393,336 @@ static void calculate_total_power(pm_handle_t handle)
         }
 
         /* Update the total values */
-        strncpy(handle->latest_data.total.name, "Total (Sum)", 
-                sizeof(handle->latest_data.total.name) - 1);
-        handle->latest_data.total.name[sizeof(handle->latest_data.total.name) - 1] = '\0';
-        
         handle->latest_data.total.power = total_power;
         handle->latest_data.total.current = total_current;
         handle->latest_data.total.voltage = total_voltage;
+
+        if (handle->latest_data.total.online != all_online || handle->latest_data.total.status[0] == '\0')
+        {
+                snprintf(handle->latest_data.total.status, sizeof(handle->latest_data.total.status), "%s",
+                         all_online ? "Normal" : "Partial");
+        }
         handle->latest_data.total.online = all_online;
-        
-        strncpy(handle->latest_data.total.status, all_online ? "Normal" : "Partial",
-                sizeof(handle->latest_data.total.status) - 1);
-        handle->latest_data.total.status[sizeof(handle->latest_data.total.status) - 1] = '\0';
-        
-        handle->latest_data.total.warning_threshold = 25.0;
-        handle->latest_data.total.critical_threshold = 35.0;
 }
 
-/* Update the statistics */
-static pm_error_t update_statistics(pm_handle_t handle)
+/* Integrate power over the time since the previous tick with the trapezoidal rule; returns the joules added */
+static double accumulate_energy(pm_sensor_stats_t *stats, pm_energy_state_t *state,
+                                const pm_sensor_data_t *data, uint64_t timestamp_ns)
 {
-        if (!handle || !handle->latest_data.sensors || !handle->statistics.sensors) {
-                return PM_ERROR_NOT_INITIALIZED;
+        double energy = 0.0;
+
+        /* Intervals next to an offline reading are left out rather than guessed */
+        if (data->online && state->valid && timestamp_ns > state->timestamp_ns)
+        {
+                double dt = (double)(timestamp_ns - state->timestamp_ns) / (double)NSEC_PER_SEC;
+
+                energy = 0.5 * (state->power + data->power) * dt;
+                stats->energy += energy;
+                stats->duration += dt;
+                stats->avg_power = stats->energy / stats->duration;
         }
 
-        /* Update the sensor statistics */
-        for (int i = 0; i < handle->sensor_count; i++)
+        state->power = data->power;
+        state->timestamp_ns = timestamp_ns;
+        state->valid = data->online;
+        return energy;
+}
+
+/* Histogram bin of a power reading, from the exponent and leading mantissa bits */
+static int histogram_bin(double power)
+{
+        if (!(power > 0.0))
         {
-                if (!handle->latest_data.sensors[i].online) continue;
+                return 0;
+        }
 
-                /* Voltage */
-                if (handle->statistics.sensors[i].voltage.count == 0)
-                {
-                        handle->statistics.sensors[i].voltage.min = handle->latest_data.sensors[i].voltage;
-                        handle->statistics.sensors[i].voltage.max = handle->latest_data.sensors[i].voltage;
-                }
-                else
-                {
-                        if (handle->latest_data.sensors[i].voltage < handle->statistics.sensors[i].voltage.min)
-                        {
-                                handle->statistics.sensors[i].voltage.min = handle->latest_data.sensors[i].voltage;
-                        }
-                        if (handle->latest_data.sensors[i].voltage > handle->statistics.sensors[i].voltage.max)
-                        {
-                                handle->statistics.sensors[i].voltage.max = handle->latest_data.sensors[i].voltage;
-                        }
-                }
+        uint64_t bits;
+        memcpy(&bits, &power, sizeof(bits));
+        int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
 
-                handle->statistics.sensors[i].voltage.total += handle->latest_data.sensors[i].voltage;
-                handle->statistics.sensors[i].voltage.count++;
-                handle->statistics.sensors[i].voltage.avg = 
-                        handle->statistics.sensors[i].voltage.total / handle->statistics.sensors[i].voltage.count;
+        if (exponent < HISTOGRAM_MIN_EXPONENT)
+        {
+                return 0;
+        }
+        if (exponent >= HISTOGRAM_MAX_EXPONENT)
+        {
+                return PM_HISTOGRAM_BINS - 1;
+        }
 
-                /* Current */
-                if (handle->statistics.sensors[i].current.count == 0)
-                {
-                        handle->statistics.sensors[i].current.min = handle->latest_data.sensors[i].current;
-                        handle->statistics.sensors[i].current.max = handle->latest_data.sensors[i].current;
-                }
-                else
-                {
-                        if (handle->latest_data.sensors[i].current < handle->statistics.sensors[i].current.min)
-                        {
-                                handle->statistics.sensors[i].current.min = handle->latest_data.sensors[i].current;
-                        }
-                        if (handle->latest_data.sensors[i].current > handle->statistics.sensors[i].current.max)
-                        {
-                                handle->statistics.sensors[i].current.max = handle->latest_data.sensors[i].current;
-                        }
-                }
+        int sub = (int)((bits >> (52 - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BINS - 1));
+        return 1 + (exponent - HISTOGRAM_MIN_EXPONENT) * HISTOGRAM_SUB_BINS + sub;
+}
 
-                handle->statistics.sensors[i].current.total += handle->latest_data.sensors[i].current;
-                handle->statistics.sensors[i].current.count++;
-                handle->statistics.sensors[i].current.avg = 
-                        handle->statistics.sensors[i].current.total / handle->statistics.sensors[i].current.count;
+/* Add time to a bin; only the writer holding data_mutex modifies histograms */
+static void histogram_add_seconds(pm_histogram_t *histogram, int bin, double seconds)
+{
+        double value = histogram->seconds[bin] + seconds;
+        __atomic_store(&histogram->seconds[bin], &value, __ATOMIC_RELAXED);
+        value = histogram->duration + seconds;
+        __atomic_store(&histogram->duration, &value, __ATOMIC_RELAXED);
+}
 
-                /* Power */
-                if (handle->statistics.sensors[i].power.count == 0)
-                {
-                        handle->statistics.sensors[i].power.min = handle->latest_data.sensors[i].power;
-                        handle->statistics.sensors[i].power.max = handle->latest_data.sensors[i].power;
-                }
-                else
-                {
-                        if (handle->latest_data.sensors[i].power < handle->statistics.sensors[i].power.min)
-                        {
-                                handle->statistics.sensors[i].power.min = handle->latest_data.sensors[i].power;
-                        }
-                        if (handle->latest_data.sensors[i].power > handle->statistics.sensors[i].power.max)
-                        {
-                                handle->statistics.sensors[i].power.max = handle->latest_data.sensors[i].power;
-                        }
-                }
+/* Bin the current reading and split the interval since the previous one between both bins */
+static void record_histogram(pm_histogram_t *histogram, const pm_energy_state_t *state,
+                             const pm_sensor_data_t *data, uint64_t timestamp_ns)
+{
+        if (!data->online)
+        {
+                return;
+        }
+
+        int bin = histogram_bin(data->power);
+        __atomic_store_n(&histogram->samples[bin], histogram->samples[bin] + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&histogram->count, histogram->count + 1, __ATOMIC_RELAXED);
 
-                handle->statistics.sensors[i].power.total += handle->latest_data.sensors[i].power;
-                handle->statistics.sensors[i].power.count++;
-                handle->statistics.sensors[i].power.avg = 
-                        handle->statistics.sensors[i].power.total / handle->statistics.sensors[i].power.count;
+        /* Same intervals as the energy integration, so residency and energy agree */
+        if (state->valid && timestamp_ns > state->timestamp_ns)
+        {
+                double half = 0.5 * (double)(timestamp_ns - state->timestamp_ns) / (double)NSEC_PER_SEC;
+
+                histogram_add_seconds(histogram, histogram_bin(state->power), half);
+                histogram_add_seconds(histogram, bin, half);
         }
+}
 
-        /* Update the total statistics */
-        if (!handle->latest_data.total.online) {
+/* Empty a histogram without tearing the bins concurrent readers load */
+static void clear_histogram(pm_histogram_t *histogram)
+{
+        double zero = 0.0;
+
+        for (int i = 0; i < PM_HISTOGRAM_BINS; i++)
+        {
+                __atomic_store_n(&histogram->samples[i], 0, __ATOMIC_RELAXED);
+                __atomic_store(&histogram->seconds[i], &zero, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+        __atomic_store(&histogram->duration, &zero, __ATOMIC_RELAXED);
+}
+
+/* Forget the previous readings so the next tick starts a new integration */
+static void reset_energy_state(pm_handle_t handle)
+{
+        memset(handle->energy_state, 0, (handle->sensor_count + 1) * sizeof(pm_energy_state_t));
+}
+
+/* Add value to the double-double sum (*sum, *compensation), keeping *sum the rounded result */
+static void compensated_add(double *sum, double *compensation, double value)
+{
+        /* Two-sum: s + e is exactly *sum + value */
+        double s = *sum + value;
+        double v = s - *sum;
+        double e = (*sum - (s - v)) + (value - v);
+
+        /* Fold the error in and renormalize so the high part stays the best estimate */
+        double low = *compensation + e;
+        *sum = s + low;
+        *compensation = low - (*sum - s);
+}
+
+/* Refresh the variance and standard deviation derived from m2 */
+static void finish_stats(pm_stats_t *stats)
+{
+        stats->variance = stats->count > 1 ? stats->m2 / (double)(stats->count - 1) : 0.0;
+        stats->stddev = sqrt(stats->variance);
+}
+
+/* Add one sample with Welford's update and a compensated total */
+static void add_stats_sample(pm_stats_t *stats, double value)
+{
+        if (stats->count == 0)
+        {
+                stats->min = value;
+                stats->max = value;
+        }
+        else
+        {
+                if (value < stats->min)
+                        stats->min = value;
+                if (value > stats->max)
+                        stats->max = value;
+        }
+
+        stats->count++;
+        double delta = value - stats->avg;
+        stats->avg += delta / (double)stats->count;
+        stats->m2 += delta * (value - stats->avg);
+        compensated_add(&stats->total, &stats->compensation, value);
+        finish_stats(stats);
+}
+
+/* Merge the statistics of two disjoint intervals */
+pm_error_t pm_stats_merge(pm_stats_t *stats, const pm_stats_t *other)
+{
+        if (!stats || !other)
+        {
+                return PM_ERROR_INIT_FAILED;
+        }
+
+        if (other->count == 0)
+        {
+                return PM_SUCCESS;
+        }
+
+        if (stats->count == 0)
+        {
+                *stats = *other;
                 return PM_SUCCESS;
         }
 
-        if (handle->statistics.total.power.count == 0)
+        /* Chan et al.: combine the means and the squared deviations of both parts */
+        double count = (double)stats->count + (double)other->count;
+        double delta = other->avg - stats->avg;
+        stats->m2 += other->m2 + delta * delta * ((double)stats->count * (double)other->count / count);
+        stats->avg += delta * ((double)other->count / count);
+        stats->count += other->count;
+
+        if (other->min < stats->min)
+                stats->min = other->min;
+        if (other->max > stats->max)
+                stats->max = other->max;
+
+        compensated_add(&stats->total, &stats->compensation, other->total);
+        compensated_add(&stats->total, &stats->compensation, other->compensation);
+        finish_stats(stats);
+        return PM_SUCCESS;
+}
+
+/* Statistics of the samples added to now since base, the reverse of pm_stats_merge() */
+static void stats_delta(pm_stats_t *stats, const pm_stats_t *now, const pm_stats_t *base)
+{
+        memset(stats, 0, sizeof(*stats));
+        if (now->count <= base->count)
+        {
+                return;
+        }
+
+        stats->count = now->count - base->count;
+        stats->total = now->total;
+        stats->compensation = now->compensation;
+        compensated_add(&stats->total, &stats->compensation, -base->total);
+        compensated_add(&stats->total, &stats->compensation, -base->compensation);
+
+        /* Solve Chan's update for the squared deviations of the new part */
+        double count = (double)stats->count;
+        stats->avg = (stats->total + stats->compensation) / count;
+        if (base->count > 0)
         {
-                handle->statistics.total.power.min = handle->latest_data.total.power;
-                handle->statistics.total.power.max = handle->latest_data.total.power;
-                handle->statistics.total.current.min = handle->latest_data.total.current;
-                handle->statistics.total.current.max = handle->latest_data.total.current;
-                handle->statistics.total.voltage.min = handle->latest_data.total.voltage;
-                handle->statistics.total.voltage.max = handle->latest_data.total.voltage;
+                double delta = stats->avg - base->avg;
+                stats->m2 = now->m2 - base->m2 - delta * delta * ((double)base->count * count / (double)now->count);
+                if (stats->m2 < 0.0)
+                        stats->m2 = 0.0;
         }
         else
         {
-                /* Power */
-                if (handle->latest_data.total.power < handle->statistics.total.power.min)
-                {
-                        handle->statistics.total.power.min = handle->latest_data.total.power;
-                }
-                if (handle->latest_data.total.power > handle->statistics.total.power.max)
-                {
-                        handle->statistics.total.power.max = handle->latest_data.total.power;
-                }
+                stats->m2 = now->m2;
+        }
+        finish_stats(stats);
+}
 
-                /* Current */
-                if (handle->latest_data.total.current < handle->statistics.total.current.min)
-                {
-                        handle->statistics.total.current.min = handle->latest_data.total.current;
-                }
-                if (handle->latest_data.total.current > handle->statistics.total.current.max)
-                {
-                        handle->statistics.total.current.max = handle->latest_data.total.current;
-                }
+/* Statistics of a session column: sums from the lifetime difference, extremes tracked per tick */
+static void session_delta(pm_sensor_stats_t *stats, const pm_sensor_stats_t *now, const pm_sensor_stats_t *base,
+                          const pm_session_range_t *range)
+{
+        pm_stats_t *quantities[3] = {&stats->voltage, &stats->current, &stats->power};
+        const pm_stats_t *current[3] = {&now->voltage, &now->current, &now->power};
+        const pm_stats_t *start[3] = {&base->voltage, &base->current, &base->power};
 
-                /* Voltage */
-                if (handle->latest_data.total.voltage < handle->statistics.total.voltage.min)
-                {
-                        handle->statistics.total.voltage.min = handle->latest_data.total.voltage;
-                }
-                if (handle->latest_data.total.voltage > handle->statistics.total.voltage.max)
+        memcpy(stats->name, now->name, sizeof(stats->name));
+        for (int q = 0; q < 3; q++)
+        {
+                stats_delta(quantities[q], current[q], start[q]);
+                if (range->seen)
                 {
-                        handle->statistics.total.voltage.max = handle->latest_data.total.voltage;
+                        quantities[q]->min = range->min[q];
+                        quantities[q]->max = range->max[q];
                 }
         }
 
-        handle->statistics.total.power.total += handle->latest_data.total.power;
-        handle->statistics.total.power.count++;
-        handle->statistics.total.power.avg = 
-                handle->statistics.total.power.total / handle->statistics.total.power.count;
+        stats->energy = now->energy - base->energy;
+        stats->duration = now->duration - base->duration;
+        stats->avg_power = stats->duration > 0.0 ? stats->energy / stats->duration : 0.0;
+}
+
+/* Add an online reading to the voltage, current and power statistics */
+static void add_sensor_sample(pm_sensor_stats_t *stats, const pm_sensor_data_t *data)
+{
+        add_stats_sample(&stats->voltage, data->voltage);
+        add_stats_sample(&stats->current, data->current);
+        add_stats_sample(&stats->power, data->power);
+}
 
-        handle->statistics.total.current.total += handle->latest_data.total.current;
-        handle->statistics.total.current.count++;
-        handle->statistics.total.current.avg = 
-                handle->statistics.total.current.total / handle->statistics.total.current.count;
+/* Widen the extremes of every open session by the current tick */
+static void update_sessions(pm_handle_t handle)
+{
+        for (struct pm_session_s *session = handle->sessions; session; session = session->next)
+        {
+                for (int c = 0; c <= handle->sensor_count; c++)
+                {
+                        const pm_sensor_data_t *data = c < handle->sensor_count ?
+                                &handle->latest_data.sensors[c] : &handle->latest_data.total;
+                        pm_session_range_t *range = &session->ranges[c];
+                        const double values[3] = {data->voltage, data->current, data->power};
 
-        handle->statistics.total.voltage.total += handle->latest_data.total.voltage;
-        handle->statistics.total.voltage.count++;
-        handle->statistics.total.voltage.avg = 
-                handle->statistics.total.voltage.total / handle->statistics.total.voltage.count;
+                        if (!data->online)
+                        {
+                                continue;
+                        }
 
-        return PM_SUCCESS;
+                        for (int q = 0; q < 3; q++)
+                        {
+                                if (!range->seen || values[q] < range->min[q])
+                                        range->min[q] = values[q];
+                                if (!range->seen || values[q] > range->max[q])
+                                        range->max[q] = values[q];
+                        }
+                        range->seen = true;
+                }
+        }
 }
 
-/* Check if a file exists */
-static bool check_file_exists(const char *path)
+/* Update the statistics */
+static pm_error_t update_statistics(pm_handle_t handle)
 {
-        return access(path, F_OK) == 0;
+        if (!handle || !handle->latest_data.sensors || !handle->statistics.sensors) {
+                return PM_ERROR_NOT_INITIALIZED;
+        }
+
+        /* Integrate energy over the monotonic time between ticks, after binning it with the previous tick */
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                record_histogram(&handle->histograms[i], &handle->energy_state[i],
+                                 &handle->latest_data.sensors[i], handle->last_sample_ns);
+                handle->tick_energy[i] = accumulate_energy(&handle->statistics.sensors[i], &handle->energy_state[i],
+                                                           &handle->latest_data.sensors[i], handle->last_sample_ns);
+                accumulate_energy(&handle->lifetime[i], &handle->lifetime_state[i],
+                                  &handle->latest_data.sensors[i], handle->last_sample_ns);
+        }
+        record_histogram(&handle->histograms[handle->sensor_count], &handle->energy_state[handle->sensor_count],
+                         &handle->latest_data.total, handle->last_sample_ns);
+        handle->tick_energy[handle->sensor_count] =
+                accumulate_energy(&handle->statistics.total, &handle->energy_state[handle->sensor_count],
+                                  &handle->latest_data.total, handle->last_sample_ns);
+        accumulate_energy(&handle->lifetime[handle->sensor_count], &handle->lifetime_state[handle->sensor_count],
+                          &handle->latest_data.total, handle->last_sample_ns);
+
+        /* Update the sensor statistics */
+        for (int i = 0; i < handle->sensor_count; i++)
+        {
+                const pm_sensor_data_t *sensor = &handle->latest_data.sensors[i];
+                if (!sensor->online) continue;
+
+                add_sensor_sample(&handle->statistics.sensors[i], sensor);
+                add_sensor_sample(&handle->lifetime[i], sensor);
+        }
+
+        /* Update the total statistics */
+        if (handle->latest_data.total.online) {
+                add_sensor_sample(&handle->statistics.total, &handle->latest_data.total);
+                add_sensor_sample(&handle->lifetime[handle->sensor_count], &handle->latest_data.total);
+        }
+
+        update_sessions(handle);
+        return PM_SUCCESS;
 }
 
 /* Safe version of strdup that checks for NULL */
@@ -108,10 +108,11 @@ static void draw_ui(pm_handle_t handle, int freq, double elapsed_sec)
 
 // --- Usage Function ---
 static void print_usage(const char *prog_name) {
-    printf("Usage: %s [-f frequency_hz] [-d duration_seconds] [-i interval_ms]\n", prog_name);
+    printf("Usage: %s [-f frequency_hz] [-d duration_seconds] [-i interval_ms] [-r file]\n", prog_name);
     printf("  -f frequency_hz     Sampling frequency for the library (Hz, default: 1)\n");
     printf("  -d duration_seconds Monitoring duration (seconds, 0 for indefinite, default: 0)\n");
     printf("  -i interval_ms      Screen refresh interval (ms, default: 1000, min: ~%dms for %dHz)\n", MIN_INTERVAL_MS, MAX_REFRESH_HZ);
+    printf("  -r file             Record every sample to a binary file (see jetpwmon_record.h)\n");
     printf("  -h                  Show this help message\n");
 }
 
@@ -121,14 +122,16 @@ int main(int argc, char* argv[]) {
     int sampling_frequency = 50; // Library sampling frequency
     int duration = 0;
     int update_interval_ms = 1000; // Screen refresh interval
+    const char *record_path = NULL; // Recording file, NULL if not recording
     int opt;
 
     // --- Parse Arguments ---
-    while ((opt = getopt(argc, argv, "f:d:i:h")) != -1) {
+    while ((opt = getopt(argc, argv, "f:d:i:r:h")) != -1) {
         switch (opt) {
             case 'f': sampling_frequency = atoi(optarg); break;
             case 'd': duration = atoi(optarg); break;
             case 'i': update_interval_ms = atoi(optarg); break;
+            case 'r': record_path = optarg; break;
             case 'h': print_usage(argv[0]); return 0;
             default: print_usage(argv[0]); return 1;
         }
@@ -163,6 +166,13 @@ int main(int argc, char* argv[]) {
     error = pm_set_sampling_frequency(g_handle, sampling_frequency);
     if (error != PM_SUCCESS) { /* Error handling */ fprintf(stderr, "Freq Error: %s\n", pm_error_string(error)); pm_cleanup(g_handle); return 1; }
 
+    // --- Start Recording ---
+    if (record_path) {
+        printf("Recording to %s...\n", record_path);
+        error = pm_record_start(g_handle, record_path);
+        if (error != PM_SUCCESS) { fprintf(stderr, "Record Error: %s\n", pm_error_string(error)); pm_cleanup(g_handle); return 1; }
+    }
+
     // --- Initialize ncurses ---
     setlocale(LC_ALL, "");
     initscr();
@@ -206,6 +216,17 @@ int main(int argc, char* argv[]) {
     // --- Cleanup ncurses ---
     endwin(); // Restore terminal
 
+    // --- Stop Recording ---
+    if (record_path) {
+        pm_record_stats_t record_stats;
+        error = pm_record_stop(g_handle);
+        if (error != PM_SUCCESS) { fprintf(stderr, "Record Error: %s\n", pm_error_string(error)); }
+        pm_get_record_stats(g_handle, &record_stats);
+        printf("Recorded %llu samples in %llu blocks to %s (%llu dropped).\n",
+               (unsigned long long)record_stats.ticks, (unsigned long long)record_stats.blocks,
+               record_path, (unsigned long long)record_stats.dropped);
+    }
+
     // --- Final Cleanup (C Library) ---
     printf("Cleaning up resources...\n");
     error = pm_cleanup(g_handle); // Error check is good
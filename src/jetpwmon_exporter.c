@@ -0,0 +1,356 @@
+/**
+ * @file jetpwmon_exporter.c
+ * @brief Minimal Prometheus/OpenMetrics exporter for the power monitor library.
+ *
+ * The whole HTTP response, headers included, is rendered once at startup with
+ * a fixed-width field for every value. A scrape only rewrites the fields of a
+ * newer snapshot in place and sends the buffer, so it allocates nothing and
+ * never formats more than the numbers.
+ */
+
+#define _POSIX_C_SOURCE 200809L // Needed for sigaction
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>     // For getopt
+#include <signal.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "jetpwmon/jetpwmon.h"
+
+// --- Constants ---
+#define VALUE_WIDTH 24          // Characters reserved for every value, enough for any %.15g
+#define REQUEST_SIZE 2048       // Bytes of a request line and headers read at most
+#define REQUEST_TIMEOUT_S 1     // A client that sends nothing for this long is dropped
+
+static const char RESPONSE_HEADER[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    "Connection: close\r\n"
+    "Content-Length: ";
+static const char NOT_FOUND[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Type: text/plain\r\n"
+    "Connection: close\r\n"
+    "Content-Length: 10\r\n\r\n"
+    "Not found\n";
+
+// --- Types ---
+typedef struct {
+    pm_handle_t handle;
+    int sensor_count;
+
+    // Pre-rendered response and the offsets of its value fields
+    char *text;
+    size_t length;
+    size_t capacity;
+    size_t *slots;
+    int slot_count;
+    int slot_capacity;
+    int next_slot;              // Field written next by an update
+    bool building;              // Whether metric() appends text or fills fields
+    bool failed;                // Out of memory while building
+
+    // Snapshot read at scrape time
+    pm_power_data_t data;
+    pm_sensor_data_t *sensors;
+    pm_power_stats_t stats;
+    pm_sensor_stats_t *sensor_stats;
+    pm_sampler_stats_t sampler;
+    uint64_t generation;        // Generation rendered into the fields, 0 before the first
+} exporter_t;
+
+// --- Global Variables ---
+volatile sig_atomic_t g_terminate_flag = 0;
+
+// --- Signal Handler ---
+static void signal_handler(int signum) {
+    (void)signum;
+    g_terminate_flag = 1;
+}
+
+// --- Rendering ---
+static void append(exporter_t *e, const char *fmt, ...) {
+    if (e->failed) return;
+
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(e->text + e->length, e->capacity - e->length, fmt, args);
+        va_end(args);
+        if (n < 0) { e->failed = true; return; }
+        if ((size_t)n < e->capacity - e->length) { e->length += (size_t)n; return; }
+
+        size_t capacity = e->capacity * 2 + (size_t)n;
+        char *text = (char *)realloc(e->text, capacity);
+        if (!text) { e->failed = true; return; }
+        e->text = text;
+        e->capacity = capacity;
+    }
+}
+
+// Write a value right-aligned into its field; exposition parsers skip the leading blanks
+static void write_field(char *field, double value) {
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (n < 0 || n > VALUE_WIDTH) n = snprintf(buffer, sizeof(buffer), "%.6e", value);
+    memset(field, ' ', VALUE_WIDTH);
+    memcpy(field + VALUE_WIDTH - n, buffer, (size_t)n);
+}
+
+// Emit the HELP and TYPE lines of a metric family while building
+static void family(exporter_t *e, const char *name, const char *type, const char *help) {
+    if (e->building) append(e, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// One sample line; while building its text and an empty field, afterwards only the value
+static void metric(exporter_t *e, const char *name, const char *rail, double value) {
+    if (e->building) {
+        if (rail) {
+            append(e, "%s{rail=\"", name);
+            for (const char *p = rail; *p; p++) {
+                if (*p == '"' || *p == '\\') append(e, "\\%c", *p);
+                else if (*p == '\n') append(e, "\\n");
+                else append(e, "%c", *p);
+            }
+            append(e, "\"} ");
+        } else {
+            append(e, "%s ", name);
+        }
+
+        if (e->slot_count == e->slot_capacity) {
+            int capacity = e->slot_capacity ? e->slot_capacity * 2 : 64;
+            size_t *slots = (size_t *)realloc(e->slots, (size_t)capacity * sizeof(size_t));
+            if (!slots) { e->failed = true; return; }
+            e->slots = slots;
+            e->slot_capacity = capacity;
+        }
+        e->slots[e->slot_count++] = e->length;
+        append(e, "%*s\n", VALUE_WIDTH, "");
+    }
+
+    if (!e->failed) write_field(e->text + e->slots[e->next_slot++], value);
+}
+
+// Walk every metric in a fixed order, building the text the first time
+static void render(exporter_t *e) {
+    e->next_slot = 0;
+    const pm_sensor_data_t *total = &e->data.total;
+
+    family(e, "jetpwmon_power_watts", "gauge", "Power of the rail in watts.");
+    for (int i = 0; i < e->sensor_count; i++) metric(e, "jetpwmon_power_watts", e->sensors[i].name, e->sensors[i].power);
+    metric(e, "jetpwmon_power_watts", "total", total->power);
+
+    family(e, "jetpwmon_voltage_volts", "gauge", "Voltage of the rail in volts.");
+    for (int i = 0; i < e->sensor_count; i++) metric(e, "jetpwmon_voltage_volts", e->sensors[i].name, e->sensors[i].voltage);
+    metric(e, "jetpwmon_voltage_volts", "total", total->voltage);
+
+    family(e, "jetpwmon_current_amperes", "gauge", "Current of the rail in amperes.");
+    for (int i = 0; i < e->sensor_count; i++) metric(e, "jetpwmon_current_amperes", e->sensors[i].name, e->sensors[i].current);
+    metric(e, "jetpwmon_current_amperes", "total", total->current);
+
+    family(e, "jetpwmon_rail_online", "gauge", "Whether the last read of the rail succeeded.");
+    for (int i = 0; i < e->sensor_count; i++) metric(e, "jetpwmon_rail_online", e->sensors[i].name, e->sensors[i].online ? 1 : 0);
+    metric(e, "jetpwmon_rail_online", "total", total->online ? 1 : 0);
+
+    family(e, "jetpwmon_energy_joules_total", "counter", "Energy consumed by the rail since the exporter started.");
+    for (int i = 0; i < e->sensor_count; i++) metric(e, "jetpwmon_energy_joules_total", e->sensor_stats[i].name, e->sensor_stats[i].energy);
+    metric(e, "jetpwmon_energy_joules_total", "total", e->stats.total.energy);
+
+    family(e, "jetpwmon_sampler_period_seconds", "gauge", "Sampling period of the last tick.");
+    metric(e, "jetpwmon_sampler_period_seconds", NULL, e->sampler.period_ns / 1e9);
+    family(e, "jetpwmon_sampler_ticks_total", "counter", "Ticks executed by the sampler.");
+    metric(e, "jetpwmon_sampler_ticks_total", NULL, (double)e->sampler.ticks);
+    family(e, "jetpwmon_sampler_overruns_total", "counter", "Ticks that ran past the next deadline.");
+    metric(e, "jetpwmon_sampler_overruns_total", NULL, (double)e->sampler.overruns);
+    family(e, "jetpwmon_sampler_missed_ticks_total", "counter", "Deadlines skipped because of overruns.");
+    metric(e, "jetpwmon_sampler_missed_ticks_total", NULL, (double)e->sampler.missed_ticks);
+    family(e, "jetpwmon_sampler_tick_seconds", "gauge", "Duration of the last tick.");
+    metric(e, "jetpwmon_sampler_tick_seconds", NULL, e->sampler.last_tick_ns / 1e9);
+    family(e, "jetpwmon_sampler_tick_max_seconds", "gauge", "Longest tick duration.");
+    metric(e, "jetpwmon_sampler_tick_max_seconds", NULL, e->sampler.max_tick_ns / 1e9);
+    family(e, "jetpwmon_sampler_lateness_seconds", "gauge", "Wakeup delay past the last deadline.");
+    metric(e, "jetpwmon_sampler_lateness_seconds", NULL, e->sampler.last_lateness_ns / 1e9);
+    family(e, "jetpwmon_sampler_lateness_max_seconds", "gauge", "Largest wakeup delay past a deadline.");
+    metric(e, "jetpwmon_sampler_lateness_max_seconds", NULL, e->sampler.max_lateness_ns / 1e9);
+    family(e, "jetpwmon_snapshots_total", "counter", "Snapshots published by the sampler.");
+    metric(e, "jetpwmon_snapshots_total", NULL, (double)e->generation);
+}
+
+// Read a snapshot and rewrite the fields if it is newer than the rendered one
+static void refresh(exporter_t *e) {
+    uint64_t generation = 0;
+    if (pm_read_latest_data(e->handle, &e->data, e->sensors, e->sensor_count, &generation) != PM_SUCCESS) return;
+    if (generation == e->generation && !e->building) return;
+
+    // Statistics of the same tick or a later one; the skew is at most one period
+    pm_read_statistics(e->handle, &e->stats, e->sensor_stats, e->sensor_count, NULL);
+    pm_get_sampler_stats(e->handle, &e->sampler);
+    e->generation = generation;
+    render(e);
+}
+
+static int exporter_build(exporter_t *e) {
+    e->sensors = (pm_sensor_data_t *)calloc((size_t)e->sensor_count, sizeof(pm_sensor_data_t));
+    e->sensor_stats = (pm_sensor_stats_t *)calloc((size_t)e->sensor_count, sizeof(pm_sensor_stats_t));
+    e->capacity = 4096;
+    e->text = (char *)malloc(e->capacity);
+    if (!e->sensors || !e->sensor_stats || !e->text) return -1;
+
+    // The header is completed once the body length is known; its digits are padded to a fixed width
+    append(e, "%s%10s\r\n\r\n", RESPONSE_HEADER, "");
+    size_t length_field = e->length - 4 - 10;
+    size_t body = e->length;
+
+    e->building = true;
+    refresh(e);
+    e->building = false;
+    if (e->failed) return -1;
+
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%-10zu", e->length - body);
+    memcpy(e->text + length_field, digits, 10);
+    return 0;
+}
+
+// --- HTTP ---
+static void serve(exporter_t *e, int fd) {
+    struct timeval timeout = {REQUEST_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters, but the headers are drained before replying
+    char request[REQUEST_SIZE + 1];
+    size_t length = 0;
+    while (length < REQUEST_SIZE) {
+        ssize_t n = recv(fd, request + length, REQUEST_SIZE - length, 0);
+        if (n <= 0) return;
+        length += (size_t)n;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+
+    const char *response = NOT_FOUND;
+    size_t response_length = sizeof(NOT_FOUND) - 1;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0 ||
+        strncmp(request, "GET / ", 6) == 0) {
+        refresh(e);
+        response = e->text;
+        response_length = e->length;
+    }
+
+    size_t sent = 0;
+    while (sent < response_length) {
+        ssize_t n = send(fd, response + sent, response_length - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += (size_t)n;
+    }
+}
+
+static int open_listener(const char *address, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) { fprintf(stderr, "Error: Invalid address %s.\n", address); return -1; }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// --- Usage Function ---
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [-a address] [-p port] [-f frequency_hz]\n", prog_name);
+    printf("  -a address      IPv4 address to listen on (default: 127.0.0.1)\n");
+    printf("  -p port         TCP port to listen on (default: 9905)\n");
+    printf("  -f frequency_hz Sampling frequency (Hz, default: 10)\n");
+    printf("  -h              Show this help message\n");
+}
+
+// --- Main Function ---
+int main(int argc, char* argv[]) {
+    const char *address = "127.0.0.1";
+    int port = 9905;
+    int frequency = 10;
+    int opt;
+
+    // --- Parse Arguments ---
+    while ((opt = getopt(argc, argv, "a:p:f:h")) != -1) {
+        switch (opt) {
+            case 'a': address = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'f': frequency = atoi(optarg); break;
+            case 'h': print_usage(argv[0]); return 0;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+    // Validate inputs
+    if (port <= 0 || port > 65535) { fprintf(stderr, "Error: Port must be between 1 and 65535.\n"); return 1; }
+    if (frequency <= 0) { fprintf(stderr, "Error: Sampling frequency must be positive.\n"); return 1; }
+
+    // --- Signal Handling ---
+    // No SA_RESTART, so accept() returns on a signal
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // --- Initialize Library ---
+    exporter_t e;
+    memset(&e, 0, sizeof(e));
+    pm_error_t error = pm_init(&e.handle);
+    if (error != PM_SUCCESS) { fprintf(stderr, "Init Error: %s\n", pm_error_string(error)); return 1; }
+    pm_get_sensor_count(e.handle, &e.sensor_count);
+
+    error = pm_set_sampling_frequency(e.handle, frequency);
+    if (error == PM_SUCCESS) error = pm_start_sampling(e.handle);
+    if (error != PM_SUCCESS) { fprintf(stderr, "Start Error: %s\n", pm_error_string(error)); pm_cleanup(e.handle); return 1; }
+
+    int listen_fd = -1;
+    if (exporter_build(&e) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+    } else {
+        listen_fd = open_listener(address, port);
+    }
+
+    if (listen_fd >= 0) {
+        printf("Serving metrics of %d rails on http://%s:%d/metrics\n", e.sensor_count, address, port);
+        fflush(stdout);
+
+        // --- Main Loop ---
+        while (!g_terminate_flag) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) continue; // EINTR on a signal
+            serve(&e, fd);
+            close(fd);
+        }
+        close(listen_fd);
+    }
+
+    // --- Final Cleanup ---
+    pm_stop_sampling(e.handle);
+    pm_cleanup(e.handle);
+    free(e.text);
+    free(e.slots);
+    free(e.sensors);
+    free(e.sensor_stats);
+    return listen_fd >= 0 ? 0 : 1;
+}
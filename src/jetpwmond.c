@@ -0,0 +1,550 @@
+/**
+ * @file jetpwmond.c
+ * @brief Sampling daemon streaming the power monitor samples to local clients.
+ *
+ * The library sampler fills the sample history; a single epoll thread drains
+ * it every batch interval and fans the ticks out over a Unix socket using the
+ * framing of jetpwmon/jetpwmond.h. Each client has a bounded output buffer: a
+ * client that falls behind has ticks dropped and its decimation raised, so
+ * neither the sampler nor the other clients ever wait for it.
+ */
+
+#define _GNU_SOURCE // Needed for accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>     // For getopt
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include "jetpwmon/jetpwmon.h"
+#include "jetpwmon/jetpwmond.h"
+
+// --- Constants ---
+#define MAX_CHANNELS 64             // Rails plus the total a rail mask can address
+#define MAX_SHIFT 10                // Backpressure raises the decimation at most 1024-fold
+#define MIN_HISTORY_TICKS 1024      // Ticks the history holds at least
+#define READ_CHUNK 4096             // Samples drained per pm_read_samples() call
+#define INPUT_SIZE 64               // Bytes buffered from a client, enough for one frame
+
+// epoll tags; clients are tagged with their slot plus TAG_CLIENT
+#define TAG_LISTEN 0
+#define TAG_TIMER 1
+#define TAG_SIGNAL 2
+#define TAG_CLIENT 3
+
+// --- Types ---
+typedef struct {
+    int fd;                         // Socket, -1 if the slot is free
+    uint64_t rails;                 // Subscribed rail mask, 0 while paused
+    int channels[MAX_CHANNELS];     // Channel index of every subscribed rail, in bit order
+    int channel_count;              // Number of subscribed rails
+    uint32_t decimation;            // Requested decimation
+    unsigned int shift;             // Backpressure: the decimation in effect is decimation << shift
+    uint64_t dropped;               // Ticks dropped because the output buffer was full
+    unsigned char *out;             // Output buffer, [queue_size]
+    size_t out_head;                // First byte not yet sent
+    size_t out_tail;                // One past the last queued byte
+    bool want_write;                // Whether EPOLLOUT is armed
+    unsigned char in[INPUT_SIZE];   // Partial input frame
+    size_t in_len;                  // Bytes in the input buffer
+} pmd_client_t;
+
+typedef struct {
+    pm_handle_t handle;             // Library handle owning the sensors
+    int sensor_count;               // Rails, the total excluded
+    uint64_t period_ns;             // Sampling period
+    int epoll_fd;
+    int listen_fd;
+    int timer_fd;
+    int signal_fd;
+    const char *socket_path;
+    size_t queue_size;              // Output buffer bytes per client
+    pmd_client_t *clients;          // [max_clients]
+    int max_clients;
+    int client_count;
+
+    // History drain state
+    uint64_t cursor;                // Next history sequence number
+    pm_sample_t *samples;           // [READ_CHUNK]
+    pm_sample_t *partial;           // Samples of the tick being assembled, [sensor_count + 1]
+    int partial_count;              // Samples of the current tick received so far
+    uint64_t partial_tick;          // Tick the partial samples belong to
+
+    // Ticks of the current batch; channel sensor_count is the total
+    pmd_tick_t *ticks;              // [batch_capacity]
+    pmd_reading_t *readings;        // [batch_capacity][sensor_count + 1]
+    int batch_count;
+    int batch_capacity;
+} pmd_daemon_t;
+
+// --- Client Handling ---
+static int client_open(pmd_daemon_t *d, int fd) {
+    for (int i = 0; i < d->max_clients; i++) {
+        pmd_client_t *c = &d->clients[i];
+        if (c->fd >= 0) continue;
+
+        memset(c, 0, sizeof(*c));
+        c->fd = fd;
+        c->decimation = 1;
+        c->out = (unsigned char *)malloc(d->queue_size);
+        if (!c->out) { c->fd = -1; return -1; }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u32 = TAG_CLIENT + (uint32_t)i;
+        if (epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c->out);
+            c->fd = -1;
+            return -1;
+        }
+        d->client_count++;
+        return i;
+    }
+    return -1;
+}
+
+static void client_close(pmd_daemon_t *d, pmd_client_t *c) {
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->out);
+    c->out = NULL;
+    c->fd = -1;
+    d->client_count--;
+}
+
+// Space left at the end of the output buffer, compacting it first if needed
+static size_t client_space(pmd_daemon_t *d, pmd_client_t *c, size_t needed) {
+    if (d->queue_size - c->out_tail < needed && c->out_head > 0) {
+        memmove(c->out, c->out + c->out_head, c->out_tail - c->out_head);
+        c->out_tail -= c->out_head;
+        c->out_head = 0;
+    }
+    return d->queue_size - c->out_tail;
+}
+
+static void client_queue(pmd_client_t *c, const void *data, size_t length) {
+    memcpy(c->out + c->out_tail, data, length);
+    c->out_tail += length;
+}
+
+static void client_want_write(pmd_daemon_t *d, pmd_client_t *c, int slot, bool want) {
+    if (c->want_write == want) return;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = want ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.u32 = TAG_CLIENT + (uint32_t)slot;
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_write = want;
+}
+
+// Send what the socket takes without blocking; returns false if the client is gone
+static bool client_flush(pmd_daemon_t *d, pmd_client_t *c, int slot) {
+    while (c->out_head < c->out_tail) {
+        ssize_t n = send(c->fd, c->out + c->out_head, c->out_tail - c->out_head, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            c->out_head += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            client_want_write(d, c, slot, true);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    c->out_head = c->out_tail = 0;
+    client_want_write(d, c, slot, false);
+    return true;
+}
+
+static void client_subscribe(pmd_daemon_t *d, pmd_client_t *c, const pmd_subscribe_t *sub) {
+    c->rails = 0;
+    c->channel_count = 0;
+    for (int bit = 0; bit < MAX_CHANNELS; bit++) {
+        if (!(sub->rails & (1ULL << bit))) continue;
+        if (bit < d->sensor_count) {
+            c->channels[c->channel_count++] = bit;
+        } else if (bit == PMD_RAIL_TOTAL) {
+            c->channels[c->channel_count++] = d->sensor_count;
+        } else {
+            continue; // No such rail
+        }
+        c->rails |= 1ULL << bit;
+    }
+    c->decimation = sub->decimation > 0 ? sub->decimation : 1;
+    c->shift = 0;
+}
+
+// Parse complete frames from the client; returns false on a protocol error or hangup
+static bool client_read(pmd_daemon_t *d, pmd_client_t *c) {
+    for (;;) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, MSG_DONTWAIT);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->in_len += (size_t)n;
+
+        while (c->in_len >= sizeof(pmd_frame_header_t)) {
+            pmd_frame_header_t header;
+            memcpy(&header, c->in, sizeof(header));
+            if (header.version != PMD_PROTOCOL_VERSION || header.type != PMD_MSG_SUBSCRIBE ||
+                header.length != sizeof(pmd_subscribe_t)) {
+                return false;
+            }
+
+            size_t frame = sizeof(header) + header.length;
+            if (c->in_len < frame) break;
+
+            pmd_subscribe_t sub;
+            memcpy(&sub, c->in + sizeof(header), sizeof(sub));
+            client_subscribe(d, c, &sub);
+
+            memmove(c->in, c->in + frame, c->in_len - frame);
+            c->in_len -= frame;
+        }
+    }
+}
+
+static void send_hello(pmd_daemon_t *d, pmd_client_t *c, int slot) {
+    pm_power_data_t data;
+    if (pm_get_latest_data(d->handle, &data) != PM_SUCCESS) return;
+
+    pmd_frame_header_t header = {0, PMD_MSG_HELLO, PMD_PROTOCOL_VERSION};
+    pmd_hello_t hello = {d->period_ns, (uint32_t)d->sensor_count, 0};
+    char name[64];
+    header.length = (uint32_t)(sizeof(hello) + (size_t)(d->sensor_count + 1) * sizeof(name));
+    if (client_space(d, c, sizeof(header) + header.length) < sizeof(header) + header.length) return;
+
+    client_queue(c, &header, sizeof(header));
+    client_queue(c, &hello, sizeof(hello));
+    for (int i = 0; i <= d->sensor_count; i++) {
+        memset(name, 0, sizeof(name));
+        snprintf(name, sizeof(name), "%s", i < d->sensor_count ? data.sensors[i].name : data.total.name);
+        client_queue(c, name, sizeof(name));
+    }
+    client_flush(d, c, slot);
+}
+
+// --- Fan-out ---
+// Queue the ticks of the batch this client takes; a batch that does not fit is dropped
+static void client_send_batch(pmd_daemon_t *d, pmd_client_t *c) {
+    if (!c->rails || d->batch_count == 0) return;
+
+    // The client caught up: undo one step of the backpressure decimation
+    if (c->shift > 0 && c->out_head == c->out_tail) c->shift--;
+
+    uint64_t decimation = (uint64_t)c->decimation << c->shift;
+    int selected = 0;
+    for (int i = 0; i < d->batch_count; i++) {
+        if (d->ticks[i].tick % decimation == 0) selected++;
+    }
+    if (selected == 0) return;
+
+    size_t record = sizeof(pmd_tick_t) + (size_t)c->channel_count * sizeof(pmd_reading_t);
+    size_t length = sizeof(pmd_samples_t) + (size_t)selected * record;
+    pmd_frame_header_t header = {(uint32_t)length, PMD_MSG_SAMPLES, PMD_PROTOCOL_VERSION};
+    if (client_space(d, c, sizeof(header) + length) < sizeof(header) + length) {
+        c->dropped += (uint64_t)selected;
+        if (c->shift < MAX_SHIFT) c->shift++;
+        return;
+    }
+
+    pmd_samples_t samples = {c->rails, c->dropped, (uint32_t)decimation, (uint32_t)selected};
+    client_queue(c, &header, sizeof(header));
+    client_queue(c, &samples, sizeof(samples));
+    for (int i = 0; i < d->batch_count; i++) {
+        if (d->ticks[i].tick % decimation != 0) continue;
+
+        const pmd_reading_t *readings = &d->readings[(size_t)i * (d->sensor_count + 1)];
+        pmd_tick_t tick = d->ticks[i];
+        tick.offline &= c->rails;
+        client_queue(c, &tick, sizeof(tick));
+        for (int k = 0; k < c->channel_count; k++) {
+            client_queue(c, &readings[c->channels[k]], sizeof(pmd_reading_t));
+        }
+    }
+
+    // More than half the buffer is waiting: thin out the next batches
+    if (c->out_tail - c->out_head > d->queue_size / 2 && c->shift < MAX_SHIFT) c->shift++;
+}
+
+// Turn the assembled samples of a tick into a batch entry
+static void finish_tick(pmd_daemon_t *d) {
+    if (d->partial_count != d->sensor_count + 1 || d->batch_count == d->batch_capacity) return;
+
+    pmd_tick_t *tick = &d->ticks[d->batch_count];
+    pmd_reading_t *readings = &d->readings[(size_t)d->batch_count * (d->sensor_count + 1)];
+    tick->tick = d->partial_tick;
+    tick->timestamp_ns = d->partial[0].timestamp_ns;
+    tick->offline = 0;
+    for (int i = 0; i <= d->sensor_count; i++) {
+        const pm_sample_t *sample = &d->partial[i];
+        int channel = sample->rail < 0 ? d->sensor_count : sample->rail;
+        readings[channel].voltage = sample->voltage;
+        readings[channel].current = sample->current;
+        readings[channel].power = sample->power;
+        if (!sample->online) tick->offline |= 1ULL << (sample->rail < 0 ? PMD_RAIL_TOTAL : sample->rail);
+    }
+    d->batch_count++;
+}
+
+// Drain the history into the batch until it is full; ticks cut by an overwrite are skipped
+static void drain_history(pmd_daemon_t *d) {
+    uint64_t per_tick = (uint64_t)d->sensor_count + 1;
+    d->batch_count = 0;
+
+    while (d->batch_count < d->batch_capacity) {
+        // Never take more than the batch holds, the rest stays in the history
+        uint64_t room = (uint64_t)(d->batch_capacity - d->batch_count) * per_tick - (uint64_t)d->partial_count;
+        int max = room < READ_CHUNK ? (int)room : READ_CHUNK;
+        int count = 0;
+        if (pm_read_samples(d->handle, d->samples, max, &d->cursor, &count) != PM_SUCCESS || count == 0) break;
+
+        for (int i = 0; i < count; i++) {
+            const pm_sample_t *sample = &d->samples[i];
+            uint64_t tick = sample->seq / per_tick;
+            int index = (int)(sample->seq % per_tick);
+            if (tick != d->partial_tick || index != d->partial_count) {
+                // A tick starts over only at its first sample
+                d->partial_count = 0;
+                d->partial_tick = tick;
+                if (index != 0) continue;
+            }
+            d->partial[d->partial_count++] = *sample;
+            if (d->partial_count == (int)per_tick) {
+                finish_tick(d);
+                d->partial_count = 0;
+                d->partial_tick = tick + 1;
+            }
+        }
+    }
+}
+
+static void fan_out(pmd_daemon_t *d) {
+    // A late wakeup finds more than a batch; it goes out as several
+    do {
+        drain_history(d);
+        for (int i = 0; i < d->max_clients; i++) {
+            pmd_client_t *c = &d->clients[i];
+            if (c->fd < 0) continue;
+            client_send_batch(d, c);
+            if (!client_flush(d, c, i)) client_close(d, c);
+        }
+    } while (d->batch_count == d->batch_capacity);
+}
+
+// --- Setup ---
+static int open_listener(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) { fprintf(stderr, "Error: Socket path too long.\n"); return -1; }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+
+    unlink(path); // A socket left behind by a previous instance
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int watch(int epoll_fd, int fd, uint32_t tag) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int daemon_setup(pmd_daemon_t *d, int frequency, int batch_ms) {
+    pm_error_t error = pm_init(&d->handle);
+    if (error != PM_SUCCESS) { fprintf(stderr, "Init Error: %s\n", pm_error_string(error)); return -1; }
+
+    pm_get_sensor_count(d->handle, &d->sensor_count);
+    if (d->sensor_count >= PMD_RAIL_TOTAL) { fprintf(stderr, "Error: Too many rails for the rail mask.\n"); return -1; }
+
+    error = pm_set_sampling_frequency(d->handle, frequency);
+    if (error != PM_SUCCESS) { fprintf(stderr, "Freq Error: %s\n", pm_error_string(error)); return -1; }
+    pm_get_sampling_period_ns(d->handle, &d->period_ns);
+
+    // The history absorbs several batches in case the loop is late
+    d->batch_capacity = (int)((uint64_t)batch_ms * 1000000ULL / d->period_ns) + 2;
+    int history_ticks = 8 * d->batch_capacity > MIN_HISTORY_TICKS ? 8 * d->batch_capacity : MIN_HISTORY_TICKS;
+    error = pm_configure_history(d->handle, history_ticks * (d->sensor_count + 1), PM_OVERFLOW_DROP_OLDEST);
+    if (error != PM_SUCCESS) { fprintf(stderr, "History Error: %s\n", pm_error_string(error)); return -1; }
+
+    d->samples = (pm_sample_t *)malloc(READ_CHUNK * sizeof(pm_sample_t));
+    d->partial = (pm_sample_t *)malloc((size_t)(d->sensor_count + 1) * sizeof(pm_sample_t));
+    d->ticks = (pmd_tick_t *)malloc((size_t)d->batch_capacity * sizeof(pmd_tick_t));
+    d->readings = (pmd_reading_t *)malloc((size_t)d->batch_capacity * (d->sensor_count + 1) * sizeof(pmd_reading_t));
+    d->clients = (pmd_client_t *)calloc((size_t)d->max_clients, sizeof(pmd_client_t));
+    if (!d->samples || !d->partial || !d->ticks || !d->readings || !d->clients) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int i = 0; i < d->max_clients; i++) d->clients[i].fd = -1;
+
+    // A batch needs to fit in an empty output buffer
+    size_t batch_bytes = sizeof(pmd_frame_header_t) + sizeof(pmd_samples_t) +
+                         (size_t)d->batch_capacity * (sizeof(pmd_tick_t) + (size_t)(d->sensor_count + 1) * sizeof(pmd_reading_t));
+    if (d->queue_size < 2 * batch_bytes) d->queue_size = 2 * batch_bytes;
+
+    // SIGINT/SIGTERM are read from a signalfd; SIGPIPE is ignored in favour of EPIPE
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    d->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    d->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    d->listen_fd = open_listener(d->socket_path);
+    if (d->epoll_fd < 0 || d->signal_fd < 0 || d->timer_fd < 0 || d->listen_fd < 0) return -1;
+
+    struct itimerspec interval;
+    memset(&interval, 0, sizeof(interval));
+    interval.it_interval.tv_sec = batch_ms / 1000;
+    interval.it_interval.tv_nsec = (long)(batch_ms % 1000) * 1000000L;
+    interval.it_value = interval.it_interval;
+    if (timerfd_settime(d->timer_fd, 0, &interval, NULL) != 0) { perror("timerfd_settime"); return -1; }
+
+    if (watch(d->epoll_fd, d->listen_fd, TAG_LISTEN) != 0 || watch(d->epoll_fd, d->timer_fd, TAG_TIMER) != 0 ||
+        watch(d->epoll_fd, d->signal_fd, TAG_SIGNAL) != 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+
+    error = pm_start_sampling(d->handle);
+    if (error != PM_SUCCESS) { fprintf(stderr, "Start Error: %s\n", pm_error_string(error)); return -1; }
+    return 0;
+}
+
+static void daemon_cleanup(pmd_daemon_t *d) {
+    if (d->clients) {
+        for (int i = 0; i < d->max_clients; i++) {
+            if (d->clients[i].fd >= 0) client_close(d, &d->clients[i]);
+        }
+    }
+    if (d->listen_fd >= 0) { close(d->listen_fd); unlink(d->socket_path); }
+    if (d->timer_fd >= 0) close(d->timer_fd);
+    if (d->signal_fd >= 0) close(d->signal_fd);
+    if (d->epoll_fd >= 0) close(d->epoll_fd);
+    if (d->handle) pm_cleanup(d->handle);
+    free(d->samples);
+    free(d->partial);
+    free(d->ticks);
+    free(d->readings);
+    free(d->clients);
+}
+
+// --- Usage Function ---
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [-s socket_path] [-f frequency_hz] [-b batch_ms] [-c max_clients] [-q queue_kib]\n", prog_name);
+    printf("  -s socket_path  Unix socket to listen on (default: %s)\n", PMD_DEFAULT_SOCKET);
+    printf("  -f frequency_hz Sampling frequency (Hz, default: 1000)\n");
+    printf("  -b batch_ms     Interval between sample batches sent to clients (ms, default: 10)\n");
+    printf("  -c max_clients  Maximum number of connected clients (default: 64)\n");
+    printf("  -q queue_kib    Output buffer per client (KiB, default: 256)\n");
+    printf("  -h              Show this help message\n");
+}
+
+// --- Main Function ---
+int main(int argc, char* argv[]) {
+    pmd_daemon_t d;
+    memset(&d, 0, sizeof(d));
+    d.epoll_fd = d.listen_fd = d.timer_fd = d.signal_fd = -1;
+    d.socket_path = PMD_DEFAULT_SOCKET;
+    d.max_clients = 64;
+    int frequency = 1000;
+    int batch_ms = 10;
+    int queue_kib = 256;
+    int opt;
+
+    // --- Parse Arguments ---
+    while ((opt = getopt(argc, argv, "s:f:b:c:q:h")) != -1) {
+        switch (opt) {
+            case 's': d.socket_path = optarg; break;
+            case 'f': frequency = atoi(optarg); break;
+            case 'b': batch_ms = atoi(optarg); break;
+            case 'c': d.max_clients = atoi(optarg); break;
+            case 'q': queue_kib = atoi(optarg); break;
+            case 'h': print_usage(argv[0]); return 0;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+    // Validate inputs
+    if (frequency <= 0) { fprintf(stderr, "Error: Sampling frequency must be positive.\n"); return 1; }
+    if (batch_ms <= 0) { fprintf(stderr, "Error: Batch interval must be positive.\n"); return 1; }
+    if (d.max_clients <= 0) { fprintf(stderr, "Error: Maximum clients must be positive.\n"); return 1; }
+    if (queue_kib <= 0) { fprintf(stderr, "Error: Queue size must be positive.\n"); return 1; }
+    d.queue_size = (size_t)queue_kib * 1024;
+
+    if (daemon_setup(&d, frequency, batch_ms) != 0) {
+        daemon_cleanup(&d);
+        return 1;
+    }
+    printf("Serving %d rails at %d Hz on %s\n", d.sensor_count, frequency, d.socket_path);
+    fflush(stdout);
+
+    // --- Event Loop ---
+    struct epoll_event events[64];
+    bool running = true;
+    while (running) {
+        int n = epoll_wait(d.epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == TAG_SIGNAL) {
+                running = false;
+            } else if (tag == TAG_TIMER) {
+                uint64_t expirations;
+                if (read(d.timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) fan_out(&d);
+            } else if (tag == TAG_LISTEN) {
+                int fd;
+                while ((fd = accept4(d.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int slot = client_open(&d, fd);
+                    if (slot < 0) { close(fd); continue; }
+                    send_hello(&d, &d.clients[slot], slot);
+                }
+            } else {
+                int slot = (int)(tag - TAG_CLIENT);
+                pmd_client_t *c = &d.clients[slot];
+                if (c->fd < 0) continue; // Closed earlier in this round
+                bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP));
+                if (alive && (events[i].events & EPOLLIN)) alive = client_read(&d, c);
+                if (alive && (events[i].events & EPOLLOUT)) alive = client_flush(&d, c, slot);
+                if (!alive) client_close(&d, c);
+            }
+        }
+    }
+
+    // --- Final Cleanup ---
+    pm_stop_sampling(d.handle);
+    daemon_cleanup(&d);
+    printf("jetpwmond stopped.\n");
+    return 0;
+}
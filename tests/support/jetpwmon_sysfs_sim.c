@@ -0,0 +1,99 @@
+/**
+ * @file jetpwmon_sysfs_sim.c
+ * @brief Serves a simulated board's sysfs tree until interrupted.
+ *
+ * Prints the environment that points jetpwmon programs at the tree, then keeps
+ * the readings moving with the writer thread. Read latency applies to the
+ * processes that preload the jetpwmon_sysfs_delay module with the printed
+ * JETPWMON_SIM_* variables.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>    // For pthread_sigmask
+#include <unistd.h>     // For getopt
+#include "sysfs_sim.h"
+
+// --- Helper Functions ---
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [-b board] [-d parent_dir] [-r rate_hz] [-l latency_us]\n", prog_name);
+    printf("  -b board        orin, xavier or nano (default: orin)\n");
+    printf("  -d parent_dir   Directory to create the tree in (default: $TMPDIR or /tmp)\n");
+    printf("  -r rate_hz      Updates of the readings per second (default: 100, 0 for static values)\n");
+    printf("  -l latency_us   Read latency printed for the delay shim (us, default: 0)\n");
+    printf("  -h              Show this help message\n");
+}
+
+static int parse_board(const char *name, pm_sim_board_t *board) {
+    if (strcmp(name, "orin") == 0) *board = PM_SIM_BOARD_ORIN;
+    else if (strcmp(name, "xavier") == 0) *board = PM_SIM_BOARD_XAVIER;
+    else if (strcmp(name, "nano") == 0) *board = PM_SIM_BOARD_NANO;
+    else return -1;
+    return 0;
+}
+
+// --- Main Function ---
+int main(int argc, char* argv[]) {
+    pm_sim_board_t board = PM_SIM_BOARD_ORIN;
+    const char *parent = NULL;
+    double rate_hz = 100.0;
+    long latency_us = 0;
+    int opt;
+
+    // --- Parse Arguments ---
+    while ((opt = getopt(argc, argv, "b:d:r:l:h")) != -1) {
+        switch (opt) {
+            case 'b':
+                if (parse_board(optarg, &board) != 0) {
+                    fprintf(stderr, "Error: Unknown board '%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'd': parent = optarg; break;
+            case 'r': rate_hz = atof(optarg); break;
+            case 'l': latency_us = atol(optarg); break;
+            case 'h': print_usage(argv[0]); return 0;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+    // Validate inputs
+    if (rate_hz < 0) { fprintf(stderr, "Error: Update rate cannot be negative.\n"); return 1; }
+    if (latency_us < 0) { fprintf(stderr, "Error: Latency cannot be negative.\n"); return 1; }
+
+    // Block the stop signals before the writer thread inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // --- Build the Tree ---
+    pm_sim_t sim = pm_sim_create(board, parent);
+    if (!sim) {
+        perror("pm_sim_create");
+        return 1;
+    }
+    if (rate_hz > 0 && pm_sim_start(sim, rate_hz) != 0) {
+        fprintf(stderr, "Error: Failed to start the writer thread.\n");
+        pm_sim_destroy(sim);
+        return 1;
+    }
+
+    printf("JETPWMON_SYSFS_ROOT=%s\n", pm_sim_root(sim));
+    if (latency_us > 0) {
+        printf("JETPWMON_SIM_ROOT=%s\n", pm_sim_root(sim));
+        printf("JETPWMON_SIM_LATENCY_NS=%ld\n", latency_us * 1000L);
+    }
+    fflush(stdout);
+
+    // --- Serve Until Interrupted ---
+    int sig;
+    sigwait(&signals, &sig);
+
+    // --- Final Cleanup ---
+    printf("%llu updates written.\n", (unsigned long long)pm_sim_updates(sim));
+    pm_sim_destroy(sim);
+    return 0;
+}
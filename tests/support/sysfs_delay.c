@@ -0,0 +1,206 @@
+/**
+ * @file sysfs_delay.c
+ * @brief Read latency shim for simulated sysfs trees, see sysfs_sim.h
+ * @author Qi Deng<dengqi935@gmail.com>
+ *
+ * Linked into an executable, the definitions below take precedence over the
+ * C library's for every caller in the process, including the jetpwmon
+ * library; built as a module they can be preloaded into any process. Files
+ * opened under the configured root, by absolute path or relative to a
+ * directory opened there, are remembered by fd and their reads are delayed
+ * before being forwarded to the real functions.
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sysfs_sim.h"
+
+/* Highest fd tracked plus one */
+#define DELAY_MAX_FDS 4096
+
+/* Shim configuration, read by every interposed call */
+static char delay_root[PATH_MAX];
+static size_t delay_root_length;
+static uint64_t delay_ns;
+
+/* Whether each fd was opened under the root */
+static bool delayed_fds[DELAY_MAX_FDS];
+
+/* Real functions, resolved on first use */
+static int (*real_open)(const char *, int, ...);
+static int (*real_openat)(int, const char *, int, ...);
+static FILE *(*real_fopen)(const char *, const char *);
+static ssize_t (*real_read)(int, void *, size_t);
+static ssize_t (*real_pread)(int, void *, size_t, off_t);
+static int (*real_close)(int);
+
+/* Resolve the next definition of a function, the C library's */
+static void *next_symbol(const char *name)
+{
+        void *symbol = dlsym(RTLD_NEXT, name);
+        if (!symbol)
+        {
+                fprintf(stderr, "sysfs_delay: cannot resolve %s\n", name);
+                abort();
+        }
+        return symbol;
+}
+
+/* Whether a path lies under the delayed root */
+static bool under_root(const char *path)
+{
+        size_t length = __atomic_load_n(&delay_root_length, __ATOMIC_ACQUIRE);
+        return length > 0 && path && strncmp(path, delay_root, length) == 0 &&
+               (path[length] == '/' || path[length] == '\0');
+}
+
+/* Whether an fd was opened under the root */
+static bool fd_delayed(int fd)
+{
+        return fd >= 0 && fd < DELAY_MAX_FDS && __atomic_load_n(&delayed_fds[fd], __ATOMIC_RELAXED);
+}
+
+/* Remember whether a new fd is delayed */
+static void track_fd(int fd, bool delayed)
+{
+        if (fd >= 0 && fd < DELAY_MAX_FDS)
+        {
+                __atomic_store_n(&delayed_fds[fd], delayed, __ATOMIC_RELAXED);
+        }
+}
+
+/* Sleep for the configured latency */
+static void delay(void)
+{
+        uint64_t ns = __atomic_load_n(&delay_ns, __ATOMIC_RELAXED);
+        struct timespec remaining = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+
+        while (ns > 0 && nanosleep(&remaining, &remaining) != 0 && errno == EINTR)
+        {
+        }
+}
+
+/* Delay the reads of an fd if it was opened under the root */
+static void delay_fd(int fd)
+{
+        if (fd_delayed(fd))
+        {
+                delay();
+        }
+}
+
+/* Configure the shim */
+void pm_sim_set_latency(const char *root, uint64_t latency_ns)
+{
+        /* Disable matching while the root changes */
+        __atomic_store_n(&delay_root_length, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&delay_ns, latency_ns, __ATOMIC_RELAXED);
+        if (root && root[0] != '\0' && latency_ns > 0)
+        {
+                snprintf(delay_root, sizeof(delay_root), "%s", root);
+                __atomic_store_n(&delay_root_length, strlen(delay_root), __ATOMIC_RELEASE);
+        }
+}
+
+/* Take the configuration from the environment when preloaded */
+__attribute__((constructor)) static void delay_init(void)
+{
+        const char *latency = getenv("JETPWMON_SIM_LATENCY_NS");
+
+        if (latency)
+        {
+                pm_sim_set_latency(getenv("JETPWMON_SIM_ROOT"), strtoull(latency, NULL, 10));
+        }
+}
+
+int open(const char *path, int flags, ...)
+{
+        mode_t mode = 0;
+
+        if (flags & (O_CREAT | O_TMPFILE))
+        {
+                va_list args;
+                va_start(args, flags);
+                mode = (mode_t)va_arg(args, int);
+                va_end(args);
+        }
+
+        if (!real_open)
+                real_open = (int (*)(const char *, int, ...))next_symbol("open");
+        int fd = real_open(path, flags, mode);
+        track_fd(fd, under_root(path));
+        return fd;
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+        mode_t mode = 0;
+
+        if (flags & (O_CREAT | O_TMPFILE))
+        {
+                va_list args;
+                va_start(args, flags);
+                mode = (mode_t)va_arg(args, int);
+                va_end(args);
+        }
+
+        if (!real_openat)
+                real_openat = (int (*)(int, const char *, int, ...))next_symbol("openat");
+        int fd = real_openat(dirfd, path, flags, mode);
+
+        /* Relative paths are under the root if their directory is */
+        track_fd(fd, path[0] == '/' ? under_root(path) : fd_delayed(dirfd));
+        return fd;
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+        if (!real_fopen)
+                real_fopen = (FILE * (*)(const char *, const char *)) next_symbol("fopen");
+
+        /* stdio reads go through internal calls, so the open carries the delay */
+        if (under_root(path))
+        {
+                delay();
+        }
+        return real_fopen(path, mode);
+}
+
+ssize_t read(int fd, void *buffer, size_t count)
+{
+        if (!real_read)
+                real_read = (ssize_t(*)(int, void *, size_t))next_symbol("read");
+        delay_fd(fd);
+        return real_read(fd, buffer, count);
+}
+
+ssize_t pread(int fd, void *buffer, size_t count, off_t offset)
+{
+        if (!real_pread)
+                real_pread = (ssize_t(*)(int, void *, size_t, off_t))next_symbol("pread");
+        delay_fd(fd);
+        return real_pread(fd, buffer, count, offset);
+}
+
+int close(int fd)
+{
+        if (!real_close)
+                real_close = (int (*)(int))next_symbol("close");
+        if (fd >= 0 && fd < DELAY_MAX_FDS)
+        {
+                __atomic_store_n(&delayed_fds[fd], false, __ATOMIC_RELAXED);
+        }
+        return real_close(fd);
+}
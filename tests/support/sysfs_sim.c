@@ -0,0 +1,415 @@
+/**
+ * @file sysfs_sim.c
+ * @brief Simulated Jetson sysfs trees, see sysfs_sim.h
+ * @author Qi Deng<dengqi935@gmail.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sysfs_sim.h"
+
+/* Channels per INA3221 */
+#define SIM_CHANNELS 3
+
+/* Maximum number of INA3221 per board */
+#define SIM_MAX_DEVICES 2
+
+/* Writer waveform: +-20% of the current over 50 updates */
+#define SIM_RIPPLE 0.2
+#define SIM_RIPPLE_UPDATES 50
+
+/* INA3221 as wired on a board */
+typedef struct
+{
+        const char *device;                 /* I2C device directory */
+        const char *labels[SIM_CHANNELS];   /* Channel labels, "NC" if unconnected */
+        int millivolts[SIM_CHANNELS];       /* Idle bus voltage per channel */
+        int milliamps[SIM_CHANNELS];        /* Idle current per channel */
+} pm_sim_device_t;
+
+/* Board layout */
+typedef struct
+{
+        bool iio;                           /* IIO devices (JetPack 4) instead of hwmon */
+        const char *driver_name;            /* Content of the name files */
+        int device_count;                   /* INA3221 on the board */
+        pm_sim_device_t devices[SIM_MAX_DEVICES];
+} pm_sim_layout_t;
+
+static const pm_sim_layout_t layouts[] = {
+    /* PM_SIM_BOARD_ORIN */
+    {false, "ina3221", 2,
+     {{"1-0040", {"VDD_GPU_SOC", "VDD_CPU_CV", "VIN_SYS_5V0"}, {19072, 19072, 4976}, {1224, 408, 904}},
+      {"1-0041", {"NC", "VDDQ_VDD2_1V8AO", "NC"}, {0, 4984, 0}, {0, 96, 0}}}},
+    /* PM_SIM_BOARD_XAVIER */
+    {true, "ina3221x", 2,
+     {{"1-0040", {"GPU", "CPU", "SOC"}, {19136, 19136, 19136}, {40, 232, 96}},
+      {"1-0041", {"CV", "VDDRQ", "SYS5V"}, {19136, 19136, 4976}, {24, 48, 416}}}},
+    /* PM_SIM_BOARD_NANO */
+    {true, "ina3221x", 1,
+     {{"6-0040", {"POM_5V_IN", "POM_5V_GPU", "POM_5V_CPU"}, {5016, 5016, 5016}, {544, 40, 168}}}},
+};
+
+/* Connected channel */
+typedef struct
+{
+        char name[64];                      /* Channel label */
+        int volt_fd;                        /* Voltage attribute, open for writing */
+        int curr_fd;                        /* Current attribute, open for writing */
+        int millivolts;                     /* Set bus voltage */
+        int milliamps;                      /* Set current */
+} pm_sim_rail_t;
+
+struct pm_sim_s
+{
+        char root[PATH_MAX];                /* Tree directory */
+        int rail_count;                     /* Connected channels */
+        pm_sim_rail_t rails[SIM_MAX_DEVICES * SIM_CHANNELS];
+
+        /* Writer thread */
+        pthread_mutex_t mutex;              /* Serializes the writes */
+        pthread_t thread;                   /* Writer thread */
+        bool running;                       /* Whether the writer runs */
+        bool stop_flag;                     /* Asks the writer to exit */
+        uint64_t period_ns;                 /* Update interval */
+        uint64_t updates;                   /* Updates written */
+};
+
+/* Create a directory and its parents */
+static int make_dirs(const char *path)
+{
+        char buffer[PATH_MAX];
+
+        snprintf(buffer, sizeof(buffer), "%s", path);
+        for (char *p = buffer + 1; *p; p++)
+        {
+                if (*p == '/')
+                {
+                        *p = '\0';
+                        if (mkdir(buffer, 0755) != 0 && errno != EEXIST)
+                                return -errno;
+                        *p = '/';
+                }
+        }
+        if (mkdir(buffer, 0755) != 0 && errno != EEXIST)
+                return -errno;
+        return 0;
+}
+
+/* Write a whole attribute file */
+static int write_file(const char *dir, const char *name, const char *value)
+{
+        char path[PATH_MAX];
+
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+                return -errno;
+        ssize_t length = (ssize_t)strlen(value);
+        int err = write(fd, value, (size_t)length) == length ? 0 : -EIO;
+        close(fd);
+        return err;
+}
+
+/* Replace the value of an open attribute without an empty window; returns 0 or -errno */
+static int write_value(int fd, int value)
+{
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), "%d\n", value);
+
+        if (pwrite(fd, buffer, (size_t)length, 0) != length)
+        {
+                return -EIO;
+        }
+
+        /* Readers racing the truncation see stale bytes after the newline, which are never parsed */
+        return ftruncate(fd, length) == 0 ? 0 : -errno;
+}
+
+/* Create the files of a channel and keep its value files open */
+static int add_channel(pm_sim_t sim, const pm_sim_layout_t *layout, const char *dir,
+                       const pm_sim_device_t *device, int channel)
+{
+        char name[64], value[32], path[PATH_MAX];
+        int index = layout->iio ? channel : channel + 1;
+        int err;
+
+        /* JetPack 4 labels rail_name_<n> from 0, hwmon labels in<n>_label from 1 */
+        snprintf(name, sizeof(name), layout->iio ? "rail_name_%d" : "in%d_label", index);
+        snprintf(value, sizeof(value), "%s\n", device->labels[channel]);
+        if ((err = write_file(dir, name, value)) != 0)
+                return err;
+
+        snprintf(name, sizeof(name), layout->iio ? "in_voltage%d_input" : "in%d_input", index);
+        snprintf(value, sizeof(value), "%d\n", device->millivolts[channel]);
+        if ((err = write_file(dir, name, value)) != 0)
+                return err;
+
+        snprintf(name, sizeof(name), layout->iio ? "in_current%d_input" : "curr%d_input", index);
+        snprintf(value, sizeof(value), "%d\n", device->milliamps[channel]);
+        if ((err = write_file(dir, name, value)) != 0)
+                return err;
+
+        if (strstr(device->labels[channel], "NC"))
+                return 0;
+
+        pm_sim_rail_t *rail = &sim->rails[sim->rail_count];
+        snprintf(rail->name, sizeof(rail->name), "%s", device->labels[channel]);
+        rail->millivolts = device->millivolts[channel];
+        rail->milliamps = device->milliamps[channel];
+
+        snprintf(path, sizeof(path), layout->iio ? "%s/in_voltage%d_input" : "%s/in%d_input", dir, index);
+        rail->volt_fd = open(path, O_WRONLY | O_CLOEXEC);
+        snprintf(path, sizeof(path), layout->iio ? "%s/in_current%d_input" : "%s/curr%d_input", dir, index);
+        rail->curr_fd = open(path, O_WRONLY | O_CLOEXEC);
+        if (rail->volt_fd < 0 || rail->curr_fd < 0)
+        {
+                err = -errno;
+                if (rail->volt_fd >= 0)
+                        close(rail->volt_fd);
+                if (rail->curr_fd >= 0)
+                        close(rail->curr_fd);
+                return err;
+        }
+
+        sim->rail_count++;
+        return 0;
+}
+
+/* Build the devices of a board under the root */
+static int build_tree(pm_sim_t sim, const pm_sim_layout_t *layout)
+{
+        char path[PATH_MAX], dir[PATH_MAX], value[64];
+        int err;
+
+        if (snprintf(path, sizeof(path), "%s/class/power_supply", sim->root) >= (int)sizeof(path))
+                return -ENAMETOOLONG;
+        if ((err = make_dirs(path)) != 0)
+                return err;
+
+        for (int i = 0; i < layout->device_count; i++)
+        {
+                const pm_sim_device_t *device = &layout->devices[i];
+
+                if (snprintf(path, sizeof(path), "%s/bus/i2c/devices/%s", sim->root, device->device) >= (int)sizeof(path))
+                        return -ENAMETOOLONG;
+                snprintf(value, sizeof(value), "%s\n", layout->driver_name);
+                if ((err = make_dirs(path)) != 0 || (err = write_file(path, "name", value)) != 0)
+                        return err;
+
+                /* The driver directory is numbered across the board */
+                int length = layout->iio ? snprintf(dir, sizeof(dir), "%s/iio:device%d", path, i) :
+                                           snprintf(dir, sizeof(dir), "%s/hwmon/hwmon%d", path, i + 1);
+                if (length >= (int)sizeof(dir))
+                        return -ENAMETOOLONG;
+                if ((err = make_dirs(dir)) != 0 || (err = write_file(dir, "name", value)) != 0)
+                        return err;
+
+                for (int channel = 0; channel < SIM_CHANNELS; channel++)
+                {
+                        if ((err = add_channel(sim, layout, dir, device, channel)) != 0)
+                                return err;
+                }
+
+                /* hwmon also exposes the sum of the shunt voltages, which is not a rail */
+                if (!layout->iio && (err = write_file(dir, "in7_label", "sum of shunt voltages\n")) != 0)
+                        return err;
+        }
+        return 0;
+}
+
+/* Remove one entry of the tree */
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+        (void)st;
+        (void)flag;
+        (void)ftw;
+        remove(path);
+        return 0;
+}
+
+/* Build the tree of a board */
+pm_sim_t pm_sim_create(pm_sim_board_t board, const char *parent)
+{
+        if ((int)board < 0 || (size_t)board >= sizeof(layouts) / sizeof(layouts[0]))
+        {
+                errno = EINVAL;
+                return NULL;
+        }
+
+        pm_sim_t sim = (pm_sim_t)calloc(1, sizeof(struct pm_sim_s));
+        if (!sim)
+        {
+                return NULL;
+        }
+
+        if (!parent)
+        {
+                parent = getenv("TMPDIR");
+                if (!parent || parent[0] == '\0')
+                        parent = "/tmp";
+        }
+        snprintf(sim->root, sizeof(sim->root), "%s/jetpwmon-sim-XXXXXX", parent);
+        if (!mkdtemp(sim->root))
+        {
+                free(sim);
+                return NULL;
+        }
+        pthread_mutex_init(&sim->mutex, NULL);
+
+        int err = build_tree(sim, &layouts[board]);
+        if (err != 0)
+        {
+                pm_sim_destroy(sim);
+                errno = -err;
+                return NULL;
+        }
+        return sim;
+}
+
+/* Stop the writer and remove the tree */
+void pm_sim_destroy(pm_sim_t sim)
+{
+        if (!sim)
+        {
+                return;
+        }
+
+        pm_sim_stop(sim);
+        for (int i = 0; i < sim->rail_count; i++)
+        {
+                close(sim->rails[i].volt_fd);
+                close(sim->rails[i].curr_fd);
+        }
+        nftw(sim->root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+        pthread_mutex_destroy(&sim->mutex);
+        free(sim);
+}
+
+/* Directory to use as the sysfs root */
+const char *pm_sim_root(pm_sim_t sim)
+{
+        return sim->root;
+}
+
+/* Number of rails the library discovers */
+int pm_sim_rail_count(pm_sim_t sim)
+{
+        return sim->rail_count;
+}
+
+/* Name of a rail */
+const char *pm_sim_rail_name(pm_sim_t sim, int rail)
+{
+        if (rail < 0 || rail >= sim->rail_count)
+        {
+                return NULL;
+        }
+        return sim->rails[rail].name;
+}
+
+/* Set the reading of a rail */
+int pm_sim_set_rail(pm_sim_t sim, int rail, int millivolts, int milliamps)
+{
+        if (rail < 0 || rail >= sim->rail_count)
+        {
+                return -EINVAL;
+        }
+
+        pthread_mutex_lock(&sim->mutex);
+        sim->rails[rail].millivolts = millivolts;
+        sim->rails[rail].milliamps = milliamps;
+        write_value(sim->rails[rail].volt_fd, millivolts);
+        write_value(sim->rails[rail].curr_fd, milliamps);
+        pthread_mutex_unlock(&sim->mutex);
+        return 0;
+}
+
+/* Rewrite every reading at the update rate */
+static void *writer_thread_func(void *arg)
+{
+        pm_sim_t sim = (pm_sim_t)arg;
+        struct timespec deadline;
+
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        while (!__atomic_load_n(&sim->stop_flag, __ATOMIC_ACQUIRE))
+        {
+                pthread_mutex_lock(&sim->mutex);
+                double ripple = 1.0 + SIM_RIPPLE * sin(2.0 * M_PI * (double)(sim->updates % SIM_RIPPLE_UPDATES) /
+                                                       SIM_RIPPLE_UPDATES);
+                for (int i = 0; i < sim->rail_count; i++)
+                {
+                        const pm_sim_rail_t *rail = &sim->rails[i];
+                        write_value(rail->volt_fd, rail->millivolts);
+                        write_value(rail->curr_fd, (int)lround(rail->milliamps * ripple));
+                }
+                __atomic_add_fetch(&sim->updates, 1, __ATOMIC_RELAXED);
+                pthread_mutex_unlock(&sim->mutex);
+
+                uint64_t nsec = (uint64_t)deadline.tv_nsec + sim->period_ns;
+                deadline.tv_sec += (time_t)(nsec / 1000000000ULL);
+                deadline.tv_nsec = (long)(nsec % 1000000000ULL);
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+                {
+                }
+        }
+        return NULL;
+}
+
+/* Start the writer thread */
+int pm_sim_start(pm_sim_t sim, double rate_hz)
+{
+        if (rate_hz <= 0.0)
+        {
+                return -EINVAL;
+        }
+        if (sim->running)
+        {
+                return -EBUSY;
+        }
+
+        sim->period_ns = (uint64_t)(1e9 / rate_hz);
+        if (sim->period_ns == 0)
+                sim->period_ns = 1;
+        sim->stop_flag = false;
+        int err = pthread_create(&sim->thread, NULL, writer_thread_func, sim);
+        if (err != 0)
+        {
+                return -err;
+        }
+        sim->running = true;
+        return 0;
+}
+
+/* Stop the writer thread */
+void pm_sim_stop(pm_sim_t sim)
+{
+        if (!sim->running)
+        {
+                return;
+        }
+
+        __atomic_store_n(&sim->stop_flag, true, __ATOMIC_RELEASE);
+        pthread_join(sim->thread, NULL);
+        sim->running = false;
+}
+
+/* Number of updates written */
+uint64_t pm_sim_updates(pm_sim_t sim)
+{
+        return __atomic_load_n(&sim->updates, __ATOMIC_RELAXED);
+}
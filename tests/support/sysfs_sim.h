@@ -0,0 +1,140 @@
+/**
+ * @file sysfs_sim.h
+ * @brief Simulated Jetson sysfs trees for tests and benchmarks
+ * @author Qi Deng<dengqi935@gmail.com>
+ *
+ * pm_sim_create() builds the INA3221 layout of a board in a temporary
+ * directory, which pm_init_config() reads through pm_config_t.sysfs_root (or
+ * JETPWMON_SYSFS_ROOT). A writer thread can update the readings at a chosen
+ * rate, and pm_sim_set_latency() delays every read of the simulated files to
+ * mimic a slow I2C bus without FUSE or FIFOs: the open(), openat(), pread(),
+ * read() and fopen() calls of the process are interposed, so linking
+ * sysfs_delay.c into a test (or preloading the jetpwmon_sysfs_delay module)
+ * is enough. Reads submitted through io_uring bypass the shim and are not
+ * delayed.
+ */
+
+#ifndef JETPWMON_SYSFS_SIM_H
+#define JETPWMON_SYSFS_SIM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Simulated boards
+ */
+typedef enum {
+    PM_SIM_BOARD_ORIN = 0,           /**< AGX Orin: two INA3221 under hwmon (JetPack 5 and later) */
+    PM_SIM_BOARD_XAVIER = 1,         /**< AGX Xavier: two INA3221 IIO devices (JetPack 4) */
+    PM_SIM_BOARD_NANO = 2            /**< Nano: one INA3221 IIO device on bus 6 (JetPack 4) */
+} pm_sim_board_t;
+
+/**
+ * @brief Simulated tree
+ */
+typedef struct pm_sim_s* pm_sim_t;
+
+/**
+ * @brief Build the tree of a board
+ *
+ * The tree holds bus/i2c/devices with the INA3221 devices of the board,
+ * including unconnected ("NC") channels and the hwmon sum channel the library
+ * skips, and an empty class/power_supply.
+ *
+ * @param board Board to simulate
+ * @param parent Directory to create the tree in, NULL for TMPDIR or /tmp
+ * @return Simulated tree, NULL with errno set on failure
+ */
+pm_sim_t pm_sim_create(pm_sim_board_t board, const char* parent);
+
+/**
+ * @brief Stop the writer and remove the tree
+ * @param sim Simulated tree
+ */
+void pm_sim_destroy(pm_sim_t sim);
+
+/**
+ * @brief Directory to use as the sysfs root
+ * @param sim Simulated tree
+ * @return Path of the tree
+ */
+const char* pm_sim_root(pm_sim_t sim);
+
+/**
+ * @brief Number of rails the library discovers in the tree
+ * @param sim Simulated tree
+ * @return Connected channels of the board
+ */
+int pm_sim_rail_count(pm_sim_t sim);
+
+/**
+ * @brief Name of a rail
+ *
+ * Rails are numbered in board order; discovery may list them in another order.
+ *
+ * @param sim Simulated tree
+ * @param rail Rail index, below pm_sim_rail_count()
+ * @return Rail label, NULL if rail is out of range
+ */
+const char* pm_sim_rail_name(pm_sim_t sim, int rail);
+
+/**
+ * @brief Set the reading of a rail
+ *
+ * The value is written at once; a running writer varies the current around it.
+ *
+ * @param sim Simulated tree
+ * @param rail Rail index, below pm_sim_rail_count()
+ * @param millivolts Bus voltage in mV
+ * @param milliamps Current in mA
+ * @return 0, or -errno on failure
+ */
+int pm_sim_set_rail(pm_sim_t sim, int rail, int millivolts, int milliamps);
+
+/**
+ * @brief Start the writer thread
+ *
+ * Every update rewrites all readings, moving the currents along a sine of
+ * +-20% around their set value with a period of 50 updates.
+ *
+ * @param sim Simulated tree
+ * @param rate_hz Updates per second
+ * @return 0, or -errno on failure
+ */
+int pm_sim_start(pm_sim_t sim, double rate_hz);
+
+/**
+ * @brief Stop the writer thread
+ * @param sim Simulated tree
+ */
+void pm_sim_stop(pm_sim_t sim);
+
+/**
+ * @brief Number of updates written by the writer thread
+ * @param sim Simulated tree
+ * @return Updates since the tree was created
+ */
+uint64_t pm_sim_updates(pm_sim_t sim);
+
+/**
+ * @brief Delay reads of the files under a directory
+ *
+ * Applies to files opened after the call: every read() or pread() of them
+ * sleeps latency_ns first, and so does every fopen() since stdio reads cannot
+ * be interposed. Process-wide; a NULL root or zero latency disables the delay.
+ * Without a call, JETPWMON_SIM_ROOT and JETPWMON_SIM_LATENCY_NS configure the
+ * shim when it is preloaded.
+ *
+ * @param root Directory whose files are delayed, e.g. pm_sim_root()
+ * @param latency_ns Delay per read in nanoseconds
+ */
+void pm_sim_set_latency(const char* root, uint64_t latency_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JETPWMON_SYSFS_SIM_H */
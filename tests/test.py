@@ -3,6 +3,8 @@
 
 import unittest
 import jetpwmon
+import os
+import tempfile
 import time
 import warnings
 
@@ -190,5 +192,52 @@ class TestJetPwMon(unittest.TestCase):
         self.assertEqual(jetpwmon.SensorType.I2C, 1)
         self.assertEqual(jetpwmon.SensorType.SYSTEM, 2)
 
+    def test_replay(self):
+        """Test replaying a CSV trace as virtual sensors"""
+        with tempfile.NamedTemporaryFile('w', suffix='.csv', delete=False) as trace:
+            trace.write("time_s,VDD_IN_V,VDD_IN_A,VDD_SOC_V,VDD_SOC_A\n")
+            for i in range(100):
+                trace.write("%.2f,5,1,1,0.5\n" % (i * 0.01))
+        try:
+            monitor = jetpwmon.PowerMonitor.replay(trace.name, speed=1.0, loop=True)
+            names = [sensor['name'] for sensor in monitor.get_latest_data()['sensors']]
+            self.assertEqual(names, ["VDD_IN", "VDD_SOC"])
+
+            monitor.set_sampling_frequency(50)
+            monitor.start_sampling()
+            time.sleep(0.3)
+            monitor.stop_sampling()
+
+            # The constant trace yields exact averages whatever the timing
+            stats = monitor.get_statistics()
+            self.assertGreater(stats['total']['power']['count'], 0)
+            self.assertAlmostEqual(stats['total']['power']['avg'], 5.0)
+            self.assertAlmostEqual(stats['total']['avg_power'], 5.0)
+            del monitor
+        finally:
+            os.unlink(trace.name)
+
+        with self.assertRaises(RuntimeError):
+            jetpwmon.PowerMonitor.replay("/nonexistent.csv")
+
+    def test_synthetic(self):
+        """Test synthetic waveforms sampled at a high rate"""
+        monitor = jetpwmon.PowerMonitor.synthetic("VDD_IN=const:6@12;VDD_GPU=sine:2,1,50")
+        names = [sensor['name'] for sensor in monitor.get_latest_data()['sensors']]
+        self.assertEqual(names, ["VDD_IN", "VDD_GPU"])
+
+        monitor.set_sampling_period_ns(100000)
+        monitor.start_sampling()
+        time.sleep(0.2)
+        monitor.stop_sampling()
+
+        stats = monitor.get_statistics()
+        self.assertGreater(stats['total']['power']['count'], 100)
+        self.assertAlmostEqual(stats['total']['power']['avg'], 6.0)
+        del monitor
+
+        with self.assertRaises(RuntimeError):
+            jetpwmon.PowerMonitor.synthetic("VDD_IN=square:1")
+
 if __name__ == '__main__':
     unittest.main()
@@ -1,10 +1,19 @@
 #include <gtest/gtest.h>
 #include <jetpwmon/jetpwmon.h> // C API header
+#include <jetpwmon/jetpwmon_record.h> // Recording file format
 #include <thread>              // For std::this_thread::sleep_for
+#include <atomic>              // For flags shared with reader threads
 #include <chrono>              // For std::chrono::milliseconds
 #include <vector>              // Can be useful, though not strictly required here
 #include <string>              // For checking error strings
 #include <cstdio>              // For potential debug printf
+#include <unistd.h>            // For getpid
+#include <fcntl.h>             // For open
+#include <sys/mman.h>          // For mmap
+#include <sys/stat.h>          // For fstat
+#include <sys/wait.h>          // For waitpid
+#include <algorithm>           // For std::find
+#include "sysfs_sim.h"         // Simulated sysfs trees
 
 // Test Fixture for managing pm_handle_t lifecycle
 class JetPwMonCAPITest : public ::testing::Test {
@@ -71,6 +80,141 @@ TEST_F(JetPwMonCAPITest, SamplingFrequency) {
     EXPECT_EQ(PM_ERROR_INVALID_FREQUENCY, err) << "Setting frequency to -1 did not return expected error.";
 }
 
+// Test case: Nanosecond sampling periods and the scheduler accounting
+TEST_F(JetPwMonCAPITest, SamplingPeriod) {
+    uint64_t period_ns = 0;
+    int freq = 0;
+    pm_error_t err;
+
+    err = pm_set_sampling_period_ns(handle_, 2500000); // 400 Hz
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to set sampling period: " << pm_error_string(err);
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampling_period_ns(handle_, &period_ns));
+    EXPECT_EQ(2500000u, period_ns);
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampling_frequency(handle_, &freq));
+    EXPECT_EQ(400, freq);
+
+    EXPECT_EQ(PM_ERROR_INVALID_FREQUENCY, pm_set_sampling_period_ns(handle_, 0));
+
+    // Sub-Hz periods still report a nonzero frequency
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_period_ns(handle_, 5000000000ULL));
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampling_frequency(handle_, &freq));
+    EXPECT_EQ(1, freq);
+
+    // The frequency setter is a wrapper around the period
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle_, 50));
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampling_period_ns(handle_, &period_ns));
+    EXPECT_EQ(20000000u, period_ns);
+
+    // A new period is picked up by the running sampler on its next tick
+    err = pm_start_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to start sampling: " << pm_error_string(err);
+    SleepForSampling(100);
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_period_ns(handle_, 5000000));
+    SleepForSampling(200);
+    err = pm_stop_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to stop sampling: " << pm_error_string(err);
+
+    pm_sampler_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampler_stats(handle_, &stats));
+    EXPECT_EQ(5000000u, stats.period_ns);
+    EXPECT_GT(stats.ticks, 10u) << "Sampler did not speed up after the period change.";
+    EXPECT_GE(stats.missed_ticks, stats.overruns);
+    EXPECT_GE(stats.max_tick_ns, stats.last_tick_ns);
+
+    // Each tick is counted exactly once in the statistics
+    pm_power_stats_t power_stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_statistics(handle_, &power_stats));
+    for (int i = 0; i < power_stats.sensor_count; ++i) {
+        EXPECT_EQ(stats.ticks, power_stats.sensors[i].power.count) << "Sensor " << i;
+    }
+}
+
+// Test case: Sampler thread settings and the report of what took effect
+TEST_F(JetPwMonCAPITest, SamplerConfig) {
+    pm_sampler_config_t config = {};
+    pm_error_t err;
+
+    // Out-of-range settings are rejected up front
+    config.policy = PM_SCHED_FIFO;
+    config.priority = 0;
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_set_sampler_config(handle_, &config));
+    config.policy = PM_SCHED_OTHER;
+    config.pin_cpu = true;
+    config.cpu = -1;
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_set_sampler_config(handle_, &config));
+
+    config.policy = PM_SCHED_FIFO;
+    config.priority = 10;
+    config.pin_cpu = true;
+    config.cpu = 0;
+    config.lock_memory = true;
+    config.timer_slack_ns = 1000;
+    err = pm_set_sampler_config(handle_, &config);
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to set sampler config: " << pm_error_string(err);
+
+    pm_sampler_config_t stored;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampler_config(handle_, &stored));
+    EXPECT_EQ(PM_SCHED_FIFO, stored.policy);
+    EXPECT_EQ(10, stored.priority);
+    EXPECT_EQ(0, stored.cpu);
+
+    // Settings the process may not make do not prevent sampling
+    err = pm_start_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to start sampling: " << pm_error_string(err);
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_set_sampler_config(handle_, &config));
+
+    pm_sampler_report_t report;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sampler_report(handle_, &report));
+    const uint32_t all = PM_SAMPLER_SETTING_POLICY | PM_SAMPLER_SETTING_AFFINITY |
+                         PM_SAMPLER_SETTING_MLOCK | PM_SAMPLER_SETTING_TIMER_SLACK;
+    EXPECT_EQ(all, report.requested);
+    EXPECT_EQ(0u, report.applied & ~report.requested);
+    EXPECT_EQ(report.policy_errno == 0, (report.applied & PM_SAMPLER_SETTING_POLICY) != 0);
+    EXPECT_EQ(report.affinity_errno == 0, (report.applied & PM_SAMPLER_SETTING_AFFINITY) != 0);
+    EXPECT_EQ(report.mlock_errno == 0, (report.applied & PM_SAMPLER_SETTING_MLOCK) != 0);
+    EXPECT_EQ(report.timer_slack_errno == 0, (report.applied & PM_SAMPLER_SETTING_TIMER_SLACK) != 0);
+
+    err = pm_stop_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err) << "Failed to stop sampling: " << pm_error_string(err);
+}
+
+// Test case: Stopping the sampler keeps the memory the application locked itself
+TEST_F(JetPwMonCAPITest, SamplerKeepsApplicationMemoryLocks) {
+    auto locked_kb = []() {
+        unsigned long kb = 0;
+        FILE* fp = fopen("/proc/self/status", "r");
+        char line[256];
+        while (fp && fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, "VmLck: %lu kB", &kb) == 1) {
+                break;
+            }
+        }
+        if (fp) {
+            fclose(fp);
+        }
+        return kb;
+    };
+
+    const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void* page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, page);
+    // Sanitizers intercept mlock() as a no-op, so the lock has to show up in VmLck
+    if (locked_kb() != 0 || mlock(page, size) != 0 || locked_kb() == 0) {
+        munmap(page, size);
+        GTEST_SKIP() << "Memory cannot be locked by this process";
+    }
+
+    pm_sampler_config_t config = {};
+    config.lock_memory = true;
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampler_config(handle_, &config));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle_));
+    EXPECT_GT(locked_kb(), 0u);
+
+    munlock(page, size);
+    munmap(page, size);
+}
+
 // Test case: Starting, checking status, and stopping sampling
 TEST_F(JetPwMonCAPITest, SamplingControl) {
     pm_error_t err;
@@ -201,6 +345,1201 @@ TEST_F(JetPwMonCAPITest, StatisticsCollection) {
     }
 }
 
+// Test case: Energy is power integrated over the monotonic time between samples
+TEST_F(JetPwMonCAPITest, EnergyIntegration) {
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle_));
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+        if (tick < 2) {
+            SleepForSampling(50);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    pm_power_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_statistics(handle_, &stats));
+    ASSERT_EQ(3u, stats.total.power.count);
+
+    // Two intervals of ~50 ms, regardless of how many samples were taken
+    EXPECT_GE(stats.total.duration, 0.1);
+    EXPECT_LE(stats.total.duration, elapsed);
+    EXPECT_NEAR(stats.total.avg_power * stats.total.duration, stats.total.energy, 1e-9);
+    for (int i = 0; i < stats.sensor_count; ++i) {
+        // The test tree holds constant readings, so energy is power times time
+        EXPECT_NEAR(stats.sensors[i].power.avg * stats.sensors[i].duration, stats.sensors[i].energy, 1e-9);
+        EXPECT_NEAR(stats.sensors[i].power.avg, stats.sensors[i].avg_power, 1e-9);
+    }
+
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_get_statistics(handle_, &stats));
+    EXPECT_EQ(0.0, stats.total.energy);
+    EXPECT_EQ(0.0, stats.total.duration);
+}
+
+// Test case: Concurrent lock-free readers always see a single, complete tick
+TEST_F(JetPwMonCAPITest, ConcurrentSnapshotReaders) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+
+    // Buffers that are too small are rejected, but the required size is reported
+    pm_power_data_t small;
+    if (count > 0) {
+        EXPECT_EQ(PM_ERROR_MEMORY, pm_read_latest_data(handle_, &small, nullptr, 0, nullptr));
+        EXPECT_EQ(count, small.sensor_count);
+    }
+
+    uint64_t start_generation = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_generation(handle_, &start_generation));
+    EXPECT_GT(start_generation, 0u) << "Sensor names should be published at init.";
+
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle_, 1000));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle_));
+
+    std::vector<std::thread> readers;
+    std::vector<int> failures(3, 0);
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([this, r, count, &failures]() {
+            std::vector<pm_sensor_stats_t> sensors(count);
+            uint64_t last_generation = 0;
+            auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+            while (std::chrono::steady_clock::now() < end) {
+                pm_power_stats_t stats;
+                uint64_t generation = 0;
+                if (pm_read_statistics(handle_, &stats, sensors.data(), count, &generation) != PM_SUCCESS ||
+                    generation < last_generation) {
+                    failures[r]++;
+                    continue;
+                }
+                last_generation = generation;
+
+                // Within one tick every online rail was sampled as often as the total
+                for (int i = 0; i < count; ++i) {
+                    if (sensors[i].power.count != stats.total.power.count) {
+                        failures[r]++;
+                    }
+                }
+
+                // The pointer getters hand each thread its own buffer
+                if (pm_get_statistics(handle_, &stats) != PM_SUCCESS) {
+                    failures[r]++;
+                    continue;
+                }
+                std::this_thread::yield();
+                for (int i = 0; i < count; ++i) {
+                    if (stats.sensors[i].power.count != stats.total.power.count) {
+                        failures[r]++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle_));
+    for (int r = 0; r < 3; ++r) {
+        EXPECT_EQ(0, failures[r]) << "Reader " << r << " saw an inconsistent snapshot.";
+    }
+
+    uint64_t end_generation = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_generation(handle_, &end_generation));
+    EXPECT_GT(end_generation, start_generation);
+}
+
+// Test case: Draining the sample history in batches
+TEST_F(JetPwMonCAPITest, SampleHistory) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    const int per_tick = count + 1;
+    std::vector<pm_sample_t> buffer(1024);
+    uint64_t cursor = 0;
+    int read = 0;
+
+    // Disabled by default, and a tick must fit
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_read_samples(handle_, buffer.data(), 1, &cursor, &read));
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_configure_history(handle_, per_tick - 1, PM_OVERFLOW_DROP_OLDEST));
+
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 1000, PM_OVERFLOW_DROP_OLDEST));
+    for (int tick = 0; tick < 10; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+
+    // Small batches return every sample in order, one per rail plus the total per tick
+    std::vector<pm_sample_t> drained;
+    do {
+        ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 7, &cursor, &read));
+        drained.insert(drained.end(), buffer.begin(), buffer.begin() + read);
+    } while (read > 0);
+    ASSERT_EQ(static_cast<size_t>(10 * per_tick), drained.size());
+    EXPECT_EQ(drained.size(), cursor);
+    for (size_t i = 0; i < drained.size(); ++i) {
+        EXPECT_EQ(i, drained[i].seq);
+        int rail = static_cast<int>(i % per_tick);
+        EXPECT_EQ(rail == count ? -1 : rail, drained[i].rail);
+        if (i > 0) {
+            EXPECT_GE(drained[i].timestamp_ns, drained[i - 1].timestamp_ns);
+        }
+    }
+
+    // DROP_OLDEST: a slow reader skips what was overwritten and it is counted as lost
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 2 * per_tick, PM_OVERFLOW_DROP_OLDEST));
+    cursor = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 1024, &cursor, &read));
+    EXPECT_EQ(per_tick, read);
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 1024, &cursor, &read));
+    EXPECT_EQ(2 * per_tick, read);
+    EXPECT_EQ(static_cast<uint64_t>(2 * per_tick), buffer[0].seq);
+
+    pm_history_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_history_stats(handle_, &stats));
+    EXPECT_EQ(static_cast<uint64_t>(per_tick), stats.lost);
+    EXPECT_EQ(static_cast<uint64_t>(4 * per_tick), stats.written);
+
+    // DROP_NEWEST: ticks that do not fit are discarded until the reader catches up
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 2 * per_tick, PM_OVERFLOW_DROP_NEWEST));
+    cursor = 0;
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_get_history_stats(handle_, &stats));
+    EXPECT_EQ(static_cast<uint64_t>(per_tick), stats.dropped);
+    EXPECT_EQ(static_cast<uint64_t>(2 * per_tick), stats.written);
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 1024, &cursor, &read));
+    EXPECT_EQ(2 * per_tick, read);
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 1024, &cursor, &read));
+    EXPECT_EQ(per_tick, read);
+}
+
+// Test case: A reader draining while the sampler runs sees every sample once
+TEST_F(JetPwMonCAPITest, SampleHistoryWhileSampling) {
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 4096, PM_OVERFLOW_DROP_OLDEST));
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle_, 500));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle_));
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_configure_history(handle_, 4096, PM_OVERFLOW_DROP_OLDEST));
+
+    std::vector<pm_sample_t> buffer(256);
+    uint64_t cursor = 0;
+    uint64_t expected_seq = 0;
+    uint64_t total = 0;
+    int read = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < end) {
+        ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 256, &cursor, &read));
+        for (int i = 0; i < read; ++i) {
+            ASSERT_EQ(expected_seq++, buffer[i].seq);
+        }
+        total += read;
+        SleepForSampling(5);
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle_));
+    do {
+        ASSERT_EQ(PM_SUCCESS, pm_read_samples(handle_, buffer.data(), 256, &cursor, &read));
+        total += read;
+    } while (read > 0);
+
+    pm_history_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_history_stats(handle_, &stats));
+    EXPECT_EQ(stats.written, total);
+    EXPECT_EQ(0u, stats.lost);
+    EXPECT_GT(total, 0u);
+}
+
+// Test case: Reconfiguring the history while another thread drains it
+TEST_F(JetPwMonCAPITest, SampleHistoryReconfiguredWhileRead) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 16 * (count + 1), PM_OVERFLOW_DROP_OLDEST));
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> failures(0);
+    std::thread reader([this, &stop, &failures]() {
+        std::vector<pm_sample_t> buffer(64);
+        uint64_t cursor = 0;
+        while (!stop.load()) {
+            int read = 0;
+            pm_history_stats_t stats;
+            if (pm_read_samples(handle_, buffer.data(), 64, &cursor, &read) != PM_SUCCESS ||
+                pm_get_history_stats(handle_, &stats) != PM_SUCCESS || stats.capacity <= 0) {
+                failures++;
+            }
+        }
+    });
+
+    // Every configuration replaces the ring the reader may be using
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, (1 + i % 8) * (count + 1),
+                                                   i % 2 ? PM_OVERFLOW_DROP_NEWEST : PM_OVERFLOW_DROP_OLDEST));
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(0, failures.load());
+}
+
+// Test case: Sliding windows cover the last N nanoseconds of ticks independently of resets
+TEST_F(JetPwMonCAPITest, WindowStatistics) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    std::vector<pm_stats_t> sensors(count);
+    pm_window_stats_t stats;
+
+    // No windows by default, and every window needs a length
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count));
+    const uint64_t invalid[] = {0};
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_configure_windows(handle_, invalid, 1));
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_configure_windows(handle_, nullptr, PM_MAX_WINDOWS + 1));
+
+    const uint64_t windows[] = {100000000ULL, 10000000000ULL};  // 100 ms and 10 s
+    ASSERT_EQ(PM_SUCCESS, pm_configure_windows(handle_, windows, 2));
+    EXPECT_EQ(PM_SUCCESS, pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count));
+    EXPECT_EQ(0u, stats.total.count);
+    EXPECT_EQ(PM_ERROR_MEMORY, pm_get_window_statistics(handle_, 0, &stats, nullptr, 0));
+    EXPECT_EQ(count, stats.sensor_count);
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_get_window_statistics(handle_, 2, &stats, sensors.data(), count));
+
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    SleepForSampling(150);
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+
+    pm_power_data_t data;
+    std::vector<pm_sensor_data_t> latest(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(handle_, &data, latest.data(), count, nullptr));
+
+    // The short window only holds the last tick, the long one all four
+    ASSERT_EQ(PM_SUCCESS, pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count));
+    EXPECT_EQ(windows[0], stats.window_ns);
+    EXPECT_EQ(sensors.data(), stats.sensors);
+    EXPECT_EQ(0u, stats.span_ns);
+    if (data.total.online) {
+        EXPECT_EQ(1u, stats.total.count);
+        EXPECT_DOUBLE_EQ(data.total.power, stats.total.max);
+    }
+
+    ASSERT_EQ(PM_SUCCESS, pm_get_window_statistics(handle_, 1, &stats, sensors.data(), count));
+    EXPECT_EQ(windows[1], stats.window_ns);
+    EXPECT_GE(stats.span_ns, 150000000u);
+    for (int i = 0; i < count; ++i) {
+        if (!latest[i].online) {
+            continue;
+        }
+        EXPECT_EQ(4u, stats.sensors[i].count);
+        EXPECT_LE(stats.sensors[i].min, stats.sensors[i].avg);
+        EXPECT_GE(stats.sensors[i].max, stats.sensors[i].avg);
+        EXPECT_NEAR(stats.sensors[i].total, stats.sensors[i].avg * 4, 1e-9);
+    }
+
+    // Windows cannot be reconfigured while sampling
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle_, 200));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle_));
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_configure_windows(handle_, windows, 2));
+    SleepForSampling(300);
+    ASSERT_EQ(PM_SUCCESS, pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count));
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle_));
+    EXPECT_LT(stats.span_ns, windows[0]);
+    if (data.total.online) {
+        EXPECT_GT(stats.total.count, 5u);
+        EXPECT_LE(stats.total.count, 21u);
+    }
+
+    ASSERT_EQ(PM_SUCCESS, pm_configure_windows(handle_, nullptr, 0));
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count));
+}
+
+// Test case: Reconfiguring the windows never pulls them from under a reader
+TEST_F(JetPwMonCAPITest, WindowsReconfiguredWhileRead) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    const uint64_t windows[] = {100000000ULL, 1000000000ULL, 10000000000ULL};
+    ASSERT_EQ(PM_SUCCESS, pm_configure_windows(handle_, windows, 3));
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> failures(0);
+    std::thread reader([this, count, &stop, &failures]() {
+        std::vector<pm_stats_t> sensors(count);
+        while (!stop.load()) {
+            // The last window comes and goes; the first one is always there
+            pm_window_stats_t stats;
+            pm_get_window_statistics(handle_, 2, &stats, sensors.data(), count);
+            if (pm_get_window_statistics(handle_, 0, &stats, sensors.data(), count) != PM_SUCCESS) {
+                failures++;
+            }
+        }
+    });
+
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_EQ(PM_SUCCESS, pm_configure_windows(handle_, windows, 1 + i % 3));
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(0, failures.load());
+}
+
+// Test case: Rollup tiers keep bounded, aligned buckets that add up to the statistics
+TEST_F(JetPwMonCAPITest, RollupTiers) {
+    std::vector<pm_rollup_point_t> points(64);
+    int read = 0;
+
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_read_rollup(handle_, 0, -1, 0, UINT64_MAX, points.data(), 64, &read));
+    const pm_rollup_tier_t invalid[] = {{0, 10}};
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_configure_rollups(handle_, invalid, 1));
+
+    const uint64_t fine = 20000000ULL;  // 20 ms
+    const pm_rollup_tier_t tiers[] = {{fine, 4}, {3600ULL * 1000000000ULL, 10}};
+    ASSERT_EQ(PM_SUCCESS, pm_configure_rollups(handle_, tiers, 2));
+    pm_rollup_tier_t config;
+    ASSERT_EQ(PM_SUCCESS, pm_get_rollup_tier(handle_, 1, &config));
+    EXPECT_EQ(10, config.capacity);
+
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle_, 200));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle_));
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_configure_rollups(handle_, tiers, 2));
+    SleepForSampling(300);
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle_));
+
+    // The fine tier only keeps its last 4 buckets, in order and aligned
+    ASSERT_EQ(PM_SUCCESS, pm_read_rollup(handle_, 0, -1, 0, UINT64_MAX, points.data(), 64, &read));
+    ASSERT_GT(read, 0);
+    EXPECT_LE(read, 4);
+    for (int i = 0; i < read; ++i) {
+        EXPECT_EQ(0u, points[i].start_ns % fine);
+        if (i > 0) {
+            EXPECT_GT(points[i].start_ns, points[i - 1].start_ns);
+        }
+    }
+
+    // A range starting at the newest bucket returns only that one
+    uint64_t newest = points[read - 1].start_ns;
+    ASSERT_EQ(PM_SUCCESS, pm_read_rollup(handle_, 0, -1, newest, UINT64_MAX, points.data(), 64, &read));
+    EXPECT_EQ(1, read);
+
+    // The coarse tier holds every tick of the run
+    pm_power_stats_t stats;
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    std::vector<pm_sensor_stats_t> sensors(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(handle_, &stats, sensors.data(), count, nullptr));
+    for (int sensor = -1; sensor < count; ++sensor) {
+        const pm_sensor_stats_t &expected = sensor < 0 ? stats.total : sensors[sensor];
+        ASSERT_EQ(PM_SUCCESS, pm_read_rollup(handle_, 1, sensor, 0, UINT64_MAX, points.data(), 64, &read));
+        uint64_t samples = 0;
+        double energy = 0.0;
+        for (int i = 0; i < read; ++i) {
+            samples += points[i].count;
+            energy += points[i].energy;
+        }
+        EXPECT_EQ(expected.power.count, samples);
+        EXPECT_NEAR(expected.energy, energy, 1e-9);
+    }
+}
+
+// Test case: Reconfiguring the tiers never pulls them from under a reader
+TEST_F(JetPwMonCAPITest, RollupsReconfiguredWhileRead) {
+    const pm_rollup_tier_t tiers[] = {{1000000ULL, 8}, {10000000ULL, 16}, {100000000ULL, 32}};
+    ASSERT_EQ(PM_SUCCESS, pm_configure_rollups(handle_, tiers, 3));
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> failures(0);
+    std::thread reader([this, &stop, &failures]() {
+        std::vector<pm_rollup_point_t> points(32);
+        while (!stop.load()) {
+            // The last tier comes and goes; the first one is always there
+            int read = 0;
+            pm_rollup_tier_t config;
+            pm_read_rollup(handle_, 2, -1, 0, UINT64_MAX, points.data(), 32, &read);
+            if (pm_read_rollup(handle_, 0, -1, 0, UINT64_MAX, points.data(), 32, &read) != PM_SUCCESS ||
+                pm_get_rollup_tier(handle_, 0, &config) != PM_SUCCESS || config.capacity != 8) {
+                failures++;
+            }
+        }
+    });
+
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_EQ(PM_SUCCESS, pm_configure_rollups(handle_, tiers, 1 + i % 3));
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(0, failures.load());
+}
+
+// Test case: Sessions measure their own intervals regardless of resets and each other
+TEST_F(JetPwMonCAPITest, MeasurementSessions) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    std::vector<pm_sensor_stats_t> sensors(count);
+    pm_power_stats_t stats;
+
+    pm_session_t first = nullptr, second = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_session_open(handle_, &first));
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_session_open(handle_, &second));
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+
+    // A global reset does not disturb the sessions
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+
+    EXPECT_EQ(PM_ERROR_MEMORY, pm_session_read(handle_, first, &stats, sensors.data(), count - 1, false));
+    ASSERT_EQ(PM_SUCCESS, pm_session_read(handle_, first, &stats, sensors.data(), count, false));
+    EXPECT_EQ(6u, stats.total.power.count);
+    ASSERT_GT(count, 0);
+    EXPECT_EQ(6u, sensors[0].power.count);
+    EXPECT_STREQ("Total", stats.total.name);
+    EXPECT_LE(stats.total.power.min, stats.total.power.avg);
+    EXPECT_GE(stats.total.power.max, stats.total.power.avg);
+    EXPECT_GT(stats.total.energy, 0.0);
+    EXPECT_NEAR(stats.total.power.avg, stats.total.avg_power, 1e-6 * stats.total.power.avg);
+
+    ASSERT_EQ(PM_SUCCESS, pm_session_read(handle_, second, &stats, sensors.data(), count, false));
+    EXPECT_EQ(3u, stats.total.power.count);
+
+    pm_power_stats_t global;
+    std::vector<pm_sensor_stats_t> global_sensors(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(handle_, &global, global_sensors.data(), count, nullptr));
+    EXPECT_EQ(1u, global.total.power.count);
+
+    // Read and restart: consecutive intervals add up to the whole run
+    uint64_t reported = 0;
+    for (int round = 0; round < 3; ++round) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+        ASSERT_EQ(PM_SUCCESS, pm_session_read(handle_, second, &stats, sensors.data(), count, true));
+        reported += stats.total.power.count;
+    }
+    EXPECT_EQ(6u, reported);
+    ASSERT_EQ(PM_SUCCESS, pm_session_read(handle_, second, &stats, sensors.data(), count, false));
+    EXPECT_EQ(0u, stats.total.power.count);
+    EXPECT_EQ(0.0, stats.total.energy);
+
+    ASSERT_EQ(PM_SUCCESS, pm_session_close(handle_, second));
+    ASSERT_EQ(PM_SUCCESS, pm_session_read(handle_, first, &stats, sensors.data(), count, false));
+    EXPECT_EQ(9u, stats.total.power.count);
+    EXPECT_EQ(PM_SUCCESS, pm_session_close(handle_, first));
+}
+
+// Test case: A second handle attached to the published segment reads the same data
+TEST_F(JetPwMonCAPITest, SharedMemoryPublication) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    const std::string name = "/jetpwmon_test_" + std::to_string(getpid());
+
+    pm_handle_t reader = nullptr;
+    EXPECT_EQ(PM_ERROR_FILE_ACCESS, pm_attach_shared(&reader, name.c_str()));
+
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(handle_, 64 * (count + 1), PM_OVERFLOW_DROP_OLDEST));
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_publish_shared(handle_, name.c_str()));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_configure_history(handle_, 0, PM_OVERFLOW_DROP_OLDEST));
+    ASSERT_EQ(PM_SUCCESS, pm_attach_shared(&reader, name.c_str()));
+
+    int reader_count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(reader, &reader_count));
+    ASSERT_EQ(count, reader_count);
+
+    // Every tick of the publisher is visible through the reader
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+        uint64_t published = 0, seen = 0;
+        ASSERT_EQ(PM_SUCCESS, pm_get_generation(handle_, &published));
+        ASSERT_EQ(PM_SUCCESS, pm_get_generation(reader, &seen));
+        EXPECT_EQ(published, seen);
+    }
+
+    pm_power_stats_t expected, actual;
+    std::vector<pm_sensor_stats_t> expected_sensors(count), actual_sensors(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(handle_, &expected, expected_sensors.data(), count, nullptr));
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(reader, &actual, actual_sensors.data(), count, nullptr));
+    EXPECT_EQ(expected.total.power.count, actual.total.power.count);
+    EXPECT_EQ(expected.total.energy, actual.total.energy);
+    for (int i = 0; i < count; ++i) {
+        EXPECT_STREQ(expected_sensors[i].name, actual_sensors[i].name);
+    }
+
+    pm_power_data_t data;
+    ASSERT_EQ(PM_SUCCESS, pm_get_latest_data(reader, &data));
+    EXPECT_EQ(count, data.sensor_count);
+
+    std::vector<pm_sample_t> buffer(1024);
+    uint64_t cursor = 0;
+    int read = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(reader, buffer.data(), 1024, &cursor, &read));
+    EXPECT_EQ(4 * (count + 1), read);
+
+    // The attached handle never drives the sampler
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_sample_now(reader));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_start_sampling(reader));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_reset_statistics(reader));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_set_sampling_frequency(reader, 10));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_publish_shared(reader, name.c_str()));
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(reader));
+
+    // The segment is removed with the publisher
+    ASSERT_EQ(PM_SUCCESS, pm_cleanup(handle_));
+    handle_ = nullptr;
+    EXPECT_EQ(PM_ERROR_FILE_ACCESS, pm_attach_shared(&reader, name.c_str()));
+}
+
+// Test case: A live publisher keeps its segment, a dead one's segment is replaced
+TEST_F(JetPwMonCAPITest, SharedMemoryOwnership) {
+    const std::string name = "/jetpwmon_test_" + std::to_string(getpid()) + "_owner";
+    pm_config_t config = {};
+    config.synthetic = "a=const:1@5";
+
+    // A publisher that exits without pm_cleanup() leaves its segment behind
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        pm_handle_t publisher = nullptr;
+        bool published = pm_init_config(&publisher, &config) == PM_SUCCESS &&
+                         pm_publish_shared(publisher, name.c_str()) == PM_SUCCESS;
+        _exit(published ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    pm_handle_t first = nullptr, second = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&first, &config));
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&second, &config));
+    EXPECT_EQ(PM_SUCCESS, pm_publish_shared(first, name.c_str()));
+    EXPECT_EQ(PM_ERROR_FILE_ACCESS, pm_publish_shared(second, name.c_str()));
+
+    // Readers map the segment read-only, so they cannot hold back DROP_NEWEST
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(second, 16, PM_OVERFLOW_DROP_NEWEST));
+    EXPECT_EQ(PM_ERROR_NOT_SUPPORTED, pm_publish_shared(second, (name + "_newest").c_str()));
+
+    // The reader counts what it lost in its own handle
+    ASSERT_EQ(PM_SUCCESS, pm_cleanup(first));
+    ASSERT_EQ(PM_SUCCESS, pm_configure_history(second, 4, PM_OVERFLOW_DROP_OLDEST));
+    ASSERT_EQ(PM_SUCCESS, pm_publish_shared(second, name.c_str()));
+    pm_handle_t reader = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_attach_shared(&reader, name.c_str()));
+    pm_sample_t samples[4];
+    uint64_t cursor = 0;
+    int read = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(second));
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(reader, samples, 1, &cursor, &read));
+    ASSERT_EQ(1, read);
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(second));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_read_samples(reader, samples, 4, &cursor, &read));
+    pm_history_stats_t reader_stats, publisher_stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_history_stats(reader, &reader_stats));
+    ASSERT_EQ(PM_SUCCESS, pm_get_history_stats(second, &publisher_stats));
+    EXPECT_EQ(3u, reader_stats.lost);
+    EXPECT_EQ(0u, publisher_stats.lost);
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(reader));
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(second));
+
+    // A publisher that died before claiming its segment leaves it empty
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    pm_handle_t third = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&third, &config));
+    EXPECT_EQ(PM_SUCCESS, pm_publish_shared(third, name.c_str()));
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(third));
+}
+
+// Test case: Recording ticks to a file indexed by block
+TEST_F(JetPwMonCAPITest, Recording) {
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    const std::string path = "/tmp/jetpwmon_test_" + std::to_string(getpid()) + ".rec";
+
+    EXPECT_EQ(PM_ERROR_NOT_RUNNING, pm_record_stop(handle_));
+    EXPECT_EQ(PM_ERROR_FILE_ACCESS, pm_record_start(handle_, "/nonexistent/dir/file.rec"));
+    ASSERT_EQ(PM_SUCCESS, pm_record_start(handle_, path.c_str()));
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_record_start(handle_, path.c_str()));
+
+    const int ticks = 5;
+    for (int tick = 0; tick < ticks; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_record_stop(handle_));
+
+    pm_record_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_record_stats(handle_, &stats));
+    EXPECT_FALSE(stats.recording);
+    EXPECT_EQ(static_cast<uint64_t>(ticks), stats.ticks);
+    EXPECT_EQ(1u, stats.blocks);
+    EXPECT_EQ(0u, stats.dropped);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    struct stat st;
+    ASSERT_EQ(0, fstat(fd, &st));
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    ASSERT_NE(MAP_FAILED, map);
+    const char *file = static_cast<const char *>(map);
+
+    // The header describes the rails and the block layout
+    const pm_record_header_t *header = reinterpret_cast<const pm_record_header_t *>(file);
+    EXPECT_STREQ(PM_RECORD_MAGIC, header->magic);
+    EXPECT_EQ(static_cast<uint32_t>(PM_RECORD_VERSION), header->version);
+    ASSERT_EQ(static_cast<uint32_t>(count), header->rail_count);
+    ASSERT_EQ(static_cast<off_t>(header->header_size + header->block_size), st.st_size);
+    const pm_record_rail_t *rails = reinterpret_cast<const pm_record_rail_t *>(file + sizeof(pm_record_header_t));
+    char *names[64];
+    char name_storage[64][64];
+    int name_count = 64;
+    for (int i = 0; i < 64; ++i) names[i] = name_storage[i];
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_names(handle_, names, &name_count));
+    for (int i = 0; i < count; ++i) {
+        EXPECT_STREQ(names[i], rails[i].name);
+    }
+
+    // The footer at the end of the block indexes its ticks
+    const char *block = file + header->header_size;
+    const pm_record_footer_t *footer = reinterpret_cast<const pm_record_footer_t *>(
+        block + header->block_size - header->footer_size);
+    EXPECT_EQ(PM_RECORD_BLOCK_MAGIC, footer->magic);
+    EXPECT_EQ(0u, footer->block);
+    EXPECT_EQ(static_cast<uint32_t>(ticks), footer->tick_count);
+    EXPECT_LE(footer->first_ns, footer->last_ns);
+    EXPECT_GE(footer->first_ns, header->start_monotonic_ns);
+
+    uint32_t previous = 0;
+    for (int tick = 0; tick < ticks; ++tick) {
+        const pm_record_tick_t *record = reinterpret_cast<const pm_record_tick_t *>(block + tick * header->tick_size);
+        EXPECT_GE(record->offset_us, previous);
+        previous = record->offset_us;
+    }
+    EXPECT_EQ((footer->last_ns - footer->first_ns) / 1000, previous);
+
+    munmap(map, st.st_size);
+    unlink(path.c_str());
+}
+
+// Test case: Replaying a CSV trace and a recording of it as virtual sensors
+TEST_F(JetPwMonCAPITest, Replay) {
+    const std::string csv = "/tmp/jetpwmon_test_" + std::to_string(getpid()) + ".csv";
+    const std::string rec = "/tmp/jetpwmon_test_" + std::to_string(getpid()) + "_replay.rec";
+    FILE *fp = fopen(csv.c_str(), "w");
+    ASSERT_NE(nullptr, fp);
+    fputs("# VDD_SOC goes offline in the last row\n"
+          "time_s,VDD_IN_V,VDD_IN_A,VDD_SOC_V,VDD_SOC_A\n"
+          "0.0,5,1,1,0.5\n"
+          "0.5,5,2,1,0.5\n"
+          "1.0,5,2,,\n", fp);
+    fclose(fp);
+
+    pm_config_t config = {};
+    config.replay_path = "/nonexistent.csv";
+    pm_handle_t replay = nullptr;
+    EXPECT_EQ(PM_ERROR_FILE_ACCESS, pm_init_config(&replay, &config));
+
+    // Step mode advances one recorded tick per sample
+    config.replay_path = csv.c_str();
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&replay, &config));
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(replay, &count));
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(PM_SUCCESS, pm_record_start(replay, rec.c_str()));
+
+    const double expected_power[3] = {5.0, 10.0, 10.0};
+    pm_power_data_t data;
+    pm_sensor_data_t sensors[2];
+    for (int tick = 0; tick < 3; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(replay));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(replay, &data, sensors, 2, nullptr));
+        EXPECT_STREQ("VDD_IN", sensors[0].name);
+        EXPECT_DOUBLE_EQ(expected_power[tick], sensors[0].power);
+        EXPECT_DOUBLE_EQ(expected_power[tick], data.total.power);
+        EXPECT_EQ(tick < 2, sensors[1].online);
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_record_stop(replay));
+
+    // Energy integrates over the trace clock
+    pm_power_stats_t stats;
+    pm_sensor_stats_t sensor_stats[2];
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(replay, &stats, sensor_stats, 2, nullptr));
+    EXPECT_NEAR(8.75, stats.total.energy, 1e-9);
+    EXPECT_NEAR(1.0, stats.total.duration, 1e-9);
+    EXPECT_NEAR(0.25, sensor_stats[1].energy, 1e-9);
+
+    // Past the end of the trace the rails are offline
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(replay));
+    ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(replay, &data, sensors, 2, nullptr));
+    EXPECT_FALSE(sensors[0].online);
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(replay));
+
+    // The recording replays the same ticks, looped
+    config.replay_path = rec.c_str();
+    config.replay_loop = true;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&replay, &config));
+    for (int tick = 0; tick < 6; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(replay));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(replay, &data, sensors, 2, nullptr));
+        EXPECT_DOUBLE_EQ(expected_power[tick % 3], sensors[0].power);
+        EXPECT_EQ(tick % 3 < 2, sensors[1].online);
+    }
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(replay));
+
+    unlink(csv.c_str());
+    unlink(rec.c_str());
+}
+
+// Test case: Synthetic waveforms generated in memory at a high rate
+TEST_F(JetPwMonCAPITest, Synthetic) {
+    pm_config_t config = {};
+    pm_handle_t synthetic = nullptr;
+    const char *malformed[] = {"", "VDD_IN", "VDD_IN=sine:1,2", "VDD_IN=square:1", "VDD_IN=const:1@0"};
+    for (const char *spec : malformed) {
+        config.synthetic = spec;
+        EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_init_config(&synthetic, &config)) << spec;
+    }
+
+    config.synthetic = "VDD_IN=const:6@12;VDD_GPU=step:1,3,1000;VDD_SOC=walk:2,0.5,4";
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&synthetic, &config));
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(synthetic, &count));
+    ASSERT_EQ(3, count);
+
+    // The first half period of a step is low, the walk stays within its bounds
+    pm_power_data_t data;
+    pm_sensor_data_t sensors[3];
+    for (int tick = 0; tick < 100; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(synthetic));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(synthetic, &data, sensors, 3, nullptr));
+        EXPECT_STREQ("VDD_IN", sensors[0].name);
+        EXPECT_DOUBLE_EQ(12.0, sensors[0].voltage);
+        EXPECT_DOUBLE_EQ(0.5, sensors[0].current);
+        EXPECT_DOUBLE_EQ(6.0, data.total.power);
+        EXPECT_DOUBLE_EQ(1.0, sensors[1].power);
+        EXPECT_GE(sensors[2].power, 0.0);
+        EXPECT_LE(sensors[2].power, 4.0);
+    }
+
+    // Sampling without file I/O keeps up with a 10 kHz period
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(synthetic));
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_period_ns(synthetic, 100000));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(synthetic));
+    SleepForSampling(200);
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(synthetic));
+    pm_power_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_statistics(synthetic, &stats));
+    EXPECT_GT(stats.total.power.count, 100u);
+    EXPECT_DOUBLE_EQ(6.0, stats.total.power.avg);
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(synthetic));
+}
+
+// Test case: Recording synthetic rails keeps their readings in mV and mA counts
+TEST_F(JetPwMonCAPITest, SyntheticRecording) {
+    const std::string rec = "/tmp/jetpwmon_test_" + std::to_string(getpid()) + "_synthetic.rec";
+    pm_config_t config = {};
+    config.synthetic = "a=const:3.3@5;b=sine:2,1,1";
+    pm_handle_t synthetic = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&synthetic, &config));
+    ASSERT_EQ(PM_SUCCESS, pm_record_start(synthetic, rec.c_str()));
+
+    const int ticks = 20;
+    std::vector<double> recorded;
+    pm_power_data_t data;
+    pm_sensor_data_t sensors[2];
+    for (int tick = 0; tick < ticks; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(synthetic));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(synthetic, &data, sensors, 2, nullptr));
+        recorded.push_back(sensors[0].power);
+        recorded.push_back(sensors[1].power);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_record_stop(synthetic));
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(synthetic));
+
+    // The replay matches the generated power to the resolution of a mA
+    config = {};
+    config.replay_path = rec.c_str();
+    config.replay_speed = 0.0;
+    pm_handle_t replay = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&replay, &config));
+    for (int tick = 0; tick < ticks; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(replay));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(replay, &data, sensors, 2, nullptr));
+        EXPECT_NEAR(3.3, sensors[0].power, 1e-9) << tick;
+        EXPECT_DOUBLE_EQ(5.0, sensors[0].voltage);
+        EXPECT_NEAR(recorded[2 * tick + 1], sensors[1].power, 0.005) << tick;
+    }
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(replay));
+    unlink(rec.c_str());
+}
+
+// Test case: Discovery and readings on simulated boards, one root per handle
+TEST(JetPwMonSimTest, SimulatedBoards) {
+    const pm_sim_board_t boards[] = {PM_SIM_BOARD_ORIN, PM_SIM_BOARD_XAVIER, PM_SIM_BOARD_NANO};
+    const int expected_rails[] = {4, 6, 3};
+    for (int b = 0; b < 3; ++b) {
+        pm_sim_t sim = pm_sim_create(boards[b], nullptr);
+        ASSERT_NE(nullptr, sim);
+        ASSERT_EQ(expected_rails[b], pm_sim_rail_count(sim));
+
+        pm_config_t config = {};
+        config.sysfs_root = pm_sim_root(sim);
+        pm_handle_t handle = nullptr;
+        ASSERT_EQ(PM_SUCCESS, pm_init_config(&handle, &config));
+
+        // NC channels and the hwmon sum channel are skipped
+        int count = 0;
+        ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle, &count));
+        ASSERT_EQ(pm_sim_rail_count(sim), count);
+        std::vector<pm_sensor_data_t> sensors(count);
+        pm_power_data_t data;
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(handle, &data, sensors.data(), count, nullptr));
+        std::vector<std::string> names;
+        for (int i = 0; i < count; ++i) {
+            names.push_back(sensors[i].name);
+            EXPECT_TRUE(sensors[i].online) << sensors[i].name;
+        }
+
+        // Readings follow the tree
+        ASSERT_EQ(0, pm_sim_set_rail(sim, 0, 5000, 2000));
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle));
+        ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(handle, &data, sensors.data(), count, nullptr));
+        for (int rail = 0; rail < count; ++rail) {
+            auto it = std::find(names.begin(), names.end(), pm_sim_rail_name(sim, rail));
+            ASSERT_NE(names.end(), it) << pm_sim_rail_name(sim, rail);
+            if (rail == 0) {
+                EXPECT_DOUBLE_EQ(10.0, sensors[it - names.begin()].power);
+            }
+        }
+
+        EXPECT_EQ(PM_SUCCESS, pm_cleanup(handle));
+        pm_sim_destroy(sim);
+    }
+}
+
+// Test case: Rails reused from the discovery cache of this boot
+TEST(JetPwMonSimTest, DiscoveryCache) {
+    pm_sim_t sim = pm_sim_create(PM_SIM_BOARD_XAVIER, nullptr);
+    ASSERT_NE(nullptr, sim);
+    std::string cache = std::string(pm_sim_root(sim)) + "/discovery.cache";
+    pm_config_t config = {};
+    config.sysfs_root = pm_sim_root(sim);
+    config.discovery_cache = cache.c_str();
+
+    auto rail_names = [&config]() {
+        std::vector<std::string> names;
+        pm_handle_t handle = nullptr;
+        EXPECT_EQ(PM_SUCCESS, pm_init_config(&handle, &config));
+        if (!handle) return names;
+        int count = 0;
+        EXPECT_EQ(PM_SUCCESS, pm_get_sensor_count(handle, &count));
+        std::vector<pm_sensor_data_t> sensors(count);
+        pm_power_data_t data;
+        EXPECT_EQ(PM_SUCCESS, pm_sample_now(handle));
+        EXPECT_EQ(PM_SUCCESS, pm_read_latest_data(handle, &data, sensors.data(), count, nullptr));
+        for (int i = 0; i < count; ++i) {
+            EXPECT_TRUE(sensors[i].online) << sensors[i].name;
+            names.push_back(sensors[i].name);
+        }
+        EXPECT_EQ(PM_SUCCESS, pm_cleanup(handle));
+        return names;
+    };
+    auto rename_in_cache = [&cache](const std::string& from, const std::string& to) {
+        FILE* fp = std::fopen(cache.c_str(), "r+b");
+        ASSERT_NE(nullptr, fp);
+        std::vector<char> bytes(1 << 20);
+        bytes.resize(std::fread(bytes.data(), 1, bytes.size(), fp));
+        auto it = std::search(bytes.begin(), bytes.end(), from.c_str(), from.c_str() + from.size() + 1);
+        ASSERT_NE(bytes.end(), it);
+        std::fseek(fp, static_cast<long>(it - bytes.begin()), SEEK_SET);
+        std::fwrite(to.c_str(), 1, to.size() + 1, fp);
+        std::fclose(fp);
+    };
+
+    // The first scan writes the cache
+    std::vector<std::string> scanned = rail_names();
+    ASSERT_EQ(6u, scanned.size());
+    struct stat st;
+    ASSERT_EQ(0, stat(cache.c_str(), &st));
+
+    // Later handles take the rails from it without scanning
+    rename_in_cache("VDDRQ", "VDDRX");
+    std::vector<std::string> cached = rail_names();
+    ASSERT_EQ(scanned.size(), cached.size());
+    EXPECT_NE(cached.end(), std::find(cached.begin(), cached.end(), "VDDRX"));
+    EXPECT_EQ(cached.end(), std::find(cached.begin(), cached.end(), "VDDRQ"));
+
+    // A cache others can write is rescanned and rewritten
+    ASSERT_EQ(0, chmod(cache.c_str(), 0666));
+    EXPECT_EQ(scanned, rail_names());
+    ASSERT_EQ(0, stat(cache.c_str(), &st));
+    EXPECT_EQ(0644u, st.st_mode & 0777);
+
+    // So is a corrupted one
+    rename_in_cache("JPWMDSC", "JUNK");
+    EXPECT_EQ(scanned, rail_names());
+    rename_in_cache("VDDRQ", "VDDRX");
+    EXPECT_NE(scanned, rail_names());
+
+    // Another root does not share the cache
+    pm_sim_t other = pm_sim_create(PM_SIM_BOARD_NANO, nullptr);
+    ASSERT_NE(nullptr, other);
+    config.sysfs_root = pm_sim_root(other);
+    EXPECT_EQ(3u, rail_names().size());
+
+    pm_sim_destroy(other);
+    pm_sim_destroy(sim);
+}
+
+// Test case: Sampling a tree updated by the writer thread through slow reads
+TEST(JetPwMonSimTest, WriterAndLatency) {
+    pm_sim_t sim = pm_sim_create(PM_SIM_BOARD_NANO, nullptr);
+    ASSERT_NE(nullptr, sim);
+    pm_config_t config = {};
+    config.sysfs_root = pm_sim_root(sim);
+    pm_handle_t handle = nullptr;
+    ASSERT_EQ(PM_SUCCESS, pm_init_config(&handle, &config));
+    ASSERT_EQ(PM_SUCCESS, pm_set_io_backend(handle, PM_IO_BACKEND_PREAD));
+
+    // Every tick reads two attributes per rail
+    pm_sim_set_latency(pm_sim_root(sim), 2000000);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(12));
+    pm_sim_set_latency(nullptr, 0);
+
+    // The readings move while sampling
+    ASSERT_EQ(0, pm_sim_start(sim, 1000));
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle));
+    ASSERT_EQ(PM_SUCCESS, pm_set_sampling_frequency(handle, 200));
+    ASSERT_EQ(PM_SUCCESS, pm_start_sampling(handle));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_EQ(PM_SUCCESS, pm_stop_sampling(handle));
+    pm_sim_stop(sim);
+    EXPECT_GT(pm_sim_updates(sim), 10u);
+
+    pm_power_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_statistics(handle, &stats));
+    EXPECT_GT(stats.total.power.count, 10u);
+    EXPECT_LT(stats.total.power.min, stats.total.power.max);
+
+    EXPECT_EQ(PM_SUCCESS, pm_cleanup(handle));
+    pm_sim_destroy(sim);
+}
+
+// Test case: Code region markers joined against the sampled energy
+TEST_F(JetPwMonCAPITest, CodeRegions) {
+    int outer = -1, inner = -1, again = -1;
+    ASSERT_EQ(PM_SUCCESS, pm_region_register(handle_, "outer", &outer));
+    ASSERT_EQ(PM_SUCCESS, pm_region_register(handle_, "inner", &inner));
+    ASSERT_EQ(PM_SUCCESS, pm_region_register(handle_, "outer", &again));
+    EXPECT_EQ(outer, again);
+    EXPECT_NE(outer, inner);
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_region_begin(handle_, 99));
+
+    // An end without a begin is counted as dropped
+    ASSERT_EQ(PM_SUCCESS, pm_region_end(handle_, inner));
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+
+    // Nested regions spanning several ticks
+    ASSERT_EQ(PM_SUCCESS, pm_region_begin(handle_, outer));
+    SleepForSampling(20);
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_region_begin(handle_, inner));
+    SleepForSampling(10);
+    ASSERT_EQ(PM_SUCCESS, pm_region_end(handle_, inner));
+    SleepForSampling(10);
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    SleepForSampling(10);
+    ASSERT_EQ(PM_SUCCESS, pm_region_end(handle_, outer));
+
+    // Not resolved until a tick past the end
+    pm_region_stats_t stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_region_stats(handle_, outer, &stats));
+    EXPECT_EQ(0u, stats.count);
+    EXPECT_EQ(1u, stats.active);
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+
+    pm_region_stats_t inner_stats;
+    ASSERT_EQ(PM_SUCCESS, pm_get_region_stats(handle_, outer, &stats));
+    ASSERT_EQ(PM_SUCCESS, pm_get_region_stats(handle_, inner, &inner_stats));
+    EXPECT_STREQ("outer", stats.name);
+    EXPECT_EQ(1u, stats.count);
+    EXPECT_EQ(0u, stats.active);
+    EXPECT_EQ(1u, inner_stats.count);
+    EXPECT_EQ(1u, inner_stats.dropped);
+    EXPECT_GE(stats.duration_ns, 40000000u);
+    EXPECT_GE(inner_stats.duration_ns, 10000000u);
+    EXPECT_LT(inner_stats.duration_ns, stats.duration_ns);
+
+    // The fake rails are constant, so every region sees the same power
+    pm_power_data_t data;
+    ASSERT_EQ(PM_SUCCESS, pm_get_latest_data(handle_, &data));
+    double power = data.total.power;
+    EXPECT_NEAR(power, stats.avg_power, 1e-6 * power);
+    EXPECT_NEAR(power, inner_stats.avg_power, 1e-6 * power);
+    EXPECT_DOUBLE_EQ(power, stats.peak_power);
+    EXPECT_GT(stats.energy, inner_stats.energy);
+
+    // Markers from several threads are all joined
+    int shared = -1;
+    ASSERT_EQ(PM_SUCCESS, pm_region_register(handle_, "shared", &shared));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this, shared]() {
+            for (int i = 0; i < 100; ++i) {
+                pm_region_begin(handle_, shared);
+                pm_region_end(handle_, shared);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_get_region_stats(handle_, shared, &stats));
+    EXPECT_EQ(400u, stats.count);
+    EXPECT_EQ(0u, stats.active);
+    EXPECT_EQ(0u, stats.dropped);
+
+    int regions = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_region_count(handle_, &regions));
+    EXPECT_EQ(3, regions);
+}
+
+// Test case: Streaming power histograms, quantiles and merging
+TEST_F(JetPwMonCAPITest, PowerHistogram) {
+    pm_histogram_t histogram;
+    double value = 0.0;
+
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_get_power_histogram(handle_, -2, &histogram));
+    ASSERT_EQ(PM_SUCCESS, pm_get_power_histogram(handle_, -1, &histogram));
+    EXPECT_EQ(0u, histogram.count);
+    ASSERT_EQ(PM_SUCCESS, pm_histogram_quantile(&histogram, 0.99, PM_WEIGHT_SAMPLES, &value));
+    EXPECT_EQ(0.0, value);
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_histogram_quantile(&histogram, 1.5, PM_WEIGHT_SAMPLES, &value));
+
+    for (int tick = 0; tick < 5; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+        SleepForSampling(10);
+    }
+
+    pm_power_data_t data;
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    std::vector<pm_sensor_data_t> sensors(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_latest_data(handle_, &data, sensors.data(), count, nullptr));
+    if (!data.total.online) {
+        GTEST_SKIP() << "Total power is offline on this system.";
+    }
+
+    ASSERT_EQ(PM_SUCCESS, pm_get_power_histogram(handle_, -1, &histogram));
+    EXPECT_EQ(5u, histogram.count);
+    EXPECT_GT(histogram.duration, 0.035);
+
+    // The fake sensors are constant, so every quantile is that power within the bin width
+    for (double q : {0.0, 0.5, 0.99, 1.0}) {
+        ASSERT_EQ(PM_SUCCESS, pm_histogram_quantile(&histogram, q, PM_WEIGHT_SAMPLES, &value));
+        EXPECT_NEAR(data.total.power, value, data.total.power * 0.01);
+        ASSERT_EQ(PM_SUCCESS, pm_histogram_quantile(&histogram, q, PM_WEIGHT_TIME, &value));
+        EXPECT_NEAR(data.total.power, value, data.total.power * 0.01);
+    }
+
+    // Histograms taken before a reset can be merged with the ones after it
+    pm_histogram_t before = histogram;
+    ASSERT_EQ(PM_SUCCESS, pm_reset_statistics(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_get_power_histogram(handle_, -1, &histogram));
+    EXPECT_EQ(0u, histogram.count);
+    ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    ASSERT_EQ(PM_SUCCESS, pm_get_power_histogram(handle_, -1, &histogram));
+    ASSERT_EQ(PM_SUCCESS, pm_histogram_merge(&histogram, &before));
+    EXPECT_EQ(6u, histogram.count);
+    ASSERT_EQ(PM_SUCCESS, pm_histogram_quantile(&histogram, 0.5, PM_WEIGHT_SAMPLES, &value));
+    EXPECT_NEAR(data.total.power, value, data.total.power * 0.01);
+}
+
+// Test case: Variance of collected statistics and merging of intervals
+TEST_F(JetPwMonCAPITest, StatisticsVarianceAndMerge) {
+    for (int tick = 0; tick < 4; ++tick) {
+        ASSERT_EQ(PM_SUCCESS, pm_sample_now(handle_));
+    }
+
+    pm_power_stats_t stats;
+    int count = 0;
+    ASSERT_EQ(PM_SUCCESS, pm_get_sensor_count(handle_, &count));
+    std::vector<pm_sensor_stats_t> sensors(count);
+    ASSERT_EQ(PM_SUCCESS, pm_read_statistics(handle_, &stats, sensors.data(), count, nullptr));
+    if (stats.total.power.count > 0) {
+        // The fake sensors are constant
+        EXPECT_NEAR(0.0, stats.total.power.stddev, 1e-9);
+        EXPECT_NEAR(stats.total.power.avg * stats.total.power.count, stats.total.power.total, 1e-9);
+    }
+
+    // {0, 2} merged with {4, 6}
+    pm_stats_t a = {};
+    a.min = 0.0; a.max = 2.0; a.avg = 1.0; a.total = 2.0; a.count = 2; a.m2 = 2.0;
+    pm_stats_t b = {};
+    b.min = 4.0; b.max = 6.0; b.avg = 5.0; b.total = 10.0; b.count = 2; b.m2 = 2.0;
+    ASSERT_EQ(PM_SUCCESS, pm_stats_merge(&a, &b));
+    EXPECT_EQ(4u, a.count);
+    EXPECT_DOUBLE_EQ(0.0, a.min);
+    EXPECT_DOUBLE_EQ(6.0, a.max);
+    EXPECT_DOUBLE_EQ(3.0, a.avg);
+    EXPECT_DOUBLE_EQ(12.0, a.total);
+    EXPECT_DOUBLE_EQ(20.0, a.m2);
+    EXPECT_DOUBLE_EQ(20.0 / 3.0, a.variance);
+
+    // Merging into an empty interval copies, merging an empty one changes nothing
+    pm_stats_t empty = {};
+    ASSERT_EQ(PM_SUCCESS, pm_stats_merge(&empty, &a));
+    EXPECT_DOUBLE_EQ(a.variance, empty.variance);
+    pm_stats_t none = {};
+    ASSERT_EQ(PM_SUCCESS, pm_stats_merge(&a, &none));
+    EXPECT_EQ(4u, a.count);
+    EXPECT_EQ(PM_ERROR_INIT_FAILED, pm_stats_merge(&a, nullptr));
+}
+
+// Test case: Selecting the I/O backend and taking synchronous samples
+TEST_F(JetPwMonCAPITest, IoBackendSelection) {
+    const pm_io_backend_t backends[] = {PM_IO_BACKEND_STDIO, PM_IO_BACKEND_PREAD, PM_IO_BACKEND_IO_URING};
+    pm_error_t err;
+
+    for (pm_io_backend_t backend : backends) {
+        err = pm_set_io_backend(handle_, backend);
+        ASSERT_EQ(PM_SUCCESS, err) << "Failed to set I/O backend " << backend << ": " << pm_error_string(err);
+
+        err = pm_sample_now(handle_);
+        ASSERT_EQ(PM_SUCCESS, err) << "pm_sample_now failed with backend " << backend << ": " << pm_error_string(err);
+
+        // io_uring may be unavailable at runtime, in which case pread() is used
+        pm_io_backend_t active;
+        err = pm_get_io_backend(handle_, &active);
+        ASSERT_EQ(PM_SUCCESS, err);
+        if (backend == PM_IO_BACKEND_IO_URING) {
+            EXPECT_TRUE(active == PM_IO_BACKEND_IO_URING || active == PM_IO_BACKEND_PREAD);
+        } else {
+            EXPECT_EQ(backend, active);
+        }
+    }
+
+    // The backend cannot change under the sampling thread
+    err = pm_start_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err);
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_set_io_backend(handle_, PM_IO_BACKEND_PREAD));
+    EXPECT_EQ(PM_ERROR_ALREADY_RUNNING, pm_sample_now(handle_));
+    err = pm_stop_sampling(handle_);
+    ASSERT_EQ(PM_SUCCESS, err);
+}
+
 // Test case: Sensor information retrieval (count)
 TEST_F(JetPwMonCAPITest, SensorInfo) {
     pm_error_t err;
@@ -247,6 +247,102 @@ TEST_F(JetPwMonCPPAPITest, SensorInfo) {
         }) << "Test setup failed during PowerMonitor creation";
 }
 
+// Test case: Draining the sample history through the C++ API
+TEST_F(JetPwMonCPPAPITest, SampleHistory)
+{
+        ASSERT_NO_THROW({
+                jetpwmon::PowerMonitor monitor;
+                uint64_t cursor = 0;
+
+                // Reading before the history is configured is an error
+                EXPECT_THROW(monitor.readSamples(cursor), std::runtime_error);
+
+                monitor.configureHistory(1024);
+                monitor.setSamplingFrequency(100);
+                monitor.startSampling();
+                SleepForSampling(100);
+                monitor.stopSampling();
+
+                std::vector<pm_sample_t> samples = monitor.readSamples(cursor);
+                EXPECT_FALSE(samples.empty()) << "No samples recorded while sampling.";
+                EXPECT_EQ(samples.size(), cursor);
+
+                pm_history_stats_t stats = monitor.getHistoryStats();
+                EXPECT_EQ(1024, stats.capacity);
+                EXPECT_EQ(stats.written, cursor);
+        }) << "Test setup failed during PowerMonitor creation";
+}
+
+// Test case: Sliding window statistics through the wrapper
+TEST_F(JetPwMonCPPAPITest, WindowStatistics)
+{
+        ASSERT_NO_THROW({
+                jetpwmon::PowerMonitor monitor;
+
+                // Reading a window that was not configured is an error
+                EXPECT_THROW(monitor.getWindowStatistics(0), std::runtime_error);
+
+                monitor.configureWindows({2000000000ULL});
+                monitor.setSamplingFrequency(100);
+                monitor.startSampling();
+                SleepForSampling(100);
+                monitor.stopSampling();
+
+                jetpwmon::WindowStats stats = monitor.getWindowStatistics(0);
+                EXPECT_EQ(2000000000ULL, stats.getWindowNs());
+                EXPECT_EQ(monitor.getSensorCount(), stats.getSensorCount());
+                EXPECT_LE(stats.getTotal().min, stats.getTotal().max);
+                EXPECT_THROW(monitor.getWindowStatistics(1), std::runtime_error);
+        }) << "Test setup failed during PowerMonitor creation";
+}
+
+// Test case: Power quantiles through the wrapper
+TEST_F(JetPwMonCPPAPITest, PowerQuantiles)
+{
+        ASSERT_NO_THROW({
+                jetpwmon::PowerMonitor monitor;
+
+                EXPECT_THROW(monitor.getPowerHistogram(monitor.getSensorCount()), std::runtime_error);
+                EXPECT_THROW(monitor.getPowerQuantile(-1, -0.1), std::runtime_error);
+
+                monitor.setSamplingFrequency(100);
+                monitor.startSampling();
+                SleepForSampling(100);
+                monitor.stopSampling();
+
+                pm_histogram_t histogram = monitor.getPowerHistogram(-1);
+                EXPECT_GT(histogram.count, 0u);
+                double p50 = monitor.getPowerQuantile(-1, 0.5);
+                double p99 = monitor.getPowerQuantile(-1, 0.99, PM_WEIGHT_TIME);
+                EXPECT_GE(p50, 0.0);
+                EXPECT_GE(p99, 0.0);
+        }) << "Test setup failed during PowerMonitor creation";
+}
+
+// Test case: Sessions are independent of resetStatistics()
+TEST_F(JetPwMonCPPAPITest, MeasurementSessions)
+{
+        ASSERT_NO_THROW({
+                jetpwmon::PowerMonitor monitor;
+                jetpwmon::Session session = monitor.openSession();
+
+                monitor.setSamplingFrequency(100);
+                monitor.startSampling();
+                SleepForSampling(100);
+                monitor.resetStatistics();
+                SleepForSampling(50);
+                monitor.stopSampling();
+
+                jetpwmon::PowerStats global = monitor.getStatistics();
+                jetpwmon::PowerStats interval = session.read(true);
+                EXPECT_GT(interval.getTotal().power.count, global.getTotal().power.count);
+                EXPECT_EQ(monitor.getSensorCount(), interval.getSensorCount());
+
+                // Restarted at the read, so nothing has been sampled since
+                EXPECT_EQ(0u, session.read().getTotal().power.count);
+        }) << "Test setup failed during PowerMonitor creation";
+}
+
 // Test case: Check C enum values are accessible (optional, C header needed)
 TEST_F(JetPwMonCPPAPITest, SensorTypesEnumCheck)
 {
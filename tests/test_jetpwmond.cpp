@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <jetpwmon/jetpwmond.h> // Wire protocol of the daemon
+#include <chrono>              // For deadlines
+#include <thread>              // For std::this_thread::sleep_for
+#include <vector>
+#include <string>
+#include <cstdio>              // For the trace file
+#include <cstring>             // For memcpy
+#include <algorithm>           // For std::max
+#include <csignal>             // For kill
+#include <unistd.h>            // For fork, exec
+#include <poll.h>              // For poll
+#include <sys/socket.h>        // For the client sockets
+#include <sys/un.h>
+#include <sys/wait.h>          // For waitpid
+
+#ifndef JETPWMOND_PATH
+#define JETPWMOND_PATH "jetpwmond"
+#endif
+
+namespace {
+
+constexpr int kRails = 8;                    // Rails of the trace, R1 always offline
+constexpr uint64_t kTotal = 1ULL << PMD_RAIL_TOTAL;
+
+struct Frame {
+    pmd_frame_header_t header;
+    std::vector<unsigned char> payload;
+};
+
+// Read exactly length bytes, waiting at most until deadline
+bool ReadExact(int fd, void* buffer, size_t length, std::chrono::steady_clock::time_point deadline) {
+    auto* bytes = static_cast<unsigned char*>(buffer);
+    size_t done = 0;
+    while (done < length) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd pfd = {fd, POLLIN, 0};
+        if (left.count() <= 0 || poll(&pfd, 1, static_cast<int>(left.count())) <= 0) {
+            return false;
+        }
+        ssize_t n = recv(fd, bytes + done, length - done, 0);
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ReadFrame(int fd, Frame* frame, int timeout_ms = 2000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    if (!ReadExact(fd, &frame->header, sizeof(frame->header), deadline)) {
+        return false;
+    }
+    frame->payload.resize(frame->header.length);
+    return ReadExact(fd, frame->payload.data(), frame->payload.size(), deadline);
+}
+
+void Subscribe(int fd, uint64_t rails, uint32_t decimation) {
+    pmd_frame_header_t header = {sizeof(pmd_subscribe_t), PMD_MSG_SUBSCRIBE, PMD_PROTOCOL_VERSION};
+    pmd_subscribe_t sub = {rails, decimation, 0};
+    unsigned char message[sizeof(header) + sizeof(sub)];
+    memcpy(message, &header, sizeof(header));
+    memcpy(message + sizeof(header), &sub, sizeof(sub));
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(message)), send(fd, message, sizeof(message), MSG_NOSIGNAL));
+}
+
+// A PMD_MSG_SAMPLES frame split into its parts
+struct Batch {
+    pmd_samples_t samples;
+    std::vector<pmd_tick_t> ticks;
+    std::vector<std::vector<pmd_reading_t>> readings;
+};
+
+bool ParseBatch(const Frame& frame, Batch* batch) {
+    if (frame.header.type != PMD_MSG_SAMPLES || frame.payload.size() < sizeof(pmd_samples_t)) {
+        return false;
+    }
+    memcpy(&batch->samples, frame.payload.data(), sizeof(pmd_samples_t));
+    size_t channels = static_cast<size_t>(__builtin_popcountll(batch->samples.rails));
+    size_t record = sizeof(pmd_tick_t) + channels * sizeof(pmd_reading_t);
+    if (frame.payload.size() != sizeof(pmd_samples_t) + batch->samples.tick_count * record) {
+        return false;
+    }
+
+    batch->ticks.resize(batch->samples.tick_count);
+    batch->readings.assign(batch->samples.tick_count, std::vector<pmd_reading_t>(channels));
+    const unsigned char* p = frame.payload.data() + sizeof(pmd_samples_t);
+    for (uint32_t i = 0; i < batch->samples.tick_count; ++i) {
+        memcpy(&batch->ticks[i], p, sizeof(pmd_tick_t));
+        p += sizeof(pmd_tick_t);
+        if (channels > 0) {
+            memcpy(batch->readings[i].data(), p, channels * sizeof(pmd_reading_t));
+        }
+        p += channels * sizeof(pmd_reading_t);
+    }
+    return true;
+}
+
+} // namespace
+
+// Test fixture running jetpwmond on a looping CSV trace with a temporary socket
+class JetPwMonDaemonTest : public ::testing::Test {
+protected:
+    pid_t daemon_ = -1;
+    std::string trace_;
+    std::string socket_;
+
+    void SetUp() override {
+        std::string base = "/tmp/jetpwmond_test_" + std::to_string(getpid());
+        trace_ = base + ".csv";
+        socket_ = base + ".sock";
+
+        // Rails R0..R7 at 5 V and (i + 1) * 100 mA, R1 has no readings
+        FILE* fp = fopen(trace_.c_str(), "w");
+        ASSERT_NE(nullptr, fp);
+        fprintf(fp, "time_s");
+        for (int i = 0; i < kRails; ++i) {
+            fprintf(fp, ",R%d_V,R%d_A", i, i);
+        }
+        fprintf(fp, "\n");
+        for (int row = 0; row < 100; ++row) {
+            fprintf(fp, "%.3f", row * 0.001);
+            for (int i = 0; i < kRails; ++i) {
+                if (i == 1) {
+                    fprintf(fp, ",,");
+                } else {
+                    fprintf(fp, ",5.0,%.1f", (i + 1) * 0.1);
+                }
+            }
+            fprintf(fp, "\n");
+        }
+        fclose(fp);
+
+        // A small output buffer, so a stalled client falls behind quickly
+        daemon_ = fork();
+        ASSERT_GE(daemon_, 0);
+        if (daemon_ == 0) {
+            setenv("JETPWMON_REPLAY", trace_.c_str(), 1);
+            setenv("JETPWMON_REPLAY_LOOP", "1", 1);
+            execl(JETPWMOND_PATH, "jetpwmond", "-s", socket_.c_str(), "-f", "5000", "-b", "10", "-q", "16",
+                  static_cast<char*>(nullptr));
+            _exit(127);
+        }
+    }
+
+    void TearDown() override {
+        if (daemon_ > 0) {
+            kill(daemon_, SIGTERM);
+            int status = 0;
+            EXPECT_EQ(daemon_, waitpid(daemon_, &status, 0));
+            EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "jetpwmond did not stop cleanly";
+        }
+        unlink(trace_.c_str());
+        unlink(socket_.c_str());
+    }
+
+    // Connect once the daemon listens and check its HELLO
+    int Connect() {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_.c_str());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                Frame hello;
+                EXPECT_TRUE(ReadFrame(fd, &hello));
+                EXPECT_EQ(PMD_MSG_HELLO, hello.header.type);
+                EXPECT_EQ(PMD_PROTOCOL_VERSION, hello.header.version);
+                EXPECT_EQ(sizeof(pmd_hello_t) + (kRails + 1) * 64u, hello.header.length);
+                if (hello.payload.size() == sizeof(pmd_hello_t) + (kRails + 1) * 64u) {
+                    pmd_hello_t info;
+                    memcpy(&info, hello.payload.data(), sizeof(info));
+                    EXPECT_EQ(200000u, info.period_ns);
+                    EXPECT_EQ(static_cast<uint32_t>(kRails), info.rail_count);
+                    EXPECT_STREQ("R1", reinterpret_cast<const char*>(hello.payload.data() + sizeof(info) + 64));
+                }
+                return fd;
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return -1;
+    }
+};
+
+// Test case: Rail filtering, decimation, offline masks and backpressure of a stalled client
+TEST_F(JetPwMonDaemonTest, FastAndStalledClients) {
+    int fast = Connect();
+    ASSERT_GE(fast, 0) << "jetpwmond did not accept connections";
+    int single = Connect();
+    ASSERT_GE(single, 0);
+    int stalled = Connect();
+    ASSERT_GE(stalled, 0);
+
+    const uint64_t fast_rails = 1ULL | 1ULL << 1 | kTotal;
+    Subscribe(fast, fast_rails, 2);
+    Subscribe(single, 1ULL << 3, 1);
+    Subscribe(stalled, ((1ULL << kRails) - 1) | kTotal, 1);
+
+    // The fast clients read every batch while the stalled one reads nothing
+    uint64_t fast_ticks = 0, single_ticks = 0;
+    uint64_t last_fast = 0, last_single = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+    while (std::chrono::steady_clock::now() < end) {
+        pollfd pfds[2] = {{fast, POLLIN, 0}, {single, POLLIN, 0}};
+        ASSERT_GT(poll(pfds, 2, 1000), 0) << "No batch within a second";
+
+        Frame frame;
+        Batch batch;
+        if (pfds[0].revents & POLLIN) {
+            ASSERT_TRUE(ReadFrame(fast, &frame));
+            ASSERT_TRUE(ParseBatch(frame, &batch));
+            EXPECT_EQ(fast_rails, batch.samples.rails);
+            EXPECT_EQ(0u, batch.samples.dropped);
+            ASSERT_GE(batch.samples.decimation, 2u);
+            EXPECT_EQ(0u, batch.samples.decimation % 2);
+            for (uint32_t i = 0; i < batch.samples.tick_count; ++i) {
+                const pmd_tick_t& tick = batch.ticks[i];
+                EXPECT_EQ(0u, tick.tick % batch.samples.decimation);
+                EXPECT_TRUE(fast_ticks == 0 || tick.tick > last_fast);
+                last_fast = tick.tick;
+                fast_ticks++;
+
+                // R1 and with it the total are offline; readings follow the mask order
+                EXPECT_EQ(1ULL << 1 | kTotal, tick.offline);
+                EXPECT_NEAR(5.0f, batch.readings[i][0].voltage, 1e-3);
+                EXPECT_NEAR(0.5f, batch.readings[i][0].power, 1e-3);
+                EXPECT_EQ(0.0f, batch.readings[i][1].power);
+            }
+        }
+        if (pfds[1].revents & POLLIN) {
+            ASSERT_TRUE(ReadFrame(single, &frame));
+            ASSERT_TRUE(ParseBatch(frame, &batch));
+            EXPECT_EQ(1ULL << 3, batch.samples.rails);
+            EXPECT_EQ(0u, batch.samples.dropped);
+            for (uint32_t i = 0; i < batch.samples.tick_count; ++i) {
+                // Offline rails outside the subscription are masked out
+                EXPECT_EQ(0u, batch.ticks[i].offline);
+                EXPECT_NEAR(2.0f, batch.readings[i][0].power, 1e-3);
+                EXPECT_TRUE(single_ticks == 0 || batch.ticks[i].tick > last_single);
+                last_single = batch.ticks[i].tick;
+                single_ticks++;
+            }
+        }
+    }
+    EXPECT_GT(fast_ticks, 1000u);
+    EXPECT_GT(single_ticks, 2000u);
+
+    // What the stalled client finds once it reads again: the backlog, then thinned and dropped ticks
+    uint64_t dropped = 0;
+    uint32_t max_decimation = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (dropped == 0 && std::chrono::steady_clock::now() < deadline) {
+        Frame frame;
+        Batch batch;
+        ASSERT_TRUE(ReadFrame(stalled, &frame));
+        ASSERT_TRUE(ParseBatch(frame, &batch));
+        EXPECT_GE(batch.samples.dropped, dropped);
+        dropped = batch.samples.dropped;
+        max_decimation = std::max(max_decimation, batch.samples.decimation);
+        for (uint32_t i = 0; i < batch.samples.tick_count; ++i) {
+            EXPECT_EQ(1ULL << 1 | kTotal, batch.ticks[i].offline);
+            EXPECT_EQ(static_cast<size_t>(kRails + 1), batch.readings[i].size());
+        }
+    }
+    EXPECT_GT(dropped, 0u) << "The stalled client never had ticks dropped";
+    EXPECT_GT(max_decimation, 1u) << "The stalled client's decimation was never raised";
+
+    close(fast);
+    close(single);
+    close(stalled);
+}